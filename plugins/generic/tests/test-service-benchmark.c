@@ -0,0 +1,570 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+/*
+ * Startup and hotplug latency benchmark.
+ *
+ * Announces N virtual modems at once, each one backed by its own emulated
+ * AT port, and measures for each of them the time from the port
+ * announcement until the modem is exported in the bus, until it is enabled
+ * and until it is connected. The CPU time used and the memory used by the
+ * daemon are reported as well. Results are printed as a single JSON object.
+ *
+ * When run as part of the test suite a single modem is used; any other number
+ * of modems may be given when run by hand, e.g.:
+ *   $ ./test-service-benchmark --modems=64 --latency=20 --output=results.json
+ */
+
+#include <sys/types.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include <libmm-glib.h>
+
+#include "test-port-context.h"
+#include "test-fixture.h"
+
+#define MAX_MODEMS      256
+#define PROFILE_PREFIX  "benchmark-"
+#define BENCHMARK_APN   "internet"
+
+/* Options */
+static gint     n_modems = 1;
+static gint     latency;
+static gint     timeout = 120;
+static gchar  **commands_files;
+static gchar   *output_file;
+
+static GOptionEntry entries[] = {
+    { "modems", 'n', 0, G_OPTION_ARG_INT, &n_modems,
+      "Number of virtual modems to announce (1-256, default 1)", "[N]" },
+    { "latency", 'l', 0, G_OPTION_ARG_INT, &latency,
+      "Latency of every AT response, in milliseconds (default 0)", "[MS]" },
+    { "commands", 'c', 0, G_OPTION_ARG_FILENAME_ARRAY, &commands_files,
+      "Additional commands file to load in every port", "[PATH]" },
+    { "timeout", 't', 0, G_OPTION_ARG_INT, &timeout,
+      "Maximum time to wait for all modems, in seconds (default 120)", "[S]" },
+    { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output_file,
+      "Write results to the given file instead of stdout", "[PATH]" },
+    { NULL }
+};
+
+/* Commands needed to connect, on top of the common GSM port ones */
+static const gchar *connect_commands[][2] = {
+    { "AT+CGDCONT?",                  "\\r\\n+CGDCONT: 1,\"IP\",\"" BENCHMARK_APN "\",\"0.0.0.0\",0,0\\r\\n\\r\\nOK\\r\\n" },
+    { "AT+CGDCONT=1,\"IP\",\"" BENCHMARK_APN "\"", "\\r\\nOK\\r\\n" },
+    { "AT+CGACT?",                    "\\r\\n+CGACT: 1,0\\r\\n\\r\\nOK\\r\\n" },
+    { "ATD*99***1#",                  "\\r\\nCONNECT\\r\\n" },
+};
+
+/*****************************************************************************/
+
+typedef struct {
+    guint            index;
+    gchar           *port;
+    TestPortContext *port_context;
+    MMObject        *object;
+    gint64           announced;
+    gint64           exported;
+    gint64           enabled;
+    gint64           connected;
+    gchar           *error;
+} BenchmarkModem;
+
+typedef struct {
+    GMainLoop      *loop;
+    TestFixture    *fixture;
+    MMManager      *manager;
+    BenchmarkModem *modems;
+    guint           n_modems;
+    guint           n_pending;
+    /* Operations still running, cancelled when the benchmark is over */
+    GCancellable   *cancellable;
+    guint           n_operations;
+} BenchmarkContext;
+
+typedef struct {
+    guint64 cpu_ms;
+    guint64 rss_kb;
+    guint64 hwm_kb;
+} DaemonStats;
+
+static void
+benchmark_modem_done (BenchmarkContext *ctx,
+                      BenchmarkModem   *modem,
+                      const GError     *error)
+{
+    /* Operations cancelled once the benchmark is over aren't reported */
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+
+    if (error) {
+        modem->error = g_strdup (error->message);
+        g_message ("benchmark modem %u failed: %s", modem->index, error->message);
+    }
+
+    g_assert_cmpuint (ctx->n_pending, >, 0);
+    if (--ctx->n_pending == 0)
+        g_main_loop_quit (ctx->loop);
+}
+
+/*****************************************************************************/
+/* Daemon stats, read from procfs */
+
+static guint
+get_daemon_pid (TestFixture *fixture)
+{
+    GError   *error = NULL;
+    GVariant *result;
+    guint     pid;
+
+    result = g_dbus_connection_call_sync (fixture->connection,
+                                          "org.freedesktop.DBus",
+                                          "/org/freedesktop/DBus",
+                                          "org.freedesktop.DBus",
+                                          "GetConnectionUnixProcessID",
+                                          g_variant_new ("(s)", "org.freedesktop.ModemManager1"),
+                                          G_VARIANT_TYPE ("(u)"),
+                                          G_DBUS_CALL_FLAGS_NONE,
+                                          -1,
+                                          NULL,
+                                          &error);
+    if (!result)
+        g_error ("Couldn't get ModemManager process ID: %s", error->message);
+    g_variant_get (result, "(u)", &pid);
+    g_variant_unref (result);
+    return pid;
+}
+
+static void
+get_daemon_stats (guint        pid,
+                  DaemonStats *stats)
+{
+    g_autofree gchar  *path = NULL;
+    g_autofree gchar  *contents = NULL;
+    g_auto(GStrv)      fields = NULL;
+    const gchar       *aux;
+
+    memset (stats, 0, sizeof (DaemonStats));
+
+    /* utime and stime are fields 14 and 15; the command name in field 2 may
+     * have spaces, so split after its closing parenthesis */
+    path = g_strdup_printf ("/proc/%u/stat", pid);
+    if (g_file_get_contents (path, &contents, NULL, NULL) &&
+        (aux = strrchr (contents, ')')) != NULL) {
+        fields = g_strsplit (aux + 2, " ", -1);
+        if (g_strv_length (fields) > 12)
+            stats->cpu_ms = ((g_ascii_strtoull (fields[11], NULL, 10) +
+                              g_ascii_strtoull (fields[12], NULL, 10)) * 1000) / sysconf (_SC_CLK_TCK);
+    }
+    g_clear_pointer (&path, g_free);
+    g_clear_pointer (&contents, g_free);
+
+    path = g_strdup_printf ("/proc/%u/status", pid);
+    if (g_file_get_contents (path, &contents, NULL, NULL)) {
+        if ((aux = strstr (contents, "\nVmRSS:")) != NULL)
+            stats->rss_kb = g_ascii_strtoull (aux + strlen ("\nVmRSS:"), NULL, 10);
+        if ((aux = strstr (contents, "\nVmHWM:")) != NULL)
+            stats->hwm_kb = g_ascii_strtoull (aux + strlen ("\nVmHWM:"), NULL, 10);
+    }
+}
+
+/*****************************************************************************/
+/* Per-modem sequence: exported -> enabled -> connected */
+
+typedef struct {
+    BenchmarkContext *ctx;
+    BenchmarkModem   *modem;
+} ModemOperation;
+
+static ModemOperation *
+modem_operation_new (BenchmarkContext *ctx,
+                     BenchmarkModem   *modem)
+{
+    ModemOperation *op;
+
+    op = g_slice_new (ModemOperation);
+    op->ctx = ctx;
+    op->modem = modem;
+    ctx->n_operations++;
+    return op;
+}
+
+static void
+modem_operation_free (ModemOperation *op)
+{
+    g_assert_cmpuint (op->ctx->n_operations, >, 0);
+    op->ctx->n_operations--;
+    g_slice_free (ModemOperation, op);
+}
+
+static void
+connect_ready (MMModemSimple  *simple,
+               GAsyncResult   *res,
+               ModemOperation *op)
+{
+    GError   *error = NULL;
+    MMBearer *bearer;
+
+    bearer = mm_modem_simple_connect_finish (simple, res, &error);
+    if (bearer) {
+        op->modem->connected = g_get_monotonic_time ();
+        g_object_unref (bearer);
+    }
+    benchmark_modem_done (op->ctx, op->modem, error);
+    g_clear_error (&error);
+    modem_operation_free (op);
+}
+
+static void
+enable_ready (MMModem        *modem,
+              GAsyncResult   *res,
+              ModemOperation *op)
+{
+    GError                    *error = NULL;
+    MMModemSimple             *simple;
+    MMSimpleConnectProperties *properties;
+
+    if (!mm_modem_enable_finish (modem, res, &error)) {
+        benchmark_modem_done (op->ctx, op->modem, error);
+        g_error_free (error);
+        modem_operation_free (op);
+        return;
+    }
+
+    op->modem->enabled = g_get_monotonic_time ();
+
+    simple = mm_object_get_modem_simple (op->modem->object);
+    g_assert (simple);
+    properties = mm_simple_connect_properties_new ();
+    mm_simple_connect_properties_set_apn (properties, BENCHMARK_APN);
+    mm_modem_simple_connect (simple,
+                             properties,
+                             op->ctx->cancellable,
+                             (GAsyncReadyCallback)connect_ready,
+                             op);
+    g_object_unref (properties);
+    g_object_unref (simple);
+}
+
+static void
+object_added_cb (MMManager        *manager,
+                 MMObject         *object,
+                 BenchmarkContext *ctx)
+{
+    MMModem        *modem;
+    const gchar    *device;
+    guint64         index;
+    ModemOperation *op;
+
+    modem = mm_object_peek_modem (object);
+    if (!modem)
+        return;
+
+    device = mm_modem_get_device (modem);
+    if (!device || !g_str_has_prefix (device, "/virtual/" PROFILE_PREFIX))
+        return;
+
+    index = g_ascii_strtoull (device + strlen ("/virtual/" PROFILE_PREFIX), NULL, 10);
+    g_assert_cmpuint (index, <, ctx->n_modems);
+    g_assert (!ctx->modems[index].object);
+
+    ctx->modems[index].exported = g_get_monotonic_time ();
+    ctx->modems[index].object = g_object_ref (object);
+
+    op = modem_operation_new (ctx, &ctx->modems[index]);
+    mm_modem_enable (modem, ctx->cancellable, (GAsyncReadyCallback)enable_ready, op);
+}
+
+static void
+set_profile_ready (MmGdbusTest    *test,
+                   GAsyncResult   *res,
+                   ModemOperation *op)
+{
+    GError *error = NULL;
+
+    if (!mm_gdbus_test_call_set_profile_finish (test, res, &error) &&
+        !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_error ("Error setting test profile for modem %u: %s", op->modem->index, error->message);
+    g_clear_error (&error);
+    modem_operation_free (op);
+}
+
+static gboolean
+benchmark_timeout_cb (BenchmarkContext *ctx)
+{
+    g_message ("benchmark timed out with %u modems pending", ctx->n_pending);
+    g_main_loop_quit (ctx->loop);
+    return G_SOURCE_REMOVE;
+}
+
+/*****************************************************************************/
+/* Results */
+
+static gint
+compare_gint64 (const gint64 *a,
+                const gint64 *b)
+{
+    return (*a > *b) - (*a < *b);
+}
+
+static void
+append_summary (GString          *str,
+                BenchmarkContext *ctx,
+                const gchar      *name,
+                gsize             offset)
+{
+    g_autoptr(GArray) values = NULL;
+    gint64            sum = 0;
+    guint             i;
+
+    values = g_array_new (FALSE, FALSE, sizeof (gint64));
+    for (i = 0; i < ctx->n_modems; i++) {
+        gint64 timestamp;
+        gint64 value;
+
+        timestamp = G_STRUCT_MEMBER (gint64, &ctx->modems[i], offset);
+        if (!timestamp)
+            continue;
+        value = (timestamp - ctx->modems[i].announced) / 1000;
+        g_array_append_val (values, value);
+        sum += value;
+    }
+
+    g_string_append_printf (str, "    \"%s\": { \"count\": %u", name, values->len);
+    if (values->len) {
+        g_array_sort (values, (GCompareFunc)compare_gint64);
+        g_string_append_printf (str,
+                                ", \"min-ms\": %" G_GINT64_FORMAT
+                                ", \"median-ms\": %" G_GINT64_FORMAT
+                                ", \"mean-ms\": %" G_GINT64_FORMAT
+                                ", \"max-ms\": %" G_GINT64_FORMAT,
+                                g_array_index (values, gint64, 0),
+                                g_array_index (values, gint64, values->len / 2),
+                                sum / values->len,
+                                g_array_index (values, gint64, values->len - 1));
+    }
+    g_string_append (str, " }");
+}
+
+static void
+append_time (GString *str,
+             gint64   announced,
+             gint64   timestamp)
+{
+    if (timestamp)
+        g_string_append_printf (str, "%" G_GINT64_FORMAT, (timestamp - announced) / 1000);
+    else
+        g_string_append (str, "null");
+}
+
+static gchar *
+build_results (BenchmarkContext  *ctx,
+               gint64             total_ms,
+               const DaemonStats *before,
+               const DaemonStats *after)
+{
+    GString *str;
+    guint    i;
+
+    str = g_string_new ("{\n");
+    g_string_append_printf (str,
+                            "  \"modems\": %u,\n"
+                            "  \"latency-ms\": %d,\n"
+                            "  \"total-ms\": %" G_GINT64_FORMAT ",\n",
+                            ctx->n_modems, latency, total_ms);
+    g_string_append_printf (str,
+                            "  \"daemon\": { \"cpu-ms\": %" G_GUINT64_FORMAT
+                            ", \"startup-cpu-ms\": %" G_GUINT64_FORMAT
+                            ", \"rss-kb\": %" G_GUINT64_FORMAT
+                            ", \"startup-rss-kb\": %" G_GUINT64_FORMAT
+                            ", \"peak-rss-kb\": %" G_GUINT64_FORMAT " },\n",
+                            after->cpu_ms - before->cpu_ms, before->cpu_ms,
+                            after->rss_kb, before->rss_kb, after->hwm_kb);
+
+    g_string_append (str, "  \"summary\": {\n");
+    append_summary (str, ctx, "exported", G_STRUCT_OFFSET (BenchmarkModem, exported));
+    g_string_append (str, ",\n");
+    append_summary (str, ctx, "enabled", G_STRUCT_OFFSET (BenchmarkModem, enabled));
+    g_string_append (str, ",\n");
+    append_summary (str, ctx, "connected", G_STRUCT_OFFSET (BenchmarkModem, connected));
+    g_string_append (str, "\n  },\n");
+
+    g_string_append (str, "  \"results\": [\n");
+    for (i = 0; i < ctx->n_modems; i++) {
+        BenchmarkModem *modem = &ctx->modems[i];
+
+        g_string_append_printf (str, "    { \"index\": %u, \"exported-ms\": ", modem->index);
+        append_time (str, modem->announced, modem->exported);
+        g_string_append (str, ", \"enabled-ms\": ");
+        append_time (str, modem->announced, modem->enabled);
+        g_string_append (str, ", \"connected-ms\": ");
+        append_time (str, modem->announced, modem->connected);
+        if (modem->error) {
+            g_autofree gchar *escaped = NULL;
+
+            escaped = g_strescape (modem->error, NULL);
+            g_string_append_printf (str, ", \"error\": \"%s\"", escaped);
+        }
+        g_string_append_printf (str, " }%s\n", (i + 1) < ctx->n_modems ? "," : "");
+    }
+    g_string_append (str, "  ]\n}\n");
+
+    return g_string_free (str, FALSE);
+}
+
+/*****************************************************************************/
+
+static void
+test_benchmark (TestFixture *fixture)
+{
+    GError           *error = NULL;
+    BenchmarkContext  ctx = { 0 };
+    DaemonStats       before;
+    DaemonStats       after;
+    guint             pid;
+    guint             timeout_id;
+    gint64            start;
+    g_autofree gchar *results = NULL;
+    guint             i;
+    guint             j;
+
+    ctx.fixture = fixture;
+    ctx.cancellable = g_cancellable_new ();
+    ctx.n_modems = n_modems;
+    ctx.modems = g_new0 (BenchmarkModem, ctx.n_modems);
+
+    /* Setup and start all port contexts before announcing anything */
+    for (i = 0; i < ctx.n_modems; i++) {
+        BenchmarkModem *modem = &ctx.modems[i];
+
+        modem->index = i;
+        modem->port = g_strdup_printf ("abstract:benchmark%u:%ld", i, (glong) getpid ());
+        modem->port_context = test_port_context_new (modem->port);
+        test_port_context_load_commands (modem->port_context, COMMON_GSM_PORT_CONF);
+        for (j = 0; j < G_N_ELEMENTS (connect_commands); j++)
+            test_port_context_set_command (modem->port_context, connect_commands[j][0], connect_commands[j][1]);
+        for (j = 0; commands_files && commands_files[j]; j++)
+            test_port_context_load_commands (modem->port_context, commands_files[j]);
+        test_port_context_set_latency (modem->port_context, (guint) latency);
+        test_port_context_start (modem->port_context);
+    }
+
+    test_fixture_no_modem (fixture);
+
+    ctx.manager = mm_manager_new_sync (fixture->connection,
+                                       G_DBUS_OBJECT_MANAGER_CLIENT_FLAGS_NONE,
+                                       NULL,
+                                       &error);
+    if (!ctx.manager)
+        g_error ("Couldn't create manager: %s", error->message);
+    g_signal_connect (ctx.manager, "object-added", G_CALLBACK (object_added_cb), &ctx);
+
+    pid = get_daemon_pid (fixture);
+    get_daemon_stats (pid, &before);
+
+    /* Announce all ports at once */
+    ctx.loop = g_main_loop_new (NULL, FALSE);
+    ctx.n_pending = ctx.n_modems;
+    start = g_get_monotonic_time ();
+    for (i = 0; i < ctx.n_modems; i++) {
+        BenchmarkModem   *modem = &ctx.modems[i];
+        g_autofree gchar *profile = NULL;
+        const gchar      *ports[] = { modem->port, NULL };
+
+        profile = g_strdup_printf (PROFILE_PREFIX "%u", i);
+        modem->announced = g_get_monotonic_time ();
+        mm_gdbus_test_call_set_profile (fixture->test,
+                                        profile,
+                                        "generic",
+                                        ports,
+                                        ctx.cancellable,
+                                        (GAsyncReadyCallback)set_profile_ready,
+                                        modem_operation_new (&ctx, modem));
+    }
+
+    timeout_id = g_timeout_add_seconds (timeout, (GSourceFunc)benchmark_timeout_cb, &ctx);
+    g_main_loop_run (ctx.loop);
+    if (!ctx.n_pending)
+        g_source_remove (timeout_id);
+
+    get_daemon_stats (pid, &after);
+
+    /* Cancel whatever is still running after a timeout, and wait for all
+     * callbacks to finish, as they all reference the context */
+    g_signal_handlers_disconnect_by_func (ctx.manager, object_added_cb, &ctx);
+    g_cancellable_cancel (ctx.cancellable);
+    while (ctx.n_operations > 0)
+        g_main_context_iteration (NULL, TRUE);
+
+    results = build_results (&ctx, (g_get_monotonic_time () - start) / 1000, &before, &after);
+    if (output_file) {
+        if (!g_file_set_contents (output_file, results, -1, &error))
+            g_error ("Couldn't write results to '%s': %s", output_file, error->message);
+    } else
+        g_print ("%s", results);
+
+    /* Connection may not be supported by every commands file, but all modems
+     * must have been exported and enabled */
+    for (i = 0; i < ctx.n_modems; i++) {
+        g_assert (ctx.modems[i].exported);
+        g_assert (ctx.modems[i].enabled);
+    }
+
+    g_object_unref (ctx.manager);
+    g_main_loop_unref (ctx.loop);
+    g_object_unref (ctx.cancellable);
+
+    for (i = 0; i < ctx.n_modems; i++) {
+        BenchmarkModem *modem = &ctx.modems[i];
+
+        g_clear_object (&modem->object);
+        test_port_context_stop (modem->port_context);
+        test_port_context_free (modem->port_context);
+        g_free (modem->port);
+        g_free (modem->error);
+    }
+    g_free (ctx.modems);
+}
+
+/*****************************************************************************/
+
+int main (int   argc,
+          char *argv[])
+{
+    GOptionContext *context;
+    GError         *error = NULL;
+
+    g_test_init (&argc, &argv, NULL);
+
+    context = g_option_context_new ("- ModemManager startup and hotplug benchmark");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+        g_error ("Couldn't parse options: %s", error->message);
+    g_option_context_free (context);
+
+    if (n_modems < 1 || n_modems > MAX_MODEMS)
+        g_error ("Number of modems must be between 1 and %u", MAX_MODEMS);
+    if (latency < 0)
+        g_error ("Latency must not be negative");
+    if (timeout <= 0)
+        g_error ("Timeout must be positive");
+
+    TEST_ADD ("/MM/Service/Generic/benchmark", test_benchmark);
+
+    return g_test_run ();
+}
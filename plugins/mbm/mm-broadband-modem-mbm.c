@@ -1263,6 +1263,7 @@ gps_enabled_ready (MMBaseModem *self,
                                     3,
                                     FALSE, /* never cached */
                                     FALSE, /* always queued last */
+                                    MM_PORT_SERIAL_PRIORITY_NORMAL,
                                     NULL,
                                     NULL,
                                     NULL);
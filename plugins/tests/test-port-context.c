@@ -15,6 +15,7 @@
 
 #include <gio/gio.h>
 #include <gio/gunixsocketaddress.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "test-port-context.h"
@@ -33,6 +34,8 @@ struct _TestPortContext {
     GSocketService *socket_service;
     GList *clients;
     GHashTable *commands;
+    GHashTable *latencies;
+    guint latency;
 };
 
 /*****************************************************************************/
@@ -47,6 +50,37 @@ test_port_context_set_command (TestPortContext *self,
     g_hash_table_replace (self->commands, g_strdup (command), g_strcompress (response));
 }
 
+void
+test_port_context_set_latency (TestPortContext *self,
+                               guint latency)
+{
+    self->latency = latency;
+}
+
+void
+test_port_context_set_command_latency (TestPortContext *self,
+                                       const gchar *command,
+                                       guint latency)
+{
+    if (G_UNLIKELY (!self->latencies))
+        self->latencies = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    g_hash_table_replace (self->latencies, g_strdup (command), GUINT_TO_POINTER (latency));
+}
+
+static void
+load_directive (TestPortContext *self,
+                gchar *directive)
+{
+    gchar **split;
+
+    /* Only '!latency <command> <milliseconds>' supported for now */
+    split = g_strsplit_set (directive, " ", -1);
+    if (g_strv_length (split) != 3 || !g_str_equal (split[0], "!latency"))
+        g_error ("Invalid directive in commands file: '%s'", directive);
+    test_port_context_set_command_latency (self, split[1], (guint) atoi (split[2]));
+    g_strfreev (split);
+}
+
 void
 test_port_context_load_commands (TestPortContext *self,
                                  const gchar *file)
@@ -71,7 +105,9 @@ test_port_context_load_commands (TestPortContext *self,
         }
 
         g_strstrip (current);
-        if (current[0] != '\0' && current[0] != '#') {
+        if (current[0] == '!')
+            load_directive (self, current);
+        else if (current[0] != '\0' && current[0] != '#') {
             gchar *response;
 
             response = current;
@@ -94,11 +130,13 @@ test_port_context_load_commands (TestPortContext *self,
 
 static const gchar *
 process_next_command (TestPortContext *ctx,
-                      GByteArray *buffer)
+                      GByteArray *buffer,
+                      guint *latency)
 {
     gsize i = 0;
     gchar *command;
     const gchar *response;
+    gpointer command_latency;
     static const gchar *error_response = "\r\nERROR\r\n";
 
     /* Find command end */
@@ -114,6 +152,10 @@ process_next_command (TestPortContext *ctx,
     /* Setup command and lookup response */
     command = g_strndup ((gchar *)buffer->data, i);
     response = g_hash_table_lookup (ctx->commands, command);
+    if (ctx->latencies && g_hash_table_lookup_extended (ctx->latencies, command, NULL, &command_latency))
+        *latency = GPOINTER_TO_UINT (command_latency);
+    else
+        *latency = ctx->latency;
     g_free (command);
 
     /* Remove command from buffer */
@@ -129,11 +171,30 @@ typedef struct {
     GSocketConnection *connection;
     GSource *connection_readable_source;
     GByteArray *buffer;
+    /* Delayed responses, in order */
+    GQueue *pending;
+    GSource *pending_source;
 } Client;
 
+typedef struct {
+    const gchar *response;
+    gint64 due;
+} PendingResponse;
+
+static void
+pending_response_free (PendingResponse *pending)
+{
+    g_slice_free (PendingResponse, pending);
+}
+
 static void
 client_free (Client *client)
 {
+    if (client->pending_source) {
+        g_source_destroy (client->pending_source);
+        g_source_unref (client->pending_source);
+    }
+    g_queue_free_full (client->pending, (GDestroyNotify)pending_response_free);
     g_source_destroy (client->connection_readable_source);
     g_source_unref (client->connection_readable_source);
     g_output_stream_close (g_io_stream_get_output_stream (G_IO_STREAM (client->connection)), NULL, NULL);
@@ -150,27 +211,102 @@ connection_close (Client *client)
     client_free (client);
 }
 
+static void
+client_write_response (Client *client,
+                       const gchar *response)
+{
+    GError *error = NULL;
+
+    if (!g_output_stream_write_all (g_io_stream_get_output_stream (G_IO_STREAM (client->connection)),
+                                    response,
+                                    strlen (response),
+                                    NULL, /* bytes_written */
+                                    NULL, /* cancellable */
+                                    &error)) {
+        g_warning ("Cannot send response to client: %s", error->message);
+        g_error_free (error);
+    }
+}
+
+static void client_schedule_pending (Client *client);
+
+static gboolean
+pending_source_cb (Client *client)
+{
+    PendingResponse *pending;
+    gint64 now;
+
+    g_source_unref (client->pending_source);
+    client->pending_source = NULL;
+
+    now = g_get_monotonic_time ();
+    while ((pending = g_queue_peek_head (client->pending)) != NULL && pending->due <= now) {
+        g_queue_pop_head (client->pending);
+        client_write_response (client, pending->response);
+        pending_response_free (pending);
+    }
+
+    client_schedule_pending (client);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+client_schedule_pending (Client *client)
+{
+    PendingResponse *pending;
+    gint64 now;
+
+    if (client->pending_source)
+        return;
+
+    pending = g_queue_peek_head (client->pending);
+    if (!pending)
+        return;
+
+    now = g_get_monotonic_time ();
+    client->pending_source = g_timeout_source_new (pending->due > now ? (guint)((pending->due - now + 999) / 1000) : 0);
+    g_source_set_callback (client->pending_source,
+                           (GSourceFunc)pending_source_cb,
+                           client,
+                           NULL);
+    g_source_attach (client->pending_source, client->ctx->context);
+}
+
+static void
+client_queue_response (Client *client,
+                       const gchar *response,
+                       guint latency)
+{
+    PendingResponse *pending;
+    PendingResponse *last;
+
+    /* Responses are always sent in the same order as the requests, so a
+     * response never goes out before the ones queued earlier */
+    pending = g_slice_new (PendingResponse);
+    pending->response = response;
+    pending->due = g_get_monotonic_time () + ((gint64) latency * 1000);
+    last = g_queue_peek_tail (client->pending);
+    if (last && last->due > pending->due)
+        pending->due = last->due;
+    g_queue_push_tail (client->pending, pending);
+
+    client_schedule_pending (client);
+}
+
 static void
 client_parse_request (Client *client)
 {
     const gchar *response;
+    guint latency;
 
     do {
-        response = process_next_command (client->ctx, client->buffer);
+        response = process_next_command (client->ctx, client->buffer, &latency);
         if (response) {
-            GError *error = NULL;
-
-            if (!g_output_stream_write_all (g_io_stream_get_output_stream (G_IO_STREAM (client->connection)),
-                                            response,
-                                            strlen (response),
-                                            NULL, /* bytes_written */
-                                            NULL, /* cancellable */
-                                            &error)) {
-                g_warning ("Cannot send response to client: %s", error->message);
-                g_error_free (error);
-            }
+            if (!latency && g_queue_is_empty (client->pending))
+                client_write_response (client, response);
+            else
+                client_queue_response (client, response, latency);
         }
-
     } while (response);
 }
 
@@ -230,6 +366,7 @@ client_new (TestPortContext *self,
     client = g_slice_new0 (Client);
     client->ctx = self;
     client->connection = g_object_ref (connection);
+    client->pending = g_queue_new ();
     client->connection_readable_source = g_socket_create_source (g_socket_connection_get_socket (client->connection),
                                                                  G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP,
                                                                  NULL);
@@ -390,6 +527,8 @@ test_port_context_free (TestPortContext *self)
 
     if (self->commands)
         g_hash_table_unref (self->commands);
+    if (self->latencies)
+        g_hash_table_unref (self->latencies);
     g_list_free_full (self->clients, (GDestroyNotify)client_free);
     if (self->socket) {
         GError *error = NULL;
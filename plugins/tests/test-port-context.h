@@ -32,4 +32,13 @@ void             test_port_context_set_command   (TestPortContext *self,
 void             test_port_context_load_commands (TestPortContext *self,
                                                   const gchar *commands_file);
 
+/* Delay applied to every response, or to the responses of a single command,
+ * in milliseconds. Per-command latencies may also be given in commands files
+ * with '!latency <command> <milliseconds>' lines. */
+void             test_port_context_set_latency         (TestPortContext *self,
+                                                        guint latency);
+void             test_port_context_set_command_latency (TestPortContext *self,
+                                                        const gchar *command,
+                                                        guint latency);
+
 #endif /* TEST_PORT_CONTEXT_H */
@@ -32,8 +32,8 @@
 static void
 common_test (const gchar *plugindir)
 {
-    GArray *rules;
-    GError *error = NULL;
+    MMUdevRules *rules;
+    GError      *error = NULL;
 
     if (!plugindir)
         return;
@@ -41,9 +41,9 @@ common_test (const gchar *plugindir)
     rules = mm_kernel_device_generic_rules_load (plugindir, &error);
     g_assert_no_error (error);
     g_assert (rules);
-    g_assert (rules->len > 0);
+    g_assert (mm_udev_rules_get_n_rules (rules) > 0);
 
-    g_array_unref (rules);
+    mm_udev_rules_unref (rules);
 }
 
 /* Dummy test to avoid compiler warning about common_test() being unused
@@ -1244,10 +1244,11 @@ setup_ports (MMBroadbandModem *self)
     mm_serial_parser_v1_set_custom_regex (parser, regex, NULL);
     g_regex_unref (regex);
 
-    mm_port_serial_at_set_response_parser (MM_PORT_SERIAL_AT (primary),
-                                           mm_serial_parser_v1_parse,
-                                           parser,
-                                           mm_serial_parser_v1_destroy);
+    mm_port_serial_at_set_response_parser_full (MM_PORT_SERIAL_AT (primary),
+                                                mm_serial_parser_v1_parse,
+                                                mm_serial_parser_v1_check_line,
+                                                parser,
+                                                mm_serial_parser_v1_destroy);
 }
 
 /*****************************************************************************/
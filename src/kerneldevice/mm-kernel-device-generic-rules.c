@@ -32,6 +32,9 @@ udev_rule_match_clear (MMUdevRuleMatch *rule_match)
 {
     g_free (rule_match->parameter);
     g_free (rule_match->value);
+    g_free (rule_match->key);
+    g_free (rule_match->pattern.str);
+    g_free (rule_match->prefix_pattern.str);
 }
 
 static void
@@ -56,6 +59,135 @@ udev_rule_clear (MMUdevRule *rule)
         g_array_unref (rule->conditions);
 }
 
+/*****************************************************************************/
+/* Rule preprocessing */
+
+static const struct {
+    const gchar         *name;
+    MMUdevRuleParameter  id;
+} attributes[] = {
+    { "idVendor",           MM_UDEV_RULE_PARAMETER_ATTR_ID_VENDOR          },
+    { "idProduct",          MM_UDEV_RULE_PARAMETER_ATTR_ID_PRODUCT         },
+    { "manufacturer",       MM_UDEV_RULE_PARAMETER_ATTR_MANUFACTURER       },
+    { "product",            MM_UDEV_RULE_PARAMETER_ATTR_PRODUCT            },
+    { "bInterfaceClass",    MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_CLASS    },
+    { "bInterfaceSubClass", MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_SUBCLASS },
+    { "bInterfaceProtocol", MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_PROTOCOL },
+    { "bInterfaceNumber",   MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_NUMBER   },
+};
+
+static MMUdevRuleParameter
+attribute_from_name (const gchar *name)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (attributes); i++) {
+        if (g_str_equal (name, attributes[i].name))
+            return attributes[i].id;
+    }
+    return MM_UDEV_RULE_PARAMETER_ATTR_UNKNOWN;
+}
+
+/* Gets the name within braces in e.g. ATTRS{idVendor} or ENV{ID_MM_CANDIDATE} */
+static gchar *
+parameter_key (const gchar *parameter,
+               gsize        prefix_len)
+{
+    gchar *key;
+
+    key = g_strdup (&parameter[prefix_len]);
+    g_strdelimit (key, "{}", ' ');
+    return g_strstrip (key);
+}
+
+static void
+rule_pattern_init (MMUdevRulePattern *pattern,
+                   const gchar       *str)
+{
+    gsize len;
+
+    pattern->open_prefix = (str[0] == '*');
+    if (pattern->open_prefix)
+        str++;
+
+    len = strlen (str);
+    if (!len)
+        /* a lone '*' matches everything */
+        pattern->open_suffix = pattern->open_prefix;
+    else if (str[len - 1] == '*') {
+        pattern->open_suffix = TRUE;
+        len--;
+    }
+    pattern->str = g_strndup (str, len);
+}
+
+static void
+preprocess_rule_match (MMUdevRuleMatch *rule_match)
+{
+    const gchar *parameter = rule_match->parameter;
+    const gchar *value = rule_match->value;
+
+    if (g_str_equal (parameter, "ACTION")) {
+        rule_match->parameter_id = MM_UDEV_RULE_PARAMETER_ACTION;
+        rule_match->value_valid = !!strstr (value, "add");
+    } else if (g_str_equal (parameter, "SUBSYSTEMS") || g_str_equal (parameter, "SUBSYSTEM"))
+        rule_match->parameter_id = MM_UDEV_RULE_PARAMETER_SUBSYSTEM;
+    else if (g_str_equal (parameter, "DRIVER") || g_str_equal (parameter, "DRIVERS"))
+        rule_match->parameter_id = MM_UDEV_RULE_PARAMETER_DRIVER;
+    else if (g_str_equal (parameter, "KERNEL")) {
+        rule_match->parameter_id = MM_UDEV_RULE_PARAMETER_KERNEL;
+        rule_pattern_init (&rule_match->pattern, value);
+    } else if (g_str_equal (parameter, "DEVPATH")) {
+        rule_match->parameter_id = MM_UDEV_RULE_PARAMETER_DEVPATH;
+        rule_pattern_init (&rule_match->pattern, value);
+        /* If not already doing a prefix match, do an implicit one. This is so that
+         * we can add properties to the usb_device owning all ports, and then apply
+         * the property to all ports individually processed. */
+        if (value[strlen (value) - 1] != '*') {
+            g_autofree gchar *prefix = NULL;
+
+            prefix = g_strdup_printf ("%s/*", value);
+            rule_pattern_init (&rule_match->prefix_pattern, prefix);
+        }
+    } else if (g_str_has_prefix (parameter, "ATTRS")) {
+        rule_match->key = parameter_key (parameter, 5);
+        rule_match->parameter_id = attribute_from_name (rule_match->key);
+        rule_match->value_any = g_str_equal (value, "?*");
+        rule_match->value_valid = mm_get_uint_from_hex_str (value, &rule_match->value_uint);
+    } else if (g_str_has_prefix (parameter, "ENV")) {
+        rule_match->parameter_id = MM_UDEV_RULE_PARAMETER_ENV;
+        rule_match->key = parameter_key (parameter, 3);
+    } else
+        rule_match->parameter_id = MM_UDEV_RULE_PARAMETER_UNKNOWN;
+}
+
+static MMUdevRuleParameter
+result_value_attribute (const gchar *value)
+{
+    MMUdevRuleParameter  attribute;
+    g_autofree gchar    *name = NULL;
+    gsize                len;
+
+    len = strlen (value);
+    if (!g_str_has_prefix (value, "$attr{") || value[len - 1] != '}')
+        return MM_UDEV_RULE_PARAMETER_UNKNOWN;
+
+    /* Only interface attributes are supported in substitutions */
+    name = g_strndup (value + 6, len - 7);
+    attribute = attribute_from_name (name);
+    switch (attribute) {
+    case MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_CLASS:
+    case MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_SUBCLASS:
+    case MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_PROTOCOL:
+    case MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_NUMBER:
+        return attribute;
+    default:
+        return MM_UDEV_RULE_PARAMETER_UNKNOWN;
+    }
+}
+
+/*****************************************************************************/
+
 static gboolean
 split_item (const gchar  *item,
             gchar       **out_left,
@@ -154,6 +286,7 @@ load_rule_result (MMUdevRuleResult  *rule_result,
         rule_result->type = MM_UDEV_RULE_RESULT_TYPE_PROPERTY;
         rule_result->content.property.name = g_strndup (left + 4, left_len - 5);
         rule_result->content.property.value = right;
+        rule_result->content.property.value_attribute = result_value_attribute (right);
         right = NULL;
         goto out;
     }
@@ -203,6 +336,7 @@ load_rule_match (MMUdevRuleMatch  *rule_match,
     g_free (operator);
     rule_match->parameter = left;
     rule_match->value     = right;
+    preprocess_rule_match (rule_match);
     return TRUE;
 }
 
@@ -397,16 +531,428 @@ list_rule_files (const gchar *rules_dir_path)
     return g_list_sort (children, (GCompareFunc) g_strcmp0);
 }
 
-GArray *
+/*****************************************************************************/
+/* Rule evaluation */
+
+/* List of rules to evaluate for a given set of devices, in order */
+typedef struct {
+    guint *rules; /* indices in the array of rules */
+    guint *jumps; /* for GOTO rules, position in this list to continue from */
+    guint  len;
+} RulesIndex;
+
+struct _MMUdevRules {
+    volatile gint  ref_count;
+    GArray        *rules;
+    /* Rules for devices without vendor-specific rules */
+    RulesIndex    *common;
+    /* Vendor id -> RulesIndex */
+    GHashTable    *vendors;
+};
+
+static gboolean
+pattern_match (const MMUdevRulePattern *pattern,
+               const gchar             *str)
+{
+    if (pattern->open_suffix && !pattern->open_prefix)
+        return g_str_has_prefix (str, pattern->str);
+    if (!pattern->open_suffix && pattern->open_prefix)
+        return g_str_has_suffix (str, pattern->str);
+    if (pattern->open_suffix && pattern->open_prefix)
+        return !!strstr (str, pattern->str);
+    return g_str_equal (str, pattern->str);
+}
+
+static gboolean
+check_devpath (const MMUdevRuleMatch *match,
+               const gchar           *sysfs_path,
+               gboolean               condition_equal)
+{
+    /* We allow both a direct match and a prefix match */
+    if (pattern_match (&match->pattern, sysfs_path) == condition_equal)
+        return TRUE;
+    if (match->prefix_pattern.str && pattern_match (&match->prefix_pattern, sysfs_path) == condition_equal)
+        return TRUE;
+    return FALSE;
+}
+
+static gboolean
+check_uint_attribute (const MMUdevRuleMatch *match,
+                      guint                  value,
+                      gboolean               condition_equal)
+{
+    return (match->value_valid && ((value == match->value_uint) == condition_equal));
+}
+
+static gboolean
+check_condition (const MMUdevRuleMatch   *match,
+                 const MMUdevRulesDevice *device)
+{
+    gboolean condition_equal;
+
+    condition_equal = (match->type == MM_UDEV_RULE_MATCH_TYPE_EQUAL);
+
+    switch (match->parameter_id) {
+    case MM_UDEV_RULE_PARAMETER_ACTION:
+        /* We only apply 'add' rules */
+        return (match->value_valid == condition_equal);
+
+    case MM_UDEV_RULE_PARAMETER_SUBSYSTEM:
+        /* We look for the subsystem string in the whole sysfs path.
+         *
+         * Note that we're not really making a difference between "SUBSYSTEMS"
+         * (where the whole device tree is checked) and "SUBSYSTEM" (where just one
+         * single device is checked), because a lot of the MM udev rules are meant
+         * to just tag the physical device (e.g. with ID_MM_DEVICE_IGNORE) instead
+         * of the single ports. In our case with the custom parsing, we do tag all
+         * independent ports.
+         */
+        return ((device->sysfs_path && !!strstr (device->sysfs_path, match->value)) == condition_equal);
+
+    case MM_UDEV_RULE_PARAMETER_DRIVER:
+        /* Exact DRIVER match? We also include the check for DRIVERS, even if we
+         * only apply it to this port driver. */
+        return ((!g_strcmp0 (match->value, device->driver)) == condition_equal);
+
+    case MM_UDEV_RULE_PARAMETER_KERNEL:
+        /* Device name checks */
+        return (pattern_match (&match->pattern, device->name) == condition_equal);
+
+    case MM_UDEV_RULE_PARAMETER_DEVPATH:
+        /* If sysfs path invalid (e.g. path doesn't exist), no match */
+        if (!device->sysfs_path)
+            return FALSE;
+        if (check_devpath (match, device->sysfs_path, condition_equal))
+            return TRUE;
+        return (g_str_has_prefix (device->sysfs_path, "/sys") &&
+                check_devpath (match, &device->sysfs_path[4], condition_equal));
+
+    case MM_UDEV_RULE_PARAMETER_ENV:
+        /* Previously set property checks */
+        return ((!g_strcmp0 ((const gchar *) g_object_get_data (device->object, match->key), match->value)) == condition_equal);
+
+    case MM_UDEV_RULE_PARAMETER_ATTR_ID_VENDOR:
+        return check_uint_attribute (match, device->physdev_vid, condition_equal);
+    case MM_UDEV_RULE_PARAMETER_ATTR_ID_PRODUCT:
+        return check_uint_attribute (match, device->physdev_pid, condition_equal);
+    case MM_UDEV_RULE_PARAMETER_ATTR_MANUFACTURER:
+        return ((device->physdev_manufacturer && g_str_equal (device->physdev_manufacturer, match->value)) == condition_equal);
+    case MM_UDEV_RULE_PARAMETER_ATTR_PRODUCT:
+        return ((device->physdev_product && g_str_equal (device->physdev_product, match->value)) == condition_equal);
+    case MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_CLASS:
+        return (match->value_any || check_uint_attribute (match, device->interface_class, condition_equal));
+    case MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_SUBCLASS:
+        return (match->value_any || check_uint_attribute (match, device->interface_subclass, condition_equal));
+    case MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_PROTOCOL:
+        return (match->value_any || check_uint_attribute (match, device->interface_protocol, condition_equal));
+    case MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_NUMBER:
+        return (match->value_any || check_uint_attribute (match, device->interface_number, condition_equal));
+
+    case MM_UDEV_RULE_PARAMETER_ATTR_UNKNOWN:
+        mm_obj_warn (device->object, "unknown attribute: %s", match->key);
+        return FALSE;
+
+    case MM_UDEV_RULE_PARAMETER_UNKNOWN:
+    default:
+        mm_obj_warn (device->object, "unknown match condition parameter: %s", match->parameter);
+        return FALSE;
+    }
+}
+
+static gboolean
+check_rule (const MMUdevRule        *rule,
+            const MMUdevRulesDevice *device)
+{
+    guint i;
+
+    if (!rule->conditions)
+        return TRUE;
+
+    for (i = 0; i < rule->conditions->len; i++) {
+        if (!check_condition (&g_array_index (rule->conditions, MMUdevRuleMatch, i), device))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+apply_property (const MMUdevRuleResultProperty *property,
+                const MMUdevRulesDevice        *device)
+{
+    gchar *property_value_read = NULL;
+
+    switch (property->value_attribute) {
+    case MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_CLASS:
+        property_value_read = g_strdup_printf ("%02x", device->interface_class);
+        break;
+    case MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_SUBCLASS:
+        property_value_read = g_strdup_printf ("%02x", device->interface_subclass);
+        break;
+    case MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_PROTOCOL:
+        property_value_read = g_strdup_printf ("%02x", device->interface_protocol);
+        break;
+    case MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_NUMBER:
+        property_value_read = g_strdup_printf ("%02x", device->interface_number);
+        break;
+    default:
+        break;
+    }
+
+    /* add new property */
+    mm_obj_dbg (device->object, "property added: %s=%s",
+                property->name,
+                property_value_read ? property_value_read : property->value);
+
+    if (!property_value_read)
+        /* NOTE: the caller keeps a reference to the rules, so it isn't an
+         * issue if we re-use the same string (i.e. without g_strdup-ing it)
+         * as a property value. */
+        g_object_set_data (device->object, property->name, property->value);
+    else
+        g_object_set_data_full (device->object, property->name, property_value_read, g_free);
+}
+
+guint
+mm_udev_rules_apply (MMUdevRules             *self,
+                     const MMUdevRulesDevice *device)
+{
+    const RulesIndex *index;
+    guint             i = 0;
+    guint             n_evaluated = 0;
+
+    index = g_hash_table_lookup (self->vendors, GUINT_TO_POINTER (device->physdev_vid));
+    if (!index)
+        index = self->common;
+
+    while (i < index->len) {
+        const MMUdevRule *rule;
+
+        rule = &g_array_index (self->rules, MMUdevRule, index->rules[i]);
+        n_evaluated++;
+        if (!check_rule (rule, device)) {
+            i++;
+            continue;
+        }
+
+        switch (rule->result.type) {
+        case MM_UDEV_RULE_RESULT_TYPE_PROPERTY:
+            apply_property (&rule->result.content.property, device);
+            i++;
+            break;
+        case MM_UDEV_RULE_RESULT_TYPE_GOTO_INDEX:
+            i = index->jumps[i];
+            break;
+        case MM_UDEV_RULE_RESULT_TYPE_LABEL:
+        case MM_UDEV_RULE_RESULT_TYPE_GOTO_TAG:
+        case MM_UDEV_RULE_RESULT_TYPE_UNKNOWN:
+        default:
+            g_assert_not_reached ();
+        }
+    }
+
+    return n_evaluated;
+}
+
+guint
+mm_udev_rules_apply_unindexed (MMUdevRules             *self,
+                               const MMUdevRulesDevice *device)
+{
+    guint i = 0;
+    guint n_evaluated = 0;
+
+    while (i < self->rules->len) {
+        const MMUdevRule *rule;
+
+        rule = &g_array_index (self->rules, MMUdevRule, i);
+        n_evaluated++;
+        if (!check_rule (rule, device)) {
+            i++;
+            continue;
+        }
+
+        switch (rule->result.type) {
+        case MM_UDEV_RULE_RESULT_TYPE_PROPERTY:
+            apply_property (&rule->result.content.property, device);
+            i++;
+            break;
+        case MM_UDEV_RULE_RESULT_TYPE_LABEL:
+            /* noop */
+            i++;
+            break;
+        case MM_UDEV_RULE_RESULT_TYPE_GOTO_INDEX:
+            /* Jump to a new index */
+            i = rule->result.content.index;
+            break;
+        case MM_UDEV_RULE_RESULT_TYPE_GOTO_TAG:
+        case MM_UDEV_RULE_RESULT_TYPE_UNKNOWN:
+        default:
+            g_assert_not_reached ();
+        }
+    }
+
+    return n_evaluated;
+}
+
+/*****************************************************************************/
+/* Rule indexing */
+
+#define NO_VENDOR G_MAXUINT
+
+static void
+rules_index_free (RulesIndex *index)
+{
+    g_free (index->rules);
+    g_free (index->jumps);
+    g_slice_free (RulesIndex, index);
+}
+
+/* Returns the vendor id a rule is constrained to, or NO_VENDOR if the rule
+ * may apply to any device */
+static guint
+rule_get_vendor (const MMUdevRule *rule)
+{
+    guint i;
+
+    if (!rule->conditions)
+        return NO_VENDOR;
+
+    for (i = 0; i < rule->conditions->len; i++) {
+        const MMUdevRuleMatch *match;
+
+        match = &g_array_index (rule->conditions, MMUdevRuleMatch, i);
+        if (match->parameter_id == MM_UDEV_RULE_PARAMETER_ATTR_ID_VENDOR &&
+            match->type == MM_UDEV_RULE_MATCH_TYPE_EQUAL &&
+            match->value_valid &&
+            match->value_uint <= G_MAXUINT16)
+            return match->value_uint;
+    }
+    return NO_VENDOR;
+}
+
+static RulesIndex *
+rules_index_new (GArray      *rules,
+                 const guint *rule_vendors,
+                 guint        vendor)
+{
+    RulesIndex *index;
+    guint       i;
+
+    index = g_slice_new0 (RulesIndex);
+    index->rules = g_new (guint, rules->len);
+    index->jumps = g_new (guint, rules->len);
+
+    /* Labels are not needed, GOTOs jump directly to the next rule in the list */
+    for (i = 0; i < rules->len; i++) {
+        if (g_array_index (rules, MMUdevRule, i).result.type == MM_UDEV_RULE_RESULT_TYPE_LABEL)
+            continue;
+        if (rule_vendors[i] != NO_VENDOR && rule_vendors[i] != vendor)
+            continue;
+        index->rules[index->len++] = i;
+    }
+
+    for (i = 0; i < index->len; i++) {
+        const MMUdevRule *rule;
+        guint             low;
+        guint             high;
+
+        rule = &g_array_index (rules, MMUdevRule, index->rules[i]);
+        if (rule->result.type != MM_UDEV_RULE_RESULT_TYPE_GOTO_INDEX)
+            continue;
+
+        /* Lookup the first listed rule after the label; labels are always
+         * after the GOTO, so it's always after the current one */
+        low = i + 1;
+        high = index->len;
+        while (low < high) {
+            guint mid;
+
+            mid = low + (high - low) / 2;
+            if (index->rules[mid] < rule->result.content.index)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        index->jumps[i] = low;
+    }
+
+    return index;
+}
+
+static void
+rules_build_index (MMUdevRules *self)
+{
+    g_autofree guint *rule_vendors = NULL;
+    guint             i;
+
+    rule_vendors = g_new (guint, self->rules->len);
+    for (i = 0; i < self->rules->len; i++)
+        rule_vendors[i] = rule_get_vendor (&g_array_index (self->rules, MMUdevRule, i));
+
+    self->common = rules_index_new (self->rules, rule_vendors, NO_VENDOR);
+    self->vendors = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) rules_index_free);
+    for (i = 0; i < self->rules->len; i++) {
+        if (rule_vendors[i] == NO_VENDOR || g_hash_table_contains (self->vendors, GUINT_TO_POINTER (rule_vendors[i])))
+            continue;
+        g_hash_table_insert (self->vendors,
+                             GUINT_TO_POINTER (rule_vendors[i]),
+                             rules_index_new (self->rules, rule_vendors, rule_vendors[i]));
+    }
+}
+
+/*****************************************************************************/
+
+MMUdevRules *
+mm_udev_rules_ref (MMUdevRules *self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    g_atomic_int_inc (&self->ref_count);
+    return self;
+}
+
+void
+mm_udev_rules_unref (MMUdevRules *self)
+{
+    g_return_if_fail (self != NULL);
+
+    if (g_atomic_int_dec_and_test (&self->ref_count)) {
+        if (self->vendors)
+            g_hash_table_unref (self->vendors);
+        if (self->common)
+            rules_index_free (self->common);
+        g_array_unref (self->rules);
+        g_slice_free (MMUdevRules, self);
+    }
+}
+
+G_DEFINE_BOXED_TYPE (MMUdevRules, mm_udev_rules, (GBoxedCopyFunc) mm_udev_rules_ref, (GBoxedFreeFunc) mm_udev_rules_unref)
+
+guint
+mm_udev_rules_get_n_rules (MMUdevRules *self)
+{
+    return self->rules->len;
+}
+
+const MMUdevRule *
+mm_udev_rules_get_rule (MMUdevRules *self,
+                        guint        i)
+{
+    g_return_val_if_fail (i < self->rules->len, NULL);
+    return &g_array_index (self->rules, MMUdevRule, i);
+}
+
+MMUdevRules *
 mm_kernel_device_generic_rules_load (const gchar  *rules_dir,
                                      GError      **error)
 {
-    GList  *rule_files, *l;
-    GArray *rules;
-    GError *inner_error = NULL;
+    GList       *rule_files, *l;
+    MMUdevRules *self;
+    GError      *inner_error = NULL;
 
-    rules = g_array_new (FALSE, FALSE, sizeof (MMUdevRule));
-    g_array_set_clear_func (rules, (GDestroyNotify) udev_rule_clear);
+    self = g_slice_new0 (MMUdevRules);
+    self->ref_count = 1;
+    self->rules = g_array_new (FALSE, FALSE, sizeof (MMUdevRule));
+    g_array_set_clear_func (self->rules, (GDestroyNotify) udev_rule_clear);
 
     /* List rule files in rules dir */
     rule_files = list_rule_files (rules_dir);
@@ -418,25 +964,27 @@ mm_kernel_device_generic_rules_load (const gchar  *rules_dir,
 
     /* Iterate over rule files */
     for (l = rule_files; l; l = g_list_next (l)) {
-        if (!load_rules_from_file (rules, (const gchar *)(l->data), &inner_error))
+        if (!load_rules_from_file (self->rules, (const gchar *)(l->data), &inner_error))
             goto out;
     }
 
     /* Fail if no rules were loaded */
-    if (rules->len == 0) {
+    if (self->rules->len == 0) {
         inner_error = g_error_new (MM_CORE_ERROR, MM_CORE_ERROR_FAILED, "No rules loaded");
         goto out;
     }
 
+    rules_build_index (self);
+
 out:
     if (rule_files)
         g_list_free_full (rule_files, g_free);
 
     if (inner_error) {
         g_propagate_error (error, inner_error);
-        g_array_unref (rules);
+        mm_udev_rules_unref (self);
         return NULL;
     }
 
-    return rules;
+    return self;
 }
@@ -13,7 +13,11 @@
  * Copyright (C) 2016 Aleksander Morgado <aleksander@aleksander.es>
  */
 
+#ifndef MM_KERNEL_DEVICE_GENERIC_RULES_H
+#define MM_KERNEL_DEVICE_GENERIC_RULES_H
+
 #include <glib.h>
+#include <glib-object.h>
 
 G_BEGIN_DECLS
 
@@ -23,10 +27,47 @@ typedef enum {
     MM_UDEV_RULE_MATCH_TYPE_NOT_EQUAL,
 } MMUdevRuleMatchType;
 
+/* Parameters and attributes understood in rule matches and results,
+ * resolved when the rules are loaded */
+typedef enum {
+    MM_UDEV_RULE_PARAMETER_UNKNOWN,
+    MM_UDEV_RULE_PARAMETER_ACTION,
+    MM_UDEV_RULE_PARAMETER_SUBSYSTEM,
+    MM_UDEV_RULE_PARAMETER_DRIVER,
+    MM_UDEV_RULE_PARAMETER_KERNEL,
+    MM_UDEV_RULE_PARAMETER_DEVPATH,
+    MM_UDEV_RULE_PARAMETER_ENV,
+    MM_UDEV_RULE_PARAMETER_ATTR_UNKNOWN,
+    MM_UDEV_RULE_PARAMETER_ATTR_ID_VENDOR,
+    MM_UDEV_RULE_PARAMETER_ATTR_ID_PRODUCT,
+    MM_UDEV_RULE_PARAMETER_ATTR_MANUFACTURER,
+    MM_UDEV_RULE_PARAMETER_ATTR_PRODUCT,
+    MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_CLASS,
+    MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_SUBCLASS,
+    MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_PROTOCOL,
+    MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_NUMBER,
+} MMUdevRuleParameter;
+
+/* A string pattern with optional leading and trailing '*' wildcards */
+typedef struct {
+    gchar    *str;
+    gboolean  open_prefix;
+    gboolean  open_suffix;
+} MMUdevRulePattern;
+
 typedef struct {
     MMUdevRuleMatchType  type;
     gchar               *parameter;
     gchar               *value;
+
+    /* Preprocessed contents */
+    MMUdevRuleParameter  parameter_id;
+    gchar               *key;         /* ENV property or ATTRS attribute name */
+    gboolean             value_any;   /* ATTRS value is '?*' */
+    gboolean             value_valid; /* ACTION matches 'add', or ATTRS value is a valid hex number */
+    guint                value_uint;
+    MMUdevRulePattern    pattern;
+    MMUdevRulePattern    prefix_pattern; /* DEVPATH only, if not already a prefix match */
 } MMUdevRuleMatch;
 
 typedef enum {
@@ -38,8 +79,10 @@ typedef enum {
 } MMUdevRuleResultType;
 
 typedef struct {
-    gchar *name;
-    gchar *value;
+    gchar               *name;
+    gchar               *value;
+    /* Set if the value is a '$attr{...}' substitution */
+    MMUdevRuleParameter  value_attribute;
 } MMUdevRuleResultProperty;
 
 typedef struct {
@@ -56,7 +99,56 @@ typedef struct {
     MMUdevRuleResult  result;
 } MMUdevRule;
 
-GArray *mm_kernel_device_generic_rules_load (const gchar  *rules_dir,
-                                             GError      **error);
+/*
+ * A loaded set of rules.
+ *
+ * Besides the list of rules in order, the set keeps an index of the rules
+ * that may apply to the ports of each vendor: rules matching a specific
+ * idVendor are only ever evaluated for devices with that same vendor id, and
+ * labels are skipped altogether, with GOTO results resolved to a direct jump
+ * into the per-vendor list.
+ */
+typedef struct _MMUdevRules MMUdevRules;
+
+#define MM_TYPE_UDEV_RULES (mm_udev_rules_get_type ())
+
+GType             mm_udev_rules_get_type              (void);
+MMUdevRules      *mm_udev_rules_ref                   (MMUdevRules  *self);
+void              mm_udev_rules_unref                 (MMUdevRules  *self);
+guint             mm_udev_rules_get_n_rules           (MMUdevRules  *self);
+const MMUdevRule *mm_udev_rules_get_rule              (MMUdevRules  *self,
+                                                       guint         i);
+MMUdevRules      *mm_kernel_device_generic_rules_load (const gchar  *rules_dir,
+                                                       GError      **error);
+
+/* Device contents rules are evaluated against. Properties are read from and
+ * stored in @object as object data. */
+typedef struct {
+    GObject     *object;
+    const gchar *name;
+    const gchar *driver;
+    const gchar *sysfs_path;
+    guint16      physdev_vid;
+    guint16      physdev_pid;
+    const gchar *physdev_manufacturer;
+    const gchar *physdev_product;
+    guint8       interface_class;
+    guint8       interface_subclass;
+    guint8       interface_protocol;
+    guint8       interface_number;
+} MMUdevRulesDevice;
+
+/* Applies the rules to the device, and returns the number of rules that
+ * were evaluated. Property values may be stored without copying them, so
+ * the caller must keep a reference to the rules as long as the object is
+ * alive. */
+guint mm_udev_rules_apply           (MMUdevRules             *self,
+                                     const MMUdevRulesDevice *device);
+/* Same as mm_udev_rules_apply(), but walking the whole list of rules
+ * instead of the index. Only for testing. */
+guint mm_udev_rules_apply_unindexed (MMUdevRules             *self,
+                                     const MMUdevRulesDevice *device);
 
 G_END_DECLS
+
+#endif /* MM_KERNEL_DEVICE_GENERIC_RULES_H */
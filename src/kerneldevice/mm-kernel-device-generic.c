@@ -45,11 +45,13 @@ enum {
 
 static GParamSpec *properties[PROP_LAST];
 
+typedef struct _PhysdevInfo PhysdevInfo;
+
 struct _MMKernelDeviceGenericPrivate {
     /* Input properties */
     MMKernelEventProperties *properties;
     /* Rules to apply */
-    GArray *rules;
+    MMUdevRules *rules;
 
     /* Contents from sysfs */
     gchar   *driver;
@@ -61,6 +63,7 @@ struct _MMKernelDeviceGenericPrivate {
     guint8   interface_number;
     gchar   *interface_description;
     gchar   *physdev_sysfs_path;
+    PhysdevInfo *physdev;
     guint16  physdev_vid;
     guint16  physdev_pid;
     guint16  physdev_revision;
@@ -104,6 +107,136 @@ read_sysfs_property_as_string (const gchar *path,
     return contents;
 }
 
+/*****************************************************************************/
+/* Physical device attributes
+ *
+ * All ports of the same physical device would read the very same attributes
+ * from sysfs, so they are read only once and shared among all the ports
+ * using them. The cached info is dropped when any of those ports is reported
+ * as removed, so that a device replugged in the same USB port is read again.
+ */
+
+struct _PhysdevInfo {
+    guint    ref_count;
+    gchar   *sysfs_path;
+    guint16  vid;
+    guint16  pid;
+    guint16  revision;
+    gchar   *subsystem;
+    gchar   *manufacturer;
+    gchar   *product;
+};
+
+/* physdev sysfs path -> PhysdevInfo, not owned */
+static GHashTable *physdev_infos;
+/* port subsystem/name -> physdev sysfs path */
+static GHashTable *physdev_ports;
+
+static guint16
+read_sysfs_property_as_uint16 (const gchar *path,
+                               const gchar *property)
+{
+    guint val;
+
+    val = read_sysfs_property_as_hex (path, property);
+    return (val <= G_MAXUINT16 ? val : 0);
+}
+
+static PhysdevInfo *
+physdev_info_new (const gchar *sysfs_path)
+{
+    PhysdevInfo *info;
+    gchar       *aux;
+    gchar       *subsyspath;
+
+    info = g_slice_new0 (PhysdevInfo);
+    info->ref_count    = 1;
+    info->sysfs_path   = g_strdup (sysfs_path);
+    info->vid          = read_sysfs_property_as_uint16 (sysfs_path, "idVendor");
+    info->pid          = read_sysfs_property_as_uint16 (sysfs_path, "idProduct");
+    info->revision     = read_sysfs_property_as_uint16 (sysfs_path, "bcdDevice");
+    info->manufacturer = read_sysfs_property_as_string (sysfs_path, "manufacturer");
+    info->product      = read_sysfs_property_as_string (sysfs_path, "product");
+
+    aux = g_strdup_printf ("%s/subsystem", sysfs_path);
+    subsyspath = realpath (aux, NULL);
+    info->subsystem = g_path_get_dirname (subsyspath);
+    g_free (subsyspath);
+    g_free (aux);
+
+    return info;
+}
+
+static void
+physdev_info_unref (PhysdevInfo *info)
+{
+    if (--info->ref_count > 0)
+        return;
+
+    /* May have been invalidated already and replaced by a new one */
+    if (g_hash_table_lookup (physdev_infos, info->sysfs_path) == info)
+        g_hash_table_remove (physdev_infos, info->sysfs_path);
+
+    g_free (info->product);
+    g_free (info->manufacturer);
+    g_free (info->subsystem);
+    g_free (info->sysfs_path);
+    g_slice_free (PhysdevInfo, info);
+}
+
+static gchar *
+physdev_port_key (MMKernelEventProperties *properties)
+{
+    return g_strdup_printf ("%s/%s",
+                            mm_kernel_event_properties_get_subsystem (properties),
+                            mm_kernel_event_properties_get_name      (properties));
+}
+
+static PhysdevInfo *
+physdev_info_acquire (MMKernelDeviceGeneric *self,
+                      const gchar           *sysfs_path)
+{
+    PhysdevInfo *info;
+
+    if (G_UNLIKELY (!physdev_infos)) {
+        physdev_infos = g_hash_table_new (g_str_hash, g_str_equal);
+        physdev_ports = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    }
+
+    g_hash_table_insert (physdev_ports, physdev_port_key (self->priv->properties), g_strdup (sysfs_path));
+
+    info = g_hash_table_lookup (physdev_infos, sysfs_path);
+    if (info) {
+        mm_obj_dbg (self, "physdev attributes already loaded");
+        info->ref_count++;
+        return info;
+    }
+
+    info = physdev_info_new (sysfs_path);
+    g_hash_table_insert (physdev_infos, info->sysfs_path, info);
+    return info;
+}
+
+static void
+physdev_info_invalidate (MMKernelDeviceGeneric *self)
+{
+    g_autofree gchar *port_key = NULL;
+    const gchar      *sysfs_path;
+
+    if (!physdev_ports)
+        return;
+
+    port_key = physdev_port_key (self->priv->properties);
+    sysfs_path = g_hash_table_lookup (physdev_ports, port_key);
+    if (!sysfs_path)
+        return;
+
+    /* Ports still using the info keep their own reference */
+    if (g_hash_table_remove (physdev_infos, sysfs_path))
+        mm_obj_dbg (self, "physdev attributes invalidated");
+    g_hash_table_remove (physdev_ports, port_key);
+}
+
 /*****************************************************************************/
 /* Load contents */
 
@@ -222,8 +355,11 @@ preload_physdev_sysfs_path (MMKernelDeviceGeneric *self)
     if (!self->priv->physdev_sysfs_path && self->priv->interface_sysfs_path)
         self->priv->physdev_sysfs_path = g_path_get_dirname (self->priv->interface_sysfs_path);
 
-    if (self->priv->physdev_sysfs_path)
+    if (self->priv->physdev_sysfs_path) {
         mm_obj_dbg (self, "physdev sysfs path: %s", self->priv->physdev_sysfs_path);
+        if (!self->priv->physdev)
+            self->priv->physdev = physdev_info_acquire (self, self->priv->physdev_sysfs_path);
+    }
 }
 
 static void
@@ -248,13 +384,8 @@ preload_driver (MMKernelDeviceGeneric *self)
 static void
 preload_physdev_vid (MMKernelDeviceGeneric *self)
 {
-    if (!self->priv->physdev_vid && self->priv->physdev_sysfs_path) {
-        guint val;
-
-        val = read_sysfs_property_as_hex (self->priv->physdev_sysfs_path, "idVendor");
-        if (val && val <= G_MAXUINT16)
-            self->priv->physdev_vid = val;
-    }
+    if (!self->priv->physdev_vid && self->priv->physdev)
+        self->priv->physdev_vid = self->priv->physdev->vid;
 
     if (self->priv->physdev_vid) {
         mm_obj_dbg (self, "vid (ID_VENDOR_ID): 0x%04x", self->priv->physdev_vid);
@@ -267,13 +398,8 @@ preload_physdev_vid (MMKernelDeviceGeneric *self)
 static void
 preload_physdev_pid (MMKernelDeviceGeneric *self)
 {
-    if (!self->priv->physdev_pid && self->priv->physdev_sysfs_path) {
-        guint val;
-
-        val = read_sysfs_property_as_hex (self->priv->physdev_sysfs_path, "idProduct");
-        if (val && val <= G_MAXUINT16)
-            self->priv->physdev_pid = val;
-    }
+    if (!self->priv->physdev_pid && self->priv->physdev)
+        self->priv->physdev_pid = self->priv->physdev->pid;
 
     if (self->priv->physdev_pid) {
         mm_obj_dbg (self, "pid (ID_MODEL_ID): 0x%04x", self->priv->physdev_pid);
@@ -285,13 +411,8 @@ preload_physdev_pid (MMKernelDeviceGeneric *self)
 static void
 preload_physdev_revision (MMKernelDeviceGeneric *self)
 {
-    if (!self->priv->physdev_revision && self->priv->physdev_sysfs_path) {
-        guint val;
-
-        val = read_sysfs_property_as_hex (self->priv->physdev_sysfs_path, "bcdDevice");
-        if (val && val <= G_MAXUINT16)
-            self->priv->physdev_revision = val;
-    }
+    if (!self->priv->physdev_revision && self->priv->physdev)
+        self->priv->physdev_revision = self->priv->physdev->revision;
 
     if (self->priv->physdev_revision) {
         mm_obj_dbg (self, "revision (ID_REVISION): 0x%04x", self->priv->physdev_revision);
@@ -303,16 +424,8 @@ preload_physdev_revision (MMKernelDeviceGeneric *self)
 static void
 preload_physdev_subsystem (MMKernelDeviceGeneric *self)
 {
-    if (!self->priv->physdev_subsystem && self->priv->physdev_sysfs_path) {
-        gchar *aux;
-        gchar *subsyspath;
-
-        aux = g_strdup_printf ("%s/subsystem", self->priv->physdev_sysfs_path);
-        subsyspath = realpath (aux, NULL);
-        self->priv->physdev_subsystem = g_path_get_dirname (subsyspath);
-        g_free (subsyspath);
-        g_free (aux);
-    }
+    if (!self->priv->physdev_subsystem && self->priv->physdev)
+        self->priv->physdev_subsystem = g_strdup (self->priv->physdev->subsystem);
 
     mm_obj_dbg (self, "subsystem: %s", self->priv->physdev_subsystem ? self->priv->physdev_subsystem : "unknown");
 }
@@ -320,8 +433,8 @@ preload_physdev_subsystem (MMKernelDeviceGeneric *self)
 static void
 preload_manufacturer (MMKernelDeviceGeneric *self)
 {
-    if (!self->priv->physdev_manufacturer)
-        self->priv->physdev_manufacturer = (self->priv->physdev_sysfs_path ? read_sysfs_property_as_string (self->priv->physdev_sysfs_path, "manufacturer") : NULL);
+    if (!self->priv->physdev_manufacturer && self->priv->physdev)
+        self->priv->physdev_manufacturer = g_strdup (self->priv->physdev->manufacturer);
 
     if (self->priv->physdev_manufacturer) {
         mm_obj_dbg (self, "manufacturer (ID_VENDOR): %s", self->priv->physdev_manufacturer);
@@ -333,8 +446,8 @@ preload_manufacturer (MMKernelDeviceGeneric *self)
 static void
 preload_product (MMKernelDeviceGeneric *self)
 {
-    if (!self->priv->physdev_product)
-        self->priv->physdev_product = (self->priv->physdev_sysfs_path ? read_sysfs_property_as_string (self->priv->physdev_sysfs_path, "product") : NULL);
+    if (!self->priv->physdev_product && self->priv->physdev)
+        self->priv->physdev_product = g_strdup (self->priv->physdev->product);
 
     if (self->priv->physdev_product) {
         mm_obj_dbg (self, "product (ID_MODEL): %s", self->priv->physdev_product);
@@ -566,272 +679,29 @@ kernel_device_cmp (MMKernelDevice *a,
 
 /*****************************************************************************/
 
-static gboolean
-string_match (const gchar *str,
-              const gchar *original_pattern)
-{
-    gchar    *pattern;
-    gchar    *start;
-    gboolean  open_prefix = FALSE;
-    gboolean  open_suffix = FALSE;
-    gboolean  match;
-
-    pattern = g_strdup (original_pattern);
-    start = pattern;
-
-    if (start[0] == '*') {
-        open_prefix = TRUE;
-        start++;
-    }
-
-    if (start[strlen (start) - 1] == '*') {
-        open_suffix = TRUE;
-        start[strlen (start) - 1] = '\0';
-    }
-
-    if (open_suffix && !open_prefix)
-        match = g_str_has_prefix (str, start);
-    else if (!open_suffix && open_prefix)
-        match = g_str_has_suffix (str, start);
-    else if (open_suffix && open_prefix)
-        match = !!strstr (str, start);
-    else
-        match = g_str_equal (str, start);
-
-    g_free (pattern);
-    return match;
-}
-
-static gboolean
-check_condition (MMKernelDeviceGeneric *self,
-                 MMUdevRuleMatch       *match)
-{
-    gboolean condition_equal;
-
-    condition_equal = (match->type == MM_UDEV_RULE_MATCH_TYPE_EQUAL);
-
-    /* We only apply 'add' rules */
-    if (g_str_equal (match->parameter, "ACTION"))
-        return ((!!strstr (match->value, "add")) == condition_equal);
-
-    /* We look for the subsystem string in the whole sysfs path.
-     *
-     * Note that we're not really making a difference between "SUBSYSTEMS"
-     * (where the whole device tree is checked) and "SUBSYSTEM" (where just one
-     * single device is checked), because a lot of the MM udev rules are meant
-     * to just tag the physical device (e.g. with ID_MM_DEVICE_IGNORE) instead
-     * of the single ports. In our case with the custom parsing, we do tag all
-     * independent ports.
-     */
-    if (g_str_equal (match->parameter, "SUBSYSTEMS") || g_str_equal (match->parameter, "SUBSYSTEM"))
-        return ((self->priv->sysfs_path && !!strstr (self->priv->sysfs_path, match->value)) == condition_equal);
-
-    /* Exact DRIVER match? We also include the check for DRIVERS, even if we
-     * only apply it to this port driver. */
-    if (g_str_equal (match->parameter, "DRIVER") || g_str_equal (match->parameter, "DRIVERS"))
-        return ((!g_strcmp0 (match->value, mm_kernel_device_get_driver (MM_KERNEL_DEVICE (self)))) == condition_equal);
-
-    /* Device name checks */
-    if (g_str_equal (match->parameter, "KERNEL"))
-        return (string_match (mm_kernel_device_get_name (MM_KERNEL_DEVICE (self)), match->value) == condition_equal);
-
-    /* Device sysfs path checks; we allow both a direct match and a prefix patch */
-    if (g_str_equal (match->parameter, "DEVPATH")) {
-        gchar    *prefix_match = NULL;
-        gboolean  result = FALSE;
-
-        /* If sysfs path invalid (e.g. path doesn't exist), no match */
-        if (!self->priv->sysfs_path)
-            return FALSE;
-
-        /* If not already doing a prefix match, do an implicit one. This is so that
-         * we can add properties to the usb_device owning all ports, and then apply
-         * the property to all ports individually processed here. */
-        if (match->value[0] && match->value[strlen (match->value) - 1] != '*')
-            prefix_match = g_strdup_printf ("%s/*", match->value);
-
-        if (string_match (self->priv->sysfs_path, match->value) == condition_equal) {
-            result = TRUE;
-            goto out;
-        }
-
-        if (prefix_match && string_match (self->priv->sysfs_path, prefix_match) == condition_equal) {
-            result = TRUE;
-            goto out;
-        }
-
-        if (g_str_has_prefix (self->priv->sysfs_path, "/sys")) {
-            if (string_match (&self->priv->sysfs_path[4], match->value) == condition_equal) {
-                result = TRUE;
-                goto out;
-            }
-            if (prefix_match && string_match (&self->priv->sysfs_path[4], prefix_match) == condition_equal) {
-                result = TRUE;
-                goto out;
-            }
-        }
-    out:
-        g_free (prefix_match);
-        return result;
-    }
-
-    /* Attributes checks */
-    if (g_str_has_prefix (match->parameter, "ATTRS")) {
-        gchar    *attribute;
-        gchar    *contents = NULL;
-        gboolean  result = FALSE;
-        guint     val;
-
-        attribute = g_strdup (&match->parameter[5]);
-        g_strdelimit (attribute, "{}", ' ');
-        g_strstrip (attribute);
-
-        /* VID/PID directly from our API */
-        if (g_str_equal (attribute, "idVendor"))
-            result = ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                      ((mm_kernel_device_get_physdev_vid (MM_KERNEL_DEVICE (self)) == val) == condition_equal));
-        else if (g_str_equal (attribute, "idProduct"))
-            result = ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                      ((mm_kernel_device_get_physdev_pid (MM_KERNEL_DEVICE (self)) == val) == condition_equal));
-        /* manufacturer in the physdev */
-        else if (g_str_equal (attribute, "manufacturer"))
-            result = ((self->priv->physdev_manufacturer && g_str_equal (self->priv->physdev_manufacturer, match->value)) == condition_equal);
-        /* product in the physdev */
-        else if (g_str_equal (attribute, "product"))
-            result = ((self->priv->physdev_product && g_str_equal (self->priv->physdev_product, match->value)) == condition_equal);
-        /* interface class/subclass/protocol/number in the interface */
-        else if (g_str_equal (attribute, "bInterfaceClass"))
-            result = (g_str_equal (match->value, "?*") || ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                                                           ((self->priv->interface_class == val) == condition_equal)));
-        else if (g_str_equal (attribute, "bInterfaceSubClass"))
-            result = (g_str_equal (match->value, "?*") || ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                                                           ((self->priv->interface_subclass == val) == condition_equal)));
-        else if (g_str_equal (attribute, "bInterfaceProtocol"))
-            result = (g_str_equal (match->value, "?*") || ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                                                           ((self->priv->interface_protocol == val) == condition_equal)));
-        else if (g_str_equal (attribute, "bInterfaceNumber"))
-            result = (g_str_equal (match->value, "?*") || ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                                                           ((self->priv->interface_number == val) == condition_equal)));
-        else
-            mm_obj_warn (self, "unknown attribute: %s", attribute);
-
-        g_free (contents);
-        g_free (attribute);
-        return result;
-    }
-
-    /* Previously set property checks */
-    if (g_str_has_prefix (match->parameter, "ENV")) {
-        gchar    *property;
-        gboolean  result = FALSE;
-
-        property = g_strdup (&match->parameter[3]);
-        g_strdelimit (property, "{}", ' ');
-        g_strstrip (property);
-
-        result = ((!g_strcmp0 ((const gchar *) g_object_get_data (G_OBJECT (self), property), match->value)) == condition_equal);
-
-        g_free (property);
-        return result;
-    }
-
-    mm_obj_warn (self, "unknown match condition parameter: %s", match->parameter);
-    return FALSE;
-}
-
-static guint
-check_rule (MMKernelDeviceGeneric *self,
-            guint                  rule_i)
-{
-    MMUdevRule *rule;
-    gboolean    apply = TRUE;
-
-    g_assert (rule_i < self->priv->rules->len);
-
-    rule = &g_array_index (self->priv->rules, MMUdevRule, rule_i);
-    if (rule->conditions) {
-        guint condition_i;
-
-        for (condition_i = 0; condition_i < rule->conditions->len; condition_i++) {
-            MMUdevRuleMatch *match;
-
-            match = &g_array_index (rule->conditions, MMUdevRuleMatch, condition_i);
-            if (!check_condition (self, match)) {
-                apply = FALSE;
-                break;
-            }
-        }
-    }
-
-    if (apply) {
-        switch (rule->result.type) {
-        case MM_UDEV_RULE_RESULT_TYPE_PROPERTY: {
-            gchar *property_value_read = NULL;
-
-            if (g_str_equal (rule->result.content.property.value, "$attr{bInterfaceClass}"))
-                property_value_read = g_strdup_printf ("%02x", self->priv->interface_class);
-            else if (g_str_equal (rule->result.content.property.value, "$attr{bInterfaceSubClass}"))
-                property_value_read = g_strdup_printf ("%02x", self->priv->interface_subclass);
-            else if (g_str_equal (rule->result.content.property.value, "$attr{bInterfaceProtocol}"))
-                property_value_read = g_strdup_printf ("%02x", self->priv->interface_protocol);
-            else if (g_str_equal (rule->result.content.property.value, "$attr{bInterfaceNumber}"))
-                property_value_read = g_strdup_printf ("%02x", self->priv->interface_number);
-
-            /* add new property */
-            mm_obj_dbg (self, "property added: %s=%s",
-                        rule->result.content.property.name,
-                        property_value_read ? property_value_read : rule->result.content.property.value);
-
-            if (!property_value_read)
-                /* NOTE: we keep a reference to the list of rules ourselves, so it isn't
-                 * an issue if we re-use the same string (i.e. without g_strdup-ing it)
-                 * as a property value. */
-                g_object_set_data (G_OBJECT (self),
-                                   rule->result.content.property.name,
-                                   rule->result.content.property.value);
-            else
-                g_object_set_data_full (G_OBJECT (self),
-                                        rule->result.content.property.name,
-                                        property_value_read,
-                                        g_free);
-            break;
-        }
-
-        case MM_UDEV_RULE_RESULT_TYPE_LABEL:
-            /* noop */
-            break;
-
-        case MM_UDEV_RULE_RESULT_TYPE_GOTO_INDEX:
-            /* Jump to a new index */
-            return rule->result.content.index;
-
-        case MM_UDEV_RULE_RESULT_TYPE_GOTO_TAG:
-        case MM_UDEV_RULE_RESULT_TYPE_UNKNOWN:
-        default:
-            g_assert_not_reached ();
-        }
-    }
-
-    /* Go to the next rule */
-    return rule_i + 1;
-}
-
 static void
 preload_properties (MMKernelDeviceGeneric *self)
 {
-    guint i;
+    MMUdevRulesDevice device = {
+        .object               = G_OBJECT (self),
+        .name                 = mm_kernel_device_get_name (MM_KERNEL_DEVICE (self)),
+        .driver               = self->priv->driver,
+        .sysfs_path           = self->priv->sysfs_path,
+        .physdev_vid          = self->priv->physdev_vid,
+        .physdev_pid          = self->priv->physdev_pid,
+        .physdev_manufacturer = self->priv->physdev_manufacturer,
+        .physdev_product      = self->priv->physdev_product,
+        .interface_class      = self->priv->interface_class,
+        .interface_subclass   = self->priv->interface_subclass,
+        .interface_protocol   = self->priv->interface_protocol,
+        .interface_number     = self->priv->interface_number,
+    };
+    guint n_evaluated;
 
     g_assert (self->priv->rules);
-    g_assert (self->priv->rules->len > 0);
 
-    /* Start to process rules */
-    i = 0;
-    while (i < self->priv->rules->len) {
-        guint next_rule;
-
-        next_rule = check_rule (self, i);
-        i = next_rule;
-    }
+    n_evaluated = mm_udev_rules_apply (self->priv->rules, &device);
+    mm_obj_dbg (self, "evaluated %u/%u rules", n_evaluated, mm_udev_rules_get_n_rules (self->priv->rules));
 }
 
 static void
@@ -842,8 +712,10 @@ check_preload (MMKernelDeviceGeneric *self)
         return;
 
     /* Don't preload on "remove" actions, where we don't have the device any more */
-    if (g_strcmp0 (mm_kernel_event_properties_get_action (self->priv->properties), "remove") == 0)
+    if (g_strcmp0 (mm_kernel_event_properties_get_action (self->priv->properties), "remove") == 0) {
+        physdev_info_invalidate (self);
         return;
+    }
 
     /* Don't preload for devices in the 'virtual' subsystem */
     if (g_strcmp0 (mm_kernel_event_properties_get_subsystem (self->priv->properties), "virtual") == 0)
@@ -914,7 +786,7 @@ kernel_device_get_property_as_int_hex (MMKernelDevice *self,
 
 MMKernelDevice *
 mm_kernel_device_generic_new_with_rules (MMKernelEventProperties  *props,
-                                         GArray                   *rules,
+                                         MMUdevRules              *rules,
                                          GError                  **error)
 {
     g_return_val_if_fail (MM_IS_KERNEL_EVENT_PROPERTIES (props), NULL);
@@ -933,7 +805,7 @@ MMKernelDevice *
 mm_kernel_device_generic_new (MMKernelEventProperties  *props,
                               GError                  **error)
 {
-    static GArray *rules = NULL;
+    static MMUdevRules *rules = NULL;
 
     g_return_val_if_fail (MM_IS_KERNEL_EVENT_PROPERTIES (props), NULL);
 
@@ -1048,11 +920,13 @@ dispose (GObject *object)
 
     g_clear_pointer (&self->priv->physdev_product,      g_free);
     g_clear_pointer (&self->priv->physdev_manufacturer, g_free);
+    g_clear_pointer (&self->priv->physdev_subsystem,    g_free);
+    g_clear_pointer (&self->priv->physdev,              physdev_info_unref);
     g_clear_pointer (&self->priv->physdev_sysfs_path,   g_free);
     g_clear_pointer (&self->priv->interface_sysfs_path, g_free);
     g_clear_pointer (&self->priv->sysfs_path,           g_free);
     g_clear_pointer (&self->priv->driver,               g_free);
-    g_clear_pointer (&self->priv->rules,                g_array_unref);
+    g_clear_pointer (&self->priv->rules,                mm_udev_rules_unref);
     g_clear_object  (&self->priv->properties);
 
     G_OBJECT_CLASS (mm_kernel_device_generic_parent_class)->dispose (object);
@@ -1119,7 +993,7 @@ mm_kernel_device_generic_class_init (MMKernelDeviceGenericClass *klass)
         g_param_spec_boxed ("rules",
                             "Rules",
                             "List of rules to apply",
-                            G_TYPE_ARRAY,
+                            MM_TYPE_UDEV_RULES,
                             G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
     g_object_class_install_property (object_class, PROP_RULES, properties[PROP_RULES]);
 }
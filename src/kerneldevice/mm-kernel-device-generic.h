@@ -23,6 +23,7 @@
 #include <libmm-glib.h>
 
 #include "mm-kernel-device.h"
+#include "mm-kernel-device-generic-rules.h"
 
 #define MM_TYPE_KERNEL_DEVICE_GENERIC            (mm_kernel_device_generic_get_type ())
 #define MM_KERNEL_DEVICE_GENERIC(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), MM_TYPE_KERNEL_DEVICE_GENERIC, MMKernelDeviceGeneric))
@@ -48,7 +49,7 @@ GType           mm_kernel_device_generic_get_type       (void);
 MMKernelDevice *mm_kernel_device_generic_new            (MMKernelEventProperties  *properties,
                                                          GError                  **error);
 MMKernelDevice *mm_kernel_device_generic_new_with_rules (MMKernelEventProperties  *properties,
-                                                         GArray                   *rules,
+                                                         MMUdevRules              *rules,
                                                          GError                  **error);
 
 #endif /* MM_KERNEL_DEVICE_GENERIC_H */
@@ -30,6 +30,7 @@
 #include "mm-log.h"
 #include "mm-base-manager.h"
 #include "mm-context.h"
+#include "mm-trace.h"
 
 #if defined WITH_SYSTEMD_SUSPEND_RESUME
 # include "mm-sleep-monitor.h"
@@ -64,9 +65,12 @@ hup_cb (gpointer user_data)
     mm_log_shutdown ();
     if (!mm_log_setup (mm_context_get_log_level (),
        mm_context_get_log_file (),
+       mm_context_get_log_journal (),
        mm_context_get_log_timestamps (),
        mm_context_get_log_relative_timestamps (),
-       mm_context_get_debug (),
+       mm_context_get_log_binary (),
+       mm_context_get_log_flush_interval (),
+       mm_context_get_log_buffer_size (),
        &err)) {
             g_warning ("Failed to set up logging: %s", err->message);
             g_error_free (err);
@@ -74,6 +78,23 @@ hup_cb (gpointer user_data)
     return G_SOURCE_CONTINUE;
 }
 
+static gboolean
+usr1_cb (gpointer user_data)
+{
+    GError *error = NULL;
+    gchar  *path;
+
+    path = mm_log_recorder_dump (&error);
+    if (!path) {
+        mm_warn ("couldn't dump log recorder: %s", error->message);
+        g_error_free (error);
+    } else {
+        mm_info ("log recorder dumped to %s", path);
+        g_free (path);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
 #if defined WITH_SYSTEMD_SUSPEND_RESUME
 
 static void
@@ -185,15 +206,24 @@ main (int argc, char *argv[])
                        mm_context_get_log_journal (),
                        mm_context_get_log_timestamps (),
                        mm_context_get_log_relative_timestamps (),
+                       mm_context_get_log_binary (),
+                       mm_context_get_log_flush_interval (),
+                       mm_context_get_log_buffer_size (),
                        &error)) {
         g_warning ("failed to set up logging: %s", error->message);
         g_error_free (error);
         exit (1);
     }
 
+    /* The recorder outlives log file reloads */
+    mm_log_recorder_setup ((gsize) mm_context_get_log_recorder_size () * 1024,
+                           mm_context_get_log_recorder_file ());
+    mm_trace_setup (mm_context_get_log_trace_size ());
+
     g_unix_signal_add (SIGTERM, quit_cb, NULL);
     g_unix_signal_add (SIGINT, quit_cb, NULL);
     g_unix_signal_add (SIGHUP, hup_cb, NULL);
+    g_unix_signal_add (SIGUSR1, usr1_cb, NULL);
 
     /* Early register all known errors */
     register_dbus_errors ();
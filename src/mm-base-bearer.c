@@ -36,6 +36,7 @@
 #include "mm-base-modem-at.h"
 #include "mm-base-modem.h"
 #include "mm-log-object.h"
+#include "mm-trace.h"
 #include "mm-modem-helpers.h"
 #include "mm-bearer-stats.h"
 
@@ -50,6 +51,10 @@
 #define BEARER_CONNECTION_MONITOR_INITIAL_TIMEOUT 30
 #define BEARER_CONNECTION_MONITOR_TIMEOUT          5
 
+/* Names of the polls in the modem scheduler */
+#define BEARER_STATS_POLL_NAME              "bearer-stats"
+#define BEARER_CONNECTION_MONITOR_POLL_NAME "connection-monitor"
+
 static void log_object_iface_init (MMLogObjectInterface *iface);
 
 G_DEFINE_TYPE_EXTENDED (MMBaseBearer, mm_base_bearer, MM_GDBUS_TYPE_BEARER_SKELETON, 0,
@@ -99,6 +104,9 @@ struct _MMBaseBearerPrivate {
     GCancellable *connect_cancellable;
     /* handler id for the disconnect + cancel connect request */
     gulong disconnect_signal_handler;
+    /* Trace spans of the ongoing connect() and disconnect() */
+    MMTraceSpan connect_trace_span;
+    MMTraceSpan disconnect_trace_span;
 
     /* Connection status monitoring */
     guint connection_monitor_id;
@@ -155,11 +163,17 @@ mm_base_bearer_export (MMBaseBearer *self)
 
 /*****************************************************************************/
 
+static MMPollScheduler *
+peek_poll_scheduler (MMBaseBearer *self)
+{
+    return (self->priv->modem ? mm_base_modem_peek_poll_scheduler (self->priv->modem) : NULL);
+}
+
 static void
 connection_monitor_stop (MMBaseBearer *self)
 {
     if (self->priv->connection_monitor_id) {
-        g_source_remove (self->priv->connection_monitor_id);
+        mm_poll_scheduler_remove (peek_poll_scheduler (self), self->priv->connection_monitor_id);
         self->priv->connection_monitor_id = 0;
     }
 }
@@ -172,6 +186,7 @@ load_connection_status_ready (MMBaseBearer *self,
     MMBearerConnectionStatus  status;
 
     status = MM_BASE_BEARER_GET_CLASS (self)->load_connection_status_finish (self, res, &error);
+    mm_poll_scheduler_complete (peek_poll_scheduler (self), BEARER_CONNECTION_MONITOR_POLL_NAME);
     if (status == MM_BEARER_CONNECTION_STATUS_UNKNOWN) {
         /* Only warn if not reporting an "unsupported" error */
         if (!g_error_matches (error, MM_CORE_ERROR, MM_CORE_ERROR_UNSUPPORTED)) {
@@ -217,8 +232,10 @@ initial_connection_monitor_cb (MMBaseBearer *self)
             NULL);
 
     /* Add new monitor timeout at a higher rate */
-    self->priv->connection_monitor_id = g_timeout_add_seconds (BEARER_CONNECTION_MONITOR_TIMEOUT,
-                                                               (GSourceFunc) connection_monitor_cb,
+    self->priv->connection_monitor_id = mm_poll_scheduler_add (peek_poll_scheduler (self),
+                                                               BEARER_CONNECTION_MONITOR_POLL_NAME,
+                                                               BEARER_CONNECTION_MONITOR_TIMEOUT * 1000,
+                                                               (MMPollSchedulerFunc) connection_monitor_cb,
                                                                self);
 
     /* Remove the initial connection monitor timeout as we added a new one */
@@ -238,8 +255,10 @@ connection_monitor_start (MMBaseBearer *self)
 
     /* Schedule initial check */
     g_assert (!self->priv->connection_monitor_id);
-    self->priv->connection_monitor_id = g_timeout_add_seconds (BEARER_CONNECTION_MONITOR_INITIAL_TIMEOUT,
-                                                               (GSourceFunc) initial_connection_monitor_cb,
+    self->priv->connection_monitor_id = mm_poll_scheduler_add (peek_poll_scheduler (self),
+                                                               BEARER_CONNECTION_MONITOR_POLL_NAME,
+                                                               BEARER_CONNECTION_MONITOR_INITIAL_TIMEOUT * 1000,
+                                                               (MMPollSchedulerFunc) initial_connection_monitor_cb,
                                                                self);
 }
 
@@ -326,7 +345,7 @@ bearer_stats_stop (MMBaseBearer *self)
     }
 
     if (self->priv->stats_update_id) {
-        g_source_remove (self->priv->stats_update_id);
+        mm_poll_scheduler_remove (peek_poll_scheduler (self), self->priv->stats_update_id);
         self->priv->stats_update_id = 0;
     }
 }
@@ -339,6 +358,8 @@ reload_stats_ready (MMBaseBearer *self,
     guint64  rx_bytes = 0;
     guint64  tx_bytes = 0;
 
+    mm_poll_scheduler_complete (peek_poll_scheduler (self), BEARER_STATS_POLL_NAME);
+
     if (!MM_BASE_BEARER_GET_CLASS (self)->reload_stats_finish (self, &rx_bytes, &tx_bytes, res, &error)) {
         /* If reloading stats fails, warn about it and don't update anything */
         if (!g_error_matches (error, MM_CORE_ERROR, MM_CORE_ERROR_UNSUPPORTED)) {
@@ -398,8 +419,10 @@ bearer_stats_start (MMBaseBearer *self)
 
     /* Schedule */
     g_assert (!self->priv->stats_update_id);
-    self->priv->stats_update_id = g_timeout_add_seconds (BEARER_STATS_UPDATE_TIMEOUT,
-                                                         (GSourceFunc) stats_update_cb,
+    self->priv->stats_update_id = mm_poll_scheduler_add (peek_poll_scheduler (self),
+                                                         BEARER_STATS_POLL_NAME,
+                                                         BEARER_STATS_UPDATE_TIMEOUT * 1000,
+                                                         (MMPollSchedulerFunc) stats_update_cb,
                                                          self);
     /* Load initial values */
     stats_update_cb (self);
@@ -832,9 +855,13 @@ connect_ready (MMBaseBearer *self,
             mm_port_get_device (mm_bearer_connect_result_peek_data (result)),
             mm_bearer_connect_result_peek_ipv4_config (result),
             mm_bearer_connect_result_peek_ipv6_config (result));
+        mm_trace_set_port (self->priv->connect_trace_span,
+                           mm_port_get_device (mm_bearer_connect_result_peek_data (result)));
         mm_bearer_connect_result_unref (result);
     }
 
+    mm_trace_clear (&self->priv->connect_trace_span);
+
     if (launch_disconnect) {
         bearer_update_status (self, MM_BEARER_STATUS_DISCONNECTING);
         MM_BASE_BEARER_GET_CLASS (self)->disconnect (
@@ -948,6 +975,7 @@ mm_base_bearer_connect (MMBaseBearer *self,
     mm_obj_dbg (self, "connecting...");
     self->priv->connect_cancellable = g_cancellable_new ();
     bearer_update_status (self, MM_BEARER_STATUS_CONNECTING);
+    self->priv->connect_trace_span = mm_trace_begin (self, "bearer", "connect");
     MM_BASE_BEARER_GET_CLASS (self)->connect (
         self,
         self->priv->connect_cancellable,
@@ -1044,6 +1072,8 @@ disconnect_ready (MMBaseBearer *self,
 {
     GError *error = NULL;
 
+    mm_trace_clear (&self->priv->disconnect_trace_span);
+
     if (!MM_BASE_BEARER_GET_CLASS (self)->disconnect_finish (self, res, &error)) {
         mm_obj_dbg (self, "couldn't disconnect: %s", error->message);
         bearer_update_status (self, MM_BEARER_STATUS_CONNECTED);
@@ -1141,6 +1171,7 @@ mm_base_bearer_disconnect (MMBaseBearer *self,
 
     /* Disconnecting! */
     bearer_update_status (self, MM_BEARER_STATUS_DISCONNECTING);
+    self->priv->disconnect_trace_span = mm_trace_begin (self, "bearer", "disconnect");
     MM_BASE_BEARER_GET_CLASS (self)->disconnect (
         self,
         (GAsyncReadyCallback)disconnect_ready,
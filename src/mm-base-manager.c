@@ -44,7 +44,9 @@
 #include "mm-auth-provider.h"
 #include "mm-plugin.h"
 #include "mm-filter.h"
+#include "mm-event-coalescer.h"
 #include "mm-log-object.h"
+#include "mm-trace.h"
 
 static void initable_iface_init   (GInitableIface       *iface);
 static void log_object_iface_init (MMLogObjectInterface *iface);
@@ -90,6 +92,8 @@ struct _MMBaseManagerPrivate {
     GDBusObjectManagerServer *object_manager;
     /* The map of inhibited devices */
     GHashTable *inhibited_devices;
+    /* Hotplug port events waiting to be processed */
+    MMEventCoalescer *port_events;
 
     /* The Test interface support */
     MmGdbusTest *test_skeleton;
@@ -197,6 +201,7 @@ device_support_check_ready (MMPluginManager          *plugin_manager,
         mm_obj_warn (ctx->self, "couldn't create modem for device '%s': %s",
                      mm_device_get_uid (ctx->device), error->message);
         g_error_free (error);
+        mm_plugin_manager_forget_cached_probing (plugin_manager, ctx->device);
         g_hash_table_remove (ctx->self->priv->devices, mm_device_get_uid (ctx->device));
         find_device_support_context_free (ctx);
         return;
@@ -387,6 +392,68 @@ device_added (MMBaseManager  *self,
     mm_device_grab_port (device, port);
 }
 
+/*****************************************************************************/
+/* Hotplug port events are coalesced per physical device for a short window,
+ * so that bursts of add and remove events (e.g. when a hub is reset or when
+ * a modem reboots into a different USB composition) don't launch probings
+ * that are cancelled right away, and so that the ports of a device are
+ * handed to the plugin manager all together. */
+
+#define PORT_EVENTS_COALESCE_WINDOW_MS    250
+#define PORT_EVENTS_COALESCE_MAX_DELAY_MS 2000
+
+typedef struct {
+    MMKernelDevice *kernel_device;
+    gboolean        manual_scan;
+} PortEvent;
+
+static void
+port_event_free (PortEvent *event)
+{
+    g_object_unref (event->kernel_device);
+    g_slice_free (PortEvent, event);
+}
+
+static void
+port_event_process (const gchar            *physdev_uid,
+                    MMEventCoalescerAction  action,
+                    PortEvent              *event,
+                    MMBaseManager          *self)
+{
+    if (action == MM_EVENT_COALESCER_ACTION_ADD)
+        device_added (self, event->kernel_device, TRUE, event->manual_scan);
+    else
+        device_removed (self, event->kernel_device);
+}
+
+static void
+queue_port_event (MMBaseManager          *self,
+                  MMKernelDevice         *kernel_device,
+                  MMEventCoalescerAction  action,
+                  gboolean                manual_scan)
+{
+    PortEvent        *event;
+    const gchar      *physdev_uid;
+    const gchar      *name;
+    g_autofree gchar *key = NULL;
+
+    /* Ports are identified by subsystem and name; the sysfs path is only
+     * a fallback because it may not be given in reported kernel events */
+    name = mm_kernel_device_get_name (kernel_device);
+    if (!name)
+        name = mm_kernel_device_get_sysfs_path (kernel_device);
+    key = g_strdup_printf ("%s/%s", mm_kernel_device_get_subsystem (kernel_device), name ? name : "unknown");
+
+    physdev_uid = mm_kernel_device_get_physdev_uid (kernel_device);
+    if (!physdev_uid)
+        physdev_uid = key;
+
+    event = g_slice_new (PortEvent);
+    event->kernel_device = g_object_ref (kernel_device);
+    event->manual_scan = manual_scan;
+    mm_event_coalescer_push (self->priv->port_events, physdev_uid, key, action, event);
+}
+
 static gboolean
 handle_kernel_event (MMBaseManager            *self,
                      MMKernelEventProperties  *properties,
@@ -438,9 +505,9 @@ handle_kernel_event (MMBaseManager            *self,
         return FALSE;
 
     if (g_strcmp0 (action, "add") == 0)
-        device_added (self, kernel_device, TRUE, TRUE);
+        queue_port_event (self, kernel_device, MM_EVENT_COALESCER_ACTION_ADD, TRUE);
     else if (g_strcmp0 (action, "remove") == 0)
-        device_removed (self, kernel_device);
+        queue_port_event (self, kernel_device, MM_EVENT_COALESCER_ACTION_REMOVE, FALSE);
     else
         g_assert_not_reached ();
     g_object_unref (kernel_device);
@@ -477,9 +544,9 @@ handle_uevent (GUdevClient *client,
     name = mm_kernel_device_get_name (kernel_device);
     if (   (g_str_equal (action, "add") || g_str_equal (action, "move") || g_str_equal (action, "change"))
         && (!g_str_has_prefix (subsys, "usb") || (name && g_str_has_prefix (name, "cdc-wdm"))))
-        device_added (self, kernel_device, TRUE, FALSE);
+        queue_port_event (self, kernel_device, MM_EVENT_COALESCER_ACTION_ADD, FALSE);
     else if (g_str_equal (action, "remove"))
-        device_removed (self, kernel_device);
+        queue_port_event (self, kernel_device, MM_EVENT_COALESCER_ACTION_REMOVE, FALSE);
 
     g_object_unref (kernel_device);
 }
@@ -691,6 +758,10 @@ mm_base_manager_shutdown (MMBaseManager *self,
     /* Cancel all ongoing auth requests */
     g_cancellable_cancel (self->priv->authp_cancellable);
 
+    mm_obj_dbg (self, "%u hotplug port events received, %u suppressed",
+                mm_event_coalescer_get_n_events (self->priv->port_events),
+                mm_event_coalescer_get_n_suppressed (self->priv->port_events));
+
     if (disable) {
         g_hash_table_foreach (self->priv->devices, (GHFunc)foreach_disable, self);
 
@@ -784,6 +855,65 @@ handle_set_logging (MmGdbusOrgFreedesktopModemManager1 *manager,
     return TRUE;
 }
 
+/*****************************************************************************/
+/* Dump log recorder */
+
+typedef struct {
+    MMBaseManager *self;
+    GDBusMethodInvocation *invocation;
+} DumpLogRecorderContext;
+
+static void
+dump_log_recorder_context_free (DumpLogRecorderContext *ctx)
+{
+    g_object_unref (ctx->invocation);
+    g_object_unref (ctx->self);
+    g_free (ctx);
+}
+
+static void
+dump_log_recorder_auth_ready (MMAuthProvider         *authp,
+                              GAsyncResult           *res,
+                              DumpLogRecorderContext *ctx)
+{
+    GError *error = NULL;
+    gchar  *path;
+
+    if (!mm_auth_provider_authorize_finish (authp, res, &error))
+        g_dbus_method_invocation_take_error (ctx->invocation, error);
+    else if (!(path = mm_log_recorder_dump (&error)))
+        g_dbus_method_invocation_take_error (ctx->invocation, error);
+    else {
+        mm_obj_info (ctx->self, "log recorder dumped to %s", path);
+        mm_gdbus_org_freedesktop_modem_manager1_complete_dump_log_recorder (
+            MM_GDBUS_ORG_FREEDESKTOP_MODEM_MANAGER1 (ctx->self),
+            ctx->invocation,
+            path);
+        g_free (path);
+    }
+
+    dump_log_recorder_context_free (ctx);
+}
+
+static gboolean
+handle_dump_log_recorder (MmGdbusOrgFreedesktopModemManager1 *manager,
+                          GDBusMethodInvocation *invocation)
+{
+    DumpLogRecorderContext *ctx;
+
+    ctx = g_new0 (DumpLogRecorderContext, 1);
+    ctx->self = g_object_ref (manager);
+    ctx->invocation = g_object_ref (invocation);
+
+    mm_auth_provider_authorize (ctx->self->priv->authp,
+                                invocation,
+                                MM_AUTHORIZATION_MANAGER_CONTROL,
+                                ctx->self->priv->authp_cancellable,
+                                (GAsyncReadyCallback)dump_log_recorder_auth_ready,
+                                ctx);
+    return TRUE;
+}
+
 /*****************************************************************************/
 /* Manual scan */
 
@@ -1309,6 +1439,27 @@ out:
     return TRUE;
 }
 
+/*****************************************************************************/
+/* Test trace retrieval */
+
+static gboolean
+handle_get_trace (MmGdbusTest           *skeleton,
+                  GDBusMethodInvocation *invocation,
+                  MMBaseManager         *self)
+{
+    g_autofree gchar *trace = NULL;
+
+    if (!mm_trace_enabled ()) {
+        g_dbus_method_invocation_return_error (invocation, MM_CORE_ERROR, MM_CORE_ERROR_UNSUPPORTED,
+                                               "Tracing is disabled");
+        return TRUE;
+    }
+
+    trace = mm_trace_build_chrome_json ();
+    mm_gdbus_test_complete_get_trace (skeleton, invocation, trace);
+    return TRUE;
+}
+
 /*****************************************************************************/
 
 static gchar *
@@ -1446,6 +1597,14 @@ mm_base_manager_init (MMBaseManager *self)
     /* Setup internal list of inhibited devices */
     self->priv->inhibited_devices = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify)inhibited_device_info_free);
 
+    /* Setup hotplug port events coalescing */
+    self->priv->port_events = mm_event_coalescer_new (PORT_EVENTS_COALESCE_WINDOW_MS,
+                                                      PORT_EVENTS_COALESCE_MAX_DELAY_MS,
+                                                      (GDestroyNotify)port_event_free,
+                                                      (MMEventCoalescerFunc)port_event_process,
+                                                      self,
+                                                      self);
+
 #if defined WITH_UDEV
     {
         const gchar *subsys[5] = { "tty", "net", "usb", "usbmisc", NULL };
@@ -1467,6 +1626,7 @@ mm_base_manager_init (MMBaseManager *self)
     /* Enable processing of input DBus messages */
     g_object_connect (self,
                       "signal::handle-set-logging",         G_CALLBACK (handle_set_logging),         NULL,
+                      "signal::handle-dump-log-recorder",   G_CALLBACK (handle_dump_log_recorder),   NULL,
                       "signal::handle-scan-devices",        G_CALLBACK (handle_scan_devices),        NULL,
                       "signal::handle-report-kernel-event", G_CALLBACK (handle_report_kernel_event), NULL,
                       "signal::handle-inhibit-device",      G_CALLBACK (handle_inhibit_device),      NULL,
@@ -1514,6 +1674,10 @@ initable_init (GInitable     *initable,
                           "handle-set-profile",
                           G_CALLBACK (handle_set_profile),
                           initable);
+        g_signal_connect (self->priv->test_skeleton,
+                          "handle-get-trace",
+                          G_CALLBACK (handle_get_trace),
+                          initable);
         if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (self->priv->test_skeleton),
                                                self->priv->connection,
                                                MM_DBUS_PATH,
@@ -1533,6 +1697,9 @@ finalize (GObject *object)
     g_free (self->priv->initial_kernel_events);
     g_free (self->priv->plugin_dir);
 
+    /* Pending port events are discarded */
+    mm_event_coalescer_free (self->priv->port_events);
+
     g_hash_table_destroy (self->priv->inhibited_devices);
     g_hash_table_destroy (self->priv->devices);
 
@@ -89,6 +89,8 @@ modem_cancellable_cancelled (GCancellable *modem_cancellable,
 /*****************************************************************************/
 /* AT sequence handling */
 
+typedef struct _AtSequenceReply AtSequenceReply;
+
 typedef struct {
     MMBaseModem *self;
     MMPortSerialAt *port;
@@ -102,8 +104,20 @@ typedef struct {
     gpointer response_processor_context;
     GDestroyNotify response_processor_context_free;
     GVariant *result;
+    /* Replies of each command when batching, if any */
+    AtSequenceReply *batch_replies;
+    guint n_batch_replies;
+    guint n_batch_pending;
+    /* Priority class of the commands, taken when the sequence started */
+    MMPortSerialPriority priority;
 } AtSequenceContext;
 
+struct _AtSequenceReply {
+    AtSequenceContext *ctx;
+    gchar *response;
+    GError *error;
+};
+
 static void
 at_sequence_context_free (AtSequenceContext *ctx)
 {
@@ -127,6 +141,16 @@ at_sequence_context_free (AtSequenceContext *ctx)
         g_variant_unref (ctx->result);
     if (ctx->simple)
         g_object_unref (ctx->simple);
+    if (ctx->batch_replies) {
+        guint i;
+
+        for (i = 0; i < ctx->n_batch_replies; i++) {
+            g_free (ctx->batch_replies[i].response);
+            if (ctx->batch_replies[i].error)
+                g_error_free (ctx->batch_replies[i].error);
+        }
+        g_free (ctx->batch_replies);
+    }
     g_free (ctx);
 }
 
@@ -153,29 +177,43 @@ mm_base_modem_at_sequence_full_finish (MMBaseModem *self,
 }
 
 static void
-at_sequence_parse_response (MMPortSerialAt *port,
-                            GAsyncResult *res,
-                            AtSequenceContext *ctx)
+at_sequence_complete (AtSequenceContext *ctx,
+                      GVariant          *result)
 {
-    GVariant *result = NULL;
-    GError *result_error = NULL;
-    gboolean continue_sequence;
     GSimpleAsyncResult *simple;
-    const gchar *response;
-    GError *error = NULL;
 
-    response = mm_port_serial_at_command_finish (port, res, &error);
+    /* If we got a response, set it as result */
+    if (result)
+        /* transfer-full */
+        ctx->result = result;
 
-    /* Cancelled? */
-    if (g_cancellable_is_cancelled (ctx->cancellable)) {
-        g_simple_async_result_set_error (ctx->simple, G_IO_ERROR, G_IO_ERROR_CANCELLED,
-                                         "AT sequence was cancelled");
-        if (error)
-            g_error_free (error);
-        g_simple_async_result_complete (ctx->simple);
-        at_sequence_context_free (ctx);
-        return;
-    }
+    /* Set the whole context as result, in order to pass the response
+     * processor context during finish(). We do remove the simple async result
+     * from the context as well, so that we control its last unref. */
+    simple = ctx->simple;
+    ctx->simple = NULL;
+    g_simple_async_result_set_op_res_gpointer (
+        simple,
+        ctx,
+        (GDestroyNotify)at_sequence_context_free);
+
+    /* And complete. The whole context is owned by the result, and it will
+     * be freed when completed. */
+    g_simple_async_result_complete (simple);
+    g_object_unref (simple);
+}
+
+/* Runs the response processor of the current command. Returns TRUE if the
+ * sequence should go on with the next command; otherwise the sequence is
+ * completed (and the context freed) before returning. */
+static gboolean
+at_sequence_process_response (AtSequenceContext *ctx,
+                              const gchar       *response,
+                              const GError      *error)
+{
+    GVariant *result = NULL;
+    GError *result_error = NULL;
+    gboolean continue_sequence;
 
     if (!ctx->current->response_processor)
         /* No need to process response, go on to next command */
@@ -199,71 +237,94 @@ at_sequence_parse_response (MMPortSerialAt *port,
             g_simple_async_result_take_error (ctx->simple, result_error);
             g_simple_async_result_complete (ctx->simple);
             at_sequence_context_free (ctx);
-            if (error)
-                g_error_free (error);
-            return;
+            return FALSE;
         }
     }
 
-    if (error)
-        g_error_free (error);
-
     if (continue_sequence) {
         g_assert (result == NULL);
         ctx->current++;
-        if (ctx->current->command) {
-            /* Schedule the next command in the probing group */
-            mm_port_serial_at_command (
-                ctx->port,
-                ctx->current->command,
-                ctx->current->timeout,
-                FALSE,
-                ctx->current->allow_cached,
-                ctx->cancellable,
-                (GAsyncReadyCallback)at_sequence_parse_response,
-                ctx);
-            return;
-        }
+        if (ctx->current->command)
+            return TRUE;
 
         /* On last command, end. */
     }
 
-    /* If we got a response, set it as result */
-    if (result)
-        /* transfer-full */
-        ctx->result = result;
+    at_sequence_complete (ctx, result);
+    return FALSE;
+}
 
-    /* Set the whole context as result, in order to pass the response
-     * processor context during finish(). We do remove the simple async result
-     * from the context as well, so that we control its last unref. */
-    simple = ctx->simple;
-    ctx->simple = NULL;
-    g_simple_async_result_set_op_res_gpointer (
-        simple,
-        ctx,
-        (GDestroyNotify)at_sequence_context_free);
+static gboolean
+at_sequence_cancelled (AtSequenceContext *ctx)
+{
+    if (!g_cancellable_is_cancelled (ctx->cancellable))
+        return FALSE;
 
-    /* And complete. The whole context is owned by the result, and it will
-     * be freed when completed. */
-    g_simple_async_result_complete (simple);
-    g_object_unref (simple);
+    g_simple_async_result_set_error (ctx->simple, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+                                     "AT sequence was cancelled");
+    g_simple_async_result_complete (ctx->simple);
+    at_sequence_context_free (ctx);
+    return TRUE;
 }
 
-void
-mm_base_modem_at_sequence_full (MMBaseModem *self,
-                                MMPortSerialAt *port,
-                                const MMBaseModemAtCommand *sequence,
-                                gpointer response_processor_context,
-                                GDestroyNotify response_processor_context_free,
-                                GCancellable *cancellable,
-                                GAsyncReadyCallback callback,
-                                gpointer user_data)
+static void at_sequence_parse_response (MMPortSerialAt    *port,
+                                        GAsyncResult      *res,
+                                        AtSequenceContext *ctx);
+
+static void
+at_sequence_run_current (AtSequenceContext *ctx)
 {
-    AtSequenceContext *ctx;
+    mm_port_serial_at_command_full (
+        ctx->port,
+        ctx->current->command,
+        ctx->current->timeout,
+        FALSE,
+        ctx->current->allow_cached,
+        ctx->priority,
+        ctx->cancellable,
+        (GAsyncReadyCallback)at_sequence_parse_response,
+        ctx);
+}
 
-    /* Ensure that we have an open port */
-    if (!abort_async_if_port_unusable (self, port, callback, user_data))
+static void
+at_sequence_parse_response (MMPortSerialAt *port,
+                            GAsyncResult *res,
+                            AtSequenceContext *ctx)
+{
+    const gchar *response;
+    GError *error = NULL;
+    gboolean continue_sequence;
+
+    response = mm_port_serial_at_command_finish (port, res, &error);
+
+    /* Cancelled? */
+    if (at_sequence_cancelled (ctx)) {
+        if (error)
+            g_error_free (error);
         return;
+    }
+
+    continue_sequence = at_sequence_process_response (ctx, response, error);
+    if (error)
+        g_error_free (error);
+
+    /* Schedule the next command in the probing group */
+    if (continue_sequence)
+        at_sequence_run_current (ctx);
+}
+
+static AtSequenceContext *
+at_sequence_context_new (MMBaseModem *self,
+                         MMPortSerialAt *port,
+                         const MMBaseModemAtCommand *sequence,
+                         gpointer response_processor_context,
+                         GDestroyNotify response_processor_context_free,
+                         MMPortSerialPriority priority,
+                         GCancellable *cancellable,
+                         GAsyncReadyCallback callback,
+                         gpointer user_data)
+{
+    AtSequenceContext *ctx;
 
     /* Setup context */
     ctx = g_new0 (AtSequenceContext, 1);
@@ -276,6 +337,7 @@ mm_base_modem_at_sequence_full (MMBaseModem *self,
     ctx->current = ctx->sequence = sequence;
     ctx->response_processor_context = response_processor_context;
     ctx->response_processor_context_free = response_processor_context_free;
+    ctx->priority = priority;
 
     /* Setup cancellables */
     ctx->modem_cancellable = mm_base_modem_get_cancellable (self);
@@ -293,16 +355,59 @@ mm_base_modem_at_sequence_full (MMBaseModem *self,
                                                    NULL);
     }
 
+    return ctx;
+}
+
+void
+mm_base_modem_at_sequence_full_with_priority (MMBaseModem *self,
+                                              MMPortSerialAt *port,
+                                              const MMBaseModemAtCommand *sequence,
+                                              gpointer response_processor_context,
+                                              GDestroyNotify response_processor_context_free,
+                                              MMPortSerialPriority priority,
+                                              GCancellable *cancellable,
+                                              GAsyncReadyCallback callback,
+                                              gpointer user_data)
+{
+    AtSequenceContext *ctx;
+
+    /* Ensure that we have an open port */
+    if (!abort_async_if_port_unusable (self, port, callback, user_data))
+        return;
+
+    ctx = at_sequence_context_new (self,
+                                   port,
+                                   sequence,
+                                   response_processor_context,
+                                   response_processor_context_free,
+                                   priority,
+                                   cancellable,
+                                   callback,
+                                   user_data);
+
     /* Go on with the first one in the sequence */
-    mm_port_serial_at_command (
-        ctx->port,
-        ctx->current->command,
-        ctx->current->timeout,
-        FALSE,
-        ctx->current->allow_cached,
-        ctx->cancellable,
-        (GAsyncReadyCallback)at_sequence_parse_response,
-        ctx);
+    at_sequence_run_current (ctx);
+}
+
+void
+mm_base_modem_at_sequence_full (MMBaseModem *self,
+                                MMPortSerialAt *port,
+                                const MMBaseModemAtCommand *sequence,
+                                gpointer response_processor_context,
+                                GDestroyNotify response_processor_context_free,
+                                GCancellable *cancellable,
+                                GAsyncReadyCallback callback,
+                                gpointer user_data)
+{
+    mm_base_modem_at_sequence_full_with_priority (self,
+                                                  port,
+                                                  sequence,
+                                                  response_processor_context,
+                                                  response_processor_context_free,
+                                                  MM_PORT_SERIAL_PRIORITY_NORMAL,
+                                                  cancellable,
+                                                  callback,
+                                                  user_data);
 }
 
 GVariant *
@@ -351,6 +456,141 @@ mm_base_modem_at_sequence (MMBaseModem *self,
         user_data);
 }
 
+/*****************************************************************************/
+/* Batched AT sequence handling */
+
+static gboolean
+at_sequence_can_batch (MMPortSerialAt             *port,
+                       const MMBaseModemAtCommand *sequence)
+{
+    guint i;
+
+    /* Nothing to gain with a single command */
+    if (!sequence[0].command || !sequence[1].command)
+        return FALSE;
+
+    for (i = 0; sequence[i].command; i++) {
+        if (!mm_port_serial_at_can_batch (port, sequence[i].command))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+at_sequence_batch_command_ready (MMPortSerialAt  *port,
+                                 GAsyncResult    *res,
+                                 AtSequenceReply *reply)
+{
+    AtSequenceContext *ctx = reply->ctx;
+    const gchar *response;
+    guint i;
+
+    response = mm_port_serial_at_command_finish (port, res, &reply->error);
+    reply->response = g_strdup (response);
+
+    if (--ctx->n_batch_pending > 0)
+        return;
+
+    if (at_sequence_cancelled (ctx))
+        return;
+
+    /* Feed each response processor with its own reply, as if the commands
+     * had been sent one by one */
+    for (i = 0; i < ctx->n_batch_replies; i++) {
+        if (!at_sequence_process_response (ctx, ctx->batch_replies[i].response, ctx->batch_replies[i].error))
+            return;
+    }
+    g_assert_not_reached ();
+}
+
+void
+mm_base_modem_at_sequence_batched_full (MMBaseModem *self,
+                                        MMPortSerialAt *port,
+                                        const MMBaseModemAtCommand *sequence,
+                                        gpointer response_processor_context,
+                                        GDestroyNotify response_processor_context_free,
+                                        GCancellable *cancellable,
+                                        GAsyncReadyCallback callback,
+                                        gpointer user_data)
+{
+    AtSequenceContext *ctx;
+    guint i;
+
+    /* Ensure that we have an open port */
+    if (!abort_async_if_port_unusable (self, port, callback, user_data))
+        return;
+
+    ctx = at_sequence_context_new (self,
+                                   port,
+                                   sequence,
+                                   response_processor_context,
+                                   response_processor_context_free,
+                                   MM_PORT_SERIAL_PRIORITY_NORMAL,
+                                   cancellable,
+                                   callback,
+                                   user_data);
+
+    if (!at_sequence_can_batch (port, sequence)) {
+        at_sequence_run_current (ctx);
+        return;
+    }
+
+    for (ctx->n_batch_replies = 0; sequence[ctx->n_batch_replies].command; ctx->n_batch_replies++);
+    ctx->batch_replies = g_new0 (AtSequenceReply, ctx->n_batch_replies);
+    ctx->n_batch_pending = ctx->n_batch_replies;
+
+    /* All commands are issued within a batch window of the port, which sends
+     * them in a single compound command line and splits the reply back, or
+     * runs them one by one if that fails. Cached replies are not allowed, so
+     * that they can be held. */
+    mm_port_serial_at_batch_begin (port);
+    for (i = 0; i < ctx->n_batch_replies; i++) {
+        ctx->batch_replies[i].ctx = ctx;
+        mm_port_serial_at_command (
+            ctx->port,
+            sequence[i].command,
+            sequence[i].timeout,
+            FALSE,
+            FALSE,
+            ctx->cancellable,
+            (GAsyncReadyCallback)at_sequence_batch_command_ready,
+            &ctx->batch_replies[i]);
+    }
+    mm_port_serial_at_batch_end (port);
+}
+
+void
+mm_base_modem_at_sequence_batched (MMBaseModem *self,
+                                   const MMBaseModemAtCommand *sequence,
+                                   gpointer response_processor_context,
+                                   GDestroyNotify response_processor_context_free,
+                                   GAsyncReadyCallback callback,
+                                   gpointer user_data)
+{
+    MMPortSerialAt *port;
+    GError *error = NULL;
+
+    port = mm_base_modem_peek_best_at_port (self, &error);
+    if (!port) {
+        g_assert (error != NULL);
+        g_simple_async_report_take_gerror_in_idle (G_OBJECT (self),
+                                                   callback,
+                                                   user_data,
+                                                   error);
+        return;
+    }
+
+    mm_base_modem_at_sequence_batched_full (
+        self,
+        port,
+        sequence,
+        response_processor_context,
+        response_processor_context_free,
+        NULL,
+        callback,
+        user_data);
+}
+
 /*****************************************************************************/
 /* Response processor helpers */
 
@@ -501,15 +741,16 @@ at_command_ready (MMPortSerialAt *port,
 }
 
 void
-mm_base_modem_at_command_full (MMBaseModem *self,
-                               MMPortSerialAt *port,
-                               const gchar *command,
-                               guint timeout,
-                               gboolean allow_cached,
-                               gboolean is_raw,
-                               GCancellable *cancellable,
-                               GAsyncReadyCallback callback,
-                               gpointer user_data)
+mm_base_modem_at_command_full_with_priority (MMBaseModem *self,
+                                             MMPortSerialAt *port,
+                                             const gchar *command,
+                                             guint timeout,
+                                             gboolean allow_cached,
+                                             gboolean is_raw,
+                                             MMPortSerialPriority priority,
+                                             GCancellable *cancellable,
+                                             GAsyncReadyCallback callback,
+                                             gpointer user_data)
 {
     AtCommandContext *ctx;
 
@@ -542,17 +783,41 @@ mm_base_modem_at_command_full (MMBaseModem *self,
     }
 
     /* Go on with the command */
-    mm_port_serial_at_command (
+    mm_port_serial_at_command_full (
         port,
         command,
         timeout,
         is_raw,
         allow_cached,
+        priority,
         ctx->cancellable,
         (GAsyncReadyCallback)at_command_ready,
         ctx);
 }
 
+void
+mm_base_modem_at_command_full (MMBaseModem *self,
+                               MMPortSerialAt *port,
+                               const gchar *command,
+                               guint timeout,
+                               gboolean allow_cached,
+                               gboolean is_raw,
+                               GCancellable *cancellable,
+                               GAsyncReadyCallback callback,
+                               gpointer user_data)
+{
+    mm_base_modem_at_command_full_with_priority (self,
+                                                 port,
+                                                 command,
+                                                 timeout,
+                                                 allow_cached,
+                                                 is_raw,
+                                                 MM_PORT_SERIAL_PRIORITY_NORMAL,
+                                                 cancellable,
+                                                 callback,
+                                                 user_data);
+}
+
 const gchar *
 mm_base_modem_at_command_finish (MMBaseModem *self,
                                  GAsyncResult *res,
@@ -567,6 +832,7 @@ _at_command (MMBaseModem *self,
              guint timeout,
              gboolean allow_cached,
              gboolean is_raw,
+             MMPortSerialPriority priority,
              GAsyncReadyCallback callback,
              gpointer user_data)
 {
@@ -584,15 +850,16 @@ _at_command (MMBaseModem *self,
         return;
     }
 
-    mm_base_modem_at_command_full (self,
-                                   port,
-                                   command,
-                                   timeout,
-                                   allow_cached,
-                                   is_raw,
-                                   NULL,
-                                   callback,
-                                   user_data);
+    mm_base_modem_at_command_full_with_priority (self,
+                                                 port,
+                                                 command,
+                                                 timeout,
+                                                 allow_cached,
+                                                 is_raw,
+                                                 priority,
+                                                 NULL,
+                                                 callback,
+                                                 user_data);
 }
 
 void
@@ -603,7 +870,19 @@ mm_base_modem_at_command (MMBaseModem *self,
                           GAsyncReadyCallback callback,
                           gpointer user_data)
 {
-    _at_command (self, command, timeout, allow_cached, FALSE, callback, user_data);
+    _at_command (self, command, timeout, allow_cached, FALSE, MM_PORT_SERIAL_PRIORITY_NORMAL, callback, user_data);
+}
+
+void
+mm_base_modem_at_command_with_priority (MMBaseModem *self,
+                                        const gchar *command,
+                                        guint timeout,
+                                        gboolean allow_cached,
+                                        MMPortSerialPriority priority,
+                                        GAsyncReadyCallback callback,
+                                        gpointer user_data)
+{
+    _at_command (self, command, timeout, allow_cached, FALSE, priority, callback, user_data);
 }
 
 void
@@ -614,7 +893,7 @@ mm_base_modem_at_command_raw (MMBaseModem *self,
                               GAsyncReadyCallback callback,
                               gpointer user_data)
 {
-    _at_command (self, command, timeout, allow_cached, TRUE, callback, user_data);
+    _at_command (self, command, timeout, allow_cached, TRUE, MM_PORT_SERIAL_PRIORITY_NORMAL, callback, user_data);
 }
 
 void
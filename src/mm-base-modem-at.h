@@ -86,11 +86,52 @@ void     mm_base_modem_at_sequence_full         (MMBaseModem *self,
                                                  GCancellable *cancellable,
                                                  GAsyncReadyCallback callback,
                                                  gpointer user_data);
+/* Same as mm_base_modem_at_sequence_full(), which schedules the commands in
+ * the normal priority class, but with an explicit priority class */
+void     mm_base_modem_at_sequence_full_with_priority (MMBaseModem *self,
+                                                       MMPortSerialAt *port,
+                                                       const MMBaseModemAtCommand *sequence,
+                                                       gpointer response_processor_context,
+                                                       GDestroyNotify response_processor_context_free,
+                                                       MMPortSerialPriority priority,
+                                                       GCancellable *cancellable,
+                                                       GAsyncReadyCallback callback,
+                                                       gpointer user_data);
 GVariant *mm_base_modem_at_sequence_full_finish (MMBaseModem *self,
                                                  GAsyncResult *res,
                                                  gpointer *response_processor_context,
                                                  GError **error);
 
+/* Batched AT sequence handling: all commands in the sequence are sent in a
+ * single compound command line (e.g. "AT+CGMI;+CGMM;+CGSN") within a batch
+ * window of the port, see mm_port_serial_at_batch_begin(), and each response
+ * processor gets its own response, with the same semantics as in the
+ * non-batched sequence.
+ *
+ * If the modem replies with an error or the reply cannot be split, the
+ * commands are run again one at a time. Sequences with any command the port
+ * won't batch are run as a non-batched sequence.
+ *
+ * All commands are run even if a response processor ends the sequence
+ * early, so only side-effect free queries should be batched.
+ *
+ * The results are retrieved with mm_base_modem_at_sequence_finish() and
+ * mm_base_modem_at_sequence_full_finish() respectively. */
+void     mm_base_modem_at_sequence_batched      (MMBaseModem *self,
+                                                 const MMBaseModemAtCommand *sequence,
+                                                 gpointer response_processor_context,
+                                                 GDestroyNotify response_processor_context_free,
+                                                 GAsyncReadyCallback callback,
+                                                 gpointer user_data);
+void     mm_base_modem_at_sequence_batched_full (MMBaseModem *self,
+                                                 MMPortSerialAt *port,
+                                                 const MMBaseModemAtCommand *sequence,
+                                                 gpointer response_processor_context,
+                                                 GDestroyNotify response_processor_context_free,
+                                                 GCancellable *cancellable,
+                                                 GAsyncReadyCallback callback,
+                                                 gpointer user_data);
+
 /* Common helper response processors */
 
 /* Every string received as response, will be set as result */
@@ -145,6 +186,15 @@ void mm_base_modem_at_command_raw            (MMBaseModem *self,
                                               gboolean allow_cached,
                                               GAsyncReadyCallback callback,
                                               gpointer user_data);
+/* Like mm_base_modem_at_command(), which schedules the command in the
+ * normal priority class, but with an explicit priority class */
+void mm_base_modem_at_command_with_priority  (MMBaseModem *self,
+                                              const gchar *command,
+                                              guint timeout,
+                                              gboolean allow_cached,
+                                              MMPortSerialPriority priority,
+                                              GAsyncReadyCallback callback,
+                                              gpointer user_data);
 const gchar *mm_base_modem_at_command_finish (MMBaseModem *self,
                                               GAsyncResult *res,
                                               GError **error);
@@ -160,6 +210,18 @@ void mm_base_modem_at_command_full                (MMBaseModem *self,
                                                    GCancellable *cancellable,
                                                    GAsyncReadyCallback callback,
                                                    gpointer user_data);
+/* Like mm_base_modem_at_command_full(), which schedules the command in the
+ * normal priority class, but with an explicit priority class */
+void mm_base_modem_at_command_full_with_priority  (MMBaseModem *self,
+                                                   MMPortSerialAt *port,
+                                                   const gchar *command,
+                                                   guint timeout,
+                                                   gboolean allow_cached,
+                                                   gboolean is_raw,
+                                                   MMPortSerialPriority priority,
+                                                   GCancellable *cancellable,
+                                                   GAsyncReadyCallback callback,
+                                                   gpointer user_data);
 const gchar *mm_base_modem_at_command_full_finish (MMBaseModem *self,
                                                    GAsyncResult *res,
                                                    GError **error);
@@ -45,6 +45,9 @@ G_DEFINE_ABSTRACT_TYPE_WITH_CODE (MMBaseModem, mm_base_modem, MM_GDBUS_TYPE_OBJE
  * invalid and we request re-probing. */
 #define DEFAULT_MAX_TIMEOUTS 10
 
+/* Periodic checks due within this time of each other run together */
+#define POLL_MAX_ALIGN_MS 5000
+
 enum {
     PROP_0,
     PROP_VALID,
@@ -106,6 +109,11 @@ struct _MMBaseModemPrivate {
     GList *enable_tasks;
     GList *disable_tasks;
 
+    /* Periodic checks, and the port holding their commands while they run
+     * together */
+    MMPollScheduler *poll_scheduler;
+    MMPortSerialAt *poll_batch_port;
+
 #if defined WITH_QMI
     /* QMI ports */
     GList *qmi;
@@ -225,10 +233,11 @@ mm_base_modem_grab_port (MMBaseModem         *self,
             port = MM_PORT (mm_port_serial_at_new (name, MM_PORT_SUBSYS_TTY));
 
             /* Set common response parser */
-            mm_port_serial_at_set_response_parser (MM_PORT_SERIAL_AT (port),
-                                                   mm_serial_parser_v1_parse,
-                                                   mm_serial_parser_v1_new (),
-                                                   mm_serial_parser_v1_destroy);
+            mm_port_serial_at_set_response_parser_full (MM_PORT_SERIAL_AT (port),
+                                                        mm_serial_parser_v1_parse,
+                                                        mm_serial_parser_v1_check_line,
+                                                        mm_serial_parser_v1_new (),
+                                                        mm_serial_parser_v1_destroy);
             /* Prefer plugin-provided flags to the generic ones */
             if (at_pflags == MM_PORT_SERIAL_AT_FLAG_NONE) {
                 if (mm_kernel_device_get_property_as_boolean (kernel_device, ID_MM_PORT_TYPE_AT_PRIMARY)) {
@@ -315,10 +324,11 @@ mm_base_modem_grab_port (MMBaseModem         *self,
             port = MM_PORT (mm_port_serial_at_new (name, MM_PORT_SUBSYS_USB));
 
             /* Set common response parser */
-            mm_port_serial_at_set_response_parser (MM_PORT_SERIAL_AT (port),
-                                                   mm_serial_parser_v1_parse,
-                                                   mm_serial_parser_v1_new (),
-                                                   mm_serial_parser_v1_destroy);
+            mm_port_serial_at_set_response_parser_full (MM_PORT_SERIAL_AT (port),
+                                                        mm_serial_parser_v1_parse,
+                                                        mm_serial_parser_v1_check_line,
+                                                        mm_serial_parser_v1_new (),
+                                                        mm_serial_parser_v1_destroy);
             /* Store flags already */
             mm_port_serial_at_set_flags (MM_PORT_SERIAL_AT (port), at_pflags);
         }
@@ -339,10 +349,11 @@ mm_base_modem_grab_port (MMBaseModem         *self,
         port = MM_PORT (mm_port_serial_at_new (name, MM_PORT_SUBSYS_UNIX));
 
         /* Set common response parser */
-        mm_port_serial_at_set_response_parser (MM_PORT_SERIAL_AT (port),
-                                               mm_serial_parser_v1_parse,
-                                               mm_serial_parser_v1_new (),
-                                               mm_serial_parser_v1_destroy);
+        mm_port_serial_at_set_response_parser_full (MM_PORT_SERIAL_AT (port),
+                                                    mm_serial_parser_v1_parse,
+                                                    mm_serial_parser_v1_check_line,
+                                                    mm_serial_parser_v1_new (),
+                                                    mm_serial_parser_v1_destroy);
         /* Store flags already */
         mm_port_serial_at_set_flags (MM_PORT_SERIAL_AT (port), at_pflags);
     }
@@ -583,6 +594,14 @@ mm_base_modem_get_cancellable  (MMBaseModem *self)
     return g_object_ref (self->priv->cancellable);
 }
 
+MMPollScheduler *
+mm_base_modem_peek_poll_scheduler (MMBaseModem *self)
+{
+    g_return_val_if_fail (MM_IS_BASE_MODEM (self), NULL);
+
+    return self->priv->poll_scheduler;
+}
+
 MMPortSerialAt *
 mm_base_modem_get_port_primary (MMBaseModem *self)
 {
@@ -1536,6 +1555,27 @@ log_object_build_id (MMLogObject *_self)
 
 /*****************************************************************************/
 
+/* When several periodic checks run together, the commands they send to the
+ * primary port are merged into a single command line */
+static void
+poll_batch (gboolean     begin,
+            MMBaseModem *self)
+{
+    if (begin) {
+        g_assert (!self->priv->poll_batch_port);
+        if (!self->priv->primary)
+            return;
+        self->priv->poll_batch_port = g_object_ref (self->priv->primary);
+        mm_port_serial_at_batch_begin (self->priv->poll_batch_port);
+        return;
+    }
+
+    if (self->priv->poll_batch_port) {
+        mm_port_serial_at_batch_end (self->priv->poll_batch_port);
+        g_clear_object (&self->priv->poll_batch_port);
+    }
+}
+
 static void
 mm_base_modem_init (MMBaseModem *self)
 {
@@ -1563,6 +1603,9 @@ mm_base_modem_init (MMBaseModem *self)
 
     self->priv->max_timeouts = DEFAULT_MAX_TIMEOUTS;
 
+    self->priv->poll_scheduler = mm_poll_scheduler_new (POLL_MAX_ALIGN_MS, self);
+    mm_poll_scheduler_set_batch_func (self->priv->poll_scheduler, (MMPollSchedulerBatchFunc)poll_batch, self);
+
     setup_ports_table (self);
 }
 
@@ -1666,6 +1709,10 @@ finalize (GObject *object)
     g_assert (!self->priv->enable_tasks);
     g_assert (!self->priv->disable_tasks);
 
+    /* Polls still registered are removed along with their owners, once the
+     * scheduler is gone */
+    g_clear_pointer (&self->priv->poll_scheduler, mm_poll_scheduler_free);
+
     mm_obj_dbg (self, "completely disposed");
 
     g_free (self->priv->device);
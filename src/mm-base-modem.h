@@ -34,6 +34,7 @@
 #include "mm-port-serial-at.h"
 #include "mm-port-serial-qcdm.h"
 #include "mm-port-serial-gps.h"
+#include "mm-poll-scheduler.h"
 
 #if defined WITH_QMI
 #include "mm-port-qmi.h"
@@ -184,6 +185,10 @@ guint mm_base_modem_get_product_id (MMBaseModem *self);
 GCancellable *mm_base_modem_peek_cancellable (MMBaseModem *self);
 GCancellable *mm_base_modem_get_cancellable  (MMBaseModem *self);
 
+/* Scheduler shared by all periodic checks of the modem; NULL once the modem
+ * is being finalized */
+MMPollScheduler *mm_base_modem_peek_poll_scheduler (MMBaseModem *self);
+
 void     mm_base_modem_authorize        (MMBaseModem *self,
                                          GDBusMethodInvocation *invocation,
                                          const gchar *authorization,
@@ -1246,16 +1246,20 @@ sms_send_next_part (GTask *task)
         return;
     }
 
+    /* Sending is requested by the user, so the commands are scheduled as
+     * interactive, not to be delayed by polling */
+
     /* Send from storage */
     if (ctx->from_storage) {
         cmd = g_strdup_printf ("+CMSS=%d",
                                mm_sms_part_get_index ((MMSmsPart *)ctx->current->data));
-        mm_base_modem_at_command (ctx->modem,
-                                  cmd,
-                                  60,
-                                  FALSE,
-                                  (GAsyncReadyCallback)send_from_storage_ready,
-                                  task);
+        mm_base_modem_at_command_with_priority (ctx->modem,
+                                                cmd,
+                                                60,
+                                                FALSE,
+                                                MM_PORT_SERIAL_PRIORITY_INTERACTIVE,
+                                                (GAsyncReadyCallback)send_from_storage_ready,
+                                                task);
         g_free (cmd);
         return;
     }
@@ -1280,12 +1284,13 @@ sms_send_next_part (GTask *task)
 
     g_assert (cmd != NULL);
     g_assert (ctx->msg_data != NULL);
-    mm_base_modem_at_command (ctx->modem,
-                              cmd,
-                              60,
-                              FALSE,
-                              (GAsyncReadyCallback)send_generic_ready,
-                              task);
+    mm_base_modem_at_command_with_priority (ctx->modem,
+                                            cmd,
+                                            60,
+                                            FALSE,
+                                            MM_PORT_SERIAL_PRIORITY_INTERACTIVE,
+                                            (GAsyncReadyCallback)send_generic_ready,
+                                            task);
     g_free (cmd);
 }
 
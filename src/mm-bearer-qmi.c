@@ -32,6 +32,7 @@
 #include "mm-modem-helpers-qmi.h"
 #include "mm-port-enums-types.h"
 #include "mm-log-object.h"
+#include "mm-trace.h"
 #include "mm-modem-helpers.h"
 
 G_DEFINE_TYPE (MMBearerQmi, mm_bearer_qmi, MM_TYPE_BASE_BEARER)
@@ -459,11 +460,15 @@ typedef struct {
     guint32 packet_data_handle_ipv6;
     MMBearerIpConfig *ipv6_config;
     GError *error_ipv6;
+
+    MMTraceSpan trace_span;
 } ConnectContext;
 
 static void
 connect_context_free (ConnectContext *ctx)
 {
+    mm_trace_clear (&ctx->trace_span);
+
     g_free (ctx->apn);
     g_free (ctx->user);
     g_free (ctx->password);
@@ -1370,7 +1375,7 @@ get_mux_id(MMPort *data)
 }
 
 static void
-connect_context_step (GTask *task)
+connect_context_step_run (GTask *task)
 {
     MMBearerQmi    *self;
     ConnectContext *ctx;
@@ -1749,6 +1754,21 @@ connect_context_step (GTask *task)
     }
 }
 
+static void
+connect_context_step (GTask *task)
+{
+    ConnectContext *ctx;
+
+    ctx = g_task_get_task_data (task);
+    g_object_ref (task);
+    connect_context_step_run (task);
+    if (ctx->step == CONNECT_STEP_LAST)
+        mm_trace_clear (&ctx->trace_span);
+    else
+        mm_trace_step (&ctx->trace_span, g_task_get_source_object (task), "qmi-connect", ctx->step);
+    g_object_unref (task);
+}
+
 static void
 cancel_operation_cancellable (GCancellable *cancellable,
                               GCancellable *operation_cancellable)
@@ -1986,11 +2006,15 @@ typedef struct {
     GError *error_ipv6;
 
     MMPort *data;
+
+    MMTraceSpan trace_span;
 } DisconnectContext;
 
 static void
 disconnect_context_free (DisconnectContext *ctx)
 {
+    mm_trace_clear (&ctx->trace_span);
+
     if (ctx->error_ipv4)
         g_error_free (ctx->error_ipv4);
     if (ctx->error_ipv6)
@@ -2112,7 +2136,7 @@ stop_network_ready (QmiClientWds *client,
 }
 
 static void
-disconnect_context_step (GTask *task)
+disconnect_context_step_run (GTask *task)
 {
     MMBearerQmi *self;
     DisconnectContext *ctx;
@@ -2213,6 +2237,21 @@ disconnect_context_step (GTask *task)
     }
 }
 
+static void
+disconnect_context_step (GTask *task)
+{
+    DisconnectContext *ctx;
+
+    ctx = g_task_get_task_data (task);
+    g_object_ref (task);
+    disconnect_context_step_run (task);
+    if (ctx->step == DISCONNECT_STEP_LAST)
+        mm_trace_clear (&ctx->trace_span);
+    else
+        mm_trace_step (&ctx->trace_span, g_task_get_source_object (task), "qmi-disconnect", ctx->step);
+    g_object_unref (task);
+}
+
 static void
 disconnect (MMBaseBearer *_self,
             GAsyncReadyCallback callback,
@@ -33,6 +33,7 @@
 #include "mm-iface-modem-cdma.h"
 #include "mm-base-modem-at.h"
 #include "mm-log-object.h"
+#include "mm-trace.h"
 #include "mm-modem-helpers.h"
 #include "mm-port-enums-types.h"
 #include "mm-helper-enums-types.h"
@@ -266,15 +267,16 @@ cdma_connect_context_dial (GTask *task)
 
     ctx = g_task_get_task_data (task);
 
-    mm_base_modem_at_command_full (ctx->modem,
-                                   MM_PORT_SERIAL_AT (ctx->data),
-                                   "DT#777",
-                                   90,
-                                   FALSE,
-                                   FALSE,
-                                   NULL,
-                                   (GAsyncReadyCallback)dial_cdma_ready,
-                                   task);
+    mm_base_modem_at_command_full_with_priority (ctx->modem,
+                                                 MM_PORT_SERIAL_AT (ctx->data),
+                                                 "DT#777",
+                                                 90,
+                                                 FALSE,
+                                                 FALSE,
+                                                 MM_PORT_SERIAL_PRIORITY_INTERACTIVE,
+                                                 NULL,
+                                                 (GAsyncReadyCallback)dial_cdma_ready,
+                                                 task);
 }
 
 static void
@@ -581,17 +583,19 @@ dial_3gpp (MMBroadbandBearer *self,
         return;
     }
 
-    /* Use default *99 to connect */
+    /* Use default *99 to connect; connections are requested by the user, so
+     * don't let polling delay the dial */
     command = g_strdup_printf ("ATD*99***%d#", cid);
-    mm_base_modem_at_command_full (ctx->modem,
-                                   ctx->dial_port,
-                                   command,
-                                   60,
-                                   FALSE,
-                                   FALSE, /* raw */
-                                   NULL, /* cancellable */
-                                   (GAsyncReadyCallback)atd_ready,
-                                   task);
+    mm_base_modem_at_command_full_with_priority (ctx->modem,
+                                                 ctx->dial_port,
+                                                 command,
+                                                 60,
+                                                 FALSE,
+                                                 FALSE, /* raw */
+                                                 MM_PORT_SERIAL_PRIORITY_INTERACTIVE,
+                                                 NULL, /* cancellable */
+                                                 (GAsyncReadyCallback)atd_ready,
+                                                 task);
     g_free (command);
 }
 
@@ -619,11 +623,13 @@ typedef struct {
     gboolean              cid_overwritten;
     MMBearerIpFamily      ip_family;
     const gchar          *pdp_type;
+    MMTraceSpan           trace_span;
 } CidSelection3gppContext;
 
 static void
 cid_selection_3gpp_context_free (CidSelection3gppContext *ctx)
 {
+    mm_trace_clear (&ctx->trace_span);
     mm_3gpp_pdp_context_format_list_free (ctx->context_format_list);
     mm_3gpp_pdp_context_list_free (ctx->context_list);
     g_object_unref (ctx->modem);
@@ -693,15 +699,16 @@ cid_selection_3gpp_initialize_context (GTask *task)
     cmd = g_strdup_printf ("+CGDCONT=%u,\"%s\",%s", ctx->cid, ctx->pdp_type, quoted_apn);
     g_free (quoted_apn);
 
-    mm_base_modem_at_command_full (ctx->modem,
-                                   ctx->primary,
-                                   cmd,
-                                   3,
-                                   FALSE,
-                                   FALSE, /* raw */
-                                   NULL, /* cancellable */
-                                   (GAsyncReadyCallback) cgdcont_set_ready,
-                                   task);
+    mm_base_modem_at_command_full_with_priority (ctx->modem,
+                                                 ctx->primary,
+                                                 cmd,
+                                                 3,
+                                                 FALSE,
+                                                 FALSE, /* raw */
+                                                 MM_PORT_SERIAL_PRIORITY_INTERACTIVE,
+                                                 NULL, /* cancellable */
+                                                 (GAsyncReadyCallback) cgdcont_set_ready,
+                                                 task);
     g_free (cmd);
 }
 
@@ -796,15 +803,16 @@ cid_selection_3gpp_query_current (GTask *task)
     ctx  = g_task_get_task_data (task);
 
     mm_obj_dbg (self, "checking currently defined contexts...");
-    mm_base_modem_at_command_full (ctx->modem,
-                                   ctx->primary,
-                                   "+CGDCONT?",
-                                   3,
-                                   FALSE, /* cached */
-                                   FALSE, /* raw */
-                                   ctx->cancellable,
-                                   (GAsyncReadyCallback)cgdcont_query_ready,
-                                   task);
+    mm_base_modem_at_command_full_with_priority (ctx->modem,
+                                                 ctx->primary,
+                                                 "+CGDCONT?",
+                                                 3,
+                                                 FALSE, /* cached */
+                                                 FALSE, /* raw */
+                                                 MM_PORT_SERIAL_PRIORITY_INTERACTIVE,
+                                                 ctx->cancellable,
+                                                 (GAsyncReadyCallback)cgdcont_query_ready,
+                                                 task);
 }
 
 static void
@@ -850,19 +858,20 @@ cid_selection_3gpp_query_format (GTask *task)
     ctx  = g_task_get_task_data (task);
 
     mm_obj_dbg (self, "checking context definition format...");
-    mm_base_modem_at_command_full (ctx->modem,
-                                   ctx->primary,
-                                   "+CGDCONT=?",
-                                   3,
-                                   TRUE, /* cached */
-                                   FALSE, /* raw */
-                                   ctx->cancellable,
-                                   (GAsyncReadyCallback)cgdcont_test_ready,
-                                   task);
+    mm_base_modem_at_command_full_with_priority (ctx->modem,
+                                                 ctx->primary,
+                                                 "+CGDCONT=?",
+                                                 3,
+                                                 TRUE, /* cached */
+                                                 FALSE, /* raw */
+                                                 MM_PORT_SERIAL_PRIORITY_INTERACTIVE,
+                                                 ctx->cancellable,
+                                                 (GAsyncReadyCallback)cgdcont_test_ready,
+                                                 task);
 }
 
 static void
-cid_selection_3gpp_context_step (GTask *task)
+cid_selection_3gpp_context_step_run (GTask *task)
 {
     CidSelection3gppContext *ctx;
 
@@ -906,6 +915,21 @@ cid_selection_3gpp_context_step (GTask *task)
     }
 }
 
+static void
+cid_selection_3gpp_context_step (GTask *task)
+{
+    CidSelection3gppContext *ctx;
+
+    ctx = g_task_get_task_data (task);
+    g_object_ref (task);
+    cid_selection_3gpp_context_step_run (task);
+    if (ctx->step == CID_SELECTION_3GPP_STEP_LAST)
+        mm_trace_clear (&ctx->trace_span);
+    else
+        mm_trace_step (&ctx->trace_span, g_task_get_source_object (task), "cid-selection", ctx->step);
+    g_object_unref (task);
+}
+
 static void
 cid_selection_3gpp (MMBroadbandBearer   *self,
                     MMBaseModem         *modem,
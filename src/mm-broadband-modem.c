@@ -49,6 +49,8 @@
 #include "mm-call-list.h"
 #include "mm-base-sim.h"
 #include "mm-log-object.h"
+#include "mm-trace.h"
+#include "mm-property-cache.h"
 #include "mm-modem-helpers.h"
 #include "mm-error-helpers.h"
 #include "mm-port-serial-qcdm.h"
@@ -123,6 +125,7 @@ enum {
     PROP_MODEM_SIM_HOT_SWAP_CONFIGURED,
     PROP_MODEM_PERIODIC_SIGNAL_CHECK_DISABLED,
     PROP_MODEM_PERIODIC_ACCESS_TECH_CHECK_DISABLED,
+    PROP_MODEM_PROPERTY_CACHE_LOADERS_SAFE,
     PROP_MODEM_PERIODIC_CALL_LIST_CHECK_DISABLED,
     PROP_MODEM_CARRIER_CONFIG_MAPPING,
     PROP_FLOW_CONTROL,
@@ -172,6 +175,11 @@ struct _MMBroadbandModemPrivate {
     gboolean modem_cgerep_support_checked;
     gboolean modem_cgerep_supported;
     MMFlowControl flow_control;
+    gboolean modem_device_info_batched;
+    MMBaseModemAtCommand modem_device_info_batch[4];
+    gchar *modem_batched_manufacturer;
+    gchar *modem_batched_model;
+    gchar *modem_batched_equipment_identifier;
 
     /*<--- Modem 3GPP interface --->*/
     /* Properties */
@@ -908,16 +916,208 @@ modem_load_current_capabilities (MMIfaceModem *self,
 }
 
 /*****************************************************************************/
-/* Manufacturer loading (Modem interface) */
+/* Device information loading (Modem interface) */
+
+/* The manufacturer, model and equipment identifier are queried together in a
+ * single compound command line the first time any of them is loaded, and each
+ * loader then takes its own reply; whatever the batch couldn't provide is
+ * loaded with the loader's own sequence. The revision is always loaded on its
+ * own, as its reply may span several untagged lines that can't be told apart
+ * from the rest of the compound reply. */
+
+static void modem_load_manufacturer         (MMIfaceModem        *self,
+                                             GAsyncReadyCallback  callback,
+                                             gpointer             user_data);
+static void modem_load_model                (MMIfaceModem        *self,
+                                             GAsyncReadyCallback  callback,
+                                             gpointer             user_data);
+static void modem_load_equipment_identifier (MMIfaceModem        *self,
+                                             GAsyncReadyCallback  callback,
+                                             gpointer             user_data);
+
+static gchar **
+device_info_peek_batched_reply (MMBroadbandModem *self,
+                                const gchar      *command)
+{
+    if (g_str_equal (command, "+CGMI"))
+        return &self->priv->modem_batched_manufacturer;
+    if (g_str_equal (command, "+CGMM"))
+        return &self->priv->modem_batched_model;
+    g_assert (g_str_equal (command, "+CGSN"));
+    return &self->priv->modem_batched_equipment_identifier;
+}
+
+static gboolean
+device_info_batch_response_processor (MMBaseModem   *self,
+                                      gpointer       none,
+                                      const gchar   *command,
+                                      const gchar   *response,
+                                      gboolean       last_command,
+                                      const GError  *error,
+                                      GVariant     **result,
+                                      GError       **result_error)
+{
+    gchar **reply;
+
+    /* Keep the reply for the loader, and always go on with the next one */
+    if (!error) {
+        reply = device_info_peek_batched_reply (MM_BROADBAND_MODEM (self), command);
+        g_free (*reply);
+        *reply = g_strdup (response);
+    }
+    return FALSE;
+}
+
+typedef struct {
+    const MMBaseModemAtCommand *sequence;
+    gchar                      *batched_command;
+} DeviceInfoContext;
+
+static void
+device_info_context_free (DeviceInfoContext *ctx)
+{
+    g_free (ctx->batched_command);
+    g_slice_free (DeviceInfoContext, ctx);
+}
+
+static gchar *
+device_info_load_finish (MMIfaceModem  *self,
+                         GAsyncResult  *res,
+                         GError       **error)
+{
+    return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+static void
+device_info_sequence_ready (MMBaseModem  *self,
+                            GAsyncResult *res,
+                            GTask        *task)
+{
+    GVariant *result;
+    GError   *error = NULL;
+
+    result = mm_base_modem_at_sequence_finish (self, res, NULL, &error);
+    if (error)
+        g_task_return_error (task, error);
+    else
+        g_task_return_pointer (task, result ? g_variant_dup_string (result, NULL) : NULL, g_free);
+    g_object_unref (task);
+}
+
+static void
+device_info_load_run (GTask *task)
+{
+    MMBroadbandModem  *self;
+    DeviceInfoContext *ctx;
+    gchar             *reply;
+
+    self = g_task_get_source_object (task);
+    ctx = g_task_get_task_data (task);
+
+    reply = g_steal_pointer (device_info_peek_batched_reply (self, ctx->batched_command));
+    if (reply) {
+        g_task_return_pointer (task, reply, g_free);
+        g_object_unref (task);
+        return;
+    }
+
+    mm_base_modem_at_sequence (
+        MM_BASE_MODEM (self),
+        ctx->sequence,
+        NULL, /* response_processor_context */
+        NULL, /* response_processor_context_free */
+        (GAsyncReadyCallback)device_info_sequence_ready,
+        task);
+}
+
+static void
+device_info_batch_ready (MMBaseModem  *self,
+                         GAsyncResult *res,
+                         GTask        *task)
+{
+    g_autoptr(GError) error = NULL;
+
+    /* Errors are not fatal, the loaders fall back to their own sequences */
+    mm_base_modem_at_sequence_finish (self, res, NULL, &error);
+    if (error)
+        mm_obj_dbg (self, "couldn't load device information in a single command: %s", error->message);
+    device_info_load_run (task);
+}
+
+static void
+device_info_batch_add (MMBroadbandModem *self,
+                       guint            *n_commands,
+                       const gchar      *command)
+{
+    MMBaseModemAtCommand *batch;
+
+    g_assert (*n_commands < G_N_ELEMENTS (self->priv->modem_device_info_batch) - 1);
+    batch = &self->priv->modem_device_info_batch[(*n_commands)++];
+    batch->command = command;
+    batch->timeout = 3;
+    batch->allow_cached = FALSE;
+    batch->response_processor = device_info_batch_response_processor;
+}
+
+static void
+device_info_load (MMBroadbandModem           *self,
+                  const gchar                *batched_command,
+                  const MMBaseModemAtCommand *sequence,
+                  GAsyncReadyCallback         callback,
+                  gpointer                    user_data)
+{
+    MMIfaceModem      *iface;
+    DeviceInfoContext *ctx;
+    GTask             *task;
+    guint              n_commands = 0;
+
+    task = g_task_new (self, NULL, callback, user_data);
+    ctx = g_slice_new0 (DeviceInfoContext);
+    ctx->sequence = sequence;
+    ctx->batched_command = g_strdup (batched_command);
+    g_task_set_task_data (task, ctx, (GDestroyNotify)device_info_context_free);
+
+    if (self->priv->modem_device_info_batched) {
+        device_info_load_run (task);
+        return;
+    }
+    self->priv->modem_device_info_batched = TRUE;
+
+    /* Only batch the queries of the loaders not overridden by plugins, so that
+     * commands a plugin avoids are never sent */
+    iface = MM_IFACE_MODEM_GET_INTERFACE (self);
+    if (iface->load_manufacturer == modem_load_manufacturer)
+        device_info_batch_add (self, &n_commands, "+CGMI");
+    if (iface->load_model == modem_load_model)
+        device_info_batch_add (self, &n_commands, "+CGMM");
+    /* On CDMA-only (non-3GPP) modems, the equipment identifier is loaded
+     * with +GSN */
+    if (iface->load_equipment_identifier == modem_load_equipment_identifier &&
+        !mm_iface_modem_is_cdma_only (MM_IFACE_MODEM (self)))
+        device_info_batch_add (self, &n_commands, "+CGSN");
+
+    if (n_commands < 2) {
+        device_info_load_run (task);
+        return;
+    }
+
+    mm_base_modem_at_sequence_batched (
+        MM_BASE_MODEM (self),
+        self->priv->modem_device_info_batch,
+        NULL, /* response_processor_context */
+        NULL, /* response_processor_context_free */
+        (GAsyncReadyCallback)device_info_batch_ready,
+        task);
+}
 
 static gchar *
-sanitize_info_reply (GVariant *v, const char *prefix)
+sanitize_info_reply (const gchar *reply,
+                     const char  *prefix)
 {
-    const gchar *reply, *p;
+    const gchar *p;
     gchar *sanitized;
 
     /* Strip any leading command reply */
-    reply = g_variant_get_string (v, NULL);
     p = strstr (reply, prefix);
     if (p)
         reply = p + strlen (prefix);
@@ -925,15 +1125,18 @@ sanitize_info_reply (GVariant *v, const char *prefix)
     return mm_strip_quotes (g_strstrip (sanitized));
 }
 
+/*****************************************************************************/
+/* Manufacturer loading (Modem interface) */
+
 static gchar *
 modem_load_manufacturer_finish (MMIfaceModem *self,
                                 GAsyncResult *res,
                                 GError **error)
 {
-    GVariant *result;
+    g_autofree gchar *result = NULL;
     gchar *manufacturer = NULL;
 
-    result = mm_base_modem_at_sequence_finish (MM_BASE_MODEM (self), res, NULL, error);
+    result = device_info_load_finish (self, res, error);
     if (result) {
         manufacturer = sanitize_info_reply (result, "GMI:");
         mm_obj_dbg (self, "loaded manufacturer: %s", manufacturer);
@@ -953,13 +1156,7 @@ modem_load_manufacturer (MMIfaceModem *self,
                          gpointer user_data)
 {
     mm_obj_dbg (self, "loading manufacturer...");
-    mm_base_modem_at_sequence (
-        MM_BASE_MODEM (self),
-        manufacturers,
-        NULL, /* response_processor_context */
-        NULL, /* response_processor_context_free */
-        callback,
-        user_data);
+    device_info_load (MM_BROADBAND_MODEM (self), "+CGMI", manufacturers, callback, user_data);
 }
 
 /*****************************************************************************/
@@ -970,10 +1167,10 @@ modem_load_model_finish (MMIfaceModem *self,
                          GAsyncResult *res,
                          GError **error)
 {
-    GVariant *result;
+    g_autofree gchar *result = NULL;
     gchar *model = NULL;
 
-    result = mm_base_modem_at_sequence_finish (MM_BASE_MODEM (self), res, NULL, error);
+    result = device_info_load_finish (self, res, error);
     if (result) {
         model = sanitize_info_reply (result, "GMM:");
         mm_obj_dbg (self, "loaded model: %s", model);
@@ -993,13 +1190,7 @@ modem_load_model (MMIfaceModem *self,
                   gpointer user_data)
 {
     mm_obj_dbg (self, "loading model...");
-    mm_base_modem_at_sequence (
-        MM_BASE_MODEM (self),
-        models,
-        NULL, /* response_processor_context */
-        NULL, /* response_processor_context_free */
-        callback,
-        user_data);
+    device_info_load (MM_BROADBAND_MODEM (self), "+CGMM", models, callback, user_data);
 }
 
 /*****************************************************************************/
@@ -1015,7 +1206,7 @@ modem_load_revision_finish (MMIfaceModem *self,
 
     result = mm_base_modem_at_sequence_finish (MM_BASE_MODEM (self), res, NULL, error);
     if (result) {
-        revision = sanitize_info_reply (result, "GMR:");
+        revision = sanitize_info_reply (g_variant_get_string (result, NULL), "GMR:");
         mm_obj_dbg (self, "loaded revision: %s", revision);
     }
     return revision;
@@ -1050,10 +1241,10 @@ modem_load_equipment_identifier_finish (MMIfaceModem *self,
                                         GAsyncResult *res,
                                         GError **error)
 {
-    GVariant *result;
+    g_autofree gchar *result = NULL;
     gchar *equip_id = NULL, *esn = NULL, *meid = NULL, *imei = NULL;
 
-    result = mm_base_modem_at_sequence_finish (MM_BASE_MODEM (self), res, NULL, error);
+    result = device_info_load_finish (self, res, error);
     if (result) {
         equip_id = sanitize_info_reply (result, "GSN:");
 
@@ -1100,13 +1291,7 @@ modem_load_equipment_identifier (MMIfaceModem *self,
     if (mm_iface_modem_is_cdma_only (self))
         commands++;
 
-    mm_base_modem_at_sequence (
-        MM_BASE_MODEM (self),
-        commands,
-        NULL, /* response_processor_context */
-        NULL, /* response_processor_context_free */
-        callback,
-        user_data);
+    device_info_load (MM_BROADBAND_MODEM (self), "+CGSN", commands, callback, user_data);
 }
 
 /*****************************************************************************/
@@ -2113,12 +2298,15 @@ signal_quality_csq (GTask *task)
     self = g_task_get_source_object (task);
     ctx = g_task_get_task_data (task);
 
-    mm_base_modem_at_sequence_full (
+    /* Signal quality is loaded by the periodic checks, which must not delay
+     * commands run on behalf of the user */
+    mm_base_modem_at_sequence_full_with_priority (
         MM_BASE_MODEM (self),
         MM_PORT_SERIAL_AT (ctx->at_port),
         signal_quality_csq_sequence,
         NULL, /* response_processor_context */
         NULL, /* response_processor_context_free */
+        MM_PORT_SERIAL_PRIORITY_BACKGROUND,
         NULL, /* cancellable */
         (GAsyncReadyCallback)signal_quality_csq_ready,
         task);
@@ -2209,15 +2397,16 @@ signal_quality_cind (GTask *task)
     self = g_task_get_source_object (task);
     ctx = g_task_get_task_data (task);
 
-    mm_base_modem_at_command_full (MM_BASE_MODEM (self),
-                                   MM_PORT_SERIAL_AT (ctx->at_port),
-                                   "+CIND?",
-                                   5,
-                                   FALSE,
-                                   FALSE, /* raw */
-                                   NULL, /* cancellable */
-                                   (GAsyncReadyCallback)signal_quality_cind_ready,
-                                   task);
+    mm_base_modem_at_command_full_with_priority (MM_BASE_MODEM (self),
+                                                 MM_PORT_SERIAL_AT (ctx->at_port),
+                                                 "+CIND?",
+                                                 5,
+                                                 FALSE,
+                                                 FALSE, /* raw */
+                                                 MM_PORT_SERIAL_PRIORITY_BACKGROUND,
+                                                 NULL, /* cancellable */
+                                                 (GAsyncReadyCallback)signal_quality_cind_ready,
+                                                 task);
 }
 
 static void
@@ -5078,16 +5267,21 @@ run_registration_checks_context_step (GTask *task)
     ctx->running_eps = FALSE;
     ctx->running_5gs = FALSE;
 
+    /* The registration state is mostly queried by the periodic checks, and
+     * otherwise reported with unsolicited messages, so the queries are
+     * scheduled as background commands that never delay user requests */
+
     if (ctx->run_cs) {
         ctx->running_cs = TRUE;
         ctx->run_cs = FALSE;
         /* Check current CS-registration state. */
-        mm_base_modem_at_command (MM_BASE_MODEM (self),
-                                  "+CREG?",
-                                  10,
-                                  FALSE,
-                                  (GAsyncReadyCallback)registration_status_check_ready,
-                                  task);
+        mm_base_modem_at_command_with_priority (MM_BASE_MODEM (self),
+                                                "+CREG?",
+                                                10,
+                                                FALSE,
+                                                MM_PORT_SERIAL_PRIORITY_BACKGROUND,
+                                                (GAsyncReadyCallback)registration_status_check_ready,
+                                                task);
         return;
     }
 
@@ -5095,12 +5289,13 @@ run_registration_checks_context_step (GTask *task)
         ctx->running_ps = TRUE;
         ctx->run_ps = FALSE;
         /* Check current PS-registration state. */
-        mm_base_modem_at_command (MM_BASE_MODEM (self),
-                                  "+CGREG?",
-                                  10,
-                                  FALSE,
-                                  (GAsyncReadyCallback)registration_status_check_ready,
-                                  task);
+        mm_base_modem_at_command_with_priority (MM_BASE_MODEM (self),
+                                                "+CGREG?",
+                                                10,
+                                                FALSE,
+                                                MM_PORT_SERIAL_PRIORITY_BACKGROUND,
+                                                (GAsyncReadyCallback)registration_status_check_ready,
+                                                task);
         return;
     }
 
@@ -5108,12 +5303,13 @@ run_registration_checks_context_step (GTask *task)
         ctx->running_eps = TRUE;
         ctx->run_eps = FALSE;
         /* Check current EPS-registration state. */
-        mm_base_modem_at_command (MM_BASE_MODEM (self),
-                                  "+CEREG?",
-                                  10,
-                                  FALSE,
-                                  (GAsyncReadyCallback)registration_status_check_ready,
-                                  task);
+        mm_base_modem_at_command_with_priority (MM_BASE_MODEM (self),
+                                                "+CEREG?",
+                                                10,
+                                                FALSE,
+                                                MM_PORT_SERIAL_PRIORITY_BACKGROUND,
+                                                (GAsyncReadyCallback)registration_status_check_ready,
+                                                task);
         return;
     }
 
@@ -5121,12 +5317,13 @@ run_registration_checks_context_step (GTask *task)
         ctx->running_5gs = TRUE;
         ctx->run_5gs = FALSE;
         /* Check current 5GS-registration state. */
-        mm_base_modem_at_command (MM_BASE_MODEM (self),
-                                  "+C5GREG?",
-                                  10,
-                                  FALSE,
-                                  (GAsyncReadyCallback)registration_status_check_ready,
-                                  task);
+        mm_base_modem_at_command_with_priority (MM_BASE_MODEM (self),
+                                                "+C5GREG?",
+                                                10,
+                                                FALSE,
+                                                MM_PORT_SERIAL_PRIORITY_BACKGROUND,
+                                                (GAsyncReadyCallback)registration_status_check_ready,
+                                                task);
         return;
     }
 
@@ -7675,12 +7872,14 @@ modem_voice_load_call_list (MMIfaceModemVoice   *self,
     GTask *task;
 
     task = g_task_new (self, NULL, callback, user_data);
-    mm_base_modem_at_command (MM_BASE_MODEM (self),
-                              "+CLCC",
-                              5,
-                              FALSE,
-                              (GAsyncReadyCallback)clcc_ready,
-                              task);
+    /* Mostly run by the call list polling, so don't delay user requests */
+    mm_base_modem_at_command_with_priority (MM_BASE_MODEM (self),
+                                            "+CLCC",
+                                            5,
+                                            FALSE,
+                                            MM_PORT_SERIAL_PRIORITY_BACKGROUND,
+                                            (GAsyncReadyCallback)clcc_ready,
+                                            task);
 }
 
 /*****************************************************************************/
@@ -10489,6 +10688,7 @@ typedef struct {
     DisablingStep step;
     MMModemState previous_state;
     gboolean disabled;
+    MMTraceSpan trace_span;
 } DisablingContext;
 
 static void disabling_step (GTask *task);
@@ -10504,6 +10704,8 @@ disabling_context_free (DisablingContext *ctx)
         g_error_free (error);
     }
 
+    mm_trace_clear (&ctx->trace_span);
+
     if (ctx->disabled)
         mm_iface_modem_update_state (MM_IFACE_MODEM (ctx->self),
                                      MM_MODEM_STATE_DISABLED,
@@ -10642,7 +10844,7 @@ disabling_wait_for_final_state_ready (MMIfaceModem *self,
 }
 
 static void
-disabling_step (GTask *task)
+disabling_step_run (GTask *task)
 {
     DisablingContext *ctx;
 
@@ -10819,6 +11021,21 @@ disabling_step (GTask *task)
     g_assert_not_reached ();
 }
 
+static void
+disabling_step (GTask *task)
+{
+    DisablingContext *ctx;
+
+    ctx = g_task_get_task_data (task);
+    g_object_ref (task);
+    disabling_step_run (task);
+    if (ctx->step == DISABLING_STEP_LAST)
+        mm_trace_clear (&ctx->trace_span);
+    else
+        mm_trace_step (&ctx->trace_span, ctx->self, "disable", ctx->step);
+    g_object_unref (task);
+}
+
 static void
 disable (MMBaseModem *self,
          GCancellable *cancellable,
@@ -10864,6 +11081,7 @@ typedef struct {
     EnablingStep step;
     MMModemState previous_state;
     gboolean enabled;
+    MMTraceSpan trace_span;
 } EnablingContext;
 
 static void enabling_step (GTask *task);
@@ -10871,6 +11089,8 @@ static void enabling_step (GTask *task);
 static void
 enabling_context_free (EnablingContext *ctx)
 {
+    mm_trace_clear (&ctx->trace_span);
+
     if (ctx->enabled)
         mm_iface_modem_update_state (MM_IFACE_MODEM (ctx->self),
                                      MM_MODEM_STATE_ENABLED,
@@ -10990,7 +11210,7 @@ enabling_wait_for_final_state_ready (MMIfaceModem *self,
 }
 
 static void
-enabling_step (GTask *task)
+enabling_step_run (GTask *task)
 {
     EnablingContext *ctx;
 
@@ -11181,6 +11401,21 @@ enabling_step (GTask *task)
     g_assert_not_reached ();
 }
 
+static void
+enabling_step (GTask *task)
+{
+    EnablingContext *ctx;
+
+    ctx = g_task_get_task_data (task);
+    g_object_ref (task);
+    enabling_step_run (task);
+    if (ctx->step == ENABLING_STEP_LAST)
+        mm_trace_clear (&ctx->trace_span);
+    else
+        mm_trace_step (&ctx->trace_span, ctx->self, "enable", ctx->step);
+    g_object_unref (task);
+}
+
 static void
 enable (MMBaseModem *self,
         GCancellable *cancellable,
@@ -11257,8 +11492,8 @@ typedef enum {
     INITIALIZE_STEP_SETUP_SIMPLE_STATUS,
     INITIALIZE_STEP_IFACE_MODEM,
     INITIALIZE_STEP_IFACE_3GPP,
-    INITIALIZE_STEP_IFACE_3GPP_USSD,
     INITIALIZE_STEP_IFACE_CDMA,
+    INITIALIZE_STEP_IFACE_3GPP_USSD,
     INITIALIZE_STEP_IFACE_LOCATION,
     INITIALIZE_STEP_IFACE_MESSAGING,
     INITIALIZE_STEP_IFACE_TIME,
@@ -11272,18 +11507,113 @@ typedef enum {
     INITIALIZE_STEP_LAST,
 } InitializeStep;
 
+/* Interfaces in the same group only depend on the Modem, 3GPP and CDMA
+ * interfaces, which define the capabilities of the modem, and not on each
+ * other, so they may be initialized in parallel. */
+#define INITIALIZE_GROUP_FIRST         INITIALIZE_STEP_IFACE_3GPP_USSD
+#define INITIALIZE_GROUP_LAST          INITIALIZE_STEP_IFACE_OMA
+#define INITIALIZE_GROUP_LIMITED_FIRST INITIALIZE_STEP_IFACE_VOICE
+#define INITIALIZE_GROUP_LIMITED_LAST  INITIALIZE_STEP_IFACE_FIRMWARE
+
+static const gchar *initialize_step_names[] = {
+    [INITIALIZE_STEP_STARTED]          = "started",
+    [INITIALIZE_STEP_IFACE_MODEM]      = "modem",
+    [INITIALIZE_STEP_IFACE_3GPP]       = "3gpp",
+    [INITIALIZE_STEP_IFACE_CDMA]       = "cdma",
+    [INITIALIZE_STEP_IFACE_3GPP_USSD]  = "3gpp-ussd",
+    [INITIALIZE_STEP_IFACE_LOCATION]   = "location",
+    [INITIALIZE_STEP_IFACE_MESSAGING]  = "messaging",
+    [INITIALIZE_STEP_IFACE_TIME]       = "time",
+    [INITIALIZE_STEP_IFACE_SIGNAL]     = "signal",
+    [INITIALIZE_STEP_IFACE_OMA]        = "oma",
+    [INITIALIZE_STEP_IFACE_VOICE]      = "voice",
+    [INITIALIZE_STEP_IFACE_FIRMWARE]   = "firmware",
+    [INITIALIZE_STEP_LAST]             = NULL,
+};
+
 typedef struct {
     MMBroadbandModem *self;
     InitializeStep step;
     gpointer ports_ctx;
+    /* Parallel initialization of interface groups */
+    gboolean parallel;
+    guint n_pending;
+    /* Per-step timing, in us */
+    gint64 started;
+    gint64 step_started[INITIALIZE_STEP_LAST];
+    gint64 step_time[INITIALIZE_STEP_LAST];
+    MMTraceSpan step_span[INITIALIZE_STEP_LAST];
 } InitializeContext;
 
 static void initialize_step (GTask *task);
 
+static void
+initialize_step_timing_start (InitializeContext *ctx,
+                              InitializeStep     step)
+{
+    ctx->step_started[step] = g_get_monotonic_time ();
+    ctx->step_span[step] = mm_trace_begin (ctx->self, "initialize", initialize_step_names[step]);
+}
+
+static void
+initialize_step_timing_stop (InitializeContext *ctx,
+                             InitializeStep     step)
+{
+    if (ctx->step_started[step]) {
+        ctx->step_time[step] += g_get_monotonic_time () - ctx->step_started[step];
+        ctx->step_started[step] = 0;
+    }
+    mm_trace_clear (&ctx->step_span[step]);
+}
+
+static void
+initialize_log_timing (InitializeContext *ctx)
+{
+    GString *str;
+    guint    i;
+
+    str = g_string_new (NULL);
+    for (i = 0; i < INITIALIZE_STEP_LAST; i++) {
+        if (!ctx->step_time[i] || !initialize_step_names[i])
+            continue;
+        g_string_append_printf (str, "%s%s %.3fs",
+                                str->len ? ", " : "",
+                                initialize_step_names[i],
+                                (gdouble) ctx->step_time[i] / G_USEC_PER_SEC);
+    }
+    mm_obj_dbg (ctx->self, "initialization time: %.3fs%s (%s)",
+                (gdouble) (g_get_monotonic_time () - ctx->started) / G_USEC_PER_SEC,
+                ctx->parallel ? ", parallel" : "",
+                str->str);
+    g_string_free (str, TRUE);
+}
+
+/* Called when an interface initialization step finishes, either jumping to
+ * the next one or, when initializing a group of interfaces in parallel, to
+ * the step after the group once all of them are done. */
+static void
+initialize_step_completed (GTask          *task,
+                           InitializeStep  step)
+{
+    InitializeContext *ctx;
+
+    ctx = g_task_get_task_data (task);
+    initialize_step_timing_stop (ctx, step);
+
+    if (ctx->n_pending > 0) {
+        if (--ctx->n_pending > 0)
+            return;
+    } else
+        ctx->step++;
+
+    initialize_step (task);
+}
+
 static void
 initialize_context_free (InitializeContext *ctx)
 {
     GError *error = NULL;
+    guint   i;
 
     if (ctx->ports_ctx &&
         MM_BROADBAND_MODEM_GET_CLASS (ctx->self)->initialization_stopped &&
@@ -11292,10 +11622,31 @@ initialize_context_free (InitializeContext *ctx)
         g_error_free (error);
     }
 
+    for (i = 0; i < INITIALIZE_STEP_LAST; i++)
+        mm_trace_clear (&ctx->step_span[i]);
+
     g_object_unref (ctx->self);
     g_free (ctx);
 }
 
+/* Requests sent through AT ports are serialized in the primary port anyway,
+ * so groups of interfaces are only initialized in parallel when the modem
+ * has a QMI or MBIM control port, where independent clients may run requests
+ * concurrently. */
+static gboolean
+initialize_parallel_supported (MMBroadbandModem *self)
+{
+#if defined WITH_QMI
+    if (mm_base_modem_peek_port_qmi (MM_BASE_MODEM (self)))
+        return TRUE;
+#endif
+#if defined WITH_MBIM
+    if (mm_base_modem_peek_port_mbim (MM_BASE_MODEM (self)))
+        return TRUE;
+#endif
+    return FALSE;
+}
+
 static gboolean
 initialize_finish (MMBaseModem *self,
                    GAsyncResult *res,
@@ -11315,6 +11666,8 @@ initialization_started_ready (MMBroadbandModem *self,
 
     ctx = g_task_get_task_data (task);
 
+    initialize_step_timing_stop (ctx, INITIALIZE_STEP_STARTED);
+
     /* May return NULL without error */
     ports_ctx = MM_BROADBAND_MODEM_GET_CLASS (self)->initialization_started_finish (self, result, &error);
     if (error) {
@@ -11347,6 +11700,7 @@ iface_modem_initialize_ready (MMBroadbandModem *self,
     GError *error = NULL;
 
     ctx = g_task_get_task_data (task);
+    initialize_step_timing_stop (ctx, INITIALIZE_STEP_IFACE_MODEM);
 
     /* If the modem interface fails to get initialized, we will move the modem
      * to a FAILED state. Note that in this case we still export the interface. */
@@ -11400,7 +11754,7 @@ iface_modem_initialize_ready (MMBroadbandModem *self,
 }
 
 #undef INTERFACE_INIT_READY_FN
-#define INTERFACE_INIT_READY_FN(NAME,TYPE,FATAL_ERRORS)                 \
+#define INTERFACE_INIT_READY_FN(NAME,TYPE,STEP,FATAL_ERRORS)            \
     static void                                                         \
     NAME##_initialize_ready (MMBroadbandModem *self,                    \
                              GAsyncResult *result,                      \
@@ -11421,7 +11775,10 @@ iface_modem_initialize_ready (MMBroadbandModem *self,
                 mm_iface_modem_update_failed_state (MM_IFACE_MODEM (self), \
                                                     MM_MODEM_STATE_FAILED_REASON_UNKNOWN); \
                                                                         \
-                /* Just jump to the last step */                        \
+                /* Just jump to the last step; fatal errors are only    \
+                 * reported by interfaces initialized on their own */   \
+                g_assert (ctx->n_pending == 0);                         \
+                initialize_step_timing_stop (ctx, STEP);                \
                 ctx->step = INITIALIZE_STEP_LAST;                       \
                 initialize_step (task);                                 \
                 return;                                                 \
@@ -11438,20 +11795,169 @@ iface_modem_initialize_ready (MMBroadbandModem *self,
         }                                                               \
                                                                         \
         /* Go on to next step */                                        \
-        ctx->step++;                                                    \
-        initialize_step (task);                                         \
+        initialize_step_completed (task, STEP);                         \
+    }
+
+INTERFACE_INIT_READY_FN (iface_modem_3gpp,      MM_IFACE_MODEM_3GPP,      INITIALIZE_STEP_IFACE_3GPP,      TRUE)
+INTERFACE_INIT_READY_FN (iface_modem_3gpp_ussd, MM_IFACE_MODEM_3GPP_USSD, INITIALIZE_STEP_IFACE_3GPP_USSD, FALSE)
+INTERFACE_INIT_READY_FN (iface_modem_cdma,      MM_IFACE_MODEM_CDMA,      INITIALIZE_STEP_IFACE_CDMA,      TRUE)
+INTERFACE_INIT_READY_FN (iface_modem_location,  MM_IFACE_MODEM_LOCATION,  INITIALIZE_STEP_IFACE_LOCATION,  FALSE)
+INTERFACE_INIT_READY_FN (iface_modem_messaging, MM_IFACE_MODEM_MESSAGING, INITIALIZE_STEP_IFACE_MESSAGING, FALSE)
+INTERFACE_INIT_READY_FN (iface_modem_voice,     MM_IFACE_MODEM_VOICE,     INITIALIZE_STEP_IFACE_VOICE,     FALSE)
+INTERFACE_INIT_READY_FN (iface_modem_time,      MM_IFACE_MODEM_TIME,      INITIALIZE_STEP_IFACE_TIME,      FALSE)
+INTERFACE_INIT_READY_FN (iface_modem_signal,    MM_IFACE_MODEM_SIGNAL,    INITIALIZE_STEP_IFACE_SIGNAL,    FALSE)
+INTERFACE_INIT_READY_FN (iface_modem_oma,       MM_IFACE_MODEM_OMA,       INITIALIZE_STEP_IFACE_OMA,       FALSE)
+INTERFACE_INIT_READY_FN (iface_modem_firmware,  MM_IFACE_MODEM_FIRMWARE,  INITIALIZE_STEP_IFACE_FIRMWARE,  FALSE)
+
+/* Launches the initialization of the interface of the given step. Returns
+ * FALSE if the interface doesn't apply to the modem. */
+static gboolean
+initialize_iface_start (GTask          *task,
+                        InitializeStep  step)
+{
+    InitializeContext *ctx;
+    GCancellable      *cancellable;
+
+    ctx = g_task_get_task_data (task);
+    cancellable = g_task_get_cancellable (task);
+
+    switch (step) {
+    case INITIALIZE_STEP_IFACE_MODEM:
+        initialize_step_timing_start (ctx, step);
+        mm_iface_modem_initialize (MM_IFACE_MODEM (ctx->self),
+                                   cancellable,
+                                   (GAsyncReadyCallback)iface_modem_initialize_ready,
+                                   task);
+        return TRUE;
+
+    case INITIALIZE_STEP_IFACE_3GPP:
+        if (!mm_iface_modem_is_3gpp (MM_IFACE_MODEM (ctx->self)))
+            return FALSE;
+        initialize_step_timing_start (ctx, step);
+        mm_iface_modem_3gpp_initialize (MM_IFACE_MODEM_3GPP (ctx->self),
+                                        cancellable,
+                                        (GAsyncReadyCallback)iface_modem_3gpp_initialize_ready,
+                                        task);
+        return TRUE;
+
+    case INITIALIZE_STEP_IFACE_CDMA:
+        if (!mm_iface_modem_is_cdma (MM_IFACE_MODEM (ctx->self)))
+            return FALSE;
+        initialize_step_timing_start (ctx, step);
+        mm_iface_modem_cdma_initialize (MM_IFACE_MODEM_CDMA (ctx->self),
+                                        cancellable,
+                                        (GAsyncReadyCallback)iface_modem_cdma_initialize_ready,
+                                        task);
+        return TRUE;
+
+    case INITIALIZE_STEP_IFACE_3GPP_USSD:
+        if (!mm_iface_modem_is_3gpp (MM_IFACE_MODEM (ctx->self)))
+            return FALSE;
+        initialize_step_timing_start (ctx, step);
+        mm_iface_modem_3gpp_ussd_initialize (MM_IFACE_MODEM_3GPP_USSD (ctx->self),
+                                             (GAsyncReadyCallback)iface_modem_3gpp_ussd_initialize_ready,
+                                             task);
+        return TRUE;
+
+    case INITIALIZE_STEP_IFACE_LOCATION:
+        initialize_step_timing_start (ctx, step);
+        mm_iface_modem_location_initialize (MM_IFACE_MODEM_LOCATION (ctx->self),
+                                            cancellable,
+                                            (GAsyncReadyCallback)iface_modem_location_initialize_ready,
+                                            task);
+        return TRUE;
+
+    case INITIALIZE_STEP_IFACE_MESSAGING:
+        initialize_step_timing_start (ctx, step);
+        mm_iface_modem_messaging_initialize (MM_IFACE_MODEM_MESSAGING (ctx->self),
+                                             cancellable,
+                                             (GAsyncReadyCallback)iface_modem_messaging_initialize_ready,
+                                             task);
+        return TRUE;
+
+    case INITIALIZE_STEP_IFACE_TIME:
+        initialize_step_timing_start (ctx, step);
+        mm_iface_modem_time_initialize (MM_IFACE_MODEM_TIME (ctx->self),
+                                        cancellable,
+                                        (GAsyncReadyCallback)iface_modem_time_initialize_ready,
+                                        task);
+        return TRUE;
+
+    case INITIALIZE_STEP_IFACE_SIGNAL:
+        initialize_step_timing_start (ctx, step);
+        mm_iface_modem_signal_initialize (MM_IFACE_MODEM_SIGNAL (ctx->self),
+                                          cancellable,
+                                          (GAsyncReadyCallback)iface_modem_signal_initialize_ready,
+                                          task);
+        return TRUE;
+
+    case INITIALIZE_STEP_IFACE_OMA:
+        initialize_step_timing_start (ctx, step);
+        mm_iface_modem_oma_initialize (MM_IFACE_MODEM_OMA (ctx->self),
+                                       cancellable,
+                                       (GAsyncReadyCallback)iface_modem_oma_initialize_ready,
+                                       task);
+        return TRUE;
+
+    case INITIALIZE_STEP_IFACE_VOICE:
+        initialize_step_timing_start (ctx, step);
+        mm_iface_modem_voice_initialize (MM_IFACE_MODEM_VOICE (ctx->self),
+                                         cancellable,
+                                         (GAsyncReadyCallback)iface_modem_voice_initialize_ready,
+                                         task);
+        return TRUE;
+
+    case INITIALIZE_STEP_IFACE_FIRMWARE:
+        initialize_step_timing_start (ctx, step);
+        mm_iface_modem_firmware_initialize (MM_IFACE_MODEM_FIRMWARE (ctx->self),
+                                            cancellable,
+                                            (GAsyncReadyCallback)iface_modem_firmware_initialize_ready,
+                                            task);
+        return TRUE;
+
+    case INITIALIZE_STEP_FIRST:
+    case INITIALIZE_STEP_SETUP_PORTS:
+    case INITIALIZE_STEP_STARTED:
+    case INITIALIZE_STEP_SETUP_SIMPLE_STATUS:
+    case INITIALIZE_STEP_FALLBACK_LIMITED:
+    case INITIALIZE_STEP_SIM_HOT_SWAP:
+    case INITIALIZE_STEP_IFACE_SIMPLE:
+    case INITIALIZE_STEP_LAST:
+    default:
+        break;
+    }
+
+    g_assert_not_reached ();
+}
+
+/* Launches the initialization of all the interfaces of a group at once; the
+ * sequence goes on with the step after the group once all of them finish.
+ * Returns FALSE if none of them applies to the modem. */
+static gboolean
+initialize_group_start (GTask          *task,
+                        InitializeStep  first,
+                        InitializeStep  last)
+{
+    InitializeContext *ctx;
+    InitializeStep     step;
+
+    ctx = g_task_get_task_data (task);
+    g_assert (ctx->n_pending == 0);
+
+    /* The pending counter is increased before launching each step, so that
+     * steps completing right away don't finish the group early */
+    ctx->step = last + 1;
+    ctx->n_pending = 1;
+    for (step = first; step <= last; step++) {
+        ctx->n_pending++;
+        if (!initialize_iface_start (task, step))
+            ctx->n_pending--;
     }
 
-INTERFACE_INIT_READY_FN (iface_modem_3gpp,      MM_IFACE_MODEM_3GPP,      TRUE)
-INTERFACE_INIT_READY_FN (iface_modem_3gpp_ussd, MM_IFACE_MODEM_3GPP_USSD, FALSE)
-INTERFACE_INIT_READY_FN (iface_modem_cdma,      MM_IFACE_MODEM_CDMA,      TRUE)
-INTERFACE_INIT_READY_FN (iface_modem_location,  MM_IFACE_MODEM_LOCATION,  FALSE)
-INTERFACE_INIT_READY_FN (iface_modem_messaging, MM_IFACE_MODEM_MESSAGING, FALSE)
-INTERFACE_INIT_READY_FN (iface_modem_voice,     MM_IFACE_MODEM_VOICE,     FALSE)
-INTERFACE_INIT_READY_FN (iface_modem_time,      MM_IFACE_MODEM_TIME,      FALSE)
-INTERFACE_INIT_READY_FN (iface_modem_signal,    MM_IFACE_MODEM_SIGNAL,    FALSE)
-INTERFACE_INIT_READY_FN (iface_modem_oma,       MM_IFACE_MODEM_OMA,       FALSE)
-INTERFACE_INIT_READY_FN (iface_modem_firmware,  MM_IFACE_MODEM_FIRMWARE,  FALSE)
+    if (--ctx->n_pending > 0)
+        return TRUE;
+    return FALSE;
+}
 
 static void
 initialize_step (GTask *task)
@@ -11480,6 +11986,7 @@ initialize_step (GTask *task)
     case INITIALIZE_STEP_STARTED:
         if (MM_BROADBAND_MODEM_GET_CLASS (ctx->self)->initialization_started &&
             MM_BROADBAND_MODEM_GET_CLASS (ctx->self)->initialization_started_finish) {
+            initialize_step_timing_start (ctx, INITIALIZE_STEP_STARTED);
             MM_BROADBAND_MODEM_GET_CLASS (ctx->self)->initialization_started (ctx->self,
                                                                               (GAsyncReadyCallback)initialization_started_ready,
                                                                               task);
@@ -11498,87 +12005,33 @@ initialize_step (GTask *task)
        /* fall through */
 
     case INITIALIZE_STEP_IFACE_MODEM:
-        /* Initialize the Modem interface */
-        mm_iface_modem_initialize (MM_IFACE_MODEM (ctx->self),
-                                   g_task_get_cancellable (task),
-                                   (GAsyncReadyCallback)iface_modem_initialize_ready,
-                                   task);
-        return;
-
     case INITIALIZE_STEP_IFACE_3GPP:
-        if (mm_iface_modem_is_3gpp (MM_IFACE_MODEM (ctx->self))) {
-            /* Initialize the 3GPP interface */
-            mm_iface_modem_3gpp_initialize (MM_IFACE_MODEM_3GPP (ctx->self),
-                                            g_task_get_cancellable (task),
-                                            (GAsyncReadyCallback)iface_modem_3gpp_initialize_ready,
-                                            task);
-            return;
-        }
-
-        ctx->step++;
-       /* fall through */
-
-    case INITIALIZE_STEP_IFACE_3GPP_USSD:
-        if (mm_iface_modem_is_3gpp (MM_IFACE_MODEM (ctx->self))) {
-            /* Initialize the 3GPP/USSD interface */
-            mm_iface_modem_3gpp_ussd_initialize (MM_IFACE_MODEM_3GPP_USSD (ctx->self),
-                                                 (GAsyncReadyCallback)iface_modem_3gpp_ussd_initialize_ready,
-                                                 task);
-            return;
-        }
-        ctx->step++;
-       /* fall through */
-
     case INITIALIZE_STEP_IFACE_CDMA:
-        if (mm_iface_modem_is_cdma (MM_IFACE_MODEM (ctx->self))) {
-            /* Initialize the CDMA interface */
-            mm_iface_modem_cdma_initialize (MM_IFACE_MODEM_CDMA (ctx->self),
-                                            g_task_get_cancellable (task),
-                                            (GAsyncReadyCallback)iface_modem_cdma_initialize_ready,
-                                            task);
+        /* The Modem, 3GPP and CDMA interfaces are always initialized one
+         * after the other, as every other interface depends on them */
+        if (initialize_iface_start (task, ctx->step))
             return;
-        }
         ctx->step++;
-       /* fall through */
-
-    case INITIALIZE_STEP_IFACE_LOCATION:
-        /* Initialize the Location interface */
-        mm_iface_modem_location_initialize (MM_IFACE_MODEM_LOCATION (ctx->self),
-                                            g_task_get_cancellable (task),
-                                            (GAsyncReadyCallback)iface_modem_location_initialize_ready,
-                                            task);
+        /* Go on with the next one of these steps, or with the group */
+        initialize_step (task);
         return;
 
+    case INITIALIZE_STEP_IFACE_3GPP_USSD:
+    case INITIALIZE_STEP_IFACE_LOCATION:
     case INITIALIZE_STEP_IFACE_MESSAGING:
-        /* Initialize the Messaging interface */
-        mm_iface_modem_messaging_initialize (MM_IFACE_MODEM_MESSAGING (ctx->self),
-                                             g_task_get_cancellable (task),
-                                             (GAsyncReadyCallback)iface_modem_messaging_initialize_ready,
-                                             task);
-        return;
-
     case INITIALIZE_STEP_IFACE_TIME:
-        /* Initialize the Time interface */
-        mm_iface_modem_time_initialize (MM_IFACE_MODEM_TIME (ctx->self),
-                                        g_task_get_cancellable (task),
-                                        (GAsyncReadyCallback)iface_modem_time_initialize_ready,
-                                        task);
-        return;
-
     case INITIALIZE_STEP_IFACE_SIGNAL:
-        /* Initialize the Signal interface */
-        mm_iface_modem_signal_initialize (MM_IFACE_MODEM_SIGNAL (ctx->self),
-                                          g_task_get_cancellable (task),
-                                          (GAsyncReadyCallback)iface_modem_signal_initialize_ready,
-                                          task);
-        return;
-
     case INITIALIZE_STEP_IFACE_OMA:
-        /* Initialize the Oma interface */
-        mm_iface_modem_oma_initialize (MM_IFACE_MODEM_OMA (ctx->self),
-                                       g_task_get_cancellable (task),
-                                       (GAsyncReadyCallback)iface_modem_oma_initialize_ready,
-                                       task);
+        if (ctx->parallel && ctx->step == INITIALIZE_GROUP_FIRST) {
+            if (initialize_group_start (task, INITIALIZE_GROUP_FIRST, INITIALIZE_GROUP_LAST))
+                return;
+            initialize_step (task);
+            return;
+        }
+        if (initialize_iface_start (task, ctx->step))
+            return;
+        ctx->step++;
+        initialize_step (task);
         return;
 
     case INITIALIZE_STEP_FALLBACK_LIMITED:
@@ -11588,19 +12041,17 @@ initialize_step (GTask *task)
        /* fall through */
 
     case INITIALIZE_STEP_IFACE_VOICE:
-        /* Initialize the Voice interface */
-        mm_iface_modem_voice_initialize (MM_IFACE_MODEM_VOICE (ctx->self),
-                                         g_task_get_cancellable (task),
-                                         (GAsyncReadyCallback)iface_modem_voice_initialize_ready,
-                                         task);
-        return;
-
     case INITIALIZE_STEP_IFACE_FIRMWARE:
-        /* Initialize the Firmware interface */
-        mm_iface_modem_firmware_initialize (MM_IFACE_MODEM_FIRMWARE (ctx->self),
-                                            g_task_get_cancellable (task),
-                                            (GAsyncReadyCallback)iface_modem_firmware_initialize_ready,
-                                            task);
+        if (ctx->parallel && ctx->step == INITIALIZE_GROUP_LIMITED_FIRST) {
+            if (initialize_group_start (task, INITIALIZE_GROUP_LIMITED_FIRST, INITIALIZE_GROUP_LIMITED_LAST))
+                return;
+            initialize_step (task);
+            return;
+        }
+        if (initialize_iface_start (task, ctx->step))
+            return;
+        ctx->step++;
+        initialize_step (task);
         return;
 
     case INITIALIZE_STEP_SIM_HOT_SWAP:
@@ -11649,6 +12100,8 @@ initialize_step (GTask *task)
        /* fall through */
 
     case INITIALIZE_STEP_LAST:
+        initialize_log_timing (ctx);
+
         if (ctx->self->priv->modem_state == MM_MODEM_STATE_FAILED) {
             GError *error;
 
@@ -11772,6 +12225,8 @@ initialize (MMBaseModem *self,
         ctx = g_new0 (InitializeContext, 1);
         ctx->self = g_object_ref (self);
         ctx->step = INITIALIZE_STEP_FIRST;
+        ctx->parallel = initialize_parallel_supported (MM_BROADBAND_MODEM (self));
+        ctx->started = g_get_monotonic_time ();
 
         g_task_set_task_data (task, ctx, (GDestroyNotify)initialize_context_free);
 
@@ -12067,6 +12522,26 @@ set_property (GObject *object,
     }
 }
 
+/* Subclasses overriding the supported capabilities, modes or bands loading
+ * may keep state computed while loading them, so the values are only taken
+ * from the property cache when using the generic implementations. Only
+ * known once the instance is fully constructed. */
+static gboolean
+property_cache_loaders_safe (MMBroadbandModem *self)
+{
+    static const gsize offsets[] = {
+        G_STRUCT_OFFSET (MMIfaceModem, load_supported_capabilities),
+        G_STRUCT_OFFSET (MMIfaceModem, load_supported_modes),
+        G_STRUCT_OFFSET (MMIfaceModem, load_supported_bands),
+    };
+
+    return mm_property_cache_loaders_inherited (self,
+                                                MM_TYPE_BROADBAND_MODEM,
+                                                MM_TYPE_IFACE_MODEM,
+                                                offsets,
+                                                G_N_ELEMENTS (offsets));
+}
+
 static void
 get_property (GObject *object,
               guint prop_id,
@@ -12184,6 +12659,9 @@ get_property (GObject *object,
     case PROP_MODEM_PERIODIC_ACCESS_TECH_CHECK_DISABLED:
         g_value_set_boolean (value, self->priv->periodic_access_tech_check_disabled);
         break;
+    case PROP_MODEM_PROPERTY_CACHE_LOADERS_SAFE:
+        g_value_set_boolean (value, property_cache_loaders_safe (self));
+        break;
     case PROP_MODEM_PERIODIC_CALL_LIST_CHECK_DISABLED:
         g_value_set_boolean (value, self->priv->periodic_call_list_check_disabled);
         break;
@@ -12253,6 +12731,9 @@ finalize (GObject *object)
         mm_3gpp_creg_regex_destroy (self->priv->modem_3gpp_registration_regex);
 
     g_free (self->priv->carrier_config_mapping);
+    g_free (self->priv->modem_batched_manufacturer);
+    g_free (self->priv->modem_batched_model);
+    g_free (self->priv->modem_batched_equipment_identifier);
 
     G_OBJECT_CLASS (mm_broadband_modem_parent_class)->finalize (object);
 }
@@ -12772,6 +13253,10 @@ mm_broadband_modem_class_init (MMBroadbandModemClass *klass)
                                       PROP_MODEM_PERIODIC_ACCESS_TECH_CHECK_DISABLED,
                                       MM_IFACE_MODEM_PERIODIC_ACCESS_TECH_CHECK_DISABLED);
 
+    g_object_class_override_property (object_class,
+                                      PROP_MODEM_PROPERTY_CACHE_LOADERS_SAFE,
+                                      MM_IFACE_MODEM_PROPERTY_CACHE_LOADERS_SAFE);
+
     g_object_class_override_property (object_class,
                                       PROP_MODEM_PERIODIC_CALL_LIST_CHECK_DISABLED,
                                       MM_IFACE_MODEM_VOICE_PERIODIC_CALL_LIST_CHECK_DISABLED);
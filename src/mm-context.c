@@ -41,6 +41,9 @@ static gboolean      debug;
 static MMFilterRule  filter_policy = MM_FILTER_POLICY_STRICT;
 static gboolean      no_auto_scan = NO_AUTO_SCAN_DEFAULT;
 static const gchar  *initial_kernel_events;
+static const gchar  *probe_cache_file;
+static const gchar  *plugin_manifest_file;
+static const gchar  *property_cache_file;
 
 static gboolean
 filter_policy_option_arg (const gchar  *option_name,
@@ -90,6 +93,21 @@ static const GOptionEntry entries[] = {
         "Path to initial kernel events file",
         "[PATH]"
     },
+    {
+        "probe-cache-file", 0, 0, G_OPTION_ARG_FILENAME, &probe_cache_file,
+        "Path to the file where port probing results are cached across runs",
+        "[PATH]"
+    },
+    {
+        "plugin-manifest-file", 0, 0, G_OPTION_ARG_FILENAME, &plugin_manifest_file,
+        "Path to the plugin manifest file, used to load plugins on demand",
+        "[PATH]"
+    },
+    {
+        "property-cache-file", 0, 0, G_OPTION_ARG_FILENAME, &property_cache_file,
+        "Path to the file where static modem properties are cached across runs",
+        "[PATH]"
+    },
     {
         "debug", 0, 0, G_OPTION_ARG_NONE, &debug,
         "Run with extended debugging capabilities",
@@ -120,6 +138,24 @@ mm_context_get_initial_kernel_events (void)
     return initial_kernel_events;
 }
 
+const gchar *
+mm_context_get_probe_cache_file (void)
+{
+    return probe_cache_file;
+}
+
+const gchar *
+mm_context_get_plugin_manifest_file (void)
+{
+    return plugin_manifest_file;
+}
+
+const gchar *
+mm_context_get_property_cache_file (void)
+{
+    return property_cache_file;
+}
+
 gboolean
 mm_context_get_no_auto_scan (void)
 {
@@ -140,6 +176,12 @@ static const gchar *log_file;
 static gboolean     log_journal;
 static gboolean     log_show_ts;
 static gboolean     log_rel_ts;
+static gboolean     log_binary;
+static gint         log_flush_interval = 500;
+static gint         log_buffer_size = 256;
+static gint         log_recorder_size = 256;
+static const gchar *log_recorder_file;
+static gint         log_trace_size;
 
 static const GOptionEntry log_entries[] = {
     {
@@ -169,6 +211,36 @@ static const GOptionEntry log_entries[] = {
         "Use relative timestamps (from MM start)",
         NULL
     },
+    {
+        "log-binary", 0, 0, G_OPTION_ARG_NONE, &log_binary,
+        "Write the log file in binary format, to be decoded with mmlogdecode",
+        NULL
+    },
+    {
+        "log-flush-interval", 0, 0, G_OPTION_ARG_INT, &log_flush_interval,
+        "Maximum time log file writes are delayed, 0 to write every message right away",
+        "[MS]"
+    },
+    {
+        "log-buffer-size", 0, 0, G_OPTION_ARG_INT, &log_buffer_size,
+        "Size of the buffer for delayed log file writes",
+        "[KB]"
+    },
+    {
+        "log-recorder-size", 0, 0, G_OPTION_ARG_INT, &log_recorder_size,
+        "Size of the in-memory recorder of recent messages and port traffic at any level, 0 to disable it",
+        "[KB]"
+    },
+    {
+        "log-recorder-file", 0, 0, G_OPTION_ARG_FILENAME, &log_recorder_file,
+        "Path to the file the log recorder is dumped to",
+        "[PATH]"
+    },
+    {
+        "log-trace-size", 0, 0, G_OPTION_ARG_INT, &log_trace_size,
+        "Number of state machine step and command spans to keep for tracing, 0 to disable it",
+        "[SPANS]"
+    },
     { NULL }
 };
 
@@ -216,6 +288,42 @@ mm_context_get_log_relative_timestamps (void)
     return log_rel_ts;
 }
 
+gboolean
+mm_context_get_log_binary (void)
+{
+    return log_binary;
+}
+
+guint
+mm_context_get_log_flush_interval (void)
+{
+    return (guint) MAX (log_flush_interval, 0);
+}
+
+guint
+mm_context_get_log_buffer_size (void)
+{
+    return (guint) MAX (log_buffer_size, 0);
+}
+
+guint
+mm_context_get_log_recorder_size (void)
+{
+    return (guint) MAX (log_recorder_size, 0);
+}
+
+const gchar *
+mm_context_get_log_recorder_file (void)
+{
+    return log_recorder_file;
+}
+
+guint
+mm_context_get_log_trace_size (void)
+{
+    return (guint) MAX (log_trace_size, 0);
+}
+
 /*****************************************************************************/
 /* Test context */
 
@@ -30,6 +30,9 @@ void mm_context_init (gint    argc,
 
 gboolean     mm_context_get_debug                 (void);
 const gchar *mm_context_get_initial_kernel_events (void);
+const gchar *mm_context_get_probe_cache_file      (void);
+const gchar *mm_context_get_plugin_manifest_file  (void);
+const gchar *mm_context_get_property_cache_file   (void);
 gboolean     mm_context_get_no_auto_scan          (void);
 
 /* Filter support */
@@ -41,6 +44,12 @@ const gchar *mm_context_get_log_file                (void);
 gboolean     mm_context_get_log_journal             (void);
 gboolean     mm_context_get_log_timestamps          (void);
 gboolean     mm_context_get_log_relative_timestamps (void);
+gboolean     mm_context_get_log_binary              (void);
+guint        mm_context_get_log_flush_interval      (void);
+guint        mm_context_get_log_buffer_size         (void);
+guint        mm_context_get_log_recorder_size       (void);
+const gchar *mm_context_get_log_recorder_file       (void);
+guint        mm_context_get_log_trace_size          (void);
 
 /* Testing support */
 gboolean     mm_context_get_test_session    (void);
@@ -0,0 +1,295 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+
+#include "mm-event-coalescer.h"
+#include "mm-log.h"
+
+typedef struct {
+    gchar  *uid;
+    GQueue *entries;
+    guint   n_events;
+    guint   n_reported;
+} Group;
+
+typedef struct {
+    gchar    *key;
+    Group    *group;
+    /* Latest add not cancelled by a later remove, if any */
+    gpointer  add_item;
+    /* Latest remove, if any */
+    gpointer  remove_item;
+} Entry;
+
+struct _MMEventCoalescer {
+    guint                 window_ms;
+    guint                 max_delay_ms;
+    GDestroyNotify        item_free;
+    MMEventCoalescerFunc  func;
+    gpointer              user_data;
+    gpointer              log_object;
+
+    /* Queued events; groups are owned by the queue, entries by their group */
+    GQueue               *groups;
+    GHashTable           *groups_by_uid;
+    GHashTable           *entries_by_key;
+    guint                 timeout_id;
+    gint64                first_event_time;
+
+    guint                 n_events;
+    guint                 n_suppressed;
+};
+
+/*****************************************************************************/
+
+static void
+item_free (MMEventCoalescer *self,
+           gpointer          item)
+{
+    if (item && self->item_free)
+        self->item_free (item);
+}
+
+static void
+entry_free (MMEventCoalescer *self,
+            Entry            *entry)
+{
+    item_free (self, entry->add_item);
+    item_free (self, entry->remove_item);
+    g_free (entry->key);
+    g_slice_free (Entry, entry);
+}
+
+static void
+group_free (MMEventCoalescer *self,
+            Group            *group)
+{
+    Entry *entry;
+
+    while ((entry = g_queue_pop_head (group->entries)) != NULL)
+        entry_free (self, entry);
+    g_queue_free (group->entries);
+    g_free (group->uid);
+    g_slice_free (Group, group);
+}
+
+static void
+report (MMEventCoalescer        *self,
+        Group                   *group,
+        MMEventCoalescerAction   action,
+        gpointer                *item)
+{
+    group->n_reported++;
+    self->func (group->uid, action, *item, self->user_data);
+    item_free (self, *item);
+    *item = NULL;
+}
+
+void
+mm_event_coalescer_flush (MMEventCoalescer *self)
+{
+    GQueue *groups;
+    Group  *group;
+    GList  *l;
+    GList  *m;
+
+    if (self->timeout_id) {
+        g_source_remove (self->timeout_id);
+        self->timeout_id = 0;
+    }
+
+    /* Detach all queued events before reporting any, so that new events
+     * pushed while reporting are queued for the next flush */
+    groups = self->groups;
+    self->groups = g_queue_new ();
+    g_hash_table_remove_all (self->groups_by_uid);
+    g_hash_table_remove_all (self->entries_by_key);
+
+    /* Removes first, so that ports of a new device composition are never
+     * released by stale events */
+    for (l = groups->head; l; l = g_list_next (l)) {
+        group = l->data;
+        for (m = group->entries->head; m; m = g_list_next (m)) {
+            Entry *entry = m->data;
+
+            if (entry->remove_item)
+                report (self, group, MM_EVENT_COALESCER_ACTION_REMOVE, &entry->remove_item);
+        }
+    }
+
+    /* Then all the adds of each device together */
+    for (l = groups->head; l; l = g_list_next (l)) {
+        group = l->data;
+        for (m = group->entries->head; m; m = g_list_next (m)) {
+            Entry *entry = m->data;
+
+            if (entry->add_item)
+                report (self, group, MM_EVENT_COALESCER_ACTION_ADD, &entry->add_item);
+        }
+
+        g_assert_cmpuint (group->n_events, >=, group->n_reported);
+        if (group->n_events > group->n_reported) {
+            mm_obj_dbg (self->log_object, "coalesced %u port events of device '%s' into %u",
+                        group->n_events, group->uid, group->n_reported);
+            self->n_suppressed += group->n_events - group->n_reported;
+        }
+    }
+
+    while ((group = g_queue_pop_head (groups)) != NULL)
+        group_free (self, group);
+    g_queue_free (groups);
+}
+
+static gboolean
+flush_timeout_cb (MMEventCoalescer *self)
+{
+    self->timeout_id = 0;
+    mm_event_coalescer_flush (self);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+schedule_flush (MMEventCoalescer *self)
+{
+    gint64 now;
+    gint64 deadline;
+    guint  delay_ms;
+
+    now = g_get_monotonic_time ();
+    if (!self->timeout_id)
+        self->first_event_time = now;
+    else
+        g_source_remove (self->timeout_id);
+
+    /* Wait for a quiet window, but never longer than the maximum delay
+     * since the oldest queued event */
+    deadline = self->first_event_time + ((gint64) self->max_delay_ms * 1000);
+    delay_ms = self->window_ms;
+    if (now + ((gint64) delay_ms * 1000) > deadline)
+        delay_ms = (deadline > now) ? (guint) ((deadline - now) / 1000) : 0;
+
+    self->timeout_id = g_timeout_add (delay_ms, (GSourceFunc) flush_timeout_cb, self);
+}
+
+/*****************************************************************************/
+
+void
+mm_event_coalescer_push (MMEventCoalescer       *self,
+                         const gchar            *group_uid,
+                         const gchar            *key,
+                         MMEventCoalescerAction  action,
+                         gpointer                item)
+{
+    Group *group;
+    Entry *entry;
+
+    g_assert (group_uid);
+    g_assert (key);
+
+    self->n_events++;
+
+    if (!self->window_ms) {
+        self->func (group_uid, action, item, self->user_data);
+        item_free (self, item);
+        return;
+    }
+
+    entry = g_hash_table_lookup (self->entries_by_key, key);
+    if (!entry) {
+        group = g_hash_table_lookup (self->groups_by_uid, group_uid);
+        if (!group) {
+            group = g_slice_new0 (Group);
+            group->uid = g_strdup (group_uid);
+            group->entries = g_queue_new ();
+            g_queue_push_tail (self->groups, group);
+            g_hash_table_insert (self->groups_by_uid, group->uid, group);
+        }
+        entry = g_slice_new0 (Entry);
+        entry->key = g_strdup (key);
+        entry->group = group;
+        g_queue_push_tail (group->entries, entry);
+        g_hash_table_insert (self->entries_by_key, entry->key, entry);
+    }
+
+    entry->group->n_events++;
+    if (action == MM_EVENT_COALESCER_ACTION_ADD) {
+        item_free (self, entry->add_item);
+        entry->add_item = item;
+    } else {
+        /* A remove cancels any add queued before */
+        item_free (self, entry->add_item);
+        entry->add_item = NULL;
+        item_free (self, entry->remove_item);
+        entry->remove_item = item;
+    }
+
+    schedule_flush (self);
+}
+
+/*****************************************************************************/
+
+guint
+mm_event_coalescer_get_n_events (MMEventCoalescer *self)
+{
+    return self->n_events;
+}
+
+guint
+mm_event_coalescer_get_n_suppressed (MMEventCoalescer *self)
+{
+    return self->n_suppressed;
+}
+
+/*****************************************************************************/
+
+MMEventCoalescer *
+mm_event_coalescer_new (guint                window_ms,
+                        guint                max_delay_ms,
+                        GDestroyNotify       item_free_func,
+                        MMEventCoalescerFunc func,
+                        gpointer             user_data,
+                        gpointer             log_object)
+{
+    MMEventCoalescer *self;
+
+    g_assert (func);
+
+    self = g_slice_new0 (MMEventCoalescer);
+    self->window_ms = window_ms;
+    self->max_delay_ms = MAX (window_ms, max_delay_ms);
+    self->item_free = item_free_func;
+    self->func = func;
+    self->user_data = user_data;
+    self->log_object = log_object;
+    self->groups = g_queue_new ();
+    self->groups_by_uid = g_hash_table_new (g_str_hash, g_str_equal);
+    self->entries_by_key = g_hash_table_new (g_str_hash, g_str_equal);
+    return self;
+}
+
+void
+mm_event_coalescer_free (MMEventCoalescer *self)
+{
+    Group *group;
+
+    /* Queued events are discarded */
+    if (self->timeout_id)
+        g_source_remove (self->timeout_id);
+    while ((group = g_queue_pop_head (self->groups)) != NULL)
+        group_free (self, group);
+    g_queue_free (self->groups);
+    g_hash_table_unref (self->groups_by_uid);
+    g_hash_table_unref (self->entries_by_key);
+    g_slice_free (MMEventCoalescer, self);
+}
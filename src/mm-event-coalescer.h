@@ -0,0 +1,75 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_EVENT_COALESCER_H
+#define MM_EVENT_COALESCER_H
+
+#include <glib.h>
+
+/*
+ * Coalescing of port add/remove events.
+ *
+ * Events are queued until no new event has been pushed for a whole window,
+ * or until the oldest queued event has waited for the maximum delay. All
+ * queued events are then reduced to the minimum set that leads to the same
+ * final state, per port:
+ *
+ *   - if the last event of the port is a remove, a single remove;
+ *   - if the last event is an add and there was a remove before, a single
+ *     remove followed by a single add;
+ *   - otherwise, a single add.
+ *
+ * Ports are grouped by their group key (the physical device UID), and the
+ * reduced events are reported with all removes first and then all adds
+ * of each group together, so that every group ends up with a consolidated
+ * port set. Events of a port already queued in a group are always queued
+ * in that same group, even if a different group key is given.
+ *
+ * With an empty window, events are reported right away.
+ */
+
+typedef enum {
+    MM_EVENT_COALESCER_ACTION_ADD,
+    MM_EVENT_COALESCER_ACTION_REMOVE,
+} MMEventCoalescerAction;
+
+typedef struct _MMEventCoalescer MMEventCoalescer;
+
+typedef void (* MMEventCoalescerFunc) (const gchar            *group,
+                                       MMEventCoalescerAction  action,
+                                       gpointer                item,
+                                       gpointer                user_data);
+
+MMEventCoalescer *mm_event_coalescer_new  (guint                   window_ms,
+                                           guint                   max_delay_ms,
+                                           GDestroyNotify          item_free,
+                                           MMEventCoalescerFunc    func,
+                                           gpointer                user_data,
+                                           gpointer                log_object);
+void              mm_event_coalescer_free (MMEventCoalescer       *self);
+
+/* Takes ownership of @item */
+void              mm_event_coalescer_push (MMEventCoalescer       *self,
+                                           const gchar            *group,
+                                           const gchar            *key,
+                                           MMEventCoalescerAction  action,
+                                           gpointer                item);
+
+/* Reports all queued events right away */
+void              mm_event_coalescer_flush (MMEventCoalescer      *self);
+
+/* Statistics */
+guint             mm_event_coalescer_get_n_events     (MMEventCoalescer *self);
+guint             mm_event_coalescer_get_n_suppressed (MMEventCoalescer *self);
+
+#endif /* MM_EVENT_COALESCER_H */
@@ -37,6 +37,8 @@
 static GQuark private_quark;
 
 typedef struct {
+    /* Owner, not a full reference */
+    MMIfaceModem3gpp             *self;
     /* Registration state */
     MMModem3gppRegistrationState  state_cs;
     MMModem3gppRegistrationState  state_ps;
@@ -49,6 +51,9 @@ typedef struct {
     /* Registration checks */
     guint    check_timeout_source;
     gboolean check_running;
+    /* Operator checks */
+    guint    operator_check_source;
+    gboolean operator_check_running;
 } Private;
 
 static void
@@ -59,8 +64,8 @@ private_free (Private *priv)
         g_cancellable_cancel (priv->pending_registration_cancellable);
         g_object_unref (priv->pending_registration_cancellable);
     }
-    if (priv->check_timeout_source)
-        g_source_remove (priv->check_timeout_source);
+    mm_poll_scheduler_remove (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (priv->self)), priv->check_timeout_source);
+    mm_poll_scheduler_remove (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (priv->self)), priv->operator_check_source);
     g_slice_free (Private, priv);
 }
 
@@ -75,6 +80,7 @@ get_private (MMIfaceModem3gpp *self)
     priv = g_object_get_qdata (G_OBJECT (self), private_quark);
     if (!priv) {
         priv = g_slice_new0 (Private);
+        priv->self = self;
         priv->state_cs = MM_MODEM_3GPP_REGISTRATION_STATE_UNKNOWN;
         priv->state_ps = MM_MODEM_3GPP_REGISTRATION_STATE_UNKNOWN;
         priv->state_eps = MM_MODEM_3GPP_REGISTRATION_STATE_UNKNOWN;
@@ -1533,6 +1539,8 @@ update_registration_state (MMIfaceModem3gpp             *self,
     update_non_registered_state (self, old_state, new_state);
 }
 
+static void periodic_registration_check_refreshed (MMIfaceModem3gpp *self);
+
 void
 mm_iface_modem_3gpp_update_cs_registration_state (MMIfaceModem3gpp             *self,
                                                   MMModem3gppRegistrationState  state)
@@ -1550,6 +1558,7 @@ mm_iface_modem_3gpp_update_cs_registration_state (MMIfaceModem3gpp             *
     priv = get_private (self);
     priv->state_cs = state;
     update_registration_state (self, get_consolidated_reg_state (self), TRUE);
+    periodic_registration_check_refreshed (self);
 }
 
 void
@@ -1569,6 +1578,7 @@ mm_iface_modem_3gpp_update_ps_registration_state (MMIfaceModem3gpp             *
     priv = get_private (self);
     priv->state_ps = state;
     update_registration_state (self, get_consolidated_reg_state (self), TRUE);
+    periodic_registration_check_refreshed (self);
 }
 
 void
@@ -1588,6 +1598,7 @@ mm_iface_modem_3gpp_update_eps_registration_state (MMIfaceModem3gpp
     priv = get_private (self);
     priv->state_eps = state;
     update_registration_state (self, get_consolidated_reg_state (self), TRUE);
+    periodic_registration_check_refreshed (self);
 }
 
 void
@@ -1607,12 +1618,21 @@ mm_iface_modem_3gpp_update_5gs_registration_state (MMIfaceModem3gpp
     priv = get_private (self);
     priv->state_5gs = state;
     update_registration_state (self, get_consolidated_reg_state (self), TRUE);
+    periodic_registration_check_refreshed (self);
 }
 
 /*****************************************************************************/
 /* Periodic registration checks */
 
 #define REGISTRATION_CHECK_TIMEOUT_SEC 30
+#define REGISTRATION_CHECK_POLL_NAME   "3gpp-registration"
+
+/* The operator code and name are only reloaded when getting registered, so
+ * they are refreshed on their own schedule while registered (e.g. to catch
+ * a change of operator while roaming), as registration checks may be backed
+ * off for as long as indications report the same registration state */
+#define OPERATOR_CHECK_TIMEOUT_SEC 60
+#define OPERATOR_CHECK_POLL_NAME   "3gpp-operator"
 
 static void
 periodic_registration_checks_ready (MMIfaceModem3gpp *self,
@@ -1630,6 +1650,7 @@ periodic_registration_checks_ready (MMIfaceModem3gpp *self,
     }
 
     priv->check_running = FALSE;
+    mm_poll_scheduler_complete (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)), REGISTRATION_CHECK_POLL_NAME);
 }
 
 static gboolean
@@ -1650,6 +1671,62 @@ periodic_registration_check (MMIfaceModem3gpp *self)
     return G_SOURCE_CONTINUE;
 }
 
+static void
+periodic_operator_check_ready (MMIfaceModem3gpp *self,
+                               GAsyncResult     *res)
+{
+    Private *priv;
+    GError  *error = NULL;
+
+    priv = get_private (self);
+
+    if (!mm_iface_modem_3gpp_reload_current_registration_info_finish (self, res, &error)) {
+        mm_obj_dbg (self, "couldn't refresh 3GPP operator: %s", error->message);
+        g_error_free (error);
+    }
+
+    priv->operator_check_running = FALSE;
+    mm_poll_scheduler_complete (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)), OPERATOR_CHECK_POLL_NAME);
+}
+
+static gboolean
+periodic_operator_check (MMIfaceModem3gpp *self)
+{
+    Private                      *priv;
+    MMModem3gppRegistrationState  state = MM_MODEM_3GPP_REGISTRATION_STATE_UNKNOWN;
+
+    priv = get_private (self);
+
+    g_object_get (self,
+                  MM_IFACE_MODEM_3GPP_REGISTRATION_STATE, &state,
+                  NULL);
+
+    /* Only launch a new one if registered, and if no other reload is
+     * running already */
+    if (REG_STATE_IS_REGISTERED (state) &&
+        !priv->operator_check_running &&
+        !priv->reloading_registration_info) {
+        priv->operator_check_running = TRUE;
+        mm_iface_modem_3gpp_reload_current_registration_info (
+            self,
+            (GAsyncReadyCallback)periodic_operator_check_ready,
+            NULL);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+periodic_registration_check_refreshed (MMIfaceModem3gpp *self)
+{
+    Private *priv;
+
+    priv = get_private (self);
+
+    /* Updates done by the check itself don't count */
+    if (priv->check_timeout_source && !priv->check_running)
+        mm_poll_scheduler_refreshed (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)), REGISTRATION_CHECK_POLL_NAME);
+}
+
 static void
 periodic_registration_check_disable (MMIfaceModem3gpp *self)
 {
@@ -1661,8 +1738,10 @@ periodic_registration_check_disable (MMIfaceModem3gpp *self)
     if (!priv->check_timeout_source)
         return;
 
-    g_source_remove (priv->check_timeout_source);
+    mm_poll_scheduler_remove (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)), priv->check_timeout_source);
     priv->check_timeout_source = 0;
+    mm_poll_scheduler_remove (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)), priv->operator_check_source);
+    priv->operator_check_source = 0;
 
     mm_obj_dbg (self, "periodic 3GPP registration checks disabled");
 }
@@ -1680,9 +1759,16 @@ periodic_registration_check_enable (MMIfaceModem3gpp *self)
 
     /* Create context and keep it as object data */
     mm_obj_dbg (self, "periodic 3GPP registration checks enabled");
-    priv->check_timeout_source = g_timeout_add_seconds (REGISTRATION_CHECK_TIMEOUT_SEC,
-                                                        (GSourceFunc)periodic_registration_check,
+    priv->check_timeout_source = mm_poll_scheduler_add (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)),
+                                                        REGISTRATION_CHECK_POLL_NAME,
+                                                        REGISTRATION_CHECK_TIMEOUT_SEC * 1000,
+                                                        (MMPollSchedulerFunc)periodic_registration_check,
                                                         self);
+    priv->operator_check_source = mm_poll_scheduler_add (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)),
+                                                         OPERATOR_CHECK_POLL_NAME,
+                                                         OPERATOR_CHECK_TIMEOUT_SEC * 1000,
+                                                         (MMPollSchedulerFunc)periodic_operator_check,
+                                                         self);
 }
 
 /*****************************************************************************/
@@ -2417,6 +2503,8 @@ load_imei_ready (MMIfaceModem3gpp *self,
 
     imei = MM_IFACE_MODEM_3GPP_GET_INTERFACE (self)->load_imei_finish (self, res, &error);
     mm_gdbus_modem3gpp_set_imei (ctx->skeleton, imei);
+    if (imei)
+        mm_iface_modem_store_cached_property (MM_IFACE_MODEM (self), "imei", g_variant_new_string (imei));
     g_free (imei);
 
     if (error) {
@@ -2453,6 +2541,15 @@ interface_initialization_step (GTask *task)
         /* IMEI value is meant to be loaded only once during the whole
          * lifetime of the modem. Therefore, if we already have it loaded,
          * don't try to load it again. */
+        if (!mm_gdbus_modem3gpp_get_imei (ctx->skeleton)) {
+            GVariant *cached;
+
+            cached = mm_iface_modem_lookup_cached_property (MM_IFACE_MODEM (self), "imei", G_VARIANT_TYPE_STRING);
+            if (cached) {
+                mm_gdbus_modem3gpp_set_imei (ctx->skeleton, g_variant_get_string (cached, NULL));
+                g_variant_unref (cached);
+            }
+        }
         if (!mm_gdbus_modem3gpp_get_imei (ctx->skeleton) &&
             MM_IFACE_MODEM_3GPP_GET_INTERFACE (self)->load_imei &&
             MM_IFACE_MODEM_3GPP_GET_INTERFACE (self)->load_imei_finish) {
@@ -513,6 +513,7 @@ mm_iface_modem_cdma_register_in_network (MMIfaceModemCdma *self,
 /*****************************************************************************/
 
 #define REGISTRATION_CHECK_TIMEOUT_SEC 30
+#define REGISTRATION_CHECK_POLL_NAME   "cdma-registration"
 #define REGISTRATION_CHECK_CONTEXT_TAG "cdma-registration-check-context-tag"
 
 static GQuark registration_check_context_quark;
@@ -1226,6 +1227,7 @@ mm_iface_modem_cdma_update_cdma1x_registration_state (MMIfaceModemCdma *self,
 /*****************************************************************************/
 
 typedef struct {
+    MMIfaceModemCdma *self;
     guint timeout_source;
     gboolean running;
 } RegistrationCheckContext;
@@ -1233,8 +1235,7 @@ typedef struct {
 static void
 registration_check_context_free (RegistrationCheckContext *ctx)
 {
-    if (ctx->timeout_source)
-        g_source_remove (ctx->timeout_source);
+    mm_poll_scheduler_remove (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (ctx->self)), ctx->timeout_source);
     g_free (ctx);
 }
 
@@ -1255,6 +1256,7 @@ periodic_registration_checks_ready (MMIfaceModemCdma *self,
     ctx = g_object_get_qdata (G_OBJECT (self), registration_check_context_quark);
     if (ctx)
         ctx->running = FALSE;
+    mm_poll_scheduler_complete (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)), REGISTRATION_CHECK_POLL_NAME);
 }
 
 static gboolean
@@ -1307,8 +1309,11 @@ periodic_registration_check_enable (MMIfaceModemCdma *self)
     /* Create context and keep it as object data */
     mm_obj_dbg (self, "periodic CDMA registration checks enabled");
     ctx = g_new0 (RegistrationCheckContext, 1);
-    ctx->timeout_source = g_timeout_add_seconds (REGISTRATION_CHECK_TIMEOUT_SEC,
-                                                 (GSourceFunc)periodic_registration_check,
+    ctx->self = self;
+    ctx->timeout_source = mm_poll_scheduler_add (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)),
+                                                 REGISTRATION_CHECK_POLL_NAME,
+                                                 REGISTRATION_CHECK_TIMEOUT_SEC * 1000,
+                                                 (MMPollSchedulerFunc)periodic_registration_check,
                                                  self);
     g_object_set_qdata_full (G_OBJECT (self),
                              registration_check_context_quark,
@@ -196,8 +196,11 @@ change_current_ready (MMIfaceModemFirmware *self,
 
     if (!MM_IFACE_MODEM_FIRMWARE_GET_INTERFACE (self)->change_current_finish (self, res, &error))
         g_dbus_method_invocation_take_error (ctx->invocation, error);
-    else
+    else {
+        /* The revision may not change when only the carrier image is switched */
+        mm_iface_modem_invalidate_property_cache (MM_IFACE_MODEM (self));
         mm_gdbus_modem_firmware_complete_select (ctx->skeleton, ctx->invocation);
+    }
     handle_select_context_free (ctx);
 }
 
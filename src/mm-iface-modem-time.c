@@ -17,6 +17,7 @@
 #define _LIBMM_INSIDE_MM
 #include <libmm-glib.h>
 
+#include "mm-base-modem.h"
 #include "mm-iface-modem.h"
 #include "mm-iface-modem-time.h"
 #include "mm-log-object.h"
@@ -148,8 +149,10 @@ handle_get_network_time (MmGdbusModemTime      *skeleton,
  */
 #define NETWORK_TIMEZONE_POLL_INTERVAL_SEC 5
 #define NETWORK_TIMEZONE_POLL_RETRIES 6
+#define NETWORK_TIMEZONE_POLL_NAME "network-timezone"
 
 typedef struct {
+    MMIfaceModemTime *self;
     gulong state_changed_id;
     MMModemState state;
     guint network_timezone_poll_id;
@@ -162,8 +165,7 @@ network_timezone_context_free (NetworkTimezoneContext *ctx)
     /* Note: no need to remove signal connection here, we have already done it
      * in stop_network_timezone() when the logic is disabled (or will be done
      * automatically when the last modem object reference is dropped) */
-    if (ctx->network_timezone_poll_id)
-        g_source_remove (ctx->network_timezone_poll_id);
+    mm_poll_scheduler_remove (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (ctx->self)), ctx->network_timezone_poll_id);
     g_free (ctx);
 }
 
@@ -199,6 +201,7 @@ load_network_timezone_ready (MMIfaceModemTime *self,
 
     /* Finish the async operation */
     tz = MM_IFACE_MODEM_TIME_GET_INTERFACE (self)->load_network_timezone_finish (self, res, &error);
+    mm_poll_scheduler_complete (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)), NETWORK_TIMEZONE_POLL_NAME);
     if (!tz) {
         NetworkTimezoneContext *ctx;
 
@@ -221,8 +224,10 @@ load_network_timezone_ready (MMIfaceModemTime *self,
         }
 
         /* Otherwise, relaunch timeout to query a bit later */
-        ctx->network_timezone_poll_id = g_timeout_add_seconds (NETWORK_TIMEZONE_POLL_INTERVAL_SEC,
-                                                               (GSourceFunc)network_timezone_poll_cb,
+        ctx->network_timezone_poll_id = mm_poll_scheduler_add (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)),
+                                                               NETWORK_TIMEZONE_POLL_NAME,
+                                                               NETWORK_TIMEZONE_POLL_INTERVAL_SEC * 1000,
+                                                               (MMPollSchedulerFunc)network_timezone_poll_cb,
                                                                self);
         return;
     }
@@ -257,7 +262,11 @@ start_network_timezone_poll (MMIfaceModemTime *self)
 
     mm_obj_dbg (self, "network timezone polling started");
     ctx->network_timezone_poll_retries = NETWORK_TIMEZONE_POLL_RETRIES;
-    ctx->network_timezone_poll_id = g_timeout_add_seconds (NETWORK_TIMEZONE_POLL_INTERVAL_SEC, (GSourceFunc)network_timezone_poll_cb, self);
+    ctx->network_timezone_poll_id = mm_poll_scheduler_add (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)),
+                                                           NETWORK_TIMEZONE_POLL_NAME,
+                                                           NETWORK_TIMEZONE_POLL_INTERVAL_SEC * 1000,
+                                                           (MMPollSchedulerFunc)network_timezone_poll_cb,
+                                                           self);
 }
 
 static void
@@ -269,7 +278,7 @@ stop_network_timezone_poll (MMIfaceModemTime *self)
 
     if (ctx->network_timezone_poll_id) {
         mm_obj_dbg (self, "network timezone polling stopped");
-        g_source_remove (ctx->network_timezone_poll_id);
+        mm_poll_scheduler_remove (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)), ctx->network_timezone_poll_id);
         ctx->network_timezone_poll_id = 0;
     }
 }
@@ -333,6 +342,7 @@ start_network_timezone (MMIfaceModemTime *self)
     stop_network_timezone (self);
 
     ctx = g_new0 (NetworkTimezoneContext, 1);
+    ctx->self = self;
     g_object_set_qdata_full (G_OBJECT (self),
                              network_timezone_context_quark,
                              ctx,
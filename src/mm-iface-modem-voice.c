@@ -18,6 +18,7 @@
 #define _LIBMM_INSIDE_MM
 #include <libmm-glib.h>
 
+#include "mm-base-modem.h"
 #include "mm-iface-modem.h"
 #include "mm-iface-modem-voice.h"
 #include "mm-call-list.h"
@@ -2358,17 +2359,18 @@ setup_in_call_event_handling (MMCallList        *call_list,
  */
 
 #define CALL_LIST_POLLING_TIMEOUT_SECS 2
+#define CALL_LIST_POLL_NAME            "call-list"
 
 typedef struct {
-    guint    polling_id;
-    gboolean polling_ongoing;
+    MMIfaceModemVoice *self;
+    guint              polling_id;
+    gboolean           polling_ongoing;
 } CallListPollingContext;
 
 static void
 call_list_polling_context_free (CallListPollingContext *ctx)
 {
-    if (ctx->polling_id)
-        g_source_remove (ctx->polling_id);
+    mm_poll_scheduler_remove (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (ctx->self)), ctx->polling_id);
     g_slice_free (CallListPollingContext, ctx);
 }
 
@@ -2385,6 +2387,7 @@ get_call_list_polling_context (MMIfaceModemVoice *self)
     if (!ctx) {
         /* Create context and keep it as object data */
         ctx = g_slice_new0 (CallListPollingContext);
+        ctx->self = self;
 
         g_object_set_qdata_full (
             G_OBJECT (self),
@@ -2408,6 +2411,7 @@ load_call_list_ready (MMIfaceModemVoice *self,
 
     ctx = get_call_list_polling_context (self);
     ctx->polling_ongoing = FALSE;
+    mm_poll_scheduler_complete (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)), CALL_LIST_POLL_NAME);
 
     g_assert (MM_IFACE_MODEM_VOICE_GET_INTERFACE (self)->load_call_list_finish);
     if (!MM_IFACE_MODEM_VOICE_GET_INTERFACE (self)->load_call_list_finish (self, res, &call_info_list, &error)) {
@@ -2423,8 +2427,10 @@ load_call_list_ready (MMIfaceModemVoice *self,
      * we reported calls (e.g. a new incoming call may have been detected that
      * also triggers the poll setup) */
     if (!ctx->polling_id)
-        ctx->polling_id = g_timeout_add_seconds (CALL_LIST_POLLING_TIMEOUT_SECS,
-                                                 (GSourceFunc) call_list_poll,
+        ctx->polling_id = mm_poll_scheduler_add (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)),
+                                                 CALL_LIST_POLL_NAME,
+                                                 CALL_LIST_POLLING_TIMEOUT_SECS * 1000,
+                                                 (MMPollSchedulerFunc) call_list_poll,
                                                  self);
 }
 
@@ -2497,8 +2503,10 @@ setup_call_list_polling (MMCallList        *call_list,
     ctx = get_call_list_polling_context (self);
 
     if (!ctx->polling_id && !ctx->polling_ongoing)
-        ctx->polling_id = g_timeout_add_seconds (CALL_LIST_POLLING_TIMEOUT_SECS,
-                                                 (GSourceFunc) call_list_poll,
+        ctx->polling_id = mm_poll_scheduler_add (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)),
+                                                 CALL_LIST_POLL_NAME,
+                                                 CALL_LIST_POLLING_TIMEOUT_SECS * 1000,
+                                                 (MMPollSchedulerFunc) call_list_poll,
                                                  self);
 }
 
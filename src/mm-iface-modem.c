@@ -28,7 +28,9 @@
 #include "mm-base-sim.h"
 #include "mm-bearer-list.h"
 #include "mm-log-object.h"
+#include "mm-trace.h"
 #include "mm-context.h"
+#include "mm-property-cache.h"
 
 #if defined WITH_MBIM
 #include "mm-broadband-modem-mbim.h"
@@ -83,6 +85,120 @@ mm_iface_modem_bind_simple_status (MMIfaceModem *self,
     g_object_unref (skeleton);
 }
 
+/*****************************************************************************/
+/* Persistent property cache */
+
+static MMPropertyCache *
+peek_property_cache (void)
+{
+    static MMPropertyCache *cache;
+    static gboolean         cache_loaded;
+
+    if (!cache_loaded) {
+        const gchar *path;
+
+        path = mm_context_get_property_cache_file ();
+        if (path)
+            cache = mm_property_cache_new (path, NULL);
+        cache_loaded = TRUE;
+    }
+    return cache;
+}
+
+static gchar *
+build_property_cache_unit_key (MmGdbusModem *skeleton)
+{
+    return mm_property_cache_build_unit_key (mm_gdbus_modem_get_equipment_identifier (skeleton),
+                                             mm_gdbus_modem_get_revision (skeleton));
+}
+
+static gchar *
+peek_property_cache_unit (MMIfaceModem     *self,
+                          MMPropertyCache **out_cache)
+{
+    MMPropertyCache *cache;
+    MmGdbusModem    *skeleton = NULL;
+    gchar           *unit_key = NULL;
+
+    cache = peek_property_cache ();
+    if (!cache)
+        return NULL;
+
+    g_object_get (self,
+                  MM_IFACE_MODEM_DBUS_SKELETON, &skeleton,
+                  NULL);
+    if (!skeleton)
+        return NULL;
+
+    unit_key = build_property_cache_unit_key (skeleton);
+    g_object_unref (skeleton);
+    if (!unit_key || !mm_property_cache_has_unit (cache, unit_key)) {
+        g_free (unit_key);
+        return NULL;
+    }
+
+    *out_cache = cache;
+    return unit_key;
+}
+
+static void
+save_property_cache (MMIfaceModem    *self,
+                     MMPropertyCache *cache)
+{
+    GError *error = NULL;
+
+    if (!mm_property_cache_save (cache, &error)) {
+        mm_obj_warn (self, "couldn't save property cache: %s", error->message);
+        g_error_free (error);
+    }
+}
+
+GVariant *
+mm_iface_modem_lookup_cached_property (MMIfaceModem       *self,
+                                       const gchar        *key,
+                                       const GVariantType *type)
+{
+    MMPropertyCache  *cache = NULL;
+    g_autofree gchar *unit_key = NULL;
+
+    unit_key = peek_property_cache_unit (self, &cache);
+    if (!unit_key)
+        return NULL;
+    return mm_property_cache_get (cache, unit_key, key, type);
+}
+
+void
+mm_iface_modem_store_cached_property (MMIfaceModem *self,
+                                      const gchar  *key,
+                                      GVariant     *value)
+{
+    MMPropertyCache  *cache = NULL;
+    g_autofree gchar *unit_key = NULL;
+
+    unit_key = peek_property_cache_unit (self, &cache);
+    if (!unit_key) {
+        g_variant_unref (g_variant_ref_sink (value));
+        return;
+    }
+    mm_property_cache_set (cache, unit_key, key, value);
+    save_property_cache (self, cache);
+}
+
+void
+mm_iface_modem_invalidate_property_cache (MMIfaceModem *self)
+{
+    MMPropertyCache  *cache = NULL;
+    g_autofree gchar *unit_key = NULL;
+
+    unit_key = peek_property_cache_unit (self, &cache);
+    if (!unit_key)
+        return;
+
+    mm_obj_dbg (self, "removing property cache entry");
+    mm_property_cache_remove_unit (cache, unit_key);
+    save_property_cache (self, cache);
+}
+
 /*****************************************************************************/
 /* Helper method to wait for a final state */
 
@@ -962,6 +1078,9 @@ handle_list_bearers (MmGdbusModem *skeleton,
 
 /*****************************************************************************/
 
+static void signal_check_refreshed (MMIfaceModem *self,
+                                    gboolean      signal_quality);
+
 void
 mm_iface_modem_update_access_technologies (MMIfaceModem *self,
                                            MMModemAccessTechnology new_access_tech,
@@ -1003,6 +1122,8 @@ mm_iface_modem_update_access_technologies (MMIfaceModem *self,
     }
 
     g_object_unref (skeleton);
+
+    signal_check_refreshed (self, FALSE);
 }
 
 /*****************************************************************************/
@@ -1123,6 +1244,7 @@ mm_iface_modem_update_signal_quality (MMIfaceModem *self,
                                       guint signal_quality)
 {
     update_signal_quality (self, signal_quality, TRUE);
+    signal_check_refreshed (self, TRUE);
 }
 
 /*****************************************************************************/
@@ -1137,8 +1259,9 @@ typedef enum {
 } SignalCheckStep;
 
 typedef struct {
-    gboolean enabled;
-    guint    timeout_source;
+    MMIfaceModem *self;
+    gboolean      enabled;
+    guint         timeout_source;
 
     /* We first attempt an initial loading, and once it's done we
      * setup polling */
@@ -1159,13 +1282,19 @@ typedef struct {
 
     /* Steps triggered when polling active */
     SignalCheckStep running_step;
+
+    /* Values updated by other means (e.g. unsolicited messages) since the
+     * last check */
+    gboolean signal_quality_refreshed;
+    gboolean access_technologies_refreshed;
 } SignalCheckContext;
 
+#define SIGNAL_CHECK_POLL_NAME "signal-quality"
+
 static void
 signal_check_context_free (SignalCheckContext *ctx)
 {
-    if (ctx->timeout_source)
-        g_source_remove (ctx->timeout_source);
+    mm_poll_scheduler_remove (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (ctx->self)), ctx->timeout_source);
     g_slice_free (SignalCheckContext, ctx);
 }
 
@@ -1182,6 +1311,7 @@ get_signal_check_context (MMIfaceModem *self)
     if (!ctx) {
         /* Create context and attach it to the object */
         ctx = g_slice_new0 (SignalCheckContext);
+        ctx->self = self;
         ctx->running_step = SIGNAL_CHECK_STEP_NONE;
 
         /* Initially assume supported if load_access_technologies() is
@@ -1210,6 +1340,37 @@ get_signal_check_context (MMIfaceModem *self)
     return ctx;
 }
 
+static void
+signal_check_refreshed (MMIfaceModem *self,
+                        gboolean      signal_quality)
+{
+    SignalCheckContext *ctx;
+
+    if (G_UNLIKELY (!signal_check_context_quark))
+        return;
+
+    /* Updates done by the checks themselves don't count */
+    ctx = g_object_get_qdata (G_OBJECT (self), signal_check_context_quark);
+    if (!ctx || !ctx->enabled || !ctx->initial_check_done || ctx->running_step != SIGNAL_CHECK_STEP_NONE)
+        return;
+
+    if (signal_quality)
+        ctx->signal_quality_refreshed = TRUE;
+    else
+        ctx->access_technologies_refreshed = TRUE;
+
+    /* The next check may be skipped only if everything it would poll has
+     * already been refreshed */
+    if ((ctx->signal_quality_refreshed ||
+         !ctx->signal_quality_polling_supported || ctx->signal_quality_polling_disabled) &&
+        (ctx->access_technologies_refreshed ||
+         !ctx->access_technology_polling_supported || ctx->access_technology_polling_disabled)) {
+        mm_poll_scheduler_refreshed (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)), SIGNAL_CHECK_POLL_NAME);
+        ctx->signal_quality_refreshed = FALSE;
+        ctx->access_technologies_refreshed = FALSE;
+    }
+}
+
 static void     periodic_signal_check_disable (MMIfaceModem *self,
                                                gboolean      clear);
 static gboolean periodic_signal_check_cb      (MMIfaceModem *self);
@@ -1317,6 +1478,7 @@ peridic_signal_check_step (MMIfaceModem *self)
     case SIGNAL_CHECK_STEP_LAST:
         /* Flag as sequence finished */
         ctx->running_step = SIGNAL_CHECK_STEP_NONE;
+        mm_poll_scheduler_complete (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)), SIGNAL_CHECK_POLL_NAME);
 
         /* If we have been disabled while we were running the steps, we don't
          * do anything else. */
@@ -1359,8 +1521,10 @@ peridic_signal_check_step (MMIfaceModem *self)
 
         mm_obj_dbg (self, "periodic signal quality and access technology checks scheduled");
         g_assert (!ctx->timeout_source);
-        ctx->timeout_source = g_timeout_add_seconds (ctx->initial_check_done ? SIGNAL_CHECK_TIMEOUT_SEC : SIGNAL_CHECK_INITIAL_TIMEOUT_SEC,
-                                                     (GSourceFunc) periodic_signal_check_cb,
+        ctx->timeout_source = mm_poll_scheduler_add (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)),
+                                                     SIGNAL_CHECK_POLL_NAME,
+                                                     (ctx->initial_check_done ? SIGNAL_CHECK_TIMEOUT_SEC : SIGNAL_CHECK_INITIAL_TIMEOUT_SEC) * 1000,
+                                                     (MMPollSchedulerFunc) periodic_signal_check_cb,
                                                      self);
         return;
 
@@ -1377,11 +1541,17 @@ periodic_signal_check_cb (MMIfaceModem *self)
     ctx = get_signal_check_context (self);
     g_assert (ctx->enabled);
 
+    /* The poll is removed when returning, and the sequence may schedule the
+     * next one right away */
+    ctx->timeout_source = 0;
+
     /* Start the sequence */
-    ctx->running_step             = SIGNAL_CHECK_STEP_FIRST;
-    ctx->signal_quality           = 0;
-    ctx->access_technologies      = MM_MODEM_ACCESS_TECHNOLOGY_UNKNOWN;
-    ctx->access_technologies_mask = MM_MODEM_ACCESS_TECHNOLOGY_ANY;
+    ctx->running_step                  = SIGNAL_CHECK_STEP_FIRST;
+    ctx->signal_quality                = 0;
+    ctx->access_technologies           = MM_MODEM_ACCESS_TECHNOLOGY_UNKNOWN;
+    ctx->access_technologies_mask      = MM_MODEM_ACCESS_TECHNOLOGY_ANY;
+    ctx->signal_quality_refreshed      = FALSE;
+    ctx->access_technologies_refreshed = FALSE;
     peridic_signal_check_step (self);
 
 #if defined WITH_MBIM
@@ -1397,9 +1567,6 @@ periodic_signal_check_cb (MMIfaceModem *self)
     }
 #endif
 
-    /* Remove the timeout and clear the source id */
-    if (ctx->timeout_source)
-        ctx->timeout_source = 0;
     return G_SOURCE_REMOVE;
 }
 
@@ -1426,7 +1593,7 @@ mm_iface_modem_refresh_signal (MMIfaceModem *self)
     /* Remove the scheduled timeout as we're going to refresh
      * right away */
     if (ctx->timeout_source) {
-        g_source_remove (ctx->timeout_source);
+        mm_poll_scheduler_remove (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)), ctx->timeout_source);
         ctx->timeout_source = 0;
     }
 
@@ -1459,7 +1626,7 @@ periodic_signal_check_disable (MMIfaceModem *self,
 
     /* Remove scheduled timeout */
     if (ctx->timeout_source) {
-        g_source_remove (ctx->timeout_source);
+        mm_poll_scheduler_remove (mm_base_modem_peek_poll_scheduler (MM_BASE_MODEM (self)), ctx->timeout_source);
         ctx->timeout_source = 0;
     }
 
@@ -1596,6 +1763,24 @@ __iface_modem_update_state_internal (MMIfaceModem *self,
          * cleanup signal quality retrieval */
         else if (old_state >= MM_MODEM_STATE_REGISTERED && new_state < MM_MODEM_STATE_REGISTERED)
             periodic_signal_check_disable (self, TRUE);
+
+        /* Keep the history of what led to the failure */
+        if (new_state == MM_MODEM_STATE_FAILED && mm_log_recorder_enabled ()) {
+            GError *error = NULL;
+            gchar  *path;
+
+            path = mm_log_recorder_dump_automatic (&error);
+            if (!path) {
+                if (g_error_matches (error, MM_CORE_ERROR, MM_CORE_ERROR_RETRY))
+                    mm_obj_dbg (self, "log recorder not dumped: %s", error->message);
+                else
+                    mm_obj_warn (self, "couldn't dump log recorder: %s", error->message);
+                g_error_free (error);
+            } else {
+                mm_obj_info (self, "log recorder dumped to %s", path);
+                g_free (path);
+            }
+        }
     }
 
     if (skeleton)
@@ -1997,8 +2182,11 @@ handle_reset_ready (MMIfaceModem *self,
 
     if (!MM_IFACE_MODEM_GET_INTERFACE (self)->reset_finish (self, res, &error))
         g_dbus_method_invocation_take_error (ctx->invocation, error);
-    else
+    else {
+        /* Don't trust what we know about the modem after a reset */
+        mm_iface_modem_invalidate_property_cache (self);
         mm_gdbus_modem_complete_reset (ctx->skeleton, ctx->invocation);
+    }
 
     handle_reset_context_free (ctx);
 }
@@ -2081,8 +2269,10 @@ handle_factory_reset_ready (MMIfaceModem *self,
 
     if (!MM_IFACE_MODEM_GET_INTERFACE (self)->factory_reset_finish (self, res, &error))
         g_dbus_method_invocation_take_error (ctx->invocation, error);
-    else
+    else {
+        mm_iface_modem_invalidate_property_cache (self);
         mm_gdbus_modem_complete_factory_reset (ctx->skeleton, ctx->invocation);
+    }
 
     handle_factory_reset_context_free (ctx);
 }
@@ -3836,11 +4026,13 @@ typedef enum {
 struct _EnablingContext {
     EnablingStep step;
     MmGdbusModem *skeleton;
+    MMTraceSpan trace_span;
 };
 
 static void
 enabling_context_free (EnablingContext *ctx)
 {
+    mm_trace_clear (&ctx->trace_span);
     if (ctx->skeleton)
         g_object_unref (ctx->skeleton);
     g_free (ctx);
@@ -3924,7 +4116,7 @@ static const MMModemCharset best_charsets[] = {
 };
 
 static void
-interface_enabling_step (GTask *task)
+interface_enabling_step_run (GTask *task)
 {
     MMIfaceModem *self;
     EnablingContext *ctx;
@@ -3987,6 +4179,21 @@ interface_enabling_step (GTask *task)
     g_assert_not_reached ();
 }
 
+static void
+interface_enabling_step (GTask *task)
+{
+    EnablingContext *ctx;
+
+    ctx = g_task_get_task_data (task);
+    g_object_ref (task);
+    interface_enabling_step_run (task);
+    if (ctx->step == ENABLING_STEP_LAST)
+        mm_trace_clear (&ctx->trace_span);
+    else
+        mm_trace_step (&ctx->trace_span, g_task_get_source_object (task), "modem-enable", ctx->step);
+    g_object_unref (task);
+}
+
 void
 mm_iface_modem_enable (MMIfaceModem *self,
                        GCancellable *cancellable,
@@ -4026,6 +4233,9 @@ static void interface_initialization_step (GTask *task);
 typedef enum {
     INITIALIZATION_STEP_FIRST,
     INITIALIZATION_STEP_CURRENT_CAPABILITIES,
+    INITIALIZATION_STEP_WARM_START_REVISION,
+    INITIALIZATION_STEP_WARM_START_EQUIPMENT_ID,
+    INITIALIZATION_STEP_WARM_START,
     INITIALIZATION_STEP_SUPPORTED_CAPABILITIES,
     INITIALIZATION_STEP_SUPPORTED_CHARSETS,
     INITIALIZATION_STEP_CHARSET,
@@ -4056,13 +4266,16 @@ struct _InitializationContext {
     MmGdbusModem *skeleton;
     MMModemCharset supported_charsets;
     const MMModemCharset *current_charset;
+    gboolean warm_started;
     GError *fatal_error;
+    MMTraceSpan trace_span;
 };
 
 static void
 initialization_context_free (InitializationContext *ctx)
 {
     g_assert (ctx->fatal_error == NULL);
+    mm_trace_clear (&ctx->trace_span);
     g_object_unref (ctx->skeleton);
     g_free (ctx);
 }
@@ -4655,8 +4868,128 @@ setup_sim_hot_swap_ready (MMIfaceModem *self,
     interface_initialization_step (task);
 }
 
+/*****************************************************************************/
+/* Warm start from the persistent property cache */
+
+/* Supported capabilities, modes and bands are only taken from the cache when
+ * the loaders have no side effects; plugins may keep private state computed
+ * while loading them. */
+static gboolean
+property_cache_loaders_safe (MMIfaceModem *self)
+{
+    gboolean safe = FALSE;
+
+    g_object_get (self,
+                  MM_IFACE_MODEM_PROPERTY_CACHE_LOADERS_SAFE, &safe,
+                  NULL);
+    return safe;
+}
+
 static void
-interface_initialization_step (GTask *task)
+load_cached_properties (MMIfaceModem          *self,
+                        InitializationContext *ctx)
+{
+    MMPropertyCache  *cache;
+    g_autofree gchar *unit_key = NULL;
+    GVariant         *value;
+
+    cache = peek_property_cache ();
+    if (!cache)
+        return;
+
+    unit_key = build_property_cache_unit_key (ctx->skeleton);
+    if (!unit_key || !mm_property_cache_has_unit (cache, unit_key))
+        return;
+
+    mm_obj_dbg (self, "loading static properties from cache...");
+    ctx->warm_started = TRUE;
+
+#define LOAD_CACHED(KEY, TYPE, STMT)                                   \
+    value = mm_property_cache_get (cache, unit_key, KEY, TYPE);        \
+    if (value) {                                                       \
+        STMT;                                                          \
+        g_variant_unref (value);                                       \
+    }
+
+    if (!mm_gdbus_modem_get_manufacturer (ctx->skeleton)) {
+        LOAD_CACHED ("manufacturer", G_VARIANT_TYPE_STRING,
+                     mm_gdbus_modem_set_manufacturer (ctx->skeleton, g_variant_get_string (value, NULL)));
+    }
+    if (!mm_gdbus_modem_get_model (ctx->skeleton)) {
+        LOAD_CACHED ("model", G_VARIANT_TYPE_STRING,
+                     mm_gdbus_modem_set_model (ctx->skeleton, g_variant_get_string (value, NULL)));
+    }
+    if (!mm_gdbus_modem_get_hardware_revision (ctx->skeleton)) {
+        LOAD_CACHED ("hardware-revision", G_VARIANT_TYPE_STRING,
+                     mm_gdbus_modem_set_hardware_revision (ctx->skeleton, g_variant_get_string (value, NULL)));
+    }
+    if (mm_gdbus_modem_get_supported_ip_families (ctx->skeleton) == MM_BEARER_IP_FAMILY_NONE) {
+        LOAD_CACHED ("supported-ip-families", G_VARIANT_TYPE_UINT32,
+                     mm_gdbus_modem_set_supported_ip_families (ctx->skeleton, g_variant_get_uint32 (value)));
+    }
+    LOAD_CACHED ("supported-charsets", G_VARIANT_TYPE_UINT32,
+                 ctx->supported_charsets = g_variant_get_uint32 (value));
+
+    /* The initialization steps only load these when still holding the
+     * defaults, so preloading them is enough to skip the loaders */
+    if (property_cache_loaders_safe (self)) {
+        LOAD_CACHED ("supported-capabilities", G_VARIANT_TYPE ("au"),
+                     mm_gdbus_modem_set_supported_capabilities (ctx->skeleton, value));
+        LOAD_CACHED ("supported-modes", G_VARIANT_TYPE ("a(uu)"),
+                     mm_gdbus_modem_set_supported_modes (ctx->skeleton, value));
+        LOAD_CACHED ("supported-bands", G_VARIANT_TYPE ("au"),
+                     mm_gdbus_modem_set_supported_bands (ctx->skeleton, value));
+    }
+
+#undef LOAD_CACHED
+}
+
+static void
+store_cached_properties (MMIfaceModem          *self,
+                         InitializationContext *ctx)
+{
+    MMPropertyCache  *cache;
+    g_autofree gchar *unit_key = NULL;
+    const gchar      *str;
+
+    cache = peek_property_cache ();
+    if (!cache)
+        return;
+
+    unit_key = build_property_cache_unit_key (ctx->skeleton);
+    if (!unit_key)
+        return;
+
+    mm_obj_dbg (self, "storing static properties in cache...");
+    mm_property_cache_set_unit (cache, unit_key);
+
+    if ((str = mm_gdbus_modem_get_manufacturer (ctx->skeleton)) != NULL)
+        mm_property_cache_set (cache, unit_key, "manufacturer", g_variant_new_string (str));
+    if ((str = mm_gdbus_modem_get_model (ctx->skeleton)) != NULL)
+        mm_property_cache_set (cache, unit_key, "model", g_variant_new_string (str));
+    if ((str = mm_gdbus_modem_get_hardware_revision (ctx->skeleton)) != NULL)
+        mm_property_cache_set (cache, unit_key, "hardware-revision", g_variant_new_string (str));
+    if (mm_gdbus_modem_get_supported_ip_families (ctx->skeleton) != MM_BEARER_IP_FAMILY_NONE)
+        mm_property_cache_set (cache, unit_key, "supported-ip-families",
+                               g_variant_new_uint32 (mm_gdbus_modem_get_supported_ip_families (ctx->skeleton)));
+    if (ctx->supported_charsets != MM_MODEM_CHARSET_UNKNOWN)
+        mm_property_cache_set (cache, unit_key, "supported-charsets",
+                               g_variant_new_uint32 (ctx->supported_charsets));
+
+    if (property_cache_loaders_safe (self)) {
+        mm_property_cache_set (cache, unit_key, "supported-capabilities",
+                               mm_gdbus_modem_get_supported_capabilities (ctx->skeleton));
+        mm_property_cache_set (cache, unit_key, "supported-modes",
+                               mm_gdbus_modem_get_supported_modes (ctx->skeleton));
+        mm_property_cache_set (cache, unit_key, "supported-bands",
+                               mm_gdbus_modem_get_supported_bands (ctx->skeleton));
+    }
+
+    save_property_cache (self, cache);
+}
+
+static void
+interface_initialization_step_run (GTask *task)
 {
     MMIfaceModem *self;
     InitializationContext *ctx;
@@ -4753,6 +5086,43 @@ interface_initialization_step (GTask *task)
         ctx->step++;
         /* fall-through */
 
+    case INITIALIZATION_STEP_WARM_START_REVISION:
+        /* When the persistent cache is enabled, revision and equipment
+         * identifier are loaded before anything else, so that static
+         * properties found in the cache are preloaded and not queried to the
+         * modem again. Otherwise they're loaded in their usual order. */
+        if (peek_property_cache () &&
+            mm_gdbus_modem_get_revision (ctx->skeleton) == NULL &&
+            MM_IFACE_MODEM_GET_INTERFACE (self)->load_revision &&
+            MM_IFACE_MODEM_GET_INTERFACE (self)->load_revision_finish) {
+            MM_IFACE_MODEM_GET_INTERFACE (self)->load_revision (
+                self,
+                (GAsyncReadyCallback)load_revision_ready,
+                task);
+            return;
+        }
+        ctx->step++;
+        /* fall-through */
+
+    case INITIALIZATION_STEP_WARM_START_EQUIPMENT_ID:
+        if (peek_property_cache () &&
+            mm_gdbus_modem_get_equipment_identifier (ctx->skeleton) == NULL &&
+            MM_IFACE_MODEM_GET_INTERFACE (self)->load_equipment_identifier &&
+            MM_IFACE_MODEM_GET_INTERFACE (self)->load_equipment_identifier_finish) {
+            MM_IFACE_MODEM_GET_INTERFACE (self)->load_equipment_identifier (
+                self,
+                (GAsyncReadyCallback)load_equipment_identifier_ready,
+                task);
+            return;
+        }
+        ctx->step++;
+        /* fall-through */
+
+    case INITIALIZATION_STEP_WARM_START:
+        load_cached_properties (self, ctx);
+        ctx->step++;
+        /* fall-through */
+
     case INITIALIZATION_STEP_SUPPORTED_CAPABILITIES: {
         GArray *supported_capabilities;
 
@@ -4791,7 +5161,8 @@ interface_initialization_step (GTask *task)
     } /* fall-through */
 
     case INITIALIZATION_STEP_SUPPORTED_CHARSETS:
-        if (MM_IFACE_MODEM_GET_INTERFACE (self)->load_supported_charsets &&
+        if (ctx->supported_charsets == MM_MODEM_CHARSET_UNKNOWN &&
+            MM_IFACE_MODEM_GET_INTERFACE (self)->load_supported_charsets &&
             MM_IFACE_MODEM_GET_INTERFACE (self)->load_supported_charsets_finish) {
             MM_IFACE_MODEM_GET_INTERFACE (self)->load_supported_charsets (
                 self,
@@ -5298,6 +5669,9 @@ interface_initialization_step (GTask *task)
             mm_gdbus_object_skeleton_set_modem (MM_GDBUS_OBJECT_SKELETON (self),
                                                 MM_GDBUS_MODEM (ctx->skeleton));
 
+        if (!ctx->fatal_error && !ctx->warm_started)
+            store_cached_properties (self, ctx);
+
         if (ctx->fatal_error) {
             g_task_return_error (task, ctx->fatal_error);
             ctx->fatal_error = NULL;
@@ -5314,6 +5688,21 @@ interface_initialization_step (GTask *task)
     g_assert_not_reached ();
 }
 
+static void
+interface_initialization_step (GTask *task)
+{
+    InitializationContext *ctx;
+
+    ctx = g_task_get_task_data (task);
+    g_object_ref (task);
+    interface_initialization_step_run (task);
+    if (ctx->step == INITIALIZATION_STEP_LAST)
+        mm_trace_clear (&ctx->trace_span);
+    else
+        mm_trace_step (&ctx->trace_span, g_task_get_source_object (task), "modem-init", ctx->step);
+    g_object_unref (task);
+}
+
 gboolean
 mm_iface_modem_initialize_finish (MMIfaceModem *self,
                                   GAsyncResult *res,
@@ -5754,6 +6143,14 @@ iface_modem_init (gpointer g_iface)
                                FALSE,
                                G_PARAM_READWRITE));
 
+    g_object_interface_install_property
+        (g_iface,
+         g_param_spec_boolean (MM_IFACE_MODEM_PROPERTY_CACHE_LOADERS_SAFE,
+                               "Property cache loaders safe",
+                               "Whether supported capabilities, modes and bands may be taken from the property cache.",
+                               FALSE,
+                               G_PARAM_READABLE));
+
     g_object_interface_install_property
         (g_iface,
          g_param_spec_string (MM_IFACE_MODEM_CARRIER_CONFIG_MAPPING,
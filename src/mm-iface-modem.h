@@ -41,6 +41,7 @@
 #define MM_IFACE_MODEM_CARRIER_CONFIG_MAPPING  "iface-modem-carrier-config-mapping"
 #define MM_IFACE_MODEM_PERIODIC_SIGNAL_CHECK_DISABLED      "iface-modem-periodic-signal-check-disabled"
 #define MM_IFACE_MODEM_PERIODIC_ACCESS_TECH_CHECK_DISABLED "iface-modem-periodic-access-tech-check-disabled"
+#define MM_IFACE_MODEM_PROPERTY_CACHE_LOADERS_SAFE         "iface-modem-property-cache-loaders-safe"
 
 typedef struct _MMIfaceModem MMIfaceModem;
 
@@ -413,6 +414,17 @@ gboolean     mm_iface_modem_get_carrier_config (MMIfaceModem  *self,
                                                 const gchar  **name,
                                                 const gchar  **revision);
 
+/* Persistent cache of static properties, if enabled. Values are kept in the
+ * cache entry of the modem, which is created during the Modem interface
+ * initialization; lookups and stores before that are ignored. */
+GVariant *mm_iface_modem_lookup_cached_property (MMIfaceModem       *self,
+                                                 const gchar        *key,
+                                                 const GVariantType *type);
+void      mm_iface_modem_store_cached_property  (MMIfaceModem       *self,
+                                                 const gchar        *key,
+                                                 GVariant           *value);
+void      mm_iface_modem_invalidate_property_cache (MMIfaceModem    *self);
+
 /* Initialize Modem interface (async) */
 void     mm_iface_modem_initialize        (MMIfaceModem *self,
                                            GCancellable *cancellable,
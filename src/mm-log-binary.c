@@ -0,0 +1,555 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mm-log-binary.h"
+
+/*****************************************************************************/
+/* printf conversion specifications */
+
+typedef enum {
+    SPEC_TYPE_INVALID,
+    /* "%%", without argument */
+    SPEC_TYPE_PERCENT,
+    SPEC_TYPE_SIGNED,
+    SPEC_TYPE_UNSIGNED,
+    SPEC_TYPE_CHAR,
+    SPEC_TYPE_DOUBLE,
+    SPEC_TYPE_STRING,
+    SPEC_TYPE_POINTER,
+} SpecType;
+
+typedef enum {
+    SPEC_LENGTH_NONE,
+    SPEC_LENGTH_HH,
+    SPEC_LENGTH_H,
+    SPEC_LENGTH_L,
+    SPEC_LENGTH_LL,
+    SPEC_LENGTH_Z,
+    SPEC_LENGTH_J,
+    SPEC_LENGTH_T,
+} SpecLength;
+
+typedef struct {
+    const gchar *start;
+    gsize        len;
+    /* Length of flags, width and precision, after the '%' */
+    gsize        modifiers_len;
+    /* Arguments given for width and precision */
+    guint        n_stars;
+    SpecLength   length;
+    SpecType     type;
+} Spec;
+
+/* Finds the next conversion in @fmt; returns the position right after it,
+ * or NULL if there are no more */
+static const gchar *
+spec_next (const gchar *fmt,
+           Spec        *spec)
+{
+    const gchar *p;
+
+    p = strchr (fmt, '%');
+    if (!p)
+        return NULL;
+
+    memset (spec, 0, sizeof (Spec));
+    spec->start = p++;
+
+    if (*p == '%') {
+        spec->type = SPEC_TYPE_PERCENT;
+        spec->len = 2;
+        return p + 1;
+    }
+
+    while (*p && strchr ("-+ #0'I", *p))
+        p++;
+    if (*p == '*') {
+        spec->n_stars++;
+        p++;
+    } else while (g_ascii_isdigit (*p))
+        p++;
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec->n_stars++;
+            p++;
+        } else while (g_ascii_isdigit (*p))
+            p++;
+    }
+    spec->modifiers_len = p - spec->start - 1;
+
+    switch (*p) {
+    case 'h':
+        if (*(++p) == 'h') {
+            spec->length = SPEC_LENGTH_HH;
+            p++;
+        } else
+            spec->length = SPEC_LENGTH_H;
+        break;
+    case 'l':
+        if (*(++p) == 'l') {
+            spec->length = SPEC_LENGTH_LL;
+            p++;
+        } else
+            spec->length = SPEC_LENGTH_L;
+        break;
+    case 'q':
+        spec->length = SPEC_LENGTH_LL;
+        p++;
+        break;
+    case 'z':
+        spec->length = SPEC_LENGTH_Z;
+        p++;
+        break;
+    case 'j':
+        spec->length = SPEC_LENGTH_J;
+        p++;
+        break;
+    case 't':
+        spec->length = SPEC_LENGTH_T;
+        p++;
+        break;
+    default:
+        break;
+    }
+
+    /* Anything not listed, including positional arguments, "%n" and wide
+     * characters, is left as invalid */
+    switch (*p) {
+    case 'd':
+    case 'i':
+        spec->type = SPEC_TYPE_SIGNED;
+        break;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        spec->type = SPEC_TYPE_UNSIGNED;
+        break;
+    case 'c':
+        if (spec->length == SPEC_LENGTH_NONE)
+            spec->type = SPEC_TYPE_CHAR;
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        if (spec->length == SPEC_LENGTH_NONE || spec->length == SPEC_LENGTH_L)
+            spec->type = SPEC_TYPE_DOUBLE;
+        break;
+    case 's':
+        if (spec->length == SPEC_LENGTH_NONE)
+            spec->type = SPEC_TYPE_STRING;
+        break;
+    case 'p':
+        if (spec->length == SPEC_LENGTH_NONE)
+            spec->type = SPEC_TYPE_POINTER;
+        break;
+    default:
+        break;
+    }
+
+    if (*p)
+        p++;
+    spec->len = p - spec->start;
+    return p;
+}
+
+/*****************************************************************************/
+/* Encoding */
+
+#define NULL_STRING_LEN 0xffffffff
+
+static gsize
+record_start (GString               *out,
+              MMLogBinaryRecordType  type,
+              MMLogLevel             level)
+{
+    MMLogBinaryRecord record = { 0 };
+    gsize             start;
+
+    start = out->len;
+    record.type = type;
+    record.level = level;
+    g_string_append_len (out, (const gchar *) &record, sizeof (record));
+    return start;
+}
+
+static void
+record_end (GString *out,
+            gsize    start)
+{
+    guint32 len;
+
+    len = out->len - start - sizeof (MMLogBinaryRecord);
+    memcpy (&out->str[start + offsetof (MMLogBinaryRecord, len)], &len, sizeof (len));
+}
+
+static void
+append_message_header (GString *out,
+                       guint32  format_id,
+                       guint32  object_id,
+                       guint32  module_id)
+{
+    MMLogBinaryMessage message = { 0 };
+
+    message.time = g_get_monotonic_time ();
+    message.format_id = format_id;
+    message.object_id = object_id;
+    message.module_id = module_id;
+    g_string_append_len (out, (const gchar *) &message, sizeof (message));
+}
+
+static void
+append_int64 (GString *out,
+              gint64   value)
+{
+    g_string_append_len (out, (const gchar *) &value, sizeof (value));
+}
+
+static void
+append_uint64 (GString *out,
+               guint64  value)
+{
+    g_string_append_len (out, (const gchar *) &value, sizeof (value));
+}
+
+void
+mm_log_binary_append_header (GString *out)
+{
+    MMLogBinaryHeader header;
+    gsize             start;
+
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, MM_LOG_BINARY_MAGIC, sizeof (header.magic));
+    header.byte_order = MM_LOG_BINARY_BYTE_ORDER;
+    header.wall_time = g_get_real_time ();
+    header.monotonic_time = g_get_monotonic_time ();
+
+    start = record_start (out, MM_LOG_BINARY_RECORD_HEADER, 0);
+    g_string_append_len (out, (const gchar *) &header, sizeof (header));
+    record_end (out, start);
+}
+
+void
+mm_log_binary_append_string (GString     *out,
+                             guint32      id,
+                             const gchar *str)
+{
+    gsize start;
+
+    start = record_start (out, MM_LOG_BINARY_RECORD_STRING, 0);
+    g_string_append_len (out, (const gchar *) &id, sizeof (id));
+    g_string_append (out, str);
+    record_end (out, start);
+}
+
+void
+mm_log_binary_append_text (GString     *out,
+                           MMLogLevel   level,
+                           guint32      object_id,
+                           guint32      module_id,
+                           const gchar *text,
+                           gsize        len)
+{
+    gsize start;
+
+    start = record_start (out, MM_LOG_BINARY_RECORD_MESSAGE, level);
+    append_message_header (out, 0, object_id, module_id);
+    g_string_append_len (out, text, len);
+    record_end (out, start);
+}
+
+gboolean
+mm_log_binary_append_args (GString     *out,
+                           const gchar *fmt,
+                           va_list      args)
+{
+    const gchar *p;
+    Spec         spec;
+    gsize        start;
+
+    start = out->len;
+
+    /* Every integer is stored as 64 bits, already truncated to the type
+     * given by the length modifier, so that the decoder doesn't need to care
+     * about the sizes of the types in the host that wrote the log */
+    for (p = fmt; (p = spec_next (p, &spec)) != NULL; ) {
+        guint i;
+
+        for (i = 0; i < spec.n_stars; i++)
+            append_int64 (out, va_arg (args, gint));
+
+        switch (spec.type) {
+        case SPEC_TYPE_PERCENT:
+            break;
+        case SPEC_TYPE_SIGNED:
+            switch (spec.length) {
+            case SPEC_LENGTH_HH:
+                append_int64 (out, (signed char) va_arg (args, gint));
+                break;
+            case SPEC_LENGTH_H:
+                append_int64 (out, (gshort) va_arg (args, gint));
+                break;
+            case SPEC_LENGTH_L:
+                append_int64 (out, va_arg (args, glong));
+                break;
+            case SPEC_LENGTH_LL:
+                append_int64 (out, va_arg (args, long long));
+                break;
+            case SPEC_LENGTH_Z:
+                append_int64 (out, va_arg (args, gssize));
+                break;
+            case SPEC_LENGTH_J:
+                append_int64 (out, va_arg (args, intmax_t));
+                break;
+            case SPEC_LENGTH_T:
+                append_int64 (out, va_arg (args, ptrdiff_t));
+                break;
+            case SPEC_LENGTH_NONE:
+            default:
+                append_int64 (out, va_arg (args, gint));
+                break;
+            }
+            break;
+        case SPEC_TYPE_UNSIGNED:
+            switch (spec.length) {
+            case SPEC_LENGTH_HH:
+                append_uint64 (out, (guchar) va_arg (args, guint));
+                break;
+            case SPEC_LENGTH_H:
+                append_uint64 (out, (gushort) va_arg (args, guint));
+                break;
+            case SPEC_LENGTH_L:
+                append_uint64 (out, va_arg (args, gulong));
+                break;
+            case SPEC_LENGTH_LL:
+                append_uint64 (out, va_arg (args, unsigned long long));
+                break;
+            case SPEC_LENGTH_Z:
+                append_uint64 (out, va_arg (args, gsize));
+                break;
+            case SPEC_LENGTH_J:
+                append_uint64 (out, va_arg (args, uintmax_t));
+                break;
+            case SPEC_LENGTH_T:
+                append_uint64 (out, (guint64) va_arg (args, ptrdiff_t));
+                break;
+            case SPEC_LENGTH_NONE:
+            default:
+                append_uint64 (out, va_arg (args, guint));
+                break;
+            }
+            break;
+        case SPEC_TYPE_CHAR:
+            append_int64 (out, va_arg (args, gint));
+            break;
+        case SPEC_TYPE_DOUBLE: {
+            gdouble value;
+
+            value = va_arg (args, gdouble);
+            g_string_append_len (out, (const gchar *) &value, sizeof (value));
+            break;
+        }
+        case SPEC_TYPE_STRING: {
+            const gchar *value;
+            guint32      len;
+
+            value = va_arg (args, const gchar *);
+            len = value ? strlen (value) : NULL_STRING_LEN;
+            g_string_append_len (out, (const gchar *) &len, sizeof (len));
+            if (value)
+                g_string_append_len (out, value, len);
+            break;
+        }
+        case SPEC_TYPE_POINTER:
+            append_uint64 (out, (guintptr) va_arg (args, gpointer));
+            break;
+        case SPEC_TYPE_INVALID:
+        default:
+            g_string_truncate (out, start);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+gboolean
+mm_log_binary_append_message (GString     *out,
+                              MMLogLevel   level,
+                              guint32      format_id,
+                              guint32      object_id,
+                              guint32      module_id,
+                              const gchar *fmt,
+                              va_list      args)
+{
+    gsize start;
+
+    start = record_start (out, MM_LOG_BINARY_RECORD_MESSAGE, level);
+    append_message_header (out, format_id, object_id, module_id);
+    if (!mm_log_binary_append_args (out, fmt, args)) {
+        g_string_truncate (out, start);
+        return FALSE;
+    }
+    record_end (out, start);
+    return TRUE;
+}
+
+/*****************************************************************************/
+/* Decoding */
+
+static gboolean
+read_value (const guint8 *args,
+            gsize         len,
+            gsize        *pos,
+            gpointer      value,
+            gsize         value_len)
+{
+    if (len - *pos < value_len)
+        return FALSE;
+    memcpy (value, &args[*pos], value_len);
+    *pos += value_len;
+    return TRUE;
+}
+
+/* The conversions are formatted one by one, with a format built at runtime
+ * from the original one */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+
+#define APPEND_CONVERSION(out, conversion, spec, stars, value) do {                              \
+        if ((spec)->n_stars == 0)                                                                \
+            g_string_append_printf (out, conversion, value);                                     \
+        else if ((spec)->n_stars == 1)                                                           \
+            g_string_append_printf (out, conversion, stars[0], value);                           \
+        else                                                                                     \
+            g_string_append_printf (out, conversion, stars[0], stars[1], value);                 \
+    } while (0)
+
+gboolean
+mm_log_binary_format_args (GString      *out,
+                           const gchar  *fmt,
+                           const guint8 *args,
+                           gsize         len)
+{
+    const gchar *p;
+    const gchar *next;
+    Spec         spec;
+    gsize        pos = 0;
+    GString     *conversion;
+    gboolean     success = FALSE;
+
+    conversion = g_string_sized_new (16);
+
+    for (p = fmt; (next = spec_next (p, &spec)) != NULL; p = next) {
+        gint  stars[2] = { 0, 0 };
+        guint i;
+
+        g_string_append_len (out, p, spec.start - p);
+
+        for (i = 0; i < spec.n_stars; i++) {
+            gint64 value;
+
+            if (!read_value (args, len, &pos, &value, sizeof (value)))
+                goto out;
+            stars[i] = (gint) value;
+        }
+
+        /* Same flags, width and precision, but integers always given as
+         * 64 bits and no length modifier otherwise */
+        g_string_truncate (conversion, 0);
+        g_string_append_len (conversion, spec.start, spec.modifiers_len + 1);
+        if (spec.type == SPEC_TYPE_SIGNED || spec.type == SPEC_TYPE_UNSIGNED)
+            g_string_append (conversion, "ll");
+        g_string_append_c (conversion, spec.start[spec.len - 1]);
+
+        switch (spec.type) {
+        case SPEC_TYPE_PERCENT:
+            g_string_append_c (out, '%');
+            break;
+        case SPEC_TYPE_SIGNED:
+        case SPEC_TYPE_CHAR: {
+            gint64 value;
+
+            if (!read_value (args, len, &pos, &value, sizeof (value)))
+                goto out;
+            if (spec.type == SPEC_TYPE_CHAR)
+                APPEND_CONVERSION (out, conversion->str, &spec, stars, (gint) value);
+            else
+                APPEND_CONVERSION (out, conversion->str, &spec, stars, (long long) value);
+            break;
+        }
+        case SPEC_TYPE_UNSIGNED: {
+            guint64 value;
+
+            if (!read_value (args, len, &pos, &value, sizeof (value)))
+                goto out;
+            APPEND_CONVERSION (out, conversion->str, &spec, stars, (unsigned long long) value);
+            break;
+        }
+        case SPEC_TYPE_DOUBLE: {
+            gdouble value;
+
+            if (!read_value (args, len, &pos, &value, sizeof (value)))
+                goto out;
+            APPEND_CONVERSION (out, conversion->str, &spec, stars, value);
+            break;
+        }
+        case SPEC_TYPE_STRING: {
+            guint32  value_len;
+            gchar   *value = NULL;
+
+            if (!read_value (args, len, &pos, &value_len, sizeof (value_len)))
+                goto out;
+            if (value_len != NULL_STRING_LEN) {
+                if (len - pos < value_len)
+                    goto out;
+                value = g_strndup ((const gchar *) &args[pos], value_len);
+                pos += value_len;
+            }
+            APPEND_CONVERSION (out, conversion->str, &spec, stars, value ? value : "(null)");
+            g_free (value);
+            break;
+        }
+        case SPEC_TYPE_POINTER: {
+            guint64 value;
+
+            if (!read_value (args, len, &pos, &value, sizeof (value)))
+                goto out;
+            APPEND_CONVERSION (out, conversion->str, &spec, stars, (gpointer) (guintptr) value);
+            break;
+        }
+        case SPEC_TYPE_INVALID:
+        default:
+            goto out;
+        }
+    }
+
+    g_string_append (out, p);
+    success = (pos == len);
+
+out:
+    g_string_free (conversion, TRUE);
+    return success;
+}
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,110 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_LOG_BINARY_H
+#define MM_LOG_BINARY_H
+
+#include <stdarg.h>
+#include <glib.h>
+
+#include "mm-log.h"
+
+/*
+ * Binary log format.
+ *
+ * Instead of formatting each message, the log stores the id of its printf
+ * format string and the raw values of its arguments; format strings, module
+ * names and object ids are each stored once, as string records, the first
+ * time they're used. The text is only built when the log is decoded.
+ *
+ * The log is a sequence of records, each one an MMLogBinaryRecord followed
+ * by its payload. All values are in the byte order of the host that wrote
+ * the log, given in the header record, which starts every log session and
+ * invalidates all string ids given before it.
+ */
+
+#define MM_LOG_BINARY_MAGIC      "MMBLOG01"
+#define MM_LOG_BINARY_BYTE_ORDER 0x01020304
+
+typedef enum {
+    /* MMLogBinaryHeader */
+    MM_LOG_BINARY_RECORD_HEADER  = 1,
+    /* guint32 id, followed by the string, without NUL */
+    MM_LOG_BINARY_RECORD_STRING  = 2,
+    /* MMLogBinaryMessage, followed by the encoded arguments of the format
+     * string, or by the plain text of the message if there's no format */
+    MM_LOG_BINARY_RECORD_MESSAGE = 3,
+} MMLogBinaryRecordType;
+
+typedef struct {
+    guint8  type;
+    guint8  level;
+    guint16 reserved;
+    guint32 len;
+} MMLogBinaryRecord;
+
+typedef struct {
+    gchar   magic[8];
+    guint32 byte_order;
+    guint32 reserved;
+    /* Wall clock time matching the monotonic time, to decode timestamps */
+    gint64  wall_time;
+    gint64  monotonic_time;
+} MMLogBinaryHeader;
+
+typedef struct {
+    gint64  time;
+    /* String ids; 0 if none */
+    guint32 format_id;
+    guint32 object_id;
+    guint32 module_id;
+    guint32 reserved;
+} MMLogBinaryMessage;
+
+void     mm_log_binary_append_header  (GString     *out);
+void     mm_log_binary_append_string  (GString     *out,
+                                       guint32      id,
+                                       const gchar *str);
+
+/* Appends just the encoded arguments of @fmt, as in a message record.
+ * Returns FALSE, without appending anything, if @fmt has conversions whose
+ * arguments can't be encoded; @args is consumed in any case. */
+gboolean mm_log_binary_append_args    (GString     *out,
+                                       const gchar *fmt,
+                                       va_list      args);
+
+/* Returns FALSE, without appending anything, if @fmt has conversions whose
+ * arguments can't be encoded (e.g. "%n" or "%ls"); @args is consumed in any
+ * case. */
+gboolean mm_log_binary_append_message (GString     *out,
+                                       MMLogLevel   level,
+                                       guint32      format_id,
+                                       guint32      object_id,
+                                       guint32      module_id,
+                                       const gchar *fmt,
+                                       va_list      args);
+void     mm_log_binary_append_text    (GString     *out,
+                                       MMLogLevel   level,
+                                       guint32      object_id,
+                                       guint32      module_id,
+                                       const gchar *text,
+                                       gsize        len);
+
+/* Formats the encoded @args of a message record with its format string.
+ * Returns FALSE if they don't match the format. */
+gboolean mm_log_binary_format_args    (GString      *out,
+                                       const gchar  *fmt,
+                                       const guint8 *args,
+                                       gsize         len);
+
+#endif /* MM_LOG_BINARY_H */
@@ -43,4 +43,19 @@ _mm_log (gpointer     obj,
     g_free (msg);
 }
 
+gboolean
+mm_log_check_level_enabled (MMLogLevel level)
+{
+    return g_test_verbose ();
+}
+
+void
+mm_log_recorder_add_data (gpointer               obj,
+                          const gchar           *prefix,
+                          const gchar           *data,
+                          gsize                  len,
+                          MMLogRecorderFormatFn  format)
+{
+}
+
 #endif /* MM_LOG_TEST_H */
@@ -22,6 +22,7 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -42,6 +43,7 @@
 #endif
 
 #include "mm-log.h"
+#include "mm-log-binary.h"
 #include "mm-log-object.h"
 
 enum {
@@ -55,6 +57,7 @@ static guint32 log_level = MM_LOG_LEVEL_INFO | MM_LOG_LEVEL_WARN | MM_LOG_LEVEL_
 static GTimeVal rel_start = { 0, 0 };
 static int logfd = -1;
 static gboolean append_log_level_text = TRUE;
+static gboolean binary_format;
 
 static void (*log_backend) (const char *loc,
                             const char *func,
@@ -154,6 +157,874 @@ log_backend_file (const char *loc,
     fsync (logfd);  /* Make sure output is dumped to disk immediately  */
 }
 
+/*****************************************************************************/
+/* Buffered file backend
+ *
+ * Messages are copied into a ring buffer and written to the file, followed by
+ * a single fsync(), by a separate writer thread; so that the main loop never
+ * waits for the disk, not even with DEBUG logging. The writer thread wakes up
+ * once the flush interval elapses or as soon as the buffer is half full.
+ *
+ * Producers don't take any lock: each one reserves room for its message by
+ * atomically advancing the write position, copies the message in, and then
+ * flags the record as committed. The writer thread writes records in order up
+ * to the first one not yet committed, clears the space they used, and then
+ * advances the read position. The mutex and conditions are only used to wake
+ * up the writer thread and to wait for it in synchronous flushes, which are
+ * done for warnings and errors so that they're in the file before anything
+ * else happens.
+ *
+ * Records never wrap around the end of the buffer; if one doesn't fit before
+ * the end, the space left there is reserved along with it and flagged as
+ * padding.
+ *
+ * If a message doesn't fit in the buffer it is dropped, and the number of
+ * messages dropped is written to the file in place of them.
+ */
+
+typedef enum {
+    LOG_BUFFER_RECORD_FREE = 0,
+    LOG_BUFFER_RECORD_MESSAGE,
+    LOG_BUFFER_RECORD_PADDING,
+} LogBufferRecordState;
+
+typedef struct {
+    guint32 length;
+    gint    state;
+} LogBufferRecordHeader;
+
+/* Records, and so their headers, are kept aligned */
+#define LOG_BUFFER_RECORD_SIZE(length) \
+    (((gsize) sizeof (LogBufferRecordHeader) + (length) + 7) & ~(gsize) 7)
+
+typedef struct {
+    gchar    *data;
+    gsize     size;
+    guint     flush_interval;
+    /* Total amount of data ever reserved and read; positions in the buffer
+     * are these values modulo the size */
+    gsize     head;
+    gsize     tail;
+    /* Messages dropped since last reported, and in total */
+    gint      dropped;
+    guint     dropped_total;
+    /* Writer thread wake up and synchronous flushes */
+    GThread  *thread;
+    GMutex    mutex;
+    GCond     wakeup_cond;
+    GCond     synced_cond;
+    gboolean  stop;
+    gsize     sync_requested;
+    gsize     synced;
+} LogBuffer;
+
+static LogBuffer *logbuf;
+/* Producers currently using the buffer, which must not be freed until there
+ * are none left */
+static gint logbuf_producers;
+
+static void
+log_write_all (int          fd,
+               const gchar *data,
+               gsize        len)
+{
+    while (len > 0) {
+        ssize_t n;
+
+        n = write (fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+static void
+log_writev_all (int           fd,
+                struct iovec *iov,
+                guint         n_iov)
+{
+    while (n_iov > 0) {
+        ssize_t n;
+
+        n = writev (fd, iov, n_iov);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        /* Skip what was written, which may end in the middle of a vector */
+        while (n_iov > 0 && (gsize) n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            n_iov--;
+        }
+        if (n_iov > 0) {
+            iov->iov_base = (gchar *) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+static void
+log_buffer_report_dropped (LogBuffer *buffer)
+{
+    gint dropped;
+    gchar *str;
+
+    do {
+        dropped = g_atomic_int_get (&buffer->dropped);
+    } while (dropped && !g_atomic_int_compare_and_exchange (&buffer->dropped, dropped, 0));
+
+    if (!dropped)
+        return;
+
+    buffer->dropped_total += dropped;
+    if (binary_format) {
+        GString *record;
+
+        str = g_strdup_printf ("log buffer full: %d messages dropped (%u in total)",
+                               dropped, buffer->dropped_total);
+        record = g_string_new (NULL);
+        mm_log_binary_append_text (record, MM_LOG_LEVEL_WARN, 0, 0, str, strlen (str));
+        log_write_all (logfd, record->str, record->len);
+        g_string_free (record, TRUE);
+    } else {
+        str = g_strdup_printf ("%slog buffer full: %d messages dropped (%u in total)\n",
+                               append_log_level_text ? "<warn>  " : "",
+                               dropped, buffer->dropped_total);
+        log_write_all (logfd, str, strlen (str));
+    }
+    g_free (str);
+}
+
+/* Releases the space used by the records between the read position and the
+ * given one, so that producers can reuse it */
+static void
+log_buffer_release (LogBuffer *buffer,
+                    gsize      position)
+{
+    gsize offset;
+    gsize len;
+
+    /* Cleared, so that the headers of new records start as free wherever
+     * they end up being */
+    offset = buffer->tail % buffer->size;
+    len = MIN (position - buffer->tail, buffer->size - offset);
+    memset (&buffer->data[offset], 0, len);
+    if (len < position - buffer->tail)
+        memset (buffer->data, 0, position - buffer->tail - len);
+    g_atomic_pointer_set (&buffer->tail, position);
+}
+
+/* Writes all records committed in order, returning whether any was found */
+static gboolean
+log_buffer_drain (LogBuffer *buffer)
+{
+    struct iovec iov[64];
+    guint        n_iov = 0;
+    gsize        start;
+    gsize        head;
+    gsize        position;
+
+    head = (gsize) g_atomic_pointer_get (&buffer->head);
+    start = position = buffer->tail;
+    while (position != head) {
+        LogBufferRecordHeader *header;
+        gint                   state;
+
+        header = (LogBufferRecordHeader *) &buffer->data[position % buffer->size];
+        state = g_atomic_int_get (&header->state);
+        if (state == LOG_BUFFER_RECORD_FREE)
+            break;
+
+        if (state == LOG_BUFFER_RECORD_PADDING)
+            position += buffer->size - (position % buffer->size);
+        else {
+            iov[n_iov].iov_base = &header[1];
+            iov[n_iov].iov_len = header->length;
+            n_iov++;
+            position += LOG_BUFFER_RECORD_SIZE (header->length);
+        }
+
+        if (n_iov == G_N_ELEMENTS (iov)) {
+            log_writev_all (logfd, iov, n_iov);
+            n_iov = 0;
+            log_buffer_release (buffer, position);
+        }
+    }
+
+    if (n_iov > 0)
+        log_writev_all (logfd, iov, n_iov);
+    if (position != buffer->tail)
+        log_buffer_release (buffer, position);
+    return (position != start);
+}
+
+static gpointer
+log_buffer_writer_thread (LogBuffer *buffer)
+{
+    gboolean stop = FALSE;
+
+    while (!stop) {
+        gint64   end_time;
+        gsize    tail;
+        gboolean written;
+
+        end_time = g_get_monotonic_time () + buffer->flush_interval * G_TIME_SPAN_MILLISECOND;
+
+        g_mutex_lock (&buffer->mutex);
+        while (!buffer->stop &&
+               buffer->sync_requested <= buffer->synced &&
+               ((gsize) g_atomic_pointer_get (&buffer->head) - buffer->tail) < (buffer->size / 2)) {
+            if (!g_cond_wait_until (&buffer->wakeup_cond, &buffer->mutex, end_time))
+                break;
+        }
+        stop = buffer->stop;
+        g_mutex_unlock (&buffer->mutex);
+
+        written = log_buffer_drain (buffer);
+        log_buffer_report_dropped (buffer);
+        if (written)
+            fsync (logfd);
+        /* A producer is still copying its message in; let it finish before
+         * looking again if someone is waiting for it */
+        else if (buffer->tail != (gsize) g_atomic_pointer_get (&buffer->head))
+            g_thread_yield ();
+        tail = buffer->tail;
+
+        g_mutex_lock (&buffer->mutex);
+        buffer->synced = tail;
+        g_cond_broadcast (&buffer->synced_cond);
+        g_mutex_unlock (&buffer->mutex);
+    }
+
+    return NULL;
+}
+
+/* Waits until the writer thread has written and synced all data up to the
+ * given position */
+static void
+log_buffer_sync (LogBuffer *buffer,
+                 gsize      position)
+{
+    g_mutex_lock (&buffer->mutex);
+    if (buffer->sync_requested < position)
+        buffer->sync_requested = position;
+    g_cond_signal (&buffer->wakeup_cond);
+    while (buffer->synced < position)
+        g_cond_wait (&buffer->synced_cond, &buffer->mutex);
+    g_mutex_unlock (&buffer->mutex);
+}
+
+static void
+log_buffer_wakeup (LogBuffer *buffer)
+{
+    g_mutex_lock (&buffer->mutex);
+    g_cond_signal (&buffer->wakeup_cond);
+    g_mutex_unlock (&buffer->mutex);
+}
+
+static LogBuffer *
+log_buffer_new (guint flush_interval,
+                gsize size)
+{
+    LogBuffer *buffer;
+
+    buffer = g_slice_new0 (LogBuffer);
+    buffer->size = size;
+    buffer->data = g_malloc0 (size);
+    buffer->flush_interval = flush_interval;
+    g_mutex_init (&buffer->mutex);
+    g_cond_init (&buffer->wakeup_cond);
+    g_cond_init (&buffer->synced_cond);
+    buffer->thread = g_thread_new ("mm-log", (GThreadFunc) log_buffer_writer_thread, buffer);
+    return buffer;
+}
+
+static void
+log_buffer_free (LogBuffer *buffer)
+{
+    /* The writer thread flushes everything before exiting */
+    g_mutex_lock (&buffer->mutex);
+    buffer->stop = TRUE;
+    g_cond_signal (&buffer->wakeup_cond);
+    g_mutex_unlock (&buffer->mutex);
+    g_thread_join (buffer->thread);
+
+    g_cond_clear (&buffer->synced_cond);
+    g_cond_clear (&buffer->wakeup_cond);
+    g_mutex_clear (&buffer->mutex);
+    g_free (buffer->data);
+    g_slice_free (LogBuffer, buffer);
+}
+
+/* Reserves room for a record of the given size, returning the position where
+ * it starts and the new write position, or FALSE if the buffer is full */
+static gboolean
+log_buffer_reserve (LogBuffer *buffer,
+                    gsize      record_size,
+                    gsize     *out_position,
+                    gsize     *out_head)
+{
+    gsize head;
+    gsize reserved;
+
+    do {
+        gsize offset;
+
+        head = (gsize) g_atomic_pointer_get (&buffer->head);
+        offset = head % buffer->size;
+        reserved = record_size;
+        if (record_size > buffer->size - offset)
+            reserved += buffer->size - offset;
+        if (reserved > buffer->size - (head - (gsize) g_atomic_pointer_get (&buffer->tail))) {
+            *out_head = head;
+            return FALSE;
+        }
+    } while (!g_atomic_pointer_compare_and_exchange ((gpointer *) &buffer->head,
+                                                     GSIZE_TO_POINTER (head),
+                                                     GSIZE_TO_POINTER (head + reserved)));
+
+    /* Flag the space left at the end of the buffer as padding */
+    if (reserved > record_size) {
+        LogBufferRecordHeader *padding;
+
+        padding = (LogBufferRecordHeader *) &buffer->data[head % buffer->size];
+        g_atomic_int_set (&padding->state, LOG_BUFFER_RECORD_PADDING);
+        head += reserved - record_size;
+    }
+
+    *out_position = head;
+    *out_head = head + record_size;
+    return TRUE;
+}
+
+static void
+log_backend_file_buffered (const char *loc,
+                           const char *func,
+                           int syslog_level,
+                           const char *message,
+                           size_t length)
+{
+    LogBuffer             *buffer;
+    LogBufferRecordHeader *header;
+    gboolean               sync;
+    gsize                  record_size;
+    gsize                  position;
+    gsize                  head;
+
+    /* Warnings and errors are flushed right away */
+    sync = (syslog_level <= LOG_WARNING);
+
+    g_atomic_int_inc (&logbuf_producers);
+
+    /* Logging after shutdown */
+    buffer = g_atomic_pointer_get (&logbuf);
+    if (!buffer)
+        goto out;
+
+    /* Messages larger than half the buffer are written directly, once
+     * everything before them is in the file; this also ensures there is
+     * always room for the rest once the buffer is empty, wherever the write
+     * position is */
+    record_size = LOG_BUFFER_RECORD_SIZE (length);
+    if (record_size > buffer->size / 2) {
+        log_buffer_sync (buffer, (gsize) g_atomic_pointer_get (&buffer->head));
+        log_write_all (logfd, message, length);
+        if (sync)
+            fsync (logfd);
+        goto out;
+    }
+
+    while (!log_buffer_reserve (buffer, record_size, &position, &head)) {
+        /* Never drop warnings and errors, wait for the writer thread to make
+         * room instead */
+        if (!sync) {
+            g_atomic_int_inc (&buffer->dropped);
+            log_buffer_wakeup (buffer);
+            goto out;
+        }
+        log_buffer_sync (buffer, head);
+    }
+
+    header = (LogBufferRecordHeader *) &buffer->data[position % buffer->size];
+    header->length = length;
+    memcpy (&header[1], message, length);
+    g_atomic_int_set (&header->state, LOG_BUFFER_RECORD_MESSAGE);
+
+    if (sync)
+        log_buffer_sync (buffer, head);
+    else if (head - (gsize) g_atomic_pointer_get (&buffer->tail) >= buffer->size / 2)
+        log_buffer_wakeup (buffer);
+
+out:
+    g_atomic_int_add (&logbuf_producers, -1);
+}
+
+/*****************************************************************************/
+/* Flight recorder
+ *
+ * Records are kept back to back in a ring buffer, each one as a header
+ * followed by its payload, and the oldest ones are evicted to make room for
+ * new ones. Nothing is formatted until the recorder is dumped, unless the
+ * message is also being logged: messages at disabled log levels are stored
+ * as their format string and the encoded values of their arguments (as in
+ * the binary log format), and port traffic is stored as raw data, formatted
+ * with the callback given by the port.
+ */
+
+typedef struct {
+    gint64                time;
+    /* Set only for port traffic, whose payload is the object id and the
+     * prefix, both NUL-terminated, followed by the data */
+    MMLogRecorderFormatFn format;
+    /* Set only for messages not formatted yet, whose payload is the object
+     * id, NUL-terminated, followed by the encoded arguments. Both are static
+     * strings, valid as long as the process runs. */
+    const gchar          *message_format;
+    const gchar          *module;
+    guint32               len;
+    guint32               level;
+} LogRecord;
+
+typedef struct {
+    guint8 *data;
+    gsize   size;
+    /* Total amount of data ever written and evicted; positions in the buffer
+     * are these values modulo the size */
+    gsize   head;
+    gsize   tail;
+    gchar  *path;
+    /* Last automatic dump, see mm_log_recorder_dump_automatic() */
+    gchar  *auto_path;
+    gint64  auto_time;
+} LogRecorder;
+
+/* Minimum time between automatic dumps */
+#define LOG_RECORDER_AUTO_DUMP_INTERVAL_US (60 * G_USEC_PER_SEC)
+
+static LogRecorder *recorder;
+G_LOCK_DEFINE_STATIC (recorder);
+
+static void
+log_recorder_copy_in (LogRecorder   *rec,
+                      gsize          position,
+                      gconstpointer  data,
+                      gsize          length)
+{
+    gsize offset;
+    gsize len;
+
+    offset = position % rec->size;
+    len = MIN (length, rec->size - offset);
+    memcpy (&rec->data[offset], data, len);
+    if (len < length)
+        memcpy (rec->data, (const guint8 *) data + len, length - len);
+}
+
+static void
+log_recorder_copy_out (const guint8 *ring,
+                       gsize         size,
+                       gsize         position,
+                       gpointer      data,
+                       gsize         length)
+{
+    gsize offset;
+    gsize len;
+
+    offset = position % size;
+    len = MIN (length, size - offset);
+    memcpy (data, &ring[offset], len);
+    if (len < length)
+        memcpy ((guint8 *) data + len, ring, length - len);
+}
+
+/* Makes room for a new record, evicting the oldest ones if needed, and writes
+ * its header. Returns the position where the payload is to be written, or
+ * FALSE if the record doesn't fit at all. Must be called with the lock held. */
+static gboolean
+log_recorder_push (MMLogLevel             level,
+                   MMLogRecorderFormatFn  format,
+                   const gchar           *message_format,
+                   const gchar           *module,
+                   gsize                  len,
+                   gsize                 *payload_position)
+{
+    LogRecord record;
+    gsize     needed;
+
+    needed = sizeof (LogRecord) + len;
+    if (needed > recorder->size)
+        return FALSE;
+
+    while (recorder->size - (recorder->head - recorder->tail) < needed) {
+        LogRecord oldest;
+
+        log_recorder_copy_out (recorder->data, recorder->size, recorder->tail, &oldest, sizeof (LogRecord));
+        recorder->tail += sizeof (LogRecord) + oldest.len;
+    }
+
+    record.time = g_get_real_time ();
+    record.format = format;
+    record.message_format = message_format;
+    record.module = module;
+    record.len = len;
+    record.level = level;
+    log_recorder_copy_in (recorder, recorder->head, &record, sizeof (LogRecord));
+    *payload_position = recorder->head + sizeof (LogRecord);
+    recorder->head += needed;
+    return TRUE;
+}
+
+static void
+log_recorder_add_message (MMLogLevel   level,
+                          const gchar *message,
+                          gsize        length)
+{
+    gsize position;
+
+    G_LOCK (recorder);
+    if (recorder && log_recorder_push (level, NULL, NULL, NULL, length, &position))
+        log_recorder_copy_in (recorder, position, message, length);
+    G_UNLOCK (recorder);
+}
+
+/* Returns FALSE if the arguments can't be encoded, so the message must be
+ * formatted right away. Uses msgbuf, so only for _mm_log(). */
+static gboolean
+log_recorder_add_deferred (gpointer     obj,
+                           const gchar *module,
+                           MMLogLevel   level,
+                           const gchar *fmt,
+                           va_list      args)
+{
+    const gchar *id;
+    gsize        position;
+
+    id = obj ? mm_log_object_get_id (MM_LOG_OBJECT (obj)) : "";
+
+    g_string_truncate (msgbuf, 0);
+    g_string_append_len (msgbuf, id, strlen (id) + 1);
+    if (!mm_log_binary_append_args (msgbuf, fmt, args))
+        return FALSE;
+
+    G_LOCK (recorder);
+    if (recorder && log_recorder_push (level, NULL, fmt, module, msgbuf->len, &position))
+        log_recorder_copy_in (recorder, position, msgbuf->str, msgbuf->len);
+    G_UNLOCK (recorder);
+    return TRUE;
+}
+
+void
+mm_log_recorder_add_data (gpointer               obj,
+                          const gchar           *prefix,
+                          const gchar           *data,
+                          gsize                  len,
+                          MMLogRecorderFormatFn  format)
+{
+    const gchar *id;
+    gsize        id_len;
+    gsize        prefix_len;
+    gsize        position;
+
+    g_return_if_fail (format != NULL);
+
+    if (!recorder)
+        return;
+
+    /* Both strings are stored with their NUL bytes */
+    id = obj ? mm_log_object_get_id (MM_LOG_OBJECT (obj)) : "";
+    id_len = strlen (id) + 1;
+    prefix_len = strlen (prefix) + 1;
+
+    G_LOCK (recorder);
+    if (recorder && log_recorder_push (MM_LOG_LEVEL_DEBUG, format, NULL, NULL, id_len + prefix_len + len, &position)) {
+        log_recorder_copy_in (recorder, position, id, id_len);
+        log_recorder_copy_in (recorder, position + id_len, prefix, prefix_len);
+        log_recorder_copy_in (recorder, position + id_len + prefix_len, data, len);
+    }
+    G_UNLOCK (recorder);
+}
+
+gboolean
+mm_log_recorder_enabled (void)
+{
+    return !!recorder;
+}
+
+void
+mm_log_recorder_setup (gsize        size,
+                       const gchar *path)
+{
+    G_LOCK (recorder);
+    if (recorder) {
+        g_free (recorder->data);
+        g_free (recorder->path);
+        g_free (recorder->auto_path);
+        g_slice_free (LogRecorder, recorder);
+        recorder = NULL;
+    }
+    if (size > 0) {
+        recorder = g_slice_new0 (LogRecorder);
+        recorder->size = size;
+        recorder->data = g_malloc (size);
+        recorder->path = g_strdup (path);
+    }
+    G_UNLOCK (recorder);
+}
+
+static void
+log_recorder_format_record (GString         *str,
+                            const LogRecord *record,
+                            const gchar     *payload)
+{
+    g_string_append_printf (str, "%s [%09ld.%06ld] ",
+                            log_level_description (record->level),
+                            (glong) (record->time / G_USEC_PER_SEC),
+                            (glong) (record->time % G_USEC_PER_SEC));
+
+    if (record->format) {
+        const gchar *id;
+        const gchar *prefix;
+        const gchar *data;
+
+        id = payload;
+        prefix = id + strlen (id) + 1;
+        data = prefix + strlen (prefix) + 1;
+        if (id[0])
+            g_string_append_printf (str, "[%s] ", id);
+        record->format (str, prefix, data, record->len - (data - payload));
+    } else if (record->message_format) {
+        const gchar *id;
+        const gchar *args;
+
+        id = payload;
+        args = id + strlen (id) + 1;
+        if (id[0])
+            g_string_append_printf (str, "[%s] ", id);
+        if (record->module)
+            g_string_append_printf (str, "(%s) ", record->module);
+        mm_log_binary_format_args (str, record->message_format, (const guint8 *) args, record->len - (args - payload));
+    } else
+        g_string_append_len (str, payload, record->len);
+
+    g_string_append_c (str, '\n');
+}
+
+static gchar *
+log_recorder_dump (gboolean   automatic,
+                   GError   **error)
+{
+    guint8  *snapshot;
+    gsize    snapshot_len;
+    gsize    position;
+    gchar   *path = NULL;
+    gchar   *auto_path = NULL;
+    gint     fd = -1;
+    guint    n_records = 0;
+    GString *str;
+
+    /* Take a linear copy of the records so that the lock isn't held while
+     * formatting and writing */
+    G_LOCK (recorder);
+    if (!recorder) {
+        G_UNLOCK (recorder);
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_UNSUPPORTED,
+                     "Log recorder is disabled");
+        return NULL;
+    }
+    if (automatic) {
+        gint64 now;
+
+        now = g_get_monotonic_time ();
+        if (recorder->auto_time && now - recorder->auto_time < LOG_RECORDER_AUTO_DUMP_INTERVAL_US) {
+            G_UNLOCK (recorder);
+            g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_RETRY,
+                         "Log recorder already dumped in the last %u seconds",
+                         (guint) (LOG_RECORDER_AUTO_DUMP_INTERVAL_US / G_USEC_PER_SEC));
+            return NULL;
+        }
+        recorder->auto_time = now;
+        auto_path = g_strdup (recorder->auto_path);
+    }
+    snapshot_len = recorder->head - recorder->tail;
+    snapshot = g_malloc (MAX (snapshot_len, 1));
+    log_recorder_copy_out (recorder->data, recorder->size, recorder->tail, snapshot, snapshot_len);
+    path = g_strdup (recorder->path);
+    G_UNLOCK (recorder);
+
+    if (path) {
+        fd = open (path, O_CREAT | O_TRUNC | O_WRONLY, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+        if (fd < 0)
+            g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                         "Couldn't open log recorder file '%s': (%d) %s",
+                         path, errno, strerror (errno));
+    } else {
+        GError *inner_error = NULL;
+
+        /* Automatic dumps overwrite the temporary file of the previous one,
+         * if it's still there, instead of creating a new one each time */
+        if (auto_path) {
+            fd = open (auto_path, O_TRUNC | O_WRONLY | O_NOFOLLOW);
+            if (fd >= 0)
+                path = g_steal_pointer (&auto_path);
+        }
+
+        if (fd < 0) {
+            fd = g_file_open_tmp ("ModemManager-recorder-XXXXXX.log", &path, &inner_error);
+            if (fd < 0) {
+                g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                             "Couldn't create log recorder file: %s", inner_error->message);
+                g_error_free (inner_error);
+            } else if (automatic) {
+                G_LOCK (recorder);
+                if (recorder) {
+                    g_free (recorder->auto_path);
+                    recorder->auto_path = g_strdup (path);
+                }
+                G_UNLOCK (recorder);
+            }
+        }
+    }
+    g_free (auto_path);
+
+    if (fd < 0) {
+        g_free (snapshot);
+        g_free (path);
+        return NULL;
+    }
+
+    str = g_string_sized_new (4096);
+    for (position = 0; position < snapshot_len; ) {
+        LogRecord record;
+
+        memcpy (&record, &snapshot[position], sizeof (LogRecord));
+        position += sizeof (LogRecord);
+        log_recorder_format_record (str, &record, (const gchar *) &snapshot[position]);
+        position += record.len;
+        n_records++;
+
+        if (str->len >= 4096) {
+            log_write_all (fd, str->str, str->len);
+            g_string_truncate (str, 0);
+        }
+    }
+    g_string_append_printf (str, "log recorder: %u records dumped\n", n_records);
+    log_write_all (fd, str->str, str->len);
+    g_string_free (str, TRUE);
+
+    fsync (fd);
+    close (fd);
+    g_free (snapshot);
+    return path;
+}
+
+gchar *
+mm_log_recorder_dump (GError **error)
+{
+    return log_recorder_dump (FALSE, error);
+}
+
+gchar *
+mm_log_recorder_dump_automatic (GError **error)
+{
+    return log_recorder_dump (TRUE, error);
+}
+
+/*****************************************************************************/
+/* Binary log format
+ *
+ * Messages are written as the id of their format string plus the raw values
+ * of their arguments, see mm-log-binary.h. Format strings and module names
+ * are static strings, so they're looked up by address; object ids are looked
+ * up by contents. Each string is written to the log right before the first
+ * message using it.
+ */
+
+static GHashTable *binary_static_ids;
+static GHashTable *binary_string_ids;
+static guint32     binary_next_id;
+
+static guint32
+log_binary_intern (GString     *out,
+                   const gchar *str,
+                   gboolean     static_str)
+{
+    GHashTable *table;
+    guint32     id;
+
+    table = static_str ? binary_static_ids : binary_string_ids;
+    id = GPOINTER_TO_UINT (g_hash_table_lookup (table, str));
+    if (!id) {
+        id = ++binary_next_id;
+        g_hash_table_insert (table, static_str ? (gpointer) str : g_strdup (str), GUINT_TO_POINTER (id));
+        mm_log_binary_append_string (out, id, str);
+    }
+    return id;
+}
+
+static void
+log_binary_message (gpointer     obj,
+                    const gchar *module,
+                    MMLogLevel   level,
+                    const gchar *fmt,
+                    va_list      args)
+{
+    guint32 object_id = 0;
+    guint32 module_id = 0;
+    guint32 format_id;
+    va_list args_copy;
+
+    g_string_truncate (msgbuf, 0);
+
+    if (obj)
+        object_id = log_binary_intern (msgbuf, mm_log_object_get_id (MM_LOG_OBJECT (obj)), FALSE);
+    if (module)
+        module_id = log_binary_intern (msgbuf, module, TRUE);
+    format_id = log_binary_intern (msgbuf, fmt, TRUE);
+
+    /* Formats with conversions that can't be encoded are written as text */
+    va_copy (args_copy, args);
+    if (!mm_log_binary_append_message (msgbuf, level, format_id, object_id, module_id, fmt, args_copy)) {
+        gchar *text;
+
+        text = g_strdup_vprintf (fmt, args);
+        mm_log_binary_append_text (msgbuf, level, object_id, module_id, text, strlen (text));
+        g_free (text);
+    }
+    va_end (args_copy);
+
+    log_backend (NULL, NULL, mm_to_syslog_priority (level), msgbuf->str, msgbuf->len);
+}
+
+static void
+log_binary_setup (void)
+{
+    GString *header;
+
+    binary_static_ids = g_hash_table_new (g_direct_hash, g_direct_equal);
+    binary_string_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    binary_next_id = 0;
+
+    header = g_string_new (NULL);
+    mm_log_binary_append_header (header);
+    log_write_all (logfd, header->str, header->len);
+    g_string_free (header, TRUE);
+}
+
+static void
+log_binary_shutdown (void)
+{
+    g_clear_pointer (&binary_static_ids, g_hash_table_unref);
+    g_clear_pointer (&binary_string_ids, g_hash_table_unref);
+}
+
+/*****************************************************************************/
+
 static void
 log_backend_syslog (const char *loc,
                     const char *func,
@@ -212,37 +1083,67 @@ _mm_log (gpointer     obj,
 {
     va_list args;
     GTimeVal tv;
+    gboolean enabled;
+    gsize body_start;
 
-    if (!(log_level & level))
+    /* Messages at disabled levels are still given to the recorder */
+    enabled = !!(log_level & level);
+    if (!enabled && !recorder)
         return;
 
     if (g_once_init_enter (&msgbuf_once)) {
         msgbuf = g_string_sized_new (512);
         g_once_init_leave (&msgbuf_once, 1);
-    } else
-        g_string_truncate (msgbuf, 0);
-
-    if (append_log_level_text)
-        g_string_append_printf (msgbuf, "%s ", log_level_description (level));
-
-    if (ts_flags == TS_FLAG_WALL) {
-        g_get_current_time (&tv);
-        g_string_append_printf (msgbuf, "[%09ld.%06ld] ", tv.tv_sec, tv.tv_usec);
-    } else if (ts_flags == TS_FLAG_REL) {
-        glong secs;
-        glong usecs;
-
-        g_get_current_time (&tv);
-        secs = tv.tv_sec - rel_start.tv_sec;
-        usecs = tv.tv_usec - rel_start.tv_usec;
-        if (usecs < 0) {
-            secs--;
-            usecs += 1000000;
-        }
+    }
 
-        g_string_append_printf (msgbuf, "[%06ld.%06ld] ", secs, usecs);
+    if (enabled && binary_format) {
+        va_start (args, fmt);
+        log_binary_message (obj, module, level, fmt, args);
+        va_end (args);
+        if (!recorder)
+            return;
+        enabled = FALSE;
     }
 
+    /* Only the recorder needs it, so don't format it yet */
+    if (!enabled) {
+        gboolean deferred;
+
+        va_start (args, fmt);
+        deferred = log_recorder_add_deferred (obj, module, level, fmt, args);
+        va_end (args);
+        if (deferred)
+            return;
+    }
+
+    g_string_truncate (msgbuf, 0);
+
+    if (enabled) {
+        if (append_log_level_text)
+            g_string_append_printf (msgbuf, "%s ", log_level_description (level));
+
+        if (ts_flags == TS_FLAG_WALL) {
+            g_get_current_time (&tv);
+            g_string_append_printf (msgbuf, "[%09ld.%06ld] ", tv.tv_sec, tv.tv_usec);
+        } else if (ts_flags == TS_FLAG_REL) {
+            glong secs;
+            glong usecs;
+
+            g_get_current_time (&tv);
+            secs = tv.tv_sec - rel_start.tv_sec;
+            usecs = tv.tv_usec - rel_start.tv_usec;
+            if (usecs < 0) {
+                secs--;
+                usecs += 1000000;
+            }
+
+            g_string_append_printf (msgbuf, "[%06ld.%06ld] ", secs, usecs);
+        }
+    }
+
+    /* The recorder keeps its own level and timestamp */
+    body_start = msgbuf->len;
+
 #if defined MM_LOG_FUNC_LOC
     g_string_append_printf (msgbuf, "[%s] %s(): ", loc, func);
 #endif
@@ -256,20 +1157,58 @@ _mm_log (gpointer     obj,
     g_string_append_vprintf (msgbuf, fmt, args);
     va_end (args);
 
+    if (recorder)
+        log_recorder_add_message (level, &msgbuf->str[body_start], msgbuf->len - body_start);
+
+    if (!enabled)
+        return;
+
     g_string_append_c (msgbuf, '\n');
 
     log_backend (loc, func, mm_to_syslog_priority (level), msgbuf->str, msgbuf->len);
 }
 
+static MMLogLevel
+glib_to_mm_log_level (GLogLevelFlags level)
+{
+    if (level & (G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL))
+        return MM_LOG_LEVEL_ERR;
+    if (level & G_LOG_LEVEL_WARNING)
+        return MM_LOG_LEVEL_WARN;
+    if (level & (G_LOG_LEVEL_MESSAGE | G_LOG_LEVEL_INFO))
+        return MM_LOG_LEVEL_INFO;
+    return MM_LOG_LEVEL_DEBUG;
+}
+
 static void
 log_handler (const gchar *log_domain,
              GLogLevelFlags level,
              const gchar *message,
              gpointer ignored)
 {
+    if (recorder)
+        log_recorder_add_message (glib_to_mm_log_level (level), message, strlen (message));
+
+    if (binary_format) {
+        GString *record;
+
+        /* May be called from any thread, so don't use msgbuf */
+        record = g_string_new (NULL);
+        mm_log_binary_append_text (record, glib_to_mm_log_level (level), 0, 0, message, strlen (message));
+        log_backend (NULL, NULL, glib_to_syslog_priority (level), record->str, record->len);
+        g_string_free (record, TRUE);
+        return;
+    }
+
     log_backend (NULL, NULL, glib_to_syslog_priority (level), message, strlen (message));
 }
 
+gboolean
+mm_log_check_level_enabled (MMLogLevel level)
+{
+    return !!(log_level & level);
+}
+
 gboolean
 mm_log_set_level (const char *level, GError **error)
 {
@@ -305,6 +1244,9 @@ mm_log_setup (const char *level,
               gboolean log_journal,
               gboolean show_timestamps,
               gboolean rel_timestamps,
+              gboolean binary,
+              guint flush_interval,
+              guint buffer_size,
               GError **error)
 {
     /* levels */
@@ -319,6 +1261,12 @@ mm_log_setup (const char *level,
     /* Grab start time for relative timestamps */
     g_get_current_time (&rel_start);
 
+    if (binary && (log_file == NULL || log_journal)) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
+                     "Binary log format requires a log file");
+        return FALSE;
+    }
+
 #if defined WITH_SYSTEMD_JOURNAL
     if (log_journal) {
         log_backend = log_backend_systemd_journal;
@@ -338,7 +1286,14 @@ mm_log_setup (const char *level,
                          errno, strerror (errno));
             return FALSE;
         }
-        log_backend = log_backend_file;
+        binary_format = binary;
+        if (binary_format)
+            log_binary_setup ();
+        if (flush_interval > 0 && buffer_size > 0) {
+            logbuf = log_buffer_new (flush_interval, (gsize) buffer_size * 1024);
+            log_backend = log_backend_file_buffered;
+        } else
+            log_backend = log_backend_file;
     }
 
     g_log_set_handler (G_LOG_DOMAIN,
@@ -366,6 +1321,23 @@ mm_log_setup (const char *level,
 void
 mm_log_shutdown (void)
 {
+    if (logbuf) {
+        LogBuffer *buffer;
+
+        buffer = logbuf;
+        g_atomic_pointer_set (&logbuf, NULL);
+        /* Wait for the producers that may have got the buffer just before */
+        while (g_atomic_int_get (&logbuf_producers) > 0)
+            g_thread_yield ();
+
+        log_buffer_free (buffer);
+    }
+
+    if (binary_format) {
+        log_binary_shutdown ();
+        binary_format = FALSE;
+    }
+
     if (logfd < 0)
         closelog ();
     else {
@@ -55,13 +55,44 @@ void _mm_log (gpointer     obj,
 
 gboolean mm_log_set_level (const char *level, GError **error);
 
+/* Allows skipping expensive message formatting when the level is disabled */
+gboolean mm_log_check_level_enabled (MMLogLevel level);
+
 gboolean mm_log_setup (const char *level,
                        const char *log_file,
                        gboolean log_journal,
                        gboolean show_ts,
                        gboolean rel_ts,
+                       gboolean binary,
+                       guint flush_interval,
+                       guint buffer_size,
                        GError **error);
 
 void mm_log_shutdown (void);
 
+/* Flight recorder: keeps the most recent messages, at any log level, and raw
+ * port traffic in memory, so that they can be dumped to a file on demand even
+ * when running with a lower log level. */
+
+/* Formats data given to mm_log_recorder_add_data(), only when dumped */
+typedef void (* MMLogRecorderFormatFn) (GString     *str,
+                                        const gchar *prefix,
+                                        const gchar *data,
+                                        gsize        len);
+
+void      mm_log_recorder_setup    (gsize                  size,
+                                    const gchar           *path);
+gboolean  mm_log_recorder_enabled  (void);
+void      mm_log_recorder_add_data (gpointer               obj,
+                                    const gchar           *prefix,
+                                    const gchar           *data,
+                                    gsize                  len,
+                                    MMLogRecorderFormatFn  format);
+/* Returns the path of the file written */
+gchar    *mm_log_recorder_dump     (GError               **error);
+/* Same as mm_log_recorder_dump(), for dumps not requested by the user: they
+ * fail with MM_CORE_ERROR_RETRY if there was another one in the last minute,
+ * and without a recorder file they all overwrite the same temporary file */
+gchar    *mm_log_recorder_dump_automatic (GError          **error);
+
 #endif  /* MM_LOG_H */
@@ -130,6 +130,289 @@ mm_split_string_groups (const gchar *str)
     return NULL;
 }
 
+/*****************************************************************************/
+/* Compound AT command lines */
+
+/* Skip the optional "AT" prefix of a command */
+static const gchar *
+at_command_skip_prefix (const gchar *command)
+{
+    if (!g_ascii_strncasecmp (command, "AT", 2))
+        return command + 2;
+    return command;
+}
+
+gboolean
+mm_at_command_is_batchable (const gchar *command)
+{
+    const gchar *p;
+
+    if (!command)
+        return FALSE;
+
+    /* Only extended syntax commands can be concatenated with ';' and still
+     * be told apart in the response, i.e. no basic commands like 'I', 'Z' or
+     * 'D', and nothing that already is a compound line or that carries its
+     * own line terminator. */
+    p = at_command_skip_prefix (command);
+    if (!*p || !strchr ("+^$%*#!", *p) || !g_ascii_isalpha (p[1]))
+        return FALSE;
+
+    return !strpbrk (p, ";\r\n\"");
+}
+
+gchar *
+mm_at_command_get_prefix (const gchar *command)
+{
+    const gchar *p;
+
+    g_return_val_if_fail (command != NULL, NULL);
+
+    /* Keep the command names, and whether they're queries, tests or set
+     * commands, but none of the arguments as they may be private, e.g. PINs,
+     * passwords or numbers to dial. */
+    p = at_command_skip_prefix (command);
+    while (*p) {
+        if (strchr ("+^$%*#!", *p)) {
+            /* Extended syntax, named up to the first '=', '?' or ';' */
+            p += strcspn (p, "=?;\r\n");
+        } else {
+            /* Basic syntax, just the command letter; its parameter isn't
+             * delimited so nothing else after it is kept */
+            if (*p == '&')
+                p++;
+            if (g_ascii_isalpha (*p))
+                p++;
+            break;
+        }
+
+        if (*p == '?')
+            p++;
+        else if (*p == '=') {
+            p++;
+            if (*p != '?')
+                break;
+            p++;
+        }
+
+        /* Only go on with the next command if there were no arguments */
+        if (*p != ';' || !p[1] || !strchr ("+^$%*#!", p[1]))
+            break;
+        p++;
+    }
+
+    return g_strndup (command, p - command);
+}
+
+gchar *
+mm_build_compound_at_command (const gchar **commands)
+{
+    GString *str;
+    guint    i;
+
+    g_return_val_if_fail (commands && commands[0], NULL);
+
+    for (i = 0; commands[i]; i++)
+        g_return_val_if_fail (mm_at_command_is_batchable (commands[i]), NULL);
+
+    str = g_string_new (NULL);
+    for (i = 0; commands[i]; i++) {
+        if (i > 0)
+            g_string_append_c (str, ';');
+        g_string_append (str, at_command_skip_prefix (commands[i]));
+    }
+    return g_string_free (str, FALSE);
+}
+
+/* Returns the response tag of a batchable command, e.g. "+CSQ:" for "AT+CSQ"
+ * or "+COPS:" for "+COPS?" */
+static gchar *
+at_command_get_tag (const gchar *command)
+{
+    const gchar *p;
+    gsize        len;
+
+    p = at_command_skip_prefix (command);
+    for (len = 1; p[len] && g_ascii_isalnum (p[len]); len++);
+    return g_strdup_printf ("%.*s:", (gint) len, p);
+}
+
+/* Index of the command whose tag the line starts with, or -1 if none */
+static gint
+line_find_tag (const gchar *line,
+               gchar      **tags,
+               guint        n_tags)
+{
+    guint i;
+
+    for (i = 0; i < n_tags; i++) {
+        if (!g_ascii_strncasecmp (line, tags[i], strlen (tags[i])))
+            return (gint) i;
+    }
+    return -1;
+}
+
+/* Commands whose reply is not tagged, e.g. "QUALCOMM INCORPORATED" for +CGMI.
+ * The revision queries are not known to reply with a single line, as some
+ * modems split their reply in several lines. */
+typedef struct {
+    const gchar *command;
+    gboolean     single_line;
+} UntaggedReply;
+
+static const UntaggedReply untagged_replies[] = {
+    { "+CGMI", TRUE  },
+    { "+CGMM", TRUE  },
+    { "+CGMR", FALSE },
+    { "+CGSN", TRUE  },
+    { "+CIMI", TRUE  },
+    { "+GMI",  TRUE  },
+    { "+GMM",  TRUE  },
+    { "+GMR",  FALSE },
+    { "+GSN",  TRUE  },
+};
+
+static const UntaggedReply *
+at_command_find_untagged_reply (const gchar *command)
+{
+    const gchar *p;
+    guint        i;
+
+    p = at_command_skip_prefix (command);
+    for (i = 0; i < G_N_ELEMENTS (untagged_replies); i++) {
+        if (!g_ascii_strcasecmp (p, untagged_replies[i].command))
+            return &untagged_replies[i];
+    }
+    return NULL;
+}
+
+gchar **
+mm_split_compound_at_response (const gchar  *response,
+                               const gchar **commands,
+                               GError      **error)
+{
+    g_auto(GStrv)        split = NULL;
+    g_autoptr(GPtrArray) lines = NULL;
+    g_autofree gint     *line_tags = NULL;
+    g_autofree gboolean *has_tagged_lines = NULL;
+    g_autofree guint    *untagged_commands = NULL;
+    GString            **slices;
+    gchar              **tags;
+    gchar              **out = NULL;
+    guint                n_commands;
+    guint                n_untagged_commands = 0;
+    guint                n_untagged_lines = 0;
+    guint                next_untagged = 0;
+    gboolean             any_single_line = FALSE;
+    gboolean             all_single_line = TRUE;
+    gboolean             valid;
+    guint                i;
+    gint                 current = -1;
+
+    g_return_val_if_fail (commands && commands[0], NULL);
+
+    n_commands = g_strv_length ((gchar **) commands);
+
+    /* Collect the non-empty lines of the response */
+    lines = g_ptr_array_new ();
+    split = g_strsplit_set (response ? response : "", "\r\n", -1);
+    for (i = 0; split[i]; i++) {
+        g_strstrip (split[i]);
+        if (split[i][0])
+            g_ptr_array_add (lines, split[i]);
+    }
+
+    tags = g_new0 (gchar *, n_commands + 1);
+    slices = g_new0 (GString *, n_commands);
+    for (i = 0; i < n_commands; i++) {
+        tags[i] = at_command_get_tag (commands[i]);
+        slices[i] = g_string_new (NULL);
+    }
+
+    /* Tagged lines go to the command they're tagged with */
+    line_tags = g_new (gint, MAX (lines->len, 1));
+    has_tagged_lines = g_new0 (gboolean, n_commands);
+    for (i = 0; i < lines->len; i++) {
+        line_tags[i] = line_find_tag (g_ptr_array_index (lines, i), tags, n_commands);
+        if (line_tags[i] >= 0)
+            has_tagged_lines[line_tags[i]] = TRUE;
+        else
+            n_untagged_lines++;
+    }
+
+    /* Untagged lines may only go to the commands known to reply without tag
+     * and which got no tagged line. As a command may reply with no line at
+     * all, or with several, they're only assigned if there is a single such
+     * command, or if all of them are known to reply with a single line and
+     * there is one line for each; otherwise a line could end up in the
+     * response of the wrong command. */
+    untagged_commands = g_new (guint, n_commands);
+    for (i = 0; i < n_commands; i++) {
+        const UntaggedReply *untagged;
+
+        untagged = at_command_find_untagged_reply (commands[i]);
+        if (!untagged || has_tagged_lines[i])
+            continue;
+        untagged_commands[n_untagged_commands++] = i;
+        any_single_line = any_single_line || untagged->single_line;
+        all_single_line = all_single_line && untagged->single_line;
+    }
+
+    if (!n_untagged_lines)
+        valid = !any_single_line;
+    else if (all_single_line)
+        valid = (n_untagged_lines == n_untagged_commands);
+    else
+        valid = (n_untagged_commands == 1);
+    if (!valid) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                     "Couldn't assign %u untagged lines to %u commands in the compound response",
+                     n_untagged_lines, n_untagged_commands);
+        goto out;
+    }
+
+    /* The lines of each command must follow the order of the commands;
+     * commands without any line get an empty response (e.g. when a command
+     * just replies OK) */
+    for (i = 0; i < lines->len; i++) {
+        const gchar *line;
+        gint         tag;
+
+        line = g_ptr_array_index (lines, i);
+        tag = line_tags[i];
+        if (tag < 0) {
+            tag = (gint) untagged_commands[next_untagged];
+            if (n_untagged_commands > 1)
+                next_untagged++;
+        }
+        if (tag < current) {
+            g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                         "Couldn't assign line '%s' to any command in the compound response", line);
+            goto out;
+        }
+        /* Multiple lines for the same command are kept together */
+        if (tag == current)
+            g_string_append (slices[tag], "\r\n");
+        g_string_append (slices[tag], line);
+        current = tag;
+    }
+
+    out = g_new0 (gchar *, n_commands + 1);
+    for (i = 0; i < n_commands; i++) {
+        out[i] = g_string_free (slices[i], FALSE);
+        slices[i] = NULL;
+    }
+
+out:
+    for (i = 0; i < n_commands; i++) {
+        if (slices[i])
+            g_string_free (slices[i], TRUE);
+    }
+    g_free (slices);
+    g_strfreev (tags);
+    return out;
+}
+
 /*****************************************************************************/
 
 static int uint_compare_func (gconstpointer a, gconstpointer b)
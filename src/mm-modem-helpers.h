@@ -50,6 +50,21 @@ const gchar *mm_strip_tag    (const gchar *str,
 
 gchar **mm_split_string_groups (const gchar *str);
 
+/* Compound AT command lines, e.g. "AT+CGMI;+CGMM;+CGSN". Only extended syntax
+ * commands may be batched. The response splitter returns one response per
+ * command (possibly empty), or NULL if the response cannot be split
+ * unambiguously, e.g. when several commands replying without tag may have
+ * replied with no line or with more than one. */
+gboolean   mm_at_command_is_batchable    (const gchar  *command);
+gchar     *mm_build_compound_at_command  (const gchar **commands);
+gchar    **mm_split_compound_at_response (const gchar  *response,
+                                          const gchar **commands,
+                                          GError      **error);
+
+/* The command line up to the first argument, e.g. "AT+CPIN=" for
+ * "AT+CPIN=\"1234\"", so that it can be kept in traces */
+gchar *mm_at_command_get_prefix (const gchar *command);
+
 GArray *mm_parse_uint_list (const gchar  *str,
                             GError      **error);
 
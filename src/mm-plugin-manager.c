@@ -27,7 +27,11 @@
 
 #include "mm-plugin-manager.h"
 #include "mm-plugin.h"
+#include "mm-port-probe.h"
+#include "mm-probe-cache.h"
+#include "mm-plugin-manifest.h"
 #include "mm-shared.h"
+#include "mm-context.h"
 #include "mm-log-object.h"
 
 #define SHARED_PREFIX "libmm-shared"
@@ -47,50 +51,259 @@ enum {
     LAST_PROP
 };
 
+/* Details of a plugin, which may not be loaded yet */
+typedef struct {
+    MMPluginManifestEntry *entry;
+    MMPlugin              *plugin;
+    gboolean               load_failed;
+} PluginInfo;
+
+static void
+plugin_info_free (PluginInfo *info)
+{
+    g_clear_object (&info->plugin);
+    mm_plugin_manifest_entry_free (info->entry);
+    g_slice_free (PluginInfo, info);
+}
+
 struct _MMPluginManagerPrivate {
     /* Path to look for plugins */
     gchar *plugin_dir;
     /* Device filter */
     MMFilter *filter;
 
-    /* This list contains all plugins except for the generic one, order is not
-     * important. It is loaded once when the program starts, and the list is NOT
-     * expected to change after that.*/
-    GList *plugins;
-    /* Last, the generic plugin. */
+    /* This array contains all plugins except for the generic one, order is not
+     * important. It is built once when the program starts, and the array is NOT
+     * expected to change after that. If a valid plugin manifest is available,
+     * each plugin is only loaded when first needed. */
+    GPtrArray *plugins; /* PluginInfo */
+    /* Last, the generic plugin, always loaded. */
     MMPlugin *generic;
 
+    /* Shared utils, loaded right before the first plugin that isn't the
+     * generic one */
+    GPtrArray *shared_paths;
+    gboolean   shared_loaded;
+
+    /* Index of plugins by mandatory pre-probing filters. Plugins are referred
+     * to by their position in the array of plugins. */
+    GArray     *index_unfiltered; /* guint */
+    GHashTable *index_vendor_ids; /* vid -> GArray of guint */
+    GHashTable *index_udev_tags;  /* tag -> GArray of guint */
+    GHashTable *index_drivers;    /* driver -> GArray of guint */
+
     /* List of ongoing device support checks */
     GList *device_contexts;
+
+    /* Probing results of known devices, if enabled */
+    MMProbeCache *probe_cache;
 };
 
+static MMPlugin *plugin_manager_ensure_plugin_loaded (MMPluginManager *self,
+                                                      PluginInfo      *info);
+
+/*****************************************************************************/
+/* Plugin index
+ *
+ * Most plugins can only ever support ports of devices with a given set of
+ * vendor IDs, or ports with some given udev tags, or ports handled by some
+ * given drivers. Each plugin is indexed by one of those mandatory filters
+ * (the most selective one), so that the pre-probing filters of every single
+ * plugin don't need to be run for every single port.
+ */
+
+static void
+index_add (GHashTable *index,
+           gpointer    key,
+           guint       position)
+{
+    GArray *positions;
+
+    positions = g_hash_table_lookup (index, key);
+    if (!positions) {
+        positions = g_array_new (FALSE, FALSE, sizeof (guint));
+        g_hash_table_insert (index, key, positions);
+    }
+    /* Positions are added in order, so it's enough to check the last one */
+    if (!positions->len || g_array_index (positions, guint, positions->len - 1) != position)
+        g_array_append_val (positions, position);
+}
+
+static void
+plugin_manager_build_index (MMPluginManager *self)
+{
+    guint position;
+
+    self->priv->index_unfiltered = g_array_new (FALSE, FALSE, sizeof (guint));
+    self->priv->index_vendor_ids = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_array_unref);
+    self->priv->index_udev_tags  = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) g_array_unref);
+    self->priv->index_drivers    = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) g_array_unref);
+
+    /* The filters are taken from the manifest entries, so that plugins don't
+     * need to be loaded to be indexed */
+    for (position = 0; position < self->priv->plugins->len; position++) {
+        MMPluginManifestEntry *entry;
+        guint                  i;
+
+        entry = ((PluginInfo *) g_ptr_array_index (self->priv->plugins, position))->entry;
+        if (entry->mandatory_vendor_ids) {
+            for (i = 0; i < entry->mandatory_vendor_ids->len; i++)
+                index_add (self->priv->index_vendor_ids,
+                           GUINT_TO_POINTER (g_array_index (entry->mandatory_vendor_ids, guint16, i)),
+                           position);
+        } else if (entry->udev_tags) {
+            /* The strings are owned by the entries, which outlive the index */
+            for (i = 0; entry->udev_tags[i]; i++)
+                index_add (self->priv->index_udev_tags, entry->udev_tags[i], position);
+        } else if (entry->drivers) {
+            for (i = 0; entry->drivers[i]; i++)
+                index_add (self->priv->index_drivers, entry->drivers[i], position);
+        } else
+            g_array_append_val (self->priv->index_unfiltered, position);
+    }
+
+    mm_obj_dbg (self, "plugin index: %u unfiltered, %u vendor ids, %u udev tags, %u drivers",
+                self->priv->index_unfiltered->len,
+                g_hash_table_size (self->priv->index_vendor_ids),
+                g_hash_table_size (self->priv->index_udev_tags),
+                g_hash_table_size (self->priv->index_drivers));
+}
+
+static void
+plugin_manager_clear_index (MMPluginManager *self)
+{
+    g_clear_pointer (&self->priv->index_unfiltered, g_array_unref);
+    g_clear_pointer (&self->priv->index_vendor_ids, g_hash_table_unref);
+    g_clear_pointer (&self->priv->index_udev_tags,  g_hash_table_unref);
+    g_clear_pointer (&self->priv->index_drivers,    g_hash_table_unref);
+}
+
+static gint
+position_cmp (const guint *a,
+              const guint *b)
+{
+    return (*a > *b) - (*a < *b);
+}
+
+static void
+candidates_add (GArray *candidates,
+                GArray *positions)
+{
+    if (positions)
+        g_array_append_vals (candidates, positions->data, positions->len);
+}
+
+/* Returns the positions of the plugins that may support the port, in order */
+static GArray *
+plugin_manager_lookup_candidates (MMPluginManager *self,
+                                  MMDevice        *device,
+                                  MMKernelDevice  *port)
+{
+    GArray         *candidates;
+    GHashTableIter  iter;
+    gpointer        key;
+    gpointer        value;
+    const gchar   **drivers;
+    guint           i;
+    guint           n;
+
+    candidates = g_array_new (FALSE, FALSE, sizeof (guint));
+    candidates_add (candidates, self->priv->index_unfiltered);
+
+    candidates_add (candidates, g_hash_table_lookup (self->priv->index_vendor_ids,
+                                                     GUINT_TO_POINTER (mm_device_get_vendor (device))));
+
+    g_hash_table_iter_init (&iter, self->priv->index_udev_tags);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        if (mm_kernel_device_get_global_property_as_boolean (port, (const gchar *) key))
+            candidates_add (candidates, value);
+    }
+
+    /* Virtual ports are reported with the 'virtual' driver by the plugin
+     * filters; it's harmless to consider it always. */
+    candidates_add (candidates, g_hash_table_lookup (self->priv->index_drivers, "virtual"));
+    drivers = mm_device_get_drivers (device);
+    for (i = 0; drivers && drivers[i]; i++)
+        candidates_add (candidates, g_hash_table_lookup (self->priv->index_drivers, drivers[i]));
+
+    /* Sort and remove duplicates */
+    g_array_sort (candidates, (GCompareFunc) position_cmp);
+    for (i = 0, n = 0; i < candidates->len; i++) {
+        if (n && g_array_index (candidates, guint, n - 1) == g_array_index (candidates, guint, i))
+            continue;
+        g_array_index (candidates, guint, n++) = g_array_index (candidates, guint, i);
+    }
+    g_array_set_size (candidates, n);
+
+    return candidates;
+}
+
 /*****************************************************************************/
 /* Build plugin list for a single port */
 
+/* Same subsystem filter the plugin itself applies, so that plugins are not
+ * loaded for ports they will never support */
+static gboolean
+plugin_info_check_subsystem (PluginInfo     *info,
+                             MMKernelDevice *port)
+{
+    const gchar *subsys;
+    guint        i;
+
+    if (!info->entry->subsystems)
+        return TRUE;
+
+    subsys = mm_kernel_device_get_subsystem (port);
+    for (i = 0; info->entry->subsystems[i]; i++) {
+        if (g_str_equal (subsys, info->entry->subsystems[i]))
+            return TRUE;
+        /* New kernels may report as 'usbmisc' the subsystem */
+        if (g_str_equal (info->entry->subsystems[i], "usb") &&
+            g_str_equal (subsys, "usbmisc"))
+            return TRUE;
+    }
+    return FALSE;
+}
+
 static GList *
 plugin_manager_build_plugins_list (MMPluginManager *self,
                                    MMDevice        *device,
                                    MMKernelDevice  *port)
 {
-    GList *list = NULL;
-    GList *l;
-    gboolean supported_found = FALSE;
-
-    for (l = self->priv->plugins; l && !supported_found; l = g_list_next (l)) {
-        MMPluginSupportsHint hint;
+    GList    *list = NULL;
+    GArray   *candidates;
+    guint     i;
+    gboolean  supported_found = FALSE;
+
+    /* Only the plugins that may support the port are checked */
+    candidates = plugin_manager_lookup_candidates (self, device, port);
+    mm_obj_dbg (self, "port %s: %u/%u plugin candidates",
+                mm_kernel_device_get_name (port), candidates->len, self->priv->plugins->len);
+
+    for (i = 0; i < candidates->len && !supported_found; i++) {
+        PluginInfo           *info;
+        MMPlugin             *plugin;
+        MMPluginSupportsHint  hint;
+
+        info = g_ptr_array_index (self->priv->plugins, g_array_index (candidates, guint, i));
+        if (!info->plugin && !plugin_info_check_subsystem (info, port))
+            continue;
+        plugin = plugin_manager_ensure_plugin_loaded (self, info);
+        if (!plugin)
+            continue;
 
-        hint = mm_plugin_discard_port_early (MM_PLUGIN (l->data), device, port);
+        hint = mm_plugin_discard_port_early (plugin, device, port);
         switch (hint) {
         case MM_PLUGIN_SUPPORTS_HINT_UNSUPPORTED:
             /* Fully discard */
             break;
         case MM_PLUGIN_SUPPORTS_HINT_MAYBE:
             /* Maybe supported, add to tail of list */
-            list = g_list_append (list, g_object_ref (l->data));
+            list = g_list_append (list, g_object_ref (plugin));
             break;
         case MM_PLUGIN_SUPPORTS_HINT_LIKELY:
             /* Likely supported, add to head of list */
-            list = g_list_prepend (list, g_object_ref (l->data));
+            list = g_list_prepend (list, g_object_ref (plugin));
             break;
         case MM_PLUGIN_SUPPORTS_HINT_SUPPORTED:
             /* Really supported, clean existing list and add it alone */
@@ -98,7 +311,7 @@ plugin_manager_build_plugins_list (MMPluginManager *self,
                 g_list_free_full (list, g_object_unref);
                 list = NULL;
             }
-            list = g_list_prepend (list, g_object_ref (l->data));
+            list = g_list_prepend (list, g_object_ref (plugin));
             /* This will end the loop as well */
             supported_found = TRUE;
             break;
@@ -106,6 +319,7 @@ plugin_manager_build_plugins_list (MMPluginManager *self,
             g_assert_not_reached ();
         }
     }
+    g_array_unref (candidates);
 
     /* Add the generic plugin at the end of the list */
     if (self->priv->generic)
@@ -212,6 +426,8 @@ struct _PortContext {
 
     /* The probe has been deferred */
     guint defer_id;
+    /* Probing results were restored from the probe cache */
+    gboolean cached;
     /* The probe must be deferred until a result is suggested by other
      * port probe results (e.g. for WWAN ports). */
     gboolean defer_until_suggested;
@@ -771,6 +987,14 @@ struct _DeviceContext {
 
     /* Port support check contexts being run */
     GList *port_contexts;
+
+    /* Whether the device was already looked up in the probe cache */
+    gboolean cache_checked;
+    /* If found, its key, the plugin that handled the device last time, and
+     * the keys of the cached ports not grabbed yet */
+    gchar      *cache_key;
+    MMPlugin   *cached_plugin;
+    GHashTable *cached_ports;
 };
 
 static void
@@ -795,6 +1019,11 @@ device_context_unref (DeviceContext *device_context)
             g_object_unref (device_context->cancellable);
         if (device_context->best_plugin)
             g_object_unref (device_context->best_plugin);
+        g_free (device_context->cache_key);
+        if (device_context->cached_plugin)
+            g_object_unref (device_context->cached_plugin);
+        if (device_context->cached_ports)
+            g_hash_table_unref (device_context->cached_ports);
         g_object_unref (device_context->device);
         g_object_unref (device_context->self);
         g_slice_free (DeviceContext, device_context);
@@ -808,6 +1037,263 @@ device_context_ref (DeviceContext *device_context)
     return device_context;
 }
 
+/*****************************************************************************/
+/* Probe cache
+ *
+ * Once a device has been handled by a plugin, the probing results of all its
+ * ports are stored in the probe cache. The next time the same hardware shows
+ * up, the results are restored in the port probes as soon as each port is
+ * grabbed, so that no probing is needed, and the plugin that handled the
+ * device is suggested for the restored ports. Once all the ports that the
+ * device exposed last time are available, there's no point in waiting any
+ * longer for more ports to appear.
+ *
+ * Cached results aren't checked against the device until the modem object
+ * is created with them; if that fails, or if the device ends up unsupported
+ * or handled by a plugin that can't be cached, the entry is dropped.
+ */
+
+static gchar *
+probe_cache_build_device_key (MMKernelDevice *port)
+{
+    return mm_probe_cache_build_device_key (mm_kernel_device_get_physdev_vid (port),
+                                            mm_kernel_device_get_physdev_pid (port),
+                                            mm_kernel_device_get_physdev_revision (port));
+}
+
+static gchar *
+probe_cache_build_port_key (MMKernelDevice *port)
+{
+    return mm_probe_cache_build_port_key (mm_kernel_device_get_subsystem (port),
+                                          mm_kernel_device_get_property (port, "ID_USB_INTERFACE_NUM"),
+                                          mm_kernel_device_get_driver (port));
+}
+
+/* Plugins with custom init steps may run their own checks and tag ports
+ * during probing, which cached results can't reproduce */
+static gboolean
+probe_cache_plugin_supported (MMPlugin *plugin)
+{
+    return !mm_plugin_has_custom_init (plugin);
+}
+
+static void
+probe_cache_save (MMPluginManager *self)
+{
+    GError *error = NULL;
+
+    if (!mm_probe_cache_save (self->priv->probe_cache, &error)) {
+        mm_obj_warn (self, "couldn't save probe cache: %s", error->message);
+        g_error_free (error);
+    }
+}
+
+static void
+probe_cache_forget_device (MMPluginManager *self,
+                           const gchar     *device_key)
+{
+    if (mm_probe_cache_remove_device (self->priv->probe_cache, device_key)) {
+        mm_obj_dbg (self, "removed device %s from the probe cache", device_key);
+        probe_cache_save (self);
+    }
+}
+
+static void
+probe_cache_store_device (MMPluginManager *self,
+                          MMDevice        *device,
+                          MMPlugin        *plugin)
+{
+    GList            *probes;
+    GList            *l;
+    GPtrArray        *port_keys;
+    guint             i;
+    g_autofree gchar *device_key = NULL;
+
+    probes = mm_device_peek_port_probe_list (device);
+    if (!probes)
+        return;
+
+    device_key = probe_cache_build_device_key (mm_port_probe_peek_port (MM_PORT_PROBE (probes->data)));
+    if (!device_key)
+        return;
+
+    if (!probe_cache_plugin_supported (plugin)) {
+        mm_obj_dbg (self, "not caching probing results: plugin '%s' uses custom init",
+                    mm_plugin_get_name (plugin));
+        probe_cache_forget_device (self, device_key);
+        return;
+    }
+
+    /* All ports must be identified unambiguously */
+    port_keys = g_ptr_array_new_with_free_func (g_free);
+    for (l = probes; l; l = g_list_next (l)) {
+        gchar *port_key;
+
+        port_key = probe_cache_build_port_key (mm_port_probe_peek_port (MM_PORT_PROBE (l->data)));
+        for (i = 0; port_key && i < port_keys->len; i++) {
+            if (g_str_equal (port_key, g_ptr_array_index (port_keys, i)))
+                g_clear_pointer (&port_key, g_free);
+        }
+        if (!port_key) {
+            mm_obj_dbg (self, "not caching probing results: port %s can't be identified",
+                        mm_port_probe_get_port_name (MM_PORT_PROBE (l->data)));
+            g_ptr_array_unref (port_keys);
+            probe_cache_forget_device (self, device_key);
+            return;
+        }
+        g_ptr_array_add (port_keys, port_key);
+    }
+
+    mm_probe_cache_set_device (self->priv->probe_cache, device_key, mm_plugin_get_name (plugin));
+    for (l = probes, i = 0; l; l = g_list_next (l), i++) {
+        MMPortProbe      *probe = MM_PORT_PROBE (l->data);
+        MMProbeCachePort  port = {
+            .probed   = mm_port_probe_get_probed_flags (probe),
+            .is_at    = mm_port_probe_is_at (probe),
+            .is_qcdm  = mm_port_probe_is_qcdm (probe),
+            .is_qmi   = mm_port_probe_is_qmi (probe),
+            .is_mbim  = mm_port_probe_is_mbim (probe),
+            .is_icera = mm_port_probe_is_icera (probe),
+            .is_xmm   = mm_port_probe_is_xmm (probe),
+            .vendor   = (gchar *) mm_port_probe_get_vendor (probe),
+            .product  = (gchar *) mm_port_probe_get_product (probe),
+        };
+
+        mm_probe_cache_set_port (self->priv->probe_cache,
+                                 device_key,
+                                 g_ptr_array_index (port_keys, i),
+                                 &port);
+    }
+    g_ptr_array_unref (port_keys);
+
+    mm_obj_dbg (self, "stored device %s in the probe cache", device_key);
+    probe_cache_save (self);
+}
+
+static void
+probe_cache_restore_port (MMPortProbe            *probe,
+                          const MMProbeCachePort *port)
+{
+    if (port->probed & MM_PORT_PROBE_AT)
+        mm_port_probe_set_result_at (probe, port->is_at);
+    if (port->probed & MM_PORT_PROBE_AT_VENDOR)
+        mm_port_probe_set_result_at_vendor (probe, port->vendor);
+    if (port->probed & MM_PORT_PROBE_AT_PRODUCT)
+        mm_port_probe_set_result_at_product (probe, port->product);
+    if (port->probed & MM_PORT_PROBE_AT_ICERA)
+        mm_port_probe_set_result_at_icera (probe, port->is_icera);
+    if (port->probed & MM_PORT_PROBE_AT_XMM)
+        mm_port_probe_set_result_at_xmm (probe, port->is_xmm);
+    if (port->probed & MM_PORT_PROBE_QCDM)
+        mm_port_probe_set_result_qcdm (probe, port->is_qcdm);
+    if (port->probed & MM_PORT_PROBE_QMI)
+        mm_port_probe_set_result_qmi (probe, port->is_qmi);
+    if (port->probed & MM_PORT_PROBE_MBIM)
+        mm_port_probe_set_result_mbim (probe, port->is_mbim);
+}
+
+static void
+device_context_lookup_cached_device (DeviceContext  *device_context,
+                                     MMKernelDevice *port)
+{
+    MMPluginManager   *self;
+    MMPlugin          *plugin;
+    g_autofree gchar  *device_key = NULL;
+    g_autofree gchar  *plugin_name = NULL;
+    gchar            **port_keys;
+    guint              i;
+
+    self = device_context->self;
+
+    device_context->cache_checked = TRUE;
+
+    device_key = probe_cache_build_device_key (port);
+    if (!device_key)
+        return;
+
+    plugin_name = mm_probe_cache_get_plugin (self->priv->probe_cache, device_key);
+    if (!plugin_name)
+        return;
+
+    plugin = mm_plugin_manager_peek_plugin (self, plugin_name);
+    if (!plugin || !probe_cache_plugin_supported (plugin)) {
+        mm_obj_dbg (self, "task %s: ignoring probe cache entry, plugin '%s' not usable",
+                    device_context->name, plugin_name);
+        return;
+    }
+
+    port_keys = mm_probe_cache_get_ports (self->priv->probe_cache, device_key);
+    if (port_keys && port_keys[0]) {
+        device_context->cache_key = g_steal_pointer (&device_key);
+        device_context->cached_plugin = g_object_ref (plugin);
+        device_context->cached_ports = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        for (i = 0; port_keys[i]; i++)
+            g_hash_table_add (device_context->cached_ports, g_strdup (port_keys[i]));
+        mm_obj_dbg (self, "task %s: device %s found in probe cache (plugin '%s', %u ports)",
+                    device_context->name, device_context->cache_key, plugin_name, i);
+    }
+    g_strfreev (port_keys);
+}
+
+/* Returns TRUE if probing results were restored in the port probe */
+static gboolean
+device_context_restore_cached_port (DeviceContext  *device_context,
+                                    MMKernelDevice *port)
+{
+    MMPluginManager  *self;
+    MMPortProbe      *probe;
+    MMProbeCachePort  cached;
+    g_autofree gchar *port_key = NULL;
+
+    self = device_context->self;
+
+    if (!self->priv->probe_cache)
+        return FALSE;
+
+    if (!device_context->cache_checked)
+        device_context_lookup_cached_device (device_context, port);
+    if (!device_context->cached_plugin)
+        return FALSE;
+
+    /* Each cached port is restored only once; if the port is released and
+     * grabbed again, it will be probed */
+    port_key = probe_cache_build_port_key (port);
+    if (!port_key || !g_hash_table_remove (device_context->cached_ports, port_key))
+        return FALSE;
+
+    probe = MM_PORT_PROBE (mm_device_peek_port_probe (device_context->device, port));
+    if (!probe || !mm_probe_cache_get_port (self->priv->probe_cache, device_context->cache_key, port_key, &cached))
+        return FALSE;
+
+    probe_cache_restore_port (probe, &cached);
+    mm_probe_cache_port_clear (&cached);
+
+    mm_obj_dbg (self, "task %s: restored cached probing results for port %s",
+                device_context->name, mm_kernel_device_get_name (port));
+    return TRUE;
+}
+
+static void
+device_context_update_probe_cache (DeviceContext *device_context)
+{
+    MMPluginManager *self;
+
+    self = device_context->self;
+
+    if (!self->priv->probe_cache || g_cancellable_is_cancelled (device_context->cancellable))
+        return;
+
+    if (device_context->best_plugin) {
+        if (device_context->cached_plugin && device_context->cached_plugin != device_context->best_plugin)
+            mm_obj_dbg (self, "task %s: device now handled by plugin '%s' instead of cached '%s'",
+                        device_context->name,
+                        mm_plugin_get_name (device_context->best_plugin),
+                        mm_plugin_get_name (device_context->cached_plugin));
+        probe_cache_store_device (self, device_context->device, device_context->best_plugin);
+    } else if (device_context->cache_key)
+        probe_cache_forget_device (self, device_context->cache_key);
+}
+
 static PortContext *
 device_context_peek_running_port_context (DeviceContext  *device_context,
                                           MMKernelDevice *port)
@@ -884,6 +1370,8 @@ device_context_complete (DeviceContext *device_context)
     mm_obj_dbg (self, "task %s: finished in '%lf' seconds",
                 device_context->name, g_timer_elapsed (device_context->timer, NULL));
 
+    device_context_update_probe_cache (device_context);
+
     /* Remove signal handlers */
     if (device_context->grabbed_id) {
         g_signal_handler_disconnect (device_context->device, device_context->grabbed_id);
@@ -1169,9 +1657,12 @@ device_context_run_port_context (DeviceContext *device_context,
     plugins = plugin_manager_build_plugins_list (self, device_context->device, port_context->port);
 
     /* If we got one already set in the device context, it will be the first one,
-     * unless it is the generic plugin */
+     * unless it is the generic plugin. Ports with cached probing results go
+     * straight to the plugin that handled them last time. */
     if (device_context->best_plugin && !mm_plugin_is_generic (device_context->best_plugin))
         suggested = device_context->best_plugin;
+    else if (port_context->cached && !mm_plugin_is_generic (device_context->cached_plugin))
+        suggested = device_context->cached_plugin;
 
     port_context_run (self,
                       port_context,
@@ -1220,6 +1711,31 @@ device_context_min_wait_time_elapsed (DeviceContext *device_context)
     return G_SOURCE_REMOVE;
 }
 
+/* Once all the ports found in the probe cache are available, don't wait for
+ * more ports: fire all pending timeouts right away */
+static void
+device_context_expedite (DeviceContext *device_context)
+{
+    mm_obj_dbg (device_context->self, "task %s: all cached ports available, not waiting for more",
+                device_context->name);
+
+    if (device_context->min_wait_time_id) {
+        g_source_remove (device_context->min_wait_time_id);
+        device_context->min_wait_time_id = g_idle_add ((GSourceFunc) device_context_min_wait_time_elapsed,
+                                                       device_context);
+    }
+    if (device_context->min_probing_time_id) {
+        g_source_remove (device_context->min_probing_time_id);
+        device_context->min_probing_time_id = g_idle_add ((GSourceFunc) device_context_min_probing_time_elapsed,
+                                                          device_context);
+    }
+    if (device_context->extra_probing_time_id) {
+        g_source_remove (device_context->extra_probing_time_id);
+        device_context->extra_probing_time_id = g_idle_add ((GSourceFunc) device_context_extra_probing_time_elapsed,
+                                                            device_context);
+    }
+}
+
 static void
 device_context_port_released (DeviceContext  *device_context,
                               MMKernelDevice *port)
@@ -1260,6 +1776,7 @@ device_context_port_grabbed (DeviceContext  *device_context,
 {
     MMPluginManager *self;
     PortContext     *port_context;
+    gboolean         cached;
 
     /* Recover plugin manager */
     self = MM_PLUGIN_MANAGER (device_context->self);
@@ -1299,21 +1816,26 @@ device_context_port_grabbed (DeviceContext  *device_context,
     mm_obj_dbg (self, "task %s: new support task for port",
                 port_context->name);
 
+    cached = device_context_restore_cached_port (device_context, port);
+    port_context->cached = cached;
+
     /* Îf still waiting the min wait time, store it in the waiting list */
     if (device_context->min_wait_time_id) {
         mm_obj_dbg (self, "task %s: deferred until min wait time elapsed",
                     port_context->name);
         /* Store the port reference in the list within the device */
         device_context->wait_port_contexts = g_list_prepend (device_context->wait_port_contexts, port_context);
-        return;
-    }
+    } else {
+        /* Store the port reference in the list within the device */
+        device_context->port_contexts = g_list_prepend (device_context->port_contexts, port_context) ;
 
-    /* Store the port reference in the list within the device */
-    device_context->port_contexts = g_list_prepend (device_context->port_contexts, port_context) ;
+        /* If the port has been grabbed after the min wait timeout expired, launch
+         * probing directly */
+        device_context_run_port_context (device_context, port_context);
+    }
 
-    /* If the port has been grabbed after the min wait timeout expired, launch
-     * probing directly */
-    device_context_run_port_context (device_context, port_context);
+    if (cached && !g_hash_table_size (device_context->cached_ports))
+        device_context_expedite (device_context);
 }
 
 static gboolean
@@ -1501,6 +2023,25 @@ mm_plugin_manager_device_support_check_cancel (MMPluginManager *self,
     return device_context_cancel (device_context);
 }
 
+void
+mm_plugin_manager_forget_cached_probing (MMPluginManager *self,
+                                         MMDevice        *device)
+{
+    GList            *probes;
+    g_autofree gchar *device_key = NULL;
+
+    if (!self->priv->probe_cache)
+        return;
+
+    probes = mm_device_peek_port_probe_list (device);
+    if (!probes)
+        return;
+
+    device_key = probe_cache_build_device_key (mm_port_probe_peek_port (MM_PORT_PROBE (probes->data)));
+    if (device_key)
+        probe_cache_forget_device (self, device_key);
+}
+
 static void
 device_context_run_ready (MMPluginManager    *self,
                           GAsyncResult       *res,
@@ -1584,16 +2125,17 @@ MMPlugin *
 mm_plugin_manager_peek_plugin (MMPluginManager *self,
                                const gchar *plugin_name)
 {
-    GList *l;
+    guint i;
 
     if (self->priv->generic && g_str_equal (plugin_name, mm_plugin_get_name (self->priv->generic)))
         return self->priv->generic;
 
-    for (l = self->priv->plugins; l; l = g_list_next (l)) {
-        MMPlugin *plugin = MM_PLUGIN (l->data);
+    for (i = 0; i < self->priv->plugins->len; i++) {
+        PluginInfo *info;
 
-        if (g_str_equal (plugin_name, mm_plugin_get_name (plugin)))
-            return plugin;
+        info = g_ptr_array_index (self->priv->plugins, i);
+        if (g_str_equal (plugin_name, info->entry->name))
+            return plugin_manager_ensure_plugin_loaded (self, info);
     }
 
     return NULL;
@@ -1602,50 +2144,89 @@ mm_plugin_manager_peek_plugin (MMPluginManager *self,
 /*****************************************************************************/
 
 static void
-register_plugin_whitelist_tags (MMPluginManager *self,
-                                MMPlugin        *plugin)
+register_plugin_whitelist_tags (MMPluginManager       *self,
+                                MMPluginManifestEntry *entry)
 {
-    const gchar **tags;
-    guint         i;
+    guint i;
 
     if (!mm_filter_check_rule_enabled (self->priv->filter, MM_FILTER_RULE_PLUGIN_WHITELIST))
         return;
 
-    tags = mm_plugin_get_allowed_udev_tags (plugin);
-    for (i = 0; tags && tags[i]; i++)
-        mm_filter_register_plugin_whitelist_tag (self->priv->filter, tags[i]);
+    for (i = 0; entry->udev_tags && entry->udev_tags[i]; i++)
+        mm_filter_register_plugin_whitelist_tag (self->priv->filter, entry->udev_tags[i]);
 }
 
 static void
-register_plugin_whitelist_vendor_ids (MMPluginManager *self,
-                                       MMPlugin        *plugin)
+register_plugin_whitelist_vendor_ids (MMPluginManager       *self,
+                                      MMPluginManifestEntry *entry)
 {
-    const guint16 *vendor_ids;
-    guint          i;
+    guint i;
 
     if (!mm_filter_check_rule_enabled (self->priv->filter, MM_FILTER_RULE_PLUGIN_WHITELIST))
         return;
 
-    vendor_ids = mm_plugin_get_allowed_vendor_ids (plugin);
-    for (i = 0; vendor_ids && vendor_ids[i]; i++)
-        mm_filter_register_plugin_whitelist_vendor_id (self->priv->filter, vendor_ids[i]);
+    for (i = 0; entry->vendor_ids && i < entry->vendor_ids->len; i++)
+        mm_filter_register_plugin_whitelist_vendor_id (self->priv->filter,
+                                                       g_array_index (entry->vendor_ids, guint16, i));
 }
 
 static void
-register_plugin_whitelist_product_ids (MMPluginManager *self,
-                                       MMPlugin        *plugin)
+register_plugin_whitelist_product_ids (MMPluginManager       *self,
+                                       MMPluginManifestEntry *entry)
 {
-    const mm_uint16_pair *product_ids;
-    guint                 i;
+    guint i;
 
     if (!mm_filter_check_rule_enabled (self->priv->filter, MM_FILTER_RULE_PLUGIN_WHITELIST))
         return;
 
+    for (i = 0; entry->product_ids && i < entry->product_ids->len; i++) {
+        MMPluginManifestProductId *id;
+
+        id = &g_array_index (entry->product_ids, MMPluginManifestProductId, i);
+        mm_filter_register_plugin_whitelist_product_id (self->priv->filter, id->vid, id->pid);
+    }
+}
+
+/*****************************************************************************/
+
+static void
+manifest_entry_fill (MMPluginManifestEntry *entry,
+                     MMPlugin              *plugin)
+{
+    const guint16        *vendor_ids;
+    const mm_uint16_pair *product_ids;
+    const gchar         **udev_tags;
+    const gchar         **drivers;
+    guint                 i;
+
+    entry->name = g_strdup (mm_plugin_get_name (plugin));
+    entry->generic = mm_plugin_is_generic (plugin);
+    entry->subsystems = g_strdupv ((gchar **) mm_plugin_get_allowed_subsystems (plugin));
+
+    mm_plugin_get_mandatory_filters (plugin, &entry->mandatory_vendor_ids, &udev_tags, &drivers);
+    entry->udev_tags = g_strdupv ((gchar **) udev_tags);
+    entry->drivers = g_strdupv ((gchar **) drivers);
+
+    vendor_ids = mm_plugin_get_allowed_vendor_ids (plugin);
+    if (vendor_ids) {
+        entry->vendor_ids = g_array_new (FALSE, FALSE, sizeof (guint16));
+        for (i = 0; vendor_ids[i]; i++)
+            g_array_append_val (entry->vendor_ids, vendor_ids[i]);
+    }
+
     product_ids = mm_plugin_get_allowed_product_ids (plugin);
-    for (i = 0; product_ids && product_ids[i].l; i++)
-        mm_filter_register_plugin_whitelist_product_id (self->priv->filter, product_ids[i].l, product_ids[i].r);
+    if (product_ids) {
+        entry->product_ids = g_array_new (FALSE, FALSE, sizeof (MMPluginManifestProductId));
+        for (i = 0; product_ids[i].l; i++) {
+            MMPluginManifestProductId id = { .vid = product_ids[i].l, .pid = product_ids[i].r };
+
+            g_array_append_val (entry->product_ids, id);
+        }
+    }
 }
 
+/*****************************************************************************/
+
 static MMPlugin *
 load_plugin (MMPluginManager *self,
              const gchar     *path)
@@ -1764,6 +2345,136 @@ out:
     g_free (path_display);
 }
 
+static void
+plugin_manager_ensure_shared_loaded (MMPluginManager *self)
+{
+    guint i;
+
+    if (self->priv->shared_loaded)
+        return;
+    self->priv->shared_loaded = TRUE;
+
+    for (i = 0; i < self->priv->shared_paths->len; i++)
+        load_shared (self, (const gchar *) g_ptr_array_index (self->priv->shared_paths, i));
+}
+
+static MMPlugin *
+plugin_manager_ensure_plugin_loaded (MMPluginManager *self,
+                                     PluginInfo      *info)
+{
+    gchar    *path;
+    MMPlugin *plugin;
+
+    if (info->plugin || info->load_failed)
+        return info->plugin;
+
+    /* Plugins may need the symbols of the shared utils; the generic one
+     * never does */
+    if (!info->entry->generic)
+        plugin_manager_ensure_shared_loaded (self);
+
+    path = g_module_build_path (self->priv->plugin_dir, info->entry->filename);
+    plugin = load_plugin (self, path);
+    if (plugin && g_strcmp0 (mm_plugin_get_name (plugin), info->entry->name) != 0) {
+        mm_obj_warn (self, "plugin '%s' loaded from '%s' doesn't match the manifest entry for '%s'",
+                     mm_plugin_get_name (plugin), info->entry->filename, info->entry->name);
+        g_clear_object (&plugin);
+    }
+    g_free (path);
+
+    info->plugin = plugin;
+    info->load_failed = !plugin;
+    return plugin;
+}
+
+/* Loads all plugin files, and builds their manifest entries */
+static GPtrArray *
+load_all_plugins (MMPluginManager *self,
+                  GPtrArray       *filenames)
+{
+    GPtrArray *infos;
+    guint      i;
+
+    plugin_manager_ensure_shared_loaded (self);
+
+    infos = g_ptr_array_new ();
+    for (i = 0; i < filenames->len; i++) {
+        PluginInfo *info;
+        gchar      *path;
+
+        info = g_slice_new0 (PluginInfo);
+        info->entry = mm_plugin_manifest_entry_new ((const gchar *) g_ptr_array_index (filenames, i));
+
+        path = g_module_build_path (self->priv->plugin_dir, info->entry->filename);
+        info->plugin = load_plugin (self, path);
+        g_free (path);
+
+        /* Plugin files that can't be loaded are still listed in the
+         * manifest, without name */
+        if (info->plugin)
+            manifest_entry_fill (info->entry, info->plugin);
+        else
+            info->load_failed = TRUE;
+
+        g_ptr_array_add (infos, info);
+    }
+
+    return infos;
+}
+
+static void
+save_plugin_manifest (MMPluginManager *self,
+                      const gchar     *manifest_file,
+                      GPtrArray       *infos)
+{
+    GPtrArray *entries;
+    GError    *error = NULL;
+    guint      i;
+
+    entries = g_ptr_array_sized_new (infos->len);
+    for (i = 0; i < infos->len; i++) {
+        PluginInfo *info;
+
+        info = g_ptr_array_index (infos, i);
+        if (!mm_plugin_manifest_entry_stat (info->entry, self->priv->plugin_dir, &error))
+            break;
+        g_ptr_array_add (entries, info->entry);
+    }
+
+    if (!error)
+        mm_plugin_manifest_save (manifest_file, entries, &error);
+
+    if (error) {
+        mm_obj_warn (self, "couldn't write plugin manifest: %s", error->message);
+        g_error_free (error);
+    } else
+        mm_obj_dbg (self, "plugin manifest written to '%s'", manifest_file);
+
+    g_ptr_array_unref (entries);
+}
+
+/* Takes over the manifest entries, no plugin is loaded */
+static GPtrArray *
+build_plugin_infos (GPtrArray *entries)
+{
+    GPtrArray *infos;
+    guint      i;
+
+    infos = g_ptr_array_sized_new (entries->len);
+    for (i = 0; i < entries->len; i++) {
+        PluginInfo *info;
+
+        info = g_slice_new0 (PluginInfo);
+        info->entry = g_ptr_array_index (entries, i);
+        info->load_failed = !info->entry->name;
+        g_ptr_array_add (infos, info);
+    }
+
+    g_ptr_array_set_free_func (entries, NULL);
+    g_ptr_array_unref (entries);
+    return infos;
+}
+
 static gboolean
 load_plugins (MMPluginManager *self,
               GError **error)
@@ -1771,9 +2482,13 @@ load_plugins (MMPluginManager *self,
     GDir *dir = NULL;
     const gchar *fname;
     gchar *plugindir_display = NULL;
-    GList *shared_paths = NULL;
-    GList *plugin_paths = NULL;
-    GList *l;
+    GPtrArray *plugin_filenames = NULL;
+    GPtrArray *infos = NULL;
+    const gchar *manifest_file;
+    guint i;
+
+    self->priv->plugins = g_ptr_array_new_with_free_func ((GDestroyNotify) plugin_info_free);
+    self->priv->shared_paths = g_ptr_array_new_with_free_func (g_free);
 
     if (!g_module_supported ()) {
         g_set_error (error,
@@ -1797,47 +2512,77 @@ load_plugins (MMPluginManager *self,
         goto out;
     }
 
+    plugin_filenames = g_ptr_array_new_with_free_func (g_free);
     while ((fname = g_dir_read_name (dir)) != NULL) {
         if (!g_str_has_suffix (fname, G_MODULE_SUFFIX))
             continue;
         if (g_str_has_prefix (fname, SHARED_PREFIX))
-            shared_paths = g_list_prepend (shared_paths, g_module_build_path (self->priv->plugin_dir, fname));
+            g_ptr_array_add (self->priv->shared_paths, g_module_build_path (self->priv->plugin_dir, fname));
         else if (g_str_has_prefix (fname, PLUGIN_PREFIX))
-            plugin_paths = g_list_prepend (plugin_paths, g_module_build_path (self->priv->plugin_dir, fname));
+            g_ptr_array_add (plugin_filenames, g_strdup (fname));
+    }
+
+    /* Plugins are only loaded on demand if the manifest lists exactly the
+     * plugin files installed; otherwise all are loaded and the manifest is
+     * written again */
+    manifest_file = mm_context_get_plugin_manifest_file ();
+    if (manifest_file) {
+        GPtrArray *entries;
+
+        entries = mm_plugin_manifest_load (manifest_file, self);
+        if (entries) {
+            g_ptr_array_add (plugin_filenames, NULL);
+            if (mm_plugin_manifest_matches (entries,
+                                            self->priv->plugin_dir,
+                                            (const gchar * const *) plugin_filenames->pdata,
+                                            self)) {
+                mm_obj_dbg (self, "loading plugins on demand, as listed in manifest '%s'", manifest_file);
+                infos = build_plugin_infos (entries);
+            } else
+                g_ptr_array_unref (entries);
+            g_ptr_array_remove_index (plugin_filenames, plugin_filenames->len - 1);
+        }
     }
 
-    /* Load all shared utils */
-    for (l = shared_paths; l; l = g_list_next (l))
-        load_shared (self, (const gchar *)(l->data));
+    if (!infos) {
+        infos = load_all_plugins (self, plugin_filenames);
+        if (manifest_file)
+            save_plugin_manifest (self, manifest_file, infos);
+    }
 
-    /* Load all plugins */
-    for (l = plugin_paths; l; l = g_list_next (l)) {
-        MMPlugin *plugin;
+    for (i = 0; i < infos->len; i++) {
+        PluginInfo *info;
 
-        plugin = load_plugin (self, (const gchar *)(l->data));
-        if (!plugin)
+        info = g_ptr_array_index (infos, i);
+        if (info->load_failed) {
+            plugin_info_free (info);
             continue;
+        }
 
-        if (mm_plugin_is_generic (plugin)) {
+        if (info->entry->generic) {
             if (self->priv->generic)
                 mm_obj_warn (self, "cannot register more than one generic plugin");
-            else
-                self->priv->generic = plugin;
-        } else
-            self->priv->plugins = g_list_append (self->priv->plugins, plugin);
+            else if (plugin_manager_ensure_plugin_loaded (self, info))
+                self->priv->generic = g_object_ref (info->plugin);
+            plugin_info_free (info);
+            continue;
+        }
 
         /* Register plugin whitelist rules in filter, if any */
-        register_plugin_whitelist_tags        (self, plugin);
-        register_plugin_whitelist_vendor_ids  (self, plugin);
-        register_plugin_whitelist_product_ids (self, plugin);
+        register_plugin_whitelist_tags        (self, info->entry);
+        register_plugin_whitelist_vendor_ids  (self, info->entry);
+        register_plugin_whitelist_product_ids (self, info->entry);
+
+        g_ptr_array_add (self->priv->plugins, info);
     }
+    g_ptr_array_unref (infos);
 
     /* Check the generic plugin once all looped */
     if (!self->priv->generic)
         mm_obj_dbg (self, "generic plugin not loaded");
 
     /* Treat as error if we don't find any plugin */
-    if (!self->priv->plugins && !self->priv->generic) {
+    if (!self->priv->plugins->len && !self->priv->generic) {
         g_set_error (error,
                      MM_CORE_ERROR,
                      MM_CORE_ERROR_NO_PLUGINS,
@@ -1846,18 +2591,20 @@ load_plugins (MMPluginManager *self,
         goto out;
     }
 
-    mm_obj_dbg (self, "successfully loaded %u plugins",
-                g_list_length (self->priv->plugins) + !!self->priv->generic);
+    mm_obj_dbg (self, "successfully registered %u plugins",
+                self->priv->plugins->len + !!self->priv->generic);
+
+    plugin_manager_build_index (self);
 
 out:
-    g_list_free_full (shared_paths, g_free);
-    g_list_free_full (plugin_paths, g_free);
+    if (plugin_filenames)
+        g_ptr_array_unref (plugin_filenames);
     if (dir)
         g_dir_close (dir);
     g_free (plugindir_display);
 
     /* Return TRUE if at least one plugin found */
-    return (self->priv->plugins || self->priv->generic);
+    return (self->priv->plugins->len || self->priv->generic);
 }
 
 /*****************************************************************************/
@@ -1940,8 +2687,19 @@ initable_init (GInitable *initable,
                GCancellable *cancellable,
                GError **error)
 {
+    MMPluginManager *self = MM_PLUGIN_MANAGER (initable);
+    const gchar     *probe_cache_file;
+
     /* Load the list of plugins */
-    return load_plugins (MM_PLUGIN_MANAGER (initable), error);
+    if (!load_plugins (self, error))
+        return FALSE;
+
+    probe_cache_file = mm_context_get_probe_cache_file ();
+    if (probe_cache_file) {
+        mm_obj_dbg (self, "using probe cache at '%s'", probe_cache_file);
+        self->priv->probe_cache = mm_probe_cache_new (probe_cache_file, self);
+    }
+    return TRUE;
 }
 
 static void
@@ -1949,18 +2707,20 @@ dispose (GObject *object)
 {
     MMPluginManager *self = MM_PLUGIN_MANAGER (object);
 
+    plugin_manager_clear_index (self);
+
     /* Cleanup list of plugins */
-    if (self->priv->plugins) {
-        g_list_free_full (self->priv->plugins, g_object_unref);
-        self->priv->plugins = NULL;
-    }
+    g_clear_pointer (&self->priv->plugins, g_ptr_array_unref);
     g_clear_object (&self->priv->generic);
+    g_clear_pointer (&self->priv->shared_paths, g_ptr_array_unref);
 
     g_free (self->priv->plugin_dir);
     self->priv->plugin_dir = NULL;
 
     g_clear_object (&self->priv->filter);
 
+    g_clear_pointer (&self->priv->probe_cache, mm_probe_cache_free);
+
     G_OBJECT_CLASS (mm_plugin_manager_parent_class)->dispose (object);
 }
 
@@ -64,4 +64,9 @@ MMPlugin *       mm_plugin_manager_device_support_check_finish (MMPluginManager
 MMPlugin        *mm_plugin_manager_peek_plugin                 (MMPluginManager      *self,
                                                                 const gchar          *plugin_name);
 
+/* Drops the cached probing results of the device, e.g. if the modem couldn't
+ * be created with them */
+void             mm_plugin_manager_forget_cached_probing       (MMPluginManager      *self,
+                                                                MMDevice             *device);
+
 #endif /* MM_PLUGIN_MANAGER_H */
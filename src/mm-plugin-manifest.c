@@ -0,0 +1,411 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <glib/gstdio.h>
+
+#include "mm-plugin-manifest.h"
+#include "mm-versioned-key-file.h"
+#include "mm-log.h"
+
+/*
+ * The manifest is stored as a key file:
+ *
+ *   [plugin-manifest]
+ *   version=<daemon version>
+ *
+ *   [plugin <file name>]
+ *   mtime=<modification time>
+ *   size=<file size>
+ *   name=<plugin name>
+ *   generic=true|false
+ *   subsystems=<subsystem>;...
+ *   mandatory-vendor-ids=<vid>;...
+ *   udev-tags=<tag>;...
+ *   drivers=<driver>;...
+ *   vendor-ids=<vid>;...
+ *   product-ids=<vid>:<pid>;...
+ *
+ * Keys of unset filters are not written. Groups are written in the same
+ * order as the entries given.
+ */
+
+#define MANIFEST_GROUP                   "plugin-manifest"
+#define PLUGIN_GROUP_PREFIX              "plugin "
+#define PLUGIN_KEY_MTIME                 "mtime"
+#define PLUGIN_KEY_SIZE                  "size"
+#define PLUGIN_KEY_NAME                  "name"
+#define PLUGIN_KEY_GENERIC               "generic"
+#define PLUGIN_KEY_SUBSYSTEMS            "subsystems"
+#define PLUGIN_KEY_MANDATORY_VENDOR_IDS  "mandatory-vendor-ids"
+#define PLUGIN_KEY_UDEV_TAGS             "udev-tags"
+#define PLUGIN_KEY_DRIVERS               "drivers"
+#define PLUGIN_KEY_VENDOR_IDS            "vendor-ids"
+#define PLUGIN_KEY_PRODUCT_IDS           "product-ids"
+
+/*****************************************************************************/
+
+MMPluginManifestEntry *
+mm_plugin_manifest_entry_new (const gchar *filename)
+{
+    MMPluginManifestEntry *entry;
+
+    entry = g_slice_new0 (MMPluginManifestEntry);
+    entry->filename = g_strdup (filename);
+    return entry;
+}
+
+void
+mm_plugin_manifest_entry_free (MMPluginManifestEntry *entry)
+{
+    g_free (entry->filename);
+    g_free (entry->name);
+    g_strfreev (entry->subsystems);
+    g_clear_pointer (&entry->mandatory_vendor_ids, g_array_unref);
+    g_strfreev (entry->udev_tags);
+    g_strfreev (entry->drivers);
+    g_clear_pointer (&entry->vendor_ids, g_array_unref);
+    g_clear_pointer (&entry->product_ids, g_array_unref);
+    g_slice_free (MMPluginManifestEntry, entry);
+}
+
+gboolean
+mm_plugin_manifest_entry_stat (MMPluginManifestEntry  *entry,
+                               const gchar            *plugin_dir,
+                               GError                **error)
+{
+    g_autofree gchar *path = NULL;
+    GStatBuf          st;
+
+    path = g_build_filename (plugin_dir, entry->filename, NULL);
+    if (g_stat (path, &st) < 0) {
+        gint errsv = errno;
+
+        g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errsv),
+                     "couldn't stat '%s': %s", path, g_strerror (errsv));
+        return FALSE;
+    }
+
+    entry->mtime = (guint64) st.st_mtime;
+    entry->size = (guint64) st.st_size;
+    return TRUE;
+}
+
+/*****************************************************************************/
+
+static gboolean
+parse_uint16 (const gchar  *str,
+              gchar         end_char,
+              guint16      *out,
+              const gchar **end)
+{
+    guint64  value;
+    gchar   *endptr = NULL;
+
+    if (!g_ascii_isxdigit (str[0]))
+        return FALSE;
+    value = g_ascii_strtoull (str, &endptr, 16);
+    if (value > G_MAXUINT16 || *endptr != end_char)
+        return FALSE;
+    *out = (guint16) value;
+    if (end)
+        *end = endptr;
+    return TRUE;
+}
+
+static gboolean
+load_vendor_ids (GKeyFile     *key_file,
+                 const gchar  *group,
+                 const gchar  *key,
+                 GArray      **out,
+                 GError      **error)
+{
+    g_auto(GStrv)  strv = NULL;
+    guint          i;
+
+    if (!g_key_file_has_key (key_file, group, key, NULL))
+        return TRUE;
+
+    strv = g_key_file_get_string_list (key_file, group, key, NULL, NULL);
+    *out = g_array_new (FALSE, FALSE, sizeof (guint16));
+    for (i = 0; strv && strv[i]; i++) {
+        guint16 vid;
+
+        if (!parse_uint16 (strv[i], '\0', &vid, NULL)) {
+            g_set_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_INVALID_VALUE,
+                         "invalid vendor id '%s' in key '%s'", strv[i], key);
+            return FALSE;
+        }
+        g_array_append_val (*out, vid);
+    }
+    return TRUE;
+}
+
+static gboolean
+load_product_ids (GKeyFile     *key_file,
+                  const gchar  *group,
+                  GArray      **out,
+                  GError      **error)
+{
+    g_auto(GStrv)  strv = NULL;
+    guint          i;
+
+    if (!g_key_file_has_key (key_file, group, PLUGIN_KEY_PRODUCT_IDS, NULL))
+        return TRUE;
+
+    strv = g_key_file_get_string_list (key_file, group, PLUGIN_KEY_PRODUCT_IDS, NULL, NULL);
+    *out = g_array_new (FALSE, FALSE, sizeof (MMPluginManifestProductId));
+    for (i = 0; strv && strv[i]; i++) {
+        MMPluginManifestProductId  id;
+        const gchar               *end = NULL;
+
+        if (!parse_uint16 (strv[i], ':', &id.vid, &end) ||
+            !parse_uint16 (end + 1, '\0', &id.pid, NULL)) {
+            g_set_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_INVALID_VALUE,
+                         "invalid product id '%s'", strv[i]);
+            return FALSE;
+        }
+        g_array_append_val (*out, id);
+    }
+    return TRUE;
+}
+
+static gchar **
+load_optional_strv (GKeyFile    *key_file,
+                    const gchar *group,
+                    const gchar *key)
+{
+    gchar **strv;
+
+    if (!g_key_file_has_key (key_file, group, key, NULL))
+        return NULL;
+    strv = g_key_file_get_string_list (key_file, group, key, NULL, NULL);
+    /* An empty list is still a list */
+    return strv ? strv : g_new0 (gchar *, 1);
+}
+
+static MMPluginManifestEntry *
+load_entry (GKeyFile     *key_file,
+            const gchar  *group,
+            GError      **error)
+{
+    MMPluginManifestEntry *entry;
+    GError                *inner_error = NULL;
+
+    entry = mm_plugin_manifest_entry_new (group + strlen (PLUGIN_GROUP_PREFIX));
+    entry->mtime   = g_key_file_get_uint64 (key_file, group, PLUGIN_KEY_MTIME, &inner_error);
+    entry->size    = g_key_file_get_uint64 (key_file, group, PLUGIN_KEY_SIZE, inner_error ? NULL : &inner_error);
+    entry->name    = g_key_file_get_string (key_file, group, PLUGIN_KEY_NAME, inner_error ? NULL : &inner_error);
+    entry->generic = g_key_file_get_boolean (key_file, group, PLUGIN_KEY_GENERIC, inner_error ? NULL : &inner_error);
+    if (inner_error)
+        goto out;
+
+    entry->subsystems = load_optional_strv (key_file, group, PLUGIN_KEY_SUBSYSTEMS);
+    entry->udev_tags  = load_optional_strv (key_file, group, PLUGIN_KEY_UDEV_TAGS);
+    entry->drivers    = load_optional_strv (key_file, group, PLUGIN_KEY_DRIVERS);
+
+    if (load_vendor_ids (key_file, group, PLUGIN_KEY_MANDATORY_VENDOR_IDS, &entry->mandatory_vendor_ids, &inner_error) &&
+        load_vendor_ids (key_file, group, PLUGIN_KEY_VENDOR_IDS, &entry->vendor_ids, &inner_error))
+        load_product_ids (key_file, group, &entry->product_ids, &inner_error);
+
+out:
+    if (inner_error) {
+        g_propagate_prefixed_error (error, inner_error, "invalid entry '%s': ", group);
+        mm_plugin_manifest_entry_free (entry);
+        return NULL;
+    }
+    return entry;
+}
+
+GPtrArray *
+mm_plugin_manifest_load (const gchar *path,
+                         gpointer     log_object)
+{
+    GKeyFile      *key_file;
+    GPtrArray     *entries = NULL;
+    GError        *error = NULL;
+    g_auto(GStrv)  groups = NULL;
+    guint          i;
+
+    /* Plugin filters may change between releases even if the plugin files
+     * end up with the same size */
+    key_file = mm_versioned_key_file_load (path, MANIFEST_GROUP, "plugin manifest", log_object);
+    if (!key_file)
+        return NULL;
+
+    entries = g_ptr_array_new_with_free_func ((GDestroyNotify) mm_plugin_manifest_entry_free);
+    groups = g_key_file_get_groups (key_file, NULL);
+    for (i = 0; groups[i]; i++) {
+        MMPluginManifestEntry *entry;
+
+        if (!g_str_has_prefix (groups[i], PLUGIN_GROUP_PREFIX))
+            continue;
+
+        entry = load_entry (key_file, groups[i], &error);
+        if (!entry) {
+            mm_obj_warn (log_object, "discarding plugin manifest: %s", error->message);
+            g_clear_error (&error);
+            g_clear_pointer (&entries, g_ptr_array_unref);
+            break;
+        }
+        g_ptr_array_add (entries, entry);
+    }
+
+    g_key_file_free (key_file);
+    return entries;
+}
+
+/*****************************************************************************/
+
+static void
+save_optional_strv (GKeyFile     *key_file,
+                    const gchar  *group,
+                    const gchar  *key,
+                    gchar       **strv)
+{
+    if (strv)
+        g_key_file_set_string_list (key_file, group, key, (const gchar * const *) strv, g_strv_length (strv));
+}
+
+static void
+save_vendor_ids (GKeyFile    *key_file,
+                 const gchar *group,
+                 const gchar *key,
+                 GArray      *vendor_ids)
+{
+    g_auto(GStrv) strv = NULL;
+    guint         i;
+
+    if (!vendor_ids)
+        return;
+
+    strv = g_new0 (gchar *, vendor_ids->len + 1);
+    for (i = 0; i < vendor_ids->len; i++)
+        strv[i] = g_strdup_printf ("%04x", g_array_index (vendor_ids, guint16, i));
+    g_key_file_set_string_list (key_file, group, key, (const gchar * const *) strv, vendor_ids->len);
+}
+
+static void
+save_product_ids (GKeyFile    *key_file,
+                  const gchar *group,
+                  GArray      *product_ids)
+{
+    g_auto(GStrv) strv = NULL;
+    guint         i;
+
+    if (!product_ids)
+        return;
+
+    strv = g_new0 (gchar *, product_ids->len + 1);
+    for (i = 0; i < product_ids->len; i++) {
+        MMPluginManifestProductId *id;
+
+        id = &g_array_index (product_ids, MMPluginManifestProductId, i);
+        strv[i] = g_strdup_printf ("%04x:%04x", id->vid, id->pid);
+    }
+    g_key_file_set_string_list (key_file, group, PLUGIN_KEY_PRODUCT_IDS, (const gchar * const *) strv, product_ids->len);
+}
+
+gboolean
+mm_plugin_manifest_save (const gchar  *path,
+                         GPtrArray    *entries,
+                         GError      **error)
+{
+    GKeyFile *key_file;
+    gboolean  saved;
+    guint     i;
+
+    key_file = mm_versioned_key_file_new (MANIFEST_GROUP);
+
+    for (i = 0; i < entries->len; i++) {
+        MMPluginManifestEntry *entry;
+        g_autofree gchar      *group = NULL;
+
+        entry = g_ptr_array_index (entries, i);
+        group = g_strconcat (PLUGIN_GROUP_PREFIX, entry->filename, NULL);
+        g_key_file_set_uint64 (key_file, group, PLUGIN_KEY_MTIME, entry->mtime);
+        g_key_file_set_uint64 (key_file, group, PLUGIN_KEY_SIZE, entry->size);
+        g_key_file_set_string (key_file, group, PLUGIN_KEY_NAME, entry->name);
+        g_key_file_set_boolean (key_file, group, PLUGIN_KEY_GENERIC, entry->generic);
+        save_optional_strv (key_file, group, PLUGIN_KEY_SUBSYSTEMS, entry->subsystems);
+        save_vendor_ids (key_file, group, PLUGIN_KEY_MANDATORY_VENDOR_IDS, entry->mandatory_vendor_ids);
+        save_optional_strv (key_file, group, PLUGIN_KEY_UDEV_TAGS, entry->udev_tags);
+        save_optional_strv (key_file, group, PLUGIN_KEY_DRIVERS, entry->drivers);
+        save_vendor_ids (key_file, group, PLUGIN_KEY_VENDOR_IDS, entry->vendor_ids);
+        save_product_ids (key_file, group, entry->product_ids);
+    }
+
+    saved = mm_versioned_key_file_save (key_file, path, error);
+    g_key_file_free (key_file);
+    return saved;
+}
+
+/*****************************************************************************/
+
+gboolean
+mm_plugin_manifest_matches (GPtrArray           *entries,
+                            const gchar         *plugin_dir,
+                            const gchar * const *filenames,
+                            gpointer             log_object)
+{
+    g_autoptr(GHashTable) by_filename = NULL;
+    guint                 i;
+
+    if (g_strv_length ((gchar **) filenames) != entries->len) {
+        mm_obj_dbg (log_object, "plugin manifest lists %u plugins, %u found",
+                    entries->len, g_strv_length ((gchar **) filenames));
+        return FALSE;
+    }
+
+    by_filename = g_hash_table_new (g_str_hash, g_str_equal);
+    for (i = 0; i < entries->len; i++) {
+        MMPluginManifestEntry *entry;
+
+        entry = g_ptr_array_index (entries, i);
+        g_hash_table_insert (by_filename, entry->filename, entry);
+    }
+
+    for (i = 0; filenames[i]; i++) {
+        MMPluginManifestEntry *entry;
+        MMPluginManifestEntry *current;
+        GError                *error = NULL;
+        gboolean               same;
+
+        entry = g_hash_table_lookup (by_filename, filenames[i]);
+        if (!entry) {
+            mm_obj_dbg (log_object, "plugin '%s' not listed in plugin manifest", filenames[i]);
+            return FALSE;
+        }
+
+        current = mm_plugin_manifest_entry_new (filenames[i]);
+        if (!mm_plugin_manifest_entry_stat (current, plugin_dir, &error)) {
+            mm_obj_dbg (log_object, "%s", error->message);
+            g_error_free (error);
+            mm_plugin_manifest_entry_free (current);
+            return FALSE;
+        }
+        same = (current->mtime == entry->mtime && current->size == entry->size);
+        mm_plugin_manifest_entry_free (current);
+        if (!same) {
+            mm_obj_dbg (log_object, "plugin '%s' updated since the plugin manifest was written", filenames[i]);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
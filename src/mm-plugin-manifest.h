@@ -0,0 +1,81 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_PLUGIN_MANIFEST_H
+#define MM_PLUGIN_MANIFEST_H
+
+#include <glib.h>
+
+/*
+ * Manifest of the plugins installed in the plugin directory.
+ *
+ * For every plugin file the manifest keeps the details the plugin manager
+ * needs before any port is probed: the plugin name, the pre-probing filters
+ * that ports must always match to be supported by the plugin, and the
+ * whitelist rules the plugin registers in the device filter. With a valid
+ * manifest, plugins don't need to be loaded until a port that may be
+ * supported by them shows up.
+ *
+ * Plugin files are identified by file name, modification time and size; a
+ * manifest is only valid if it lists exactly the plugin files found in the
+ * plugin directory. Manifests written by a different daemon version are
+ * discarded when loaded.
+ */
+
+typedef struct {
+    guint16 vid;
+    guint16 pid;
+} MMPluginManifestProductId;
+
+typedef struct {
+    gchar    *filename;
+    guint64   mtime;
+    guint64   size;
+
+    gchar    *name;
+    gboolean  generic;
+    gchar   **subsystems;
+
+    /* Mandatory filters, each one NULL if not mandatory for the plugin */
+    GArray   *mandatory_vendor_ids; /* guint16 */
+    gchar   **udev_tags;
+    gchar   **drivers;
+
+    /* Plugin whitelist rules */
+    GArray   *vendor_ids;  /* guint16 */
+    GArray   *product_ids; /* MMPluginManifestProductId */
+} MMPluginManifestEntry;
+
+MMPluginManifestEntry *mm_plugin_manifest_entry_new  (const gchar           *filename);
+void                   mm_plugin_manifest_entry_free (MMPluginManifestEntry *entry);
+
+/* Fills in the modification time and size of the plugin file */
+gboolean   mm_plugin_manifest_entry_stat (MMPluginManifestEntry  *entry,
+                                          const gchar            *plugin_dir,
+                                          GError                **error);
+
+/* Returns an array of MMPluginManifestEntry, or NULL if the manifest can't
+ * be used. */
+GPtrArray *mm_plugin_manifest_load       (const gchar            *path,
+                                          gpointer                log_object);
+gboolean   mm_plugin_manifest_save       (const gchar            *path,
+                                          GPtrArray              *entries,
+                                          GError                **error);
+
+/* Checks whether the entries describe exactly the given plugin files */
+gboolean   mm_plugin_manifest_matches    (GPtrArray              *entries,
+                                          const gchar            *plugin_dir,
+                                          const gchar * const    *filenames,
+                                          gpointer                log_object);
+
+#endif /* MM_PLUGIN_MANIFEST_H */
@@ -96,6 +96,7 @@ struct _MMPluginPrivate {
     gboolean xmm_probe;
     MMPortProbeAtCommand *custom_at_probe;
     guint64 send_delay;
+    gboolean send_delay_adaptive;
     gboolean remove_echo;
     gboolean send_lf;
 
@@ -133,6 +134,7 @@ enum {
     PROP_CUSTOM_AT_PROBE,
     PROP_CUSTOM_INIT,
     PROP_SEND_DELAY,
+    PROP_SEND_DELAY_ADAPTIVE,
     PROP_REMOVE_ECHO,
     PROP_SEND_LF,
     LAST_PROP
@@ -146,6 +148,12 @@ mm_plugin_get_name (MMPlugin *self)
     return self->priv->name;
 }
 
+const gchar **
+mm_plugin_get_allowed_subsystems (MMPlugin *self)
+{
+    return (const gchar **) self->priv->subsystems;
+}
+
 const gchar **
 mm_plugin_get_allowed_udev_tags (MMPlugin *self)
 {
@@ -170,6 +178,39 @@ mm_plugin_is_generic (MMPlugin *self)
     return self->priv->is_generic;
 }
 
+gboolean
+mm_plugin_has_custom_init (MMPlugin *self)
+{
+    return !!self->priv->custom_init;
+}
+
+void
+mm_plugin_get_mandatory_filters (MMPlugin      *self,
+                                 GArray       **vendor_ids,
+                                 const gchar ***udev_tags,
+                                 const gchar ***drivers)
+{
+    *vendor_ids = NULL;
+    *udev_tags = (const gchar **) self->priv->udev_tags;
+    *drivers = (const gchar **) self->priv->drivers;
+
+    /* Vendor and product ID filters are only mandatory if there are no
+     * vendor/product strings that could be used instead after probing; see
+     * apply_pre_probing_filters() */
+    if ((self->priv->vendor_ids || self->priv->product_ids) &&
+        !self->priv->vendor_strings &&
+        !self->priv->product_strings &&
+        !self->priv->forbidden_product_strings) {
+        guint i;
+
+        *vendor_ids = g_array_new (FALSE, FALSE, sizeof (guint16));
+        for (i = 0; self->priv->vendor_ids && self->priv->vendor_ids[i]; i++)
+            g_array_append_val (*vendor_ids, self->priv->vendor_ids[i]);
+        for (i = 0; self->priv->product_ids && self->priv->product_ids[i].l; i++)
+            g_array_append_val (*vendor_ids, self->priv->product_ids[i].l);
+    }
+}
+
 /*****************************************************************************/
 
 static gboolean
@@ -611,6 +652,34 @@ apply_post_probing_filters (MMPlugin *self,
     return FALSE;
 }
 
+/* A device with a QMI or MBIM control port only needs one AT port. Once
+ * the port flagged as primary AT port in udev is known to be AT-capable,
+ * there's no point in waiting for AT probing to time out in the ports
+ * without any AT port type hint. */
+static void
+cancel_unneeded_at_probing (MMDevice *device)
+{
+    GList *probes;
+    GList *l;
+
+    probes = mm_device_peek_port_probe_list (device);
+    if (!mm_port_probe_list_has_qmi_port (probes) && !mm_port_probe_list_has_mbim_port (probes))
+        return;
+
+    for (l = probes; l; l = g_list_next (l)) {
+        if (mm_port_probe_maybe_at_primary (MM_PORT_PROBE (l->data)) &&
+            mm_port_probe_is_at (MM_PORT_PROBE (l->data)))
+            break;
+    }
+    if (!l)
+        return;
+
+    for (l = probes; l; l = g_list_next (l)) {
+        if (!mm_port_probe_maybe_at (MM_PORT_PROBE (l->data)))
+            mm_port_probe_run_cancel_at_probing (MM_PORT_PROBE (l->data));
+    }
+}
+
 /* Context for the asynchronous probing operation */
 typedef struct {
     MMPlugin *self;
@@ -679,7 +748,8 @@ port_probe_run_ready (MMPortProbe *probe,
                 if (l->data != probe)
                     mm_port_probe_run_cancel_at_probing (MM_PORT_PROBE (l->data));
             }
-        }
+        } else
+            cancel_unneeded_at_probing (ctx->device);
     } else
         /* Filtered by post probing filters */
         result = MM_PLUGIN_SUPPORTS_PORT_UNSUPPORTED;
@@ -845,6 +915,7 @@ mm_plugin_supports_port (MMPlugin            *self,
     mm_port_probe_run (probe,
                        ctx->flags,
                        self->priv->send_delay,
+                       self->priv->send_delay_adaptive,
                        self->priv->remove_echo,
                        self->priv->send_lf,
                        self->priv->custom_at_probe,
@@ -1224,6 +1295,10 @@ set_property (GObject *object,
         /* Construct only */
         self->priv->send_delay = (guint64)g_value_get_uint64 (value);
         break;
+    case PROP_SEND_DELAY_ADAPTIVE:
+        /* Construct only */
+        self->priv->send_delay_adaptive = g_value_get_boolean (value);
+        break;
     case PROP_REMOVE_ECHO:
         /* Construct only */
         self->priv->remove_echo = g_value_get_boolean (value);
@@ -1325,6 +1400,9 @@ get_property (GObject *object,
     case PROP_SEND_DELAY:
         g_value_set_uint64 (value, self->priv->send_delay);
         break;
+    case PROP_SEND_DELAY_ADAPTIVE:
+        g_value_set_boolean (value, self->priv->send_delay_adaptive);
+        break;
     case PROP_REMOVE_ECHO:
         g_value_set_boolean (value, self->priv->remove_echo);
         break;
@@ -1604,6 +1682,15 @@ mm_plugin_class_init (MMPluginClass *klass)
                               0, G_MAXUINT64, 100000,
                               G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
 
+    g_object_class_install_property
+        (object_class, PROP_SEND_DELAY_ADAPTIVE,
+         g_param_spec_boolean (MM_PLUGIN_SEND_DELAY_ADAPTIVE,
+                               "Send delay adaptive",
+                               "Write AT commands in a single burst while probing, "
+                               "and only apply the send delay if the device requires it",
+                               FALSE,
+                               G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
     g_object_class_install_property
         (object_class, PROP_REMOVE_ECHO,
          g_param_spec_boolean (MM_PLUGIN_REMOVE_ECHO,
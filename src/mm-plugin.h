@@ -72,6 +72,7 @@
 #define MM_PLUGIN_CUSTOM_INIT               "custom-init"
 #define MM_PLUGIN_CUSTOM_AT_PROBE           "custom-at-probe"
 #define MM_PLUGIN_SEND_DELAY                "send-delay"
+#define MM_PLUGIN_SEND_DELAY_ADAPTIVE       "send-delay-adaptive"
 #define MM_PLUGIN_REMOVE_ECHO               "remove-echo"
 #define MM_PLUGIN_SEND_LF                   "send-lf"
 
@@ -125,10 +126,20 @@ struct _MMPluginClass {
 GType mm_plugin_get_type (void);
 
 const gchar           *mm_plugin_get_name                (MMPlugin *self);
+const gchar          **mm_plugin_get_allowed_subsystems  (MMPlugin *self);
 const gchar          **mm_plugin_get_allowed_udev_tags   (MMPlugin *self);
 const guint16         *mm_plugin_get_allowed_vendor_ids  (MMPlugin *self);
 const mm_uint16_pair  *mm_plugin_get_allowed_product_ids (MMPlugin *self);
 gboolean               mm_plugin_is_generic              (MMPlugin *self);
+gboolean               mm_plugin_has_custom_init         (MMPlugin *self);
+
+/* Pre-probing filters that ports must always match to be supported by the
+ * plugin, regardless of the probing results. Each output is left NULL if the
+ * plugin doesn't have such a mandatory filter. */
+void mm_plugin_get_mandatory_filters (MMPlugin      *self,
+                                      GArray       **vendor_ids,
+                                      const gchar ***udev_tags,
+                                      const gchar ***drivers);
 
 /* This method will run all pre-probing filters, to see if we can discard this
  * plugin from the probing logic as soon as possible. */
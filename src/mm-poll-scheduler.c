@@ -0,0 +1,483 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+
+#include "mm-poll-scheduler.h"
+#include "mm-log.h"
+
+/* Polls refreshed by other means are backed off up to this many times their
+ * base interval */
+#define MAX_BACKOFF 8
+
+typedef struct {
+    guint                id;
+    gchar               *name;
+    gint64               interval_us;
+    /* When the due time was last set */
+    gint64               scheduled;
+    gint64               due;
+    MMPollSchedulerFunc  func;
+    gpointer             user_data;
+} Poll;
+
+typedef struct {
+    guint   n_runs;
+    guint   n_skipped;
+    guint   n_batched;
+    guint   n_completed;
+    gint64  last_run;
+    gint64  total_us;
+    gint64  max_us;
+
+    /* Adaptive rate, shared by all polls with the same name */
+    gint64  last_refresh;
+    guint   backoff;
+} PollStats;
+
+struct _MMPollScheduler {
+    gint64                    max_align_us;
+    gpointer                  log_object;
+    MMPollSchedulerBatchFunc  batch_func;
+    gpointer                  batch_user_data;
+    MMPollSchedulerClockFunc  clock_func;
+    gpointer                  clock_user_data;
+
+    /* Polls by id */
+    GHashTable               *polls;
+    guint                     next_id;
+
+    /* Single timer for the earliest due poll */
+    guint                     timeout_id;
+    /* How early the timer may fire */
+    gint64                    tolerance_us;
+
+    /* Statistics, by poll name */
+    GHashTable               *stats;
+    guint                     n_wakeups;
+};
+
+static void schedule_timeout (MMPollScheduler *self);
+
+/*****************************************************************************/
+
+static gint64
+get_time (MMPollScheduler *self)
+{
+    if (self->clock_func)
+        return self->clock_func (self->clock_user_data);
+    return g_get_monotonic_time ();
+}
+
+static void
+poll_free (Poll *poll)
+{
+    g_free (poll->name);
+    g_slice_free (Poll, poll);
+}
+
+static void
+poll_stats_free (PollStats *stats)
+{
+    g_slice_free (PollStats, stats);
+}
+
+static PollStats *
+peek_stats (MMPollScheduler *self,
+            const gchar     *name)
+{
+    PollStats *stats;
+
+    stats = g_hash_table_lookup (self->stats, name);
+    if (!stats) {
+        stats = g_slice_new0 (PollStats);
+        stats->backoff = 1;
+        g_hash_table_insert (self->stats, g_strdup (name), stats);
+    }
+    return stats;
+}
+
+/* Sets the next due time of the poll, aligned with the one of any other poll
+ * due close enough */
+static void
+poll_set_due (MMPollScheduler *self,
+              Poll            *poll,
+              gint64           now)
+{
+    GHashTableIter iter;
+    Poll          *other;
+    gint64         interval;
+    gint64         due;
+    gint64         window;
+    gint64         best_diff;
+
+    interval = poll->interval_us * peek_stats (self, poll->name)->backoff;
+    due = now + interval;
+    poll->scheduled = now;
+    poll->due = due;
+
+    window = MIN (self->max_align_us, interval / 4);
+    best_diff = window + 1;
+
+    g_hash_table_iter_init (&iter, self->polls);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&other)) {
+        gint64 diff;
+
+        if (other == poll || other->due <= now)
+            continue;
+        diff = ABS (other->due - due);
+        if (diff < best_diff) {
+            best_diff = diff;
+            poll->due = other->due;
+        }
+    }
+}
+
+/* Skips the poll if what it fetches was refreshed since it was scheduled,
+ * backing it off further; otherwise it goes back to its base rate */
+static gboolean
+poll_skip (MMPollScheduler *self,
+           Poll            *poll,
+           gint64           now)
+{
+    PollStats *stats;
+
+    stats = peek_stats (self, poll->name);
+    if (stats->last_refresh <= poll->scheduled) {
+        stats->backoff = 1;
+        return FALSE;
+    }
+
+    stats->n_skipped++;
+    stats->backoff = MIN (stats->backoff * 2, MAX_BACKOFF);
+    poll_set_due (self, poll, now);
+    mm_obj_dbg (self->log_object, "%s poll skipped: refreshed %.1fs ago, next one in %.1fs",
+                poll->name,
+                (gdouble) (now - stats->last_refresh) / G_USEC_PER_SEC,
+                (gdouble) (poll->due - now) / G_USEC_PER_SEC);
+    return TRUE;
+}
+
+/* Runs the polls due by now, or within the given tolerance */
+static void
+run_due (MMPollScheduler *self,
+         gint64           tolerance_us)
+{
+    GHashTableIter  iter;
+    Poll           *poll;
+    GArray         *due;
+    gint64          now;
+    gboolean        batch;
+    guint           i;
+
+    now = get_time (self);
+
+    due = g_array_new (FALSE, FALSE, sizeof (guint));
+    g_hash_table_iter_init (&iter, self->polls);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&poll)) {
+        if (poll->due <= now + tolerance_us)
+            g_array_append_val (due, poll->id);
+    }
+
+    if (due->len > 0)
+        self->n_wakeups++;
+
+    /* Rescheduling skipped polls doesn't add or remove any other poll */
+    for (i = 0; i < due->len; ) {
+        poll = g_hash_table_lookup (self->polls, GUINT_TO_POINTER (g_array_index (due, guint, i)));
+        if (poll_skip (self, poll, now))
+            g_array_remove_index (due, i);
+        else
+            i++;
+    }
+
+    /* Polls may add or remove other polls, so always look them up again */
+    batch = (due->len > 1 && self->batch_func);
+    if (batch)
+        self->batch_func (TRUE, self->batch_user_data);
+    for (i = 0; i < due->len; i++) {
+        PollStats *stats;
+        guint      id;
+
+        id = g_array_index (due, guint, i);
+        poll = g_hash_table_lookup (self->polls, GUINT_TO_POINTER (id));
+        if (!poll)
+            continue;
+
+        stats = peek_stats (self, poll->name);
+        stats->n_runs++;
+        if (due->len > 1)
+            stats->n_batched++;
+        stats->last_run = now;
+
+        if (poll->func (poll->user_data) == G_SOURCE_REMOVE) {
+            g_hash_table_remove (self->polls, GUINT_TO_POINTER (id));
+            continue;
+        }
+
+        poll = g_hash_table_lookup (self->polls, GUINT_TO_POINTER (id));
+        if (poll)
+            poll_set_due (self, poll, now);
+    }
+    if (batch)
+        self->batch_func (FALSE, self->batch_user_data);
+
+    g_array_unref (due);
+
+    schedule_timeout (self);
+}
+
+static gboolean
+timeout_cb (MMPollScheduler *self)
+{
+    self->timeout_id = 0;
+    run_due (self, self->tolerance_us);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+schedule_timeout (MMPollScheduler *self)
+{
+    GHashTableIter  iter;
+    Poll           *poll;
+    gint64          earliest = G_MAXINT64;
+    gint64          delay;
+
+    if (self->timeout_id) {
+        g_source_remove (self->timeout_id);
+        self->timeout_id = 0;
+    }
+
+    g_hash_table_iter_init (&iter, self->polls);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&poll))
+        earliest = MIN (earliest, poll->due);
+    if (earliest == G_MAXINT64)
+        return;
+
+    delay = MAX (earliest - get_time (self), 0);
+
+    /* Timeouts in seconds share the wakeups with the rest of the system, but
+     * may fire up to a second early */
+    if (delay >= G_USEC_PER_SEC) {
+        self->tolerance_us = G_USEC_PER_SEC;
+        self->timeout_id = g_timeout_add_seconds ((guint) ((delay + G_USEC_PER_SEC / 2) / G_USEC_PER_SEC),
+                                                  (GSourceFunc) timeout_cb,
+                                                  self);
+    } else {
+        self->tolerance_us = 1000;
+        self->timeout_id = g_timeout_add ((guint) ((delay + 999) / 1000),
+                                          (GSourceFunc) timeout_cb,
+                                          self);
+    }
+}
+
+/*****************************************************************************/
+
+guint
+mm_poll_scheduler_add (MMPollScheduler     *self,
+                       const gchar         *name,
+                       guint                interval_ms,
+                       MMPollSchedulerFunc  func,
+                       gpointer             user_data)
+{
+    Poll *poll;
+
+    g_return_val_if_fail (name && func, 0);
+
+    poll = g_slice_new0 (Poll);
+    poll->id = self->next_id++;
+    if (!self->next_id)
+        self->next_id = 1;
+    poll->name = g_strdup (name);
+    poll->interval_us = (gint64) interval_ms * 1000;
+    poll->func = func;
+    poll->user_data = user_data;
+    poll_set_due (self, poll, get_time (self));
+
+    g_hash_table_insert (self->polls, GUINT_TO_POINTER (poll->id), poll);
+    schedule_timeout (self);
+    return poll->id;
+}
+
+void
+mm_poll_scheduler_remove (MMPollScheduler *self,
+                          guint            id)
+{
+    if (!self || !id)
+        return;
+
+    if (g_hash_table_remove (self->polls, GUINT_TO_POINTER (id)))
+        schedule_timeout (self);
+}
+
+void
+mm_poll_scheduler_refreshed (MMPollScheduler *self,
+                             const gchar     *name)
+{
+    PollStats *stats;
+
+    if (!self)
+        return;
+
+    stats = g_hash_table_lookup (self->stats, name);
+    if (stats)
+        stats->last_refresh = get_time (self);
+}
+
+void
+mm_poll_scheduler_complete (MMPollScheduler *self,
+                            const gchar     *name)
+{
+    PollStats *stats;
+    gint64     elapsed;
+
+    if (!self)
+        return;
+
+    stats = g_hash_table_lookup (self->stats, name);
+    if (!stats || !stats->last_run)
+        return;
+
+    elapsed = get_time (self) - stats->last_run;
+    stats->last_run = 0;
+    stats->n_completed++;
+    stats->total_us += elapsed;
+    stats->max_us = MAX (stats->max_us, elapsed);
+    mm_obj_dbg (self->log_object, "%s poll took %.3fs", name, (gdouble) elapsed / G_USEC_PER_SEC);
+}
+
+/*****************************************************************************/
+
+guint
+mm_poll_scheduler_get_n_wakeups (MMPollScheduler *self)
+{
+    return self->n_wakeups;
+}
+
+guint
+mm_poll_scheduler_get_n_runs (MMPollScheduler *self,
+                              const gchar     *name)
+{
+    PollStats *stats;
+
+    stats = g_hash_table_lookup (self->stats, name);
+    return stats ? stats->n_runs : 0;
+}
+
+guint
+mm_poll_scheduler_get_n_skipped (MMPollScheduler *self,
+                                 const gchar     *name)
+{
+    PollStats *stats;
+
+    stats = g_hash_table_lookup (self->stats, name);
+    return stats ? stats->n_skipped : 0;
+}
+
+guint
+mm_poll_scheduler_get_n_batched (MMPollScheduler *self,
+                                 const gchar     *name)
+{
+    PollStats *stats;
+
+    stats = g_hash_table_lookup (self->stats, name);
+    return stats ? stats->n_batched : 0;
+}
+
+gchar *
+mm_poll_scheduler_build_stats (MMPollScheduler *self)
+{
+    g_autoptr(GString)  polls = NULL;
+    g_autofree gchar  **names = NULL;
+    guint               n_names;
+    guint               n_runs = 0;
+    guint               n_skipped = 0;
+    guint               i;
+
+    polls = g_string_new (NULL);
+    names = (gchar **) g_hash_table_get_keys_as_array (self->stats, &n_names);
+    for (i = 0; i < n_names; i++) {
+        PollStats *stats;
+
+        stats = g_hash_table_lookup (self->stats, names[i]);
+        n_runs += stats->n_runs;
+        n_skipped += stats->n_skipped;
+        g_string_append_printf (polls, "; %s: %u runs, %u skipped, %u batched",
+                                names[i], stats->n_runs, stats->n_skipped, stats->n_batched);
+        if (stats->n_completed)
+            g_string_append_printf (polls, ", avg %.3fs, max %.3fs",
+                                    (gdouble) stats->total_us / stats->n_completed / G_USEC_PER_SEC,
+                                    (gdouble) stats->max_us / G_USEC_PER_SEC);
+    }
+
+    return g_strdup_printf ("%u wakeups, %u polls run, %u skipped%s",
+                            self->n_wakeups, n_runs, n_skipped, polls->str);
+}
+
+/*****************************************************************************/
+
+void
+mm_poll_scheduler_set_batch_func (MMPollScheduler          *self,
+                                  MMPollSchedulerBatchFunc  func,
+                                  gpointer                  user_data)
+{
+    self->batch_func = func;
+    self->batch_user_data = user_data;
+}
+
+void
+mm_poll_scheduler_set_clock (MMPollScheduler          *self,
+                             MMPollSchedulerClockFunc  func,
+                             gpointer                  user_data)
+{
+    self->clock_func = func;
+    self->clock_user_data = user_data;
+}
+
+void
+mm_poll_scheduler_run_due (MMPollScheduler *self)
+{
+    run_due (self, 0);
+}
+
+MMPollScheduler *
+mm_poll_scheduler_new (guint    max_align_ms,
+                       gpointer log_object)
+{
+    MMPollScheduler *self;
+
+    self = g_slice_new0 (MMPollScheduler);
+    self->max_align_us = (gint64) max_align_ms * 1000;
+    self->log_object = log_object;
+    self->next_id = 1;
+    self->polls = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) poll_free);
+    self->stats = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) poll_stats_free);
+    return self;
+}
+
+void
+mm_poll_scheduler_free (MMPollScheduler *self)
+{
+    if (self->n_wakeups) {
+        g_autofree gchar *stats = NULL;
+
+        stats = mm_poll_scheduler_build_stats (self);
+        mm_obj_dbg (self->log_object, "poll scheduler stats: %s", stats);
+    }
+
+    if (self->timeout_id)
+        g_source_remove (self->timeout_id);
+    g_hash_table_unref (self->polls);
+    g_hash_table_unref (self->stats);
+    g_slice_free (MMPollScheduler, self);
+}
@@ -0,0 +1,98 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_POLL_SCHEDULER_H
+#define MM_POLL_SCHEDULER_H
+
+#include <glib.h>
+
+/*
+ * Per-modem scheduler of periodic checks.
+ *
+ * Polls are added with the same semantics as g_timeout_add(), but all of
+ * them share a single timer. When a poll is scheduled, its due time is
+ * aligned with the one of any other poll due close enough (within a quarter
+ * of its interval, and never more than the maximum alignment given), so
+ * that polls end up running together in a single wakeup.
+ *
+ * When more than one poll runs in the same wakeup, the batch function, if
+ * any, is called right before and right after running them, so that the
+ * commands they issue may be merged.
+ *
+ * Polls may report when the operation they launched is over, so that the
+ * time it took is accounted as the cost of the poll.
+ *
+ * Polls also adapt their rate to unsolicited updates: when what a poll
+ * fetches is reported as refreshed by other means (e.g. indications) since
+ * the poll was scheduled, the poll is skipped and its interval doubled, up
+ * to 8 times the base one. It is back to the base rate as soon as a run is
+ * due without any refresh in between.
+ */
+
+typedef struct _MMPollScheduler MMPollScheduler;
+
+/* Same semantics as a GSourceFunc: G_SOURCE_CONTINUE to run again after the
+ * same interval, G_SOURCE_REMOVE otherwise */
+typedef gboolean (* MMPollSchedulerFunc)      (gpointer user_data);
+typedef void     (* MMPollSchedulerBatchFunc) (gboolean begin,
+                                               gpointer user_data);
+
+MMPollScheduler *mm_poll_scheduler_new  (guint                     max_align_ms,
+                                         gpointer                  log_object);
+void             mm_poll_scheduler_free (MMPollScheduler          *self);
+
+void             mm_poll_scheduler_set_batch_func (MMPollScheduler          *self,
+                                                   MMPollSchedulerBatchFunc  func,
+                                                   gpointer                  user_data);
+
+/* Returns the poll id, never 0 */
+guint            mm_poll_scheduler_add    (MMPollScheduler     *self,
+                                           const gchar         *name,
+                                           guint                interval_ms,
+                                           MMPollSchedulerFunc  func,
+                                           gpointer             user_data);
+/* A NULL scheduler is accepted, as it may already be gone when the polls
+ * of a modem are removed during its finalization */
+void             mm_poll_scheduler_remove (MMPollScheduler     *self,
+                                           guint                id);
+
+/* Reports that what the polls with the given name fetch was just refreshed
+ * by other means; ignored if no such poll was ever added */
+void             mm_poll_scheduler_refreshed (MMPollScheduler  *self,
+                                              const gchar      *name);
+
+/* Accounts the time since the poll with the given name last ran */
+void             mm_poll_scheduler_complete (MMPollScheduler   *self,
+                                             const gchar       *name);
+
+/* Statistics */
+guint            mm_poll_scheduler_get_n_wakeups (MMPollScheduler *self);
+guint            mm_poll_scheduler_get_n_runs    (MMPollScheduler *self,
+                                                  const gchar     *name);
+guint            mm_poll_scheduler_get_n_skipped (MMPollScheduler *self,
+                                                  const gchar     *name);
+guint            mm_poll_scheduler_get_n_batched (MMPollScheduler *self,
+                                                  const gchar     *name);
+gchar           *mm_poll_scheduler_build_stats   (MMPollScheduler *self);
+
+/* For testing purposes: the clock is g_get_monotonic_time() unless another
+ * one is given, and polls due by the current time may be run right away, as
+ * if the timer had just fired on time */
+typedef gint64 (* MMPollSchedulerClockFunc) (gpointer user_data);
+
+void             mm_poll_scheduler_set_clock   (MMPollScheduler          *self,
+                                                MMPollSchedulerClockFunc  func,
+                                                gpointer                  user_data);
+void             mm_poll_scheduler_run_due     (MMPollScheduler          *self);
+
+#endif /* MM_POLL_SCHEDULER_H */
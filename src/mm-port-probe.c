@@ -77,6 +77,10 @@ enum {
 
 static GParamSpec *properties[PROP_LAST];
 
+/* Number of MMPortProbeFlag values */
+#define PROBING_N_FLAGS 8
+G_STATIC_ASSERT (MM_PORT_PROBE_MBIM == 1 << (PROBING_N_FLAGS - 1));
+
 struct _MMPortProbePrivate {
     /* Properties */
     MMDevice *device;
@@ -102,10 +106,73 @@ struct _MMPortProbePrivate {
     gboolean maybe_at_ppp;
     gboolean maybe_qcdm;
 
+    /* Time spent in each probing, in microseconds, indexed by flag bit.
+     * Accumulated across all the probing tasks run. */
+    gint64 probing_started[PROBING_N_FLAGS];
+    gint64 probing_time[PROBING_N_FLAGS];
+
     /* Current probing task. Only one can be available at a time */
     GTask *task;
 };
 
+/*****************************************************************************/
+/* Probing time */
+
+static void
+port_probe_timing_start (MMPortProbe     *self,
+                         MMPortProbeFlag  flag)
+{
+    guint i;
+
+    i = g_bit_nth_lsf (flag, -1);
+    if (!self->priv->probing_started[i])
+        self->priv->probing_started[i] = g_get_monotonic_time ();
+}
+
+static void
+port_probe_timing_stop (MMPortProbe     *self,
+                        MMPortProbeFlag  flag)
+{
+    guint i;
+
+    i = g_bit_nth_lsf (flag, -1);
+    if (self->priv->probing_started[i]) {
+        self->priv->probing_time[i] += g_get_monotonic_time () - self->priv->probing_started[i];
+        self->priv->probing_started[i] = 0;
+    }
+}
+
+static void
+port_probe_log_timing (MMPortProbe *self)
+{
+    GString *str = NULL;
+    gint64   total = 0;
+    guint    i;
+
+    for (i = 0; i < PROBING_N_FLAGS; i++) {
+        gchar *flag_str;
+
+        /* Probings interrupted (e.g. cancelled) also took their time */
+        port_probe_timing_stop (self, 1 << i);
+        if (!self->priv->probing_time[i])
+            continue;
+
+        if (!str)
+            str = g_string_new (NULL);
+        else
+            g_string_append (str, ", ");
+        flag_str = mm_port_probe_flag_build_string_from_mask (1 << i);
+        g_string_append_printf (str, "%s %.3fs", flag_str, (gdouble) self->priv->probing_time[i] / G_USEC_PER_SEC);
+        g_free (flag_str);
+        total += self->priv->probing_time[i];
+    }
+
+    if (str) {
+        mm_obj_dbg (self, "port probing time: %.3fs (%s)", (gdouble) total / G_USEC_PER_SEC, str->str);
+        g_string_free (str, TRUE);
+    }
+}
+
 /*****************************************************************************/
 /* Probe task completions.
  * Always make sure that the stored task is NULL when the task is completed.
@@ -120,6 +187,7 @@ port_probe_task_return_error_if_cancelled (MMPortProbe *self)
     self->priv->task = NULL;
 
     if (g_task_return_error_if_cancelled (task)) {
+        port_probe_log_timing (self);
         g_object_unref (task);
         return TRUE;
     }
@@ -134,6 +202,8 @@ port_probe_task_return_error (MMPortProbe *self,
 {
     GTask *task;
 
+    port_probe_log_timing (self);
+
     task = self->priv->task;
     self->priv->task = NULL;
     g_task_return_error (task, error);
@@ -146,6 +216,8 @@ port_probe_task_return_boolean (MMPortProbe *self,
 {
     GTask *task;
 
+    port_probe_log_timing (self);
+
     task = self->priv->task;
     self->priv->task = NULL;
     g_task_return_boolean (task, result);
@@ -158,6 +230,8 @@ void
 mm_port_probe_set_result_at (MMPortProbe *self,
                              gboolean at)
 {
+    port_probe_timing_stop (self, MM_PORT_PROBE_AT);
+
     self->priv->is_at = at;
     self->priv->flags |= MM_PORT_PROBE_AT;
 
@@ -186,6 +260,8 @@ void
 mm_port_probe_set_result_at_vendor (MMPortProbe *self,
                                     const gchar *at_vendor)
 {
+    port_probe_timing_stop (self, MM_PORT_PROBE_AT_VENDOR);
+
     if (at_vendor) {
         mm_obj_dbg (self, "vendor probing finished");
         self->priv->vendor = g_utf8_casefold (at_vendor, -1);
@@ -202,6 +278,8 @@ void
 mm_port_probe_set_result_at_product (MMPortProbe *self,
                                      const gchar *at_product)
 {
+    port_probe_timing_stop (self, MM_PORT_PROBE_AT_PRODUCT);
+
     if (at_product) {
         mm_obj_dbg (self, "product probing finished");
         self->priv->product = g_utf8_casefold (at_product, -1);
@@ -217,6 +295,8 @@ void
 mm_port_probe_set_result_at_icera (MMPortProbe *self,
                                    gboolean is_icera)
 {
+    port_probe_timing_stop (self, MM_PORT_PROBE_AT_ICERA);
+
     if (is_icera) {
         mm_obj_dbg (self, "modem is Icera-based");
         self->priv->is_icera = TRUE;
@@ -232,6 +312,8 @@ void
 mm_port_probe_set_result_at_xmm (MMPortProbe *self,
                                  gboolean is_xmm)
 {
+    port_probe_timing_stop (self, MM_PORT_PROBE_AT_XMM);
+
     if (is_xmm) {
         mm_obj_dbg (self, "modem is XMM-based");
         self->priv->is_xmm = TRUE;
@@ -247,6 +329,8 @@ void
 mm_port_probe_set_result_qcdm (MMPortProbe *self,
                                gboolean qcdm)
 {
+    port_probe_timing_stop (self, MM_PORT_PROBE_QCDM);
+
     self->priv->is_qcdm = qcdm;
     self->priv->flags |= MM_PORT_PROBE_QCDM;
 
@@ -276,6 +360,8 @@ void
 mm_port_probe_set_result_qmi (MMPortProbe *self,
                               gboolean qmi)
 {
+    port_probe_timing_stop (self, MM_PORT_PROBE_QMI);
+
     self->priv->is_qmi = qmi;
     self->priv->flags |= MM_PORT_PROBE_QMI;
 
@@ -303,6 +389,8 @@ void
 mm_port_probe_set_result_mbim (MMPortProbe *self,
                                gboolean mbim)
 {
+    port_probe_timing_stop (self, MM_PORT_PROBE_MBIM);
+
     self->priv->is_mbim = mbim;
     self->priv->flags |= MM_PORT_PROBE_MBIM;
 
@@ -345,6 +433,8 @@ typedef struct {
     gulong at_probing_cancellable_linked;
     /* Send delay for AT commands */
     guint64 at_send_delay;
+    /* Flag to write AT commands in a single burst when possible */
+    gboolean at_send_delay_adaptive;
     /* Flag to leave/remove echo in AT responses */
     gboolean at_remove_echo;
     /* Flag to send line-feed at the end of AT commands */
@@ -488,6 +578,8 @@ wdm_probe_qmi (MMPortProbe *self)
     g_assert (self->priv->task);
     ctx = g_task_get_task_data (self->priv->task);
 
+    port_probe_timing_start (self, MM_PORT_PROBE_QMI);
+
 #if defined WITH_QMI
     mm_obj_dbg (self, "probing QMI...");
 
@@ -560,6 +652,8 @@ wdm_probe_mbim (MMPortProbe *self)
     g_assert (self->priv->task);
     ctx = g_task_get_task_data (self->priv->task);
 
+    port_probe_timing_start (self, MM_PORT_PROBE_MBIM);
+
 #if defined WITH_MBIM
     mm_obj_dbg (self, "probing MBIM...");
 
@@ -619,6 +713,11 @@ common_serial_port_setup (MMPortProbe  *self,
 {
     const gchar *flow_control_tag;
 
+    /* Needed to share the send pacing results with the modem ports */
+    g_object_set (serial,
+                  MM_PORT_KERNEL_DEVICE, self->priv->port,
+                  NULL);
+
     if (mm_kernel_device_has_property (self->priv->port, ID_MM_TTY_BAUDRATE))
         g_object_set (serial,
                       MM_PORT_SERIAL_BAUD, mm_kernel_device_get_property_as_int (self->priv->port, ID_MM_TTY_BAUDRATE),
@@ -730,6 +829,7 @@ serial_probe_qcdm (MMPortProbe *self)
         return G_SOURCE_REMOVE;
 
     mm_obj_dbg (self, "probing QCDM...");
+    port_probe_timing_start (self, MM_PORT_PROBE_QCDM);
 
     /* If open, close the AT port */
     if (ctx->serial) {
@@ -1153,6 +1253,7 @@ serial_probe_schedule (MMPortProbe *self)
         else
             ctx->at_commands = at_probing;
         ctx->at_result_processor = serial_probe_at_result_processor;
+        port_probe_timing_start (self, MM_PORT_PROBE_AT);
     }
     /* Vendor requested and not already probed? */
     else if ((ctx->flags & MM_PORT_PROBE_AT_VENDOR) &&
@@ -1160,6 +1261,7 @@ serial_probe_schedule (MMPortProbe *self)
         /* Prepare AT vendor probing */
         ctx->at_result_processor = serial_probe_at_vendor_result_processor;
         ctx->at_commands = vendor_probing;
+        port_probe_timing_start (self, MM_PORT_PROBE_AT_VENDOR);
     }
     /* Product requested and not already probed? */
     else if ((ctx->flags & MM_PORT_PROBE_AT_PRODUCT) &&
@@ -1167,6 +1269,7 @@ serial_probe_schedule (MMPortProbe *self)
         /* Prepare AT product probing */
         ctx->at_result_processor = serial_probe_at_product_result_processor;
         ctx->at_commands = product_probing;
+        port_probe_timing_start (self, MM_PORT_PROBE_AT_PRODUCT);
     }
     /* Icera support check requested and not already done? */
     else if ((ctx->flags & MM_PORT_PROBE_AT_ICERA) &&
@@ -1174,6 +1277,7 @@ serial_probe_schedule (MMPortProbe *self)
         /* Prepare AT product probing */
         ctx->at_result_processor = serial_probe_at_icera_result_processor;
         ctx->at_commands = icera_probing;
+        port_probe_timing_start (self, MM_PORT_PROBE_AT_ICERA);
         /* By default, wait 2 seconds between ICERA probing retries */
         ctx->at_commands_wait_secs = 2;
     }
@@ -1183,6 +1287,7 @@ serial_probe_schedule (MMPortProbe *self)
         /* Prepare AT product probing */
         ctx->at_result_processor = serial_probe_at_xmm_result_processor;
         ctx->at_commands = xmm_probing;
+        port_probe_timing_start (self, MM_PORT_PROBE_AT_XMM);
     }
 
     /* If a next AT group detected, go for it */
@@ -1215,13 +1320,16 @@ serial_flash_ready (MMPortSerial *port,
 }
 
 static void
-serial_buffer_full (MMPortSerial *serial,
-                    GByteArray   *buffer,
-                    MMPortProbe  *self)
+serial_buffer_full (MMPortSerial   *serial,
+                    MMSerialBuffer *buffer,
+                    MMPortProbe    *self)
 {
     PortProbeRunContext *ctx;
+    const guint8        *data;
+    gsize                len;
 
-    if (!is_non_at_response (buffer->data, buffer->len))
+    data = mm_serial_buffer_peek (buffer, &len);
+    if (!is_non_at_response (data, len))
         return;
 
     g_assert (self->priv->task);
@@ -1285,10 +1393,11 @@ serial_open_at (MMPortProbe *self)
         }
 
         g_object_set (ctx->serial,
-                      MM_PORT_SERIAL_SPEW_CONTROL,   TRUE,
-                      MM_PORT_SERIAL_SEND_DELAY,     (guint64)(subsys == MM_PORT_SUBSYS_TTY ? ctx->at_send_delay : 0),
-                      MM_PORT_SERIAL_AT_REMOVE_ECHO, ctx->at_remove_echo,
-                      MM_PORT_SERIAL_AT_SEND_LF,     ctx->at_send_lf,
+                      MM_PORT_SERIAL_SPEW_CONTROL,        TRUE,
+                      MM_PORT_SERIAL_SEND_DELAY,          (guint64)(subsys == MM_PORT_SUBSYS_TTY ? ctx->at_send_delay : 0),
+                      MM_PORT_SERIAL_SEND_DELAY_ADAPTIVE, ctx->at_send_delay_adaptive,
+                      MM_PORT_SERIAL_AT_REMOVE_ECHO,      ctx->at_remove_echo,
+                      MM_PORT_SERIAL_AT_SEND_LF,          ctx->at_send_lf,
                       NULL);
 
         common_serial_port_setup (self, ctx->serial);
@@ -1297,10 +1406,11 @@ serial_open_at (MMPortProbe *self)
         mm_serial_parser_v1_add_filter (parser,
                                         serial_parser_filter_cb,
                                         NULL);
-        mm_port_serial_at_set_response_parser (MM_PORT_SERIAL_AT (ctx->serial),
-                                               mm_serial_parser_v1_parse,
-                                               parser,
-                                               mm_serial_parser_v1_destroy);
+        mm_port_serial_at_set_response_parser_full (MM_PORT_SERIAL_AT (ctx->serial),
+                                                    mm_serial_parser_v1_parse,
+                                                    mm_serial_parser_v1_check_line,
+                                                    parser,
+                                                    mm_serial_parser_v1_destroy);
     }
 
     /* Try to open the port */
@@ -1367,7 +1477,7 @@ mm_port_probe_run_cancel_at_probing (MMPortProbe *self)
         return FALSE;
 
     ctx = g_task_get_task_data (self->priv->task);
-    if (g_cancellable_is_cancelled (ctx->at_probing_cancellable))
+    if (!ctx->at_probing_cancellable || g_cancellable_is_cancelled (ctx->at_probing_cancellable))
         return FALSE;
 
     mm_obj_dbg (self, "requested to cancel all AT probing");
@@ -1390,6 +1500,7 @@ void
 mm_port_probe_run (MMPortProbe                *self,
                    MMPortProbeFlag             flags,
                    guint64                     at_send_delay,
+                   gboolean                    at_send_delay_adaptive,
                    gboolean                    at_remove_echo,
                    gboolean                    at_send_lf,
                    const MMPortProbeAtCommand *at_custom_probe,
@@ -1413,6 +1524,7 @@ mm_port_probe_run (MMPortProbe                *self,
     /* Task context */
     ctx = g_slice_new0 (PortProbeRunContext);
     ctx->at_send_delay = at_send_delay;
+    ctx->at_send_delay_adaptive = at_send_delay_adaptive;
     ctx->at_remove_echo = at_remove_echo;
     ctx->at_send_lf = at_send_lf;
     ctx->flags = MM_PORT_PROBE_NONE;
@@ -1490,6 +1602,9 @@ mm_port_probe_run (MMPortProbe                *self,
                                                                         (GCallback) at_cancellable_cancel,
                                                                         ctx,
                                                                         NULL);
+        /* Time opening the port counts as AT probing time */
+        if (ctx->flags & MM_PORT_PROBE_AT)
+            port_probe_timing_start (self, MM_PORT_PROBE_AT);
         ctx->source_id = g_idle_add ((GSourceFunc) serial_open_at, self);
         return;
     }
@@ -1800,6 +1915,22 @@ mm_port_probe_list_is_xmm (GList *probes)
     return FALSE;
 }
 
+gboolean
+mm_port_probe_maybe_at (MMPortProbe *self)
+{
+    g_return_val_if_fail (MM_IS_PORT_PROBE (self), FALSE);
+
+    return (self->priv->maybe_at_primary || self->priv->maybe_at_secondary || self->priv->maybe_at_ppp);
+}
+
+gboolean
+mm_port_probe_maybe_at_primary (MMPortProbe *self)
+{
+    g_return_val_if_fail (MM_IS_PORT_PROBE (self), FALSE);
+
+    return self->priv->maybe_at_primary;
+}
+
 gboolean
 mm_port_probe_is_ignored (MMPortProbe *self)
 {
@@ -1808,6 +1939,14 @@ mm_port_probe_is_ignored (MMPortProbe *self)
     return self->priv->is_ignored;
 }
 
+MMPortProbeFlag
+mm_port_probe_get_probed_flags (MMPortProbe *self)
+{
+    g_return_val_if_fail (MM_IS_PORT_PROBE (self), MM_PORT_PROBE_NONE);
+
+    return (MMPortProbeFlag) self->priv->flags;
+}
+
 const gchar *
 mm_port_probe_get_port_name (MMPortProbe *self)
 {
@@ -112,6 +112,7 @@ void mm_port_probe_set_result_mbim       (MMPortProbe *self,
 void     mm_port_probe_run        (MMPortProbe *self,
                                    MMPortProbeFlag flags,
                                    guint64 at_send_delay,
+                                   gboolean at_send_delay_adaptive,
                                    gboolean at_remove_echo,
                                    gboolean at_send_lf,
                                    const MMPortProbeAtCommand *at_custom_probe,
@@ -137,6 +138,13 @@ gboolean      mm_port_probe_is_icera         (MMPortProbe *self);
 gboolean      mm_port_probe_is_xmm           (MMPortProbe *self);
 gboolean      mm_port_probe_is_ignored       (MMPortProbe *self);
 
+/* Port type hints given in udev tags */
+gboolean      mm_port_probe_maybe_at         (MMPortProbe *self);
+gboolean      mm_port_probe_maybe_at_primary (MMPortProbe *self);
+
+/* Mask of the probings for which results are available */
+MMPortProbeFlag mm_port_probe_get_probed_flags (MMPortProbe *self);
+
 /* Additional helpers */
 gboolean mm_port_probe_list_has_at_port   (GList *list);
 gboolean mm_port_probe_list_has_qmi_port  (GList *list);
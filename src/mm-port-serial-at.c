@@ -22,7 +22,9 @@
 #include <string.h>
 
 #include "mm-port-serial-at.h"
+#include "mm-modem-helpers.h"
 #include "mm-log-object.h"
+#include "mm-trace.h"
 
 G_DEFINE_TYPE (MMPortSerialAt, mm_port_serial_at, MM_TYPE_PORT_SERIAL)
 
@@ -38,13 +40,36 @@ enum {
 struct _MMPortSerialAtPrivate {
     /* Response parser data */
     MMPortSerialAtResponseParserFn response_parser_fn;
+    MMPortSerialAtResponseLineFn response_parser_line_fn;
     gpointer response_parser_user_data;
     GDestroyNotify response_parser_notify;
 
+    /* Incremental parsing state, valid as long as no data is removed from the
+     * response buffer; offsets are relative to the start of unparsed data */
+    guint scan_generation;
+    /* Amount of data already looked at */
+    gsize scan_len;
+    /* Start of the first line not yet complete */
+    gsize scan_line_start;
+    /* Where unsolicited message handlers start looking for matches */
+    gsize scan_unsolicited_start;
+    /* Whether any line received may complete the response */
+    gboolean scan_response_ready;
+
     GSList *unsolicited_msg_handlers;
+    /* Handlers with a literal prefix, indexed by its first byte */
+    GHashTable *unsolicited_msg_index;
+    guint unsolicited_msg_scan_id;
 
     MMPortSerialAtFlag flags;
 
+    /* Batch window, see mm_port_serial_at_batch_begin() */
+    guint batch_depth;
+    GQueue *batch_pending;
+    /* Commands that failed when retried alone after a batch failure */
+    GHashTable *batch_failing;
+    gboolean batch_disabled;
+
     /* Properties */
     gboolean remove_echo;
     guint init_sequence_enabled;
@@ -81,10 +106,11 @@ mm_port_serial_at_quote_string (const char *string)
 }
 
 void
-mm_port_serial_at_set_response_parser (MMPortSerialAt *self,
-                                       MMPortSerialAtResponseParserFn fn,
-                                       gpointer user_data,
-                                       GDestroyNotify notify)
+mm_port_serial_at_set_response_parser_full (MMPortSerialAt *self,
+                                            MMPortSerialAtResponseParserFn fn,
+                                            MMPortSerialAtResponseLineFn line_fn,
+                                            gpointer user_data,
+                                            GDestroyNotify notify)
 {
     g_return_if_fail (MM_IS_PORT_SERIAL_AT (self));
 
@@ -92,37 +118,208 @@ mm_port_serial_at_set_response_parser (MMPortSerialAt *self,
         self->priv->response_parser_notify (self->priv->response_parser_user_data);
 
     self->priv->response_parser_fn = fn;
+    self->priv->response_parser_line_fn = line_fn;
     self->priv->response_parser_user_data = user_data;
     self->priv->response_parser_notify = notify;
+
+    /* Lines already seen must be checked again by the new parser */
+    self->priv->scan_generation = 0;
+}
+
+void
+mm_port_serial_at_set_response_parser (MMPortSerialAt *self,
+                                       MMPortSerialAtResponseParserFn fn,
+                                       gpointer user_data,
+                                       GDestroyNotify notify)
+{
+    mm_port_serial_at_set_response_parser_full (self, fn, NULL, user_data, notify);
 }
 
 void
-mm_port_serial_at_remove_echo (GByteArray *response)
+mm_port_serial_at_remove_echo (MMSerialBuffer *response)
 {
-    guint i;
+    const guint8 *data;
+    gsize         len;
+    gsize         i;
 
-    if (response->len <= 2)
+    data = mm_serial_buffer_peek (response, &len);
+    if (len <= 2)
         return;
 
-    for (i = 0; i < (response->len - 1); i++) {
+    for (i = 0; i < (len - 1); i++) {
         /* If there is any content before the first
          * <CR><LF>, assume it's echo or garbage, and skip it */
-        if (response->data[i] == '\r' && response->data[i + 1] == '\n') {
+        if (data[i] == '\r' && data[i + 1] == '\n') {
             if (i > 0)
-                g_byte_array_remove_range (response, 0, i);
+                mm_serial_buffer_consume (response, i);
             /* else, good, we're already started with <CR><LF> */
             break;
         }
     }
 }
 
+static MMTraceSpan
+trace_command (MMPortSerial     *port,
+               const GByteArray *command)
+{
+    MMTraceSpan       span;
+    g_autofree gchar *line = NULL;
+    g_autofree gchar *prefix = NULL;
+    g_autofree gchar *name = NULL;
+
+    /* Raw data, e.g. a PDU after the prompt, isn't traced on its own */
+    line = g_strndup ((const gchar *)command->data, command->len);
+    if (g_ascii_strncasecmp (line, "AT", 2) != 0)
+        return 0;
+
+    /* Only the command prefix is kept, arguments may be private */
+    prefix = mm_at_command_get_prefix (line);
+    name = g_strndup (prefix, strcspn (prefix, "=?"));
+    span = mm_trace_begin (port, "at", name);
+    mm_trace_set_port (span, mm_port_get_device (MM_PORT (port)));
+    mm_trace_set_command (span, prefix);
+    return span;
+}
+
+static MMPortSerialEchoResult
+check_echo (MMPortSerial     *port,
+            const GByteArray *command,
+            const guint8     *data,
+            gsize             len)
+{
+    gsize cmd_len;
+    gsize i;
+
+    /* Compare with the command without trailing <CR>, <LF> or <Ctrl-Z> */
+    cmd_len = command->len;
+    while (cmd_len > 0 && command->data[cmd_len - 1] < 0x20)
+        cmd_len--;
+    if (!cmd_len)
+        return MM_PORT_SERIAL_ECHO_VALID;
+
+    if (!len)
+        return MM_PORT_SERIAL_ECHO_UNKNOWN;
+
+    /* If the reply doesn't start with the echo, it's likely disabled */
+    if (data[0] == '\r' || data[0] == '\n')
+        return MM_PORT_SERIAL_ECHO_VALID;
+
+    for (i = 0; i < len && data[i] != '\r'; i++) {
+        if (i >= cmd_len || data[i] != command->data[i])
+            return MM_PORT_SERIAL_ECHO_CORRUPTED;
+    }
+
+    /* Echo not fully received yet */
+    if (i == len)
+        return MM_PORT_SERIAL_ECHO_UNKNOWN;
+
+    return (i == cmd_len ? MM_PORT_SERIAL_ECHO_VALID : MM_PORT_SERIAL_ECHO_CORRUPTED);
+}
+
+/*****************************************************************************/
+/* Incremental parsing
+ *
+ * Slow multi-line replies arrive in many reads, and looking at the whole
+ * response buffer on every read makes their processing quadratic in their
+ * size. Instead, only the data received since the last read is scanned for
+ * line ends; each newly completed line is then checked for unsolicited
+ * messages and given to the response line checker, and the full buffer is
+ * only given to the response parser once a line that may complete the
+ * response has been received.
+ */
+
+static void
+scan_state_sync (MMPortSerialAt *self,
+                 MMSerialBuffer *response)
+{
+    guint generation;
+
+    generation = mm_serial_buffer_get_generation (response);
+    if (generation == self->priv->scan_generation)
+        return;
+
+    /* Data was removed from the buffer, start over */
+    self->priv->scan_generation = generation;
+    self->priv->scan_len = 0;
+    self->priv->scan_line_start = 0;
+    self->priv->scan_unsolicited_start = 0;
+    self->priv->scan_response_ready = FALSE;
+}
+
+static void
+scan_check_line (MMPortSerialAt *self,
+                 const gchar    *line,
+                 gsize           line_len,
+                 gboolean        complete)
+{
+    if (self->priv->scan_response_ready)
+        return;
+
+    /* Without line checker, any new data may complete the response */
+    if (!self->priv->response_parser_line_fn) {
+        self->priv->scan_response_ready = TRUE;
+        return;
+    }
+
+    while (line_len > 0 && line[line_len - 1] == '\r')
+        line_len--;
+    while (line_len > 0 && line[0] == '\r') {
+        line++;
+        line_len--;
+    }
+    if (!line_len)
+        return;
+
+    if (self->priv->response_parser_line_fn (self->priv->response_parser_user_data, line, line_len, complete))
+        self->priv->scan_response_ready = TRUE;
+}
+
+/* Scans the data received since the last call, returns TRUE if any new line
+ * was completed */
+static gboolean
+scan_update (MMPortSerialAt *self,
+             MMSerialBuffer *response)
+{
+    const gchar *data;
+    const gchar *eol;
+    gsize        len;
+    gsize        line_start;
+
+    scan_state_sync (self, response);
+
+    data = (const gchar *) mm_serial_buffer_peek (response, &len);
+    line_start = self->priv->scan_line_start;
+
+    if (self->priv->scan_len == len)
+        return FALSE;
+
+    /* Only the new data is looked at when searching line ends, the start of
+     * the incomplete line is already known */
+    while ((eol = memchr (&data[self->priv->scan_len], '\n', len - self->priv->scan_len)) != NULL) {
+        gsize line_end;
+
+        line_end = eol - data;
+        scan_check_line (self, &data[self->priv->scan_line_start], line_end - self->priv->scan_line_start, TRUE);
+        self->priv->scan_line_start = self->priv->scan_len = line_end + 1;
+    }
+    self->priv->scan_len = len;
+
+    /* Some replies are given before the line is complete */
+    if (self->priv->scan_line_start < len)
+        scan_check_line (self, &data[self->priv->scan_line_start], len - self->priv->scan_line_start, FALSE);
+
+    return (self->priv->scan_line_start != line_start);
+}
+
 static MMPortSerialResponseType
 parse_response (MMPortSerial *port,
-                GByteArray *response,
+                MMSerialBuffer *response,
                 GByteArray **parsed_response,
                 GError **error)
 {
     MMPortSerialAt *self = MM_PORT_SERIAL_AT (port);
+    const guint8 *data;
+    gsize len;
     GString *string;
     gsize parsed_len;
     GError *inner_error = NULL;
@@ -135,26 +332,30 @@ parse_response (MMPortSerial *port,
 
     /* If there's no response to receive, we're done; e.g. if we only got
      * unsolicited messages */
-    if (!response->len)
+    data = mm_serial_buffer_peek (response, &len);
+    if (!len)
         return MM_PORT_SERIAL_RESPONSE_NONE;
 
-    /* Construct the string that AT-parsing functions expect */
-    string = g_string_sized_new (response->len + 1);
-    g_string_append_len (string, (const char *) response->data, response->len);
+    /* Nothing to do until a line that may complete the response is received */
+    scan_update (self, response);
+    if (!self->priv->scan_response_ready)
+        return MM_PORT_SERIAL_RESPONSE_NONE;
 
-    /* Fully cleanup the response array, we'll consider the contents we got
-     * as the full reply that the command may expect. */
-    g_byte_array_remove_range (response, 0, response->len);
+    /* Construct the string that AT-parsing functions expect */
+    string = g_string_new_len ((const gchar *) data, len);
 
     /* Parse it; returns FALSE if there is nothing we can do with this
-     * response yet. */
+     * response yet. The response buffer is left untouched in that case. */
     if (!self->priv->response_parser_fn (self->priv->response_parser_user_data, string, self, &inner_error)) {
-        /* Copy what we got back in the response buffer. */
-        g_byte_array_append (response, (const guint8 *) string->str, string->len);
         g_string_free (string, TRUE);
+        self->priv->scan_response_ready = FALSE;
         return MM_PORT_SERIAL_RESPONSE_NONE;
     }
 
+    /* Fully cleanup the response buffer, we'll consider the contents we got
+     * as the full reply that the command may expect. */
+    mm_serial_buffer_clear (response);
+
     /* If we got an error, propagate it without any further response string */
     if (inner_error) {
         g_string_free (string, TRUE);
@@ -176,6 +377,12 @@ typedef struct {
     gboolean enable;
     gpointer user_data;
     GDestroyNotify notify;
+    /* Literal text that any match must have right after a <CR> or <LF>, if
+     * known; handlers without one always run their regex */
+    gchar *prefix;
+    gsize prefix_len;
+    /* Last scan in which the prefix was found */
+    guint scan_id;
 } MMAtUnsolicitedMsgHandler;
 
 static gint
@@ -186,6 +393,154 @@ unsolicited_msg_handler_cmp (MMAtUnsolicitedMsgHandler *handler,
                       g_regex_get_pattern (regex));
 }
 
+static gboolean
+pattern_is_quantifier (gchar c)
+{
+    return (c == '?' || c == '*' || c == '+' || c == '{');
+}
+
+/* Parses a single <CR> or <LF> element of the pattern, either escaped or as
+ * is, returning its length or 0 if it's something else */
+static guint
+pattern_newline_element (const gchar *p)
+{
+    if (*p == '\r' || *p == '\n')
+        return 1;
+    if (p[0] == '\\' && (p[1] == 'r' || p[1] == 'n'))
+        return 2;
+    return 0;
+}
+
+/*
+ * Finds the literal prefix of unsolicited message patterns like
+ * "\\r\\n\\+CREG:\\s*(\\d)\\r\\n", i.e. the literal text that follows a
+ * leading run of <CR>/<LF> elements, with at least one of them mandatory. This
+ * guarantees that the prefix is found right after a <CR> or <LF> in any text
+ * matched by the regex. Returns NULL if there isn't such prefix.
+ */
+static gchar *
+unsolicited_msg_regex_get_prefix (GRegex *regex)
+{
+    const gchar *pattern;
+    const gchar *p;
+    GString     *prefix;
+    gboolean     mandatory_newline = FALSE;
+    gint         depth = 0;
+
+    if (g_regex_get_compile_flags (regex) & (G_REGEX_CASELESS | G_REGEX_EXTENDED))
+        return NULL;
+
+    pattern = g_regex_get_pattern (regex);
+
+    /* Top-level alternatives may not share the prefix */
+    for (p = pattern; *p; p++) {
+        if (*p == '\\' && p[1])
+            p++;
+        else if (*p == '(')
+            depth++;
+        else if (*p == ')')
+            depth--;
+        else if (*p == '[') {
+            /* Skip character classes, where ']' right after '[' or '[^' is literal */
+            p++;
+            if (*p == '^')
+                p++;
+            if (*p == ']')
+                p++;
+            while (*p && *p != ']') {
+                if (*p == '\\' && p[1])
+                    p++;
+                p++;
+            }
+            if (!*p)
+                return NULL;
+        } else if (*p == '|' && depth == 0)
+            return NULL;
+    }
+
+    /* Leading <CR>/<LF> elements */
+    p = pattern;
+    while (TRUE) {
+        guint len;
+
+        len = pattern_newline_element (p);
+        if (!len)
+            break;
+        p += len;
+        if (*p == '{') {
+            /* Counted, may be zero */
+            while (*p && *p != '}')
+                p++;
+            if (!*p)
+                return NULL;
+            p++;
+        } else if (*p == '?' || *p == '*')
+            p++;
+        else {
+            if (*p == '+')
+                p++;
+            mandatory_newline = TRUE;
+        }
+    }
+    if (!mandatory_newline)
+        return NULL;
+
+    /* Literal text */
+    prefix = g_string_new (NULL);
+    while (*p) {
+        const gchar *next;
+        gchar        c;
+
+        if (p[0] == '\\') {
+            /* Only escaped punctuation is literal */
+            if (!p[1] || g_ascii_isalnum (p[1]))
+                break;
+            c = p[1];
+            next = p + 2;
+        } else if (strchr (".^$|()[]{}*+?\r\n", *p))
+            break;
+        else {
+            c = *p;
+            next = p + 1;
+        }
+
+        /* A quantified char is not part of the prefix */
+        if (pattern_is_quantifier (*next))
+            break;
+
+        g_string_append_c (prefix, c);
+        p = next;
+    }
+
+    if (!prefix->len) {
+        g_string_free (prefix, TRUE);
+        return NULL;
+    }
+    return g_string_free (prefix, FALSE);
+}
+
+static void
+unsolicited_msg_index_add (MMPortSerialAt            *self,
+                           MMAtUnsolicitedMsgHandler *handler)
+{
+    gpointer  key;
+    GSList   *bucket;
+
+    if (!handler->prefix)
+        return;
+
+    if (!self->priv->unsolicited_msg_index)
+        self->priv->unsolicited_msg_index = g_hash_table_new_full (g_direct_hash,
+                                                                   g_direct_equal,
+                                                                   NULL,
+                                                                   (GDestroyNotify) g_slist_free);
+
+    key = GUINT_TO_POINTER ((guint) (guint8) handler->prefix[0]);
+    bucket = g_hash_table_lookup (self->priv->unsolicited_msg_index, key);
+    g_hash_table_steal (self->priv->unsolicited_msg_index, key);
+    g_hash_table_insert (self->priv->unsolicited_msg_index, key, g_slist_prepend (bucket, handler));
+}
+
 void
 mm_port_serial_at_add_unsolicited_msg_handler (MMPortSerialAt *self,
                                                GRegex *regex,
@@ -211,11 +566,17 @@ mm_port_serial_at_add_unsolicited_msg_handler (MMPortSerialAt *self,
         /* The new handler is always PREPENDED, so that e.g. plugins can provide
          * more specific matches for URCs that are also handled by the generic
          * plugin. */
-        handler = g_slice_new (MMAtUnsolicitedMsgHandler);
+        handler = g_slice_new0 (MMAtUnsolicitedMsgHandler);
         handler->regex = g_regex_ref (regex);
+        handler->prefix = unsolicited_msg_regex_get_prefix (regex);
+        handler->prefix_len = handler->prefix ? strlen (handler->prefix) : 0;
         self->priv->unsolicited_msg_handlers = g_slist_prepend (self->priv->unsolicited_msg_handlers, handler);
+        unsolicited_msg_index_add (self, handler);
     }
 
+    /* Look again for messages in the data already received */
+    self->priv->scan_unsolicited_start = 0;
+
     handler->callback = callback;
     handler->enable = TRUE;
     handler->user_data = user_data;
@@ -239,71 +600,163 @@ mm_port_serial_at_enable_unsolicited_msg_handler (MMPortSerialAt *self,
     if (existing) {
         handler = existing->data;
         handler->enable = enable;
+        if (enable)
+            self->priv->scan_unsolicited_start = 0;
     }
 }
 
-static gboolean
-remove_eval_cb (const GMatchInfo *match_info,
-                GString *result,
-                gpointer user_data)
+/* Flags the handlers whose prefix is found at the start of any line
+ * beginning after @from and before @to */
+static void
+unsolicited_msg_index_scan (MMPortSerialAt *self,
+                            const gchar    *data,
+                            gsize           len,
+                            gsize           from,
+                            gsize           to)
 {
-    int *result_len = (int *) user_data;
-    int start;
-    int end;
+    gsize i;
+
+    self->priv->unsolicited_msg_scan_id++;
+
+    if (!self->priv->unsolicited_msg_index)
+        return;
+
+    for (i = from + 1; i < to; i++) {
+        GSList *l;
+
+        if (data[i - 1] != '\r' && data[i - 1] != '\n')
+            continue;
 
-    if (g_match_info_fetch_pos  (match_info, 0, &start, &end))
-        *result_len -= (end - start);
+        l = g_hash_table_lookup (self->priv->unsolicited_msg_index,
+                                 GUINT_TO_POINTER ((guint) (guint8) data[i]));
+        for (; l; l = g_slist_next (l)) {
+            MMAtUnsolicitedMsgHandler *handler = l->data;
 
-    return FALSE;
+            if (handler->prefix_len <= len - i &&
+                memcmp (&data[i], handler->prefix, handler->prefix_len) == 0)
+                handler->scan_id = self->priv->unsolicited_msg_scan_id;
+        }
+    }
+}
+
+static gboolean
+is_line_end (gchar c)
+{
+    return (c == '\r' || c == '\n');
+}
+
+/* Finds the last non-empty line completed before @line_start, including the
+ * line ends before it, as most messages start with <CR><LF> */
+static gsize
+unsolicited_msg_lookback_find (const gchar *data,
+                               gsize        from,
+                               gsize        line_start)
+{
+    gsize i = line_start;
+
+    while (i > from && is_line_end (data[i - 1]))
+        i--;
+    while (i > from && !is_line_end (data[i - 1]))
+        i--;
+    while (i > from && is_line_end (data[i - 1]))
+        i--;
+    return i;
 }
 
 static void
-parse_unsolicited (MMPortSerial *port, GByteArray *response)
+parse_unsolicited (MMPortSerial *port, MMSerialBuffer *response)
 {
     MMPortSerialAt *self = MM_PORT_SERIAL_AT (port);
     GSList *iter;
+    GArray *spans = NULL;
+    const gchar *data;
+    gsize len;
+    gsize from;
+    gsize to;
+    guint generation;
 
     /* Remove echo */
     if (self->priv->remove_echo)
         mm_port_serial_at_remove_echo (response);
 
+    /* Messages are only looked for once new lines are complete */
+    if (!scan_update (self, response))
+        return;
+
+    data = (const gchar *) mm_serial_buffer_peek (response, &len);
+    generation = mm_serial_buffer_get_generation (response);
+
+    /* Lines already looked at may still be the start of a message that the
+     * new lines complete, e.g. the header of a +CMT message; so the search
+     * starts at the last non-empty line looked at in the previous run */
+    from = self->priv->scan_unsolicited_start;
+    to = self->priv->scan_line_start;
+
+    /* Find which of the handlers with a literal prefix may match */
+    unsolicited_msg_index_scan (self, data, len, from, to);
+
+    /* Handlers are run in order, each one on the data left by the previous
+     * ones, as the text matched by a handler is removed before running the
+     * next one. */
     for (iter = self->priv->unsolicited_msg_handlers; iter; iter = iter->next) {
         MMAtUnsolicitedMsgHandler *handler = (MMAtUnsolicitedMsgHandler *) iter->data;
-        GMatchInfo *match_info;
-        gboolean matches;
+        GMatchInfo *match_info = NULL;
 
         if (!handler->enable)
             continue;
 
-        matches = g_regex_match_full (handler->regex,
-                                      (const char *) response->data,
-                                      response->len,
-                                      0, 0, &match_info, NULL);
-        if (handler->callback) {
-            while (g_match_info_matches (match_info)) {
+        if (handler->prefix && handler->scan_id != self->priv->unsolicited_msg_scan_id)
+            continue;
+
+        if (!g_regex_match_full (handler->regex, data, len, from, 0, &match_info, NULL)) {
+            g_match_info_free (match_info);
+            continue;
+        }
+
+        if (!spans)
+            spans = g_array_new (FALSE, FALSE, sizeof (MMSerialBufferSpan));
+        g_array_set_size (spans, 0);
+
+        while (g_match_info_matches (match_info)) {
+            gint start;
+            gint end;
+
+            if (handler->callback)
                 handler->callback (self, match_info, handler->user_data);
-                g_match_info_next (match_info, NULL);
+            if (g_match_info_fetch_pos (match_info, 0, &start, &end) && (end > start)) {
+                MMSerialBufferSpan span = { (gsize) start, (gsize) (end - start) };
+
+                g_array_append_val (spans, span);
             }
+            g_match_info_next (match_info, NULL);
         }
 
         g_match_info_free (match_info);
 
-        if (matches) {
-            /* Remove matches */
-            char *str;
-            int result_len = response->len;
+        /* Handlers may have ended up closing the port, which clears the buffer */
+        if (mm_serial_buffer_get_generation (response) != generation)
+            break;
+
+        if (!spans->len)
+            continue;
 
-            str = g_regex_replace_eval (handler->regex,
-                                        (const char *) response->data,
-                                        response->len,
-                                        0, 0,
-                                        remove_eval_cb, &result_len, NULL);
+        /* Matches never overlap and are found in order */
+        mm_serial_buffer_cut_spans (response, (const MMSerialBufferSpan *) spans->data, spans->len);
+        data = (const gchar *) mm_serial_buffer_peek (response, &len);
+        generation = mm_serial_buffer_get_generation (response);
 
-            g_byte_array_remove_range (response, 0, response->len);
-            g_byte_array_append (response, (const guint8 *) str, result_len);
-            g_free (str);
-        }
+        /* Removing the match may have left other prefixes at a line start;
+         * as the cut changed where lines start, look until the end */
+        to = len;
+        unsolicited_msg_index_scan (self, data, len, from, to);
     }
+
+    /* Once anything is removed the whole buffer is scanned again next time */
+    if (mm_serial_buffer_get_generation (response) == self->priv->scan_generation)
+        self->priv->scan_unsolicited_start = unsolicited_msg_lookback_find (data, from, self->priv->scan_line_start);
+
+    if (spans)
+        g_array_unref (spans);
 }
 
 /*****************************************************************************/
@@ -363,22 +816,18 @@ string_free (GString *str)
     g_string_free (str, TRUE);
 }
 
-static void
-serial_command_ready (MMPortSerial *port,
-                      GAsyncResult *res,
-                      GSimpleAsyncResult *simple)
+/* Takes the whole response out of the port response buffer */
+static GString *
+take_response (MMPortSerial *port,
+               GAsyncResult *res,
+               GError **error)
 {
     GByteArray *response_buffer;
-    GError *error = NULL;
     GString *response;
 
-    response_buffer = mm_port_serial_command_finish (port, res, &error);
-    if (!response_buffer) {
-        g_simple_async_result_take_error (simple, error);
-        g_simple_async_result_complete (simple);
-        g_object_unref (simple);
-        return;
-    }
+    response_buffer = mm_port_serial_command_finish (port, res, error);
+    if (!response_buffer)
+        return NULL;
 
     /* Build a GString just with the response we need, and clear the
      * processed range from the response buffer */
@@ -386,23 +835,321 @@ serial_command_ready (MMPortSerial *port,
     if (response_buffer->len > 0)
         g_byte_array_remove_range (response_buffer, 0, response_buffer->len);
     g_byte_array_unref (response_buffer);
+    return response;
+}
 
-    g_simple_async_result_set_op_res_gpointer (simple,
-                                               response,
-                                               (GDestroyNotify)string_free);
+/* Completes and unrefs @simple, taking either @response or @error */
+static void
+command_complete (GSimpleAsyncResult *simple,
+                  GString *response,
+                  GError *error)
+{
+    if (!response)
+        g_simple_async_result_take_error (simple, error);
+    else
+        g_simple_async_result_set_op_res_gpointer (simple,
+                                                   response,
+                                                   (GDestroyNotify)string_free);
     g_simple_async_result_complete (simple);
     g_object_unref (simple);
 }
 
+static void
+serial_command_ready (MMPortSerial *port,
+                      GAsyncResult *res,
+                      GSimpleAsyncResult *simple)
+{
+    GError *error = NULL;
+    GString *response;
+
+    response = take_response (port, res, &error);
+    command_complete (simple, response, error);
+}
+
+/*****************************************************************************/
+/* Batch window */
+
+typedef struct {
+    GSimpleAsyncResult *simple;
+    gchar *command;
+    guint32 timeout_seconds;
+    GCancellable *cancellable;
+    MMPortSerialPriority priority;
+} BatchItem;
+
+static void
+batch_item_free (BatchItem *item)
+{
+    g_assert (!item->simple);
+    g_free (item->command);
+    if (item->cancellable)
+        g_object_unref (item->cancellable);
+    g_slice_free (BatchItem, item);
+}
+
+/* Completes the item, unless its own cancellable was cancelled meanwhile, as
+ * the batched command line itself is not cancellable */
+static void
+batch_item_complete (BatchItem *item,
+                     GString *response,
+                     GError *error)
+{
+    if (response && g_cancellable_set_error_if_cancelled (item->cancellable, &error)) {
+        g_string_free (response, TRUE);
+        response = NULL;
+    }
+    command_complete (item->simple, response, error);
+    item->simple = NULL;
+}
+
+static void
+batch_item_send (MMPortSerialAt *self,
+                 BatchItem *item,
+                 GAsyncReadyCallback callback,
+                 gpointer user_data)
+{
+    GByteArray *buf;
+
+    buf = at_command_to_byte_array (item->command,
+                                    FALSE,
+                                    (mm_port_get_subsys (MM_PORT (self)) == MM_PORT_SUBSYS_TTY ?
+                                     self->priv->send_lf :
+                                     TRUE));
+
+    mm_port_serial_command (MM_PORT_SERIAL (self),
+                            buf,
+                            item->timeout_seconds,
+                            FALSE,
+                            FALSE,
+                            item->priority,
+                            item->cancellable,
+                            callback,
+                            user_data);
+    g_byte_array_unref (buf);
+}
+
+typedef struct {
+    MMPortSerialAt *self;
+    GList *items;
+    guint n_pending;
+    guint n_succeeded;
+} BatchContext;
+
+static void
+batch_context_free (BatchContext *ctx)
+{
+    g_list_free_full (ctx->items, (GDestroyNotify)batch_item_free);
+    g_object_unref (ctx->self);
+    g_slice_free (BatchContext, ctx);
+}
+
+/* Only errors the modem replied with tell anything about the commands
+ * themselves; timeouts, cancellations or errors in the port are not a reason
+ * to run them again one by one, nor to stop batching them. */
+static gboolean
+batch_error_is_reply (const GError *error)
+{
+    return (error->domain == MM_MOBILE_EQUIPMENT_ERROR ||
+            error->domain == MM_CONNECTION_ERROR);
+}
+
+typedef struct {
+    BatchContext *ctx;
+    BatchItem *item;
+} BatchRetry;
+
+static void
+batch_retry_ready (MMPortSerial *port,
+                   GAsyncResult *res,
+                   BatchRetry *retry)
+{
+    BatchContext *ctx = retry->ctx;
+    GError *error = NULL;
+    GString *response;
+
+    response = take_response (port, res, &error);
+    if (response)
+        ctx->n_succeeded++;
+    else if (batch_error_is_reply (error)) {
+        mm_obj_dbg (ctx->self, "not batching '%s' any more: %s", retry->item->command, error->message);
+        g_hash_table_add (ctx->self->priv->batch_failing, g_strdup (retry->item->command));
+    }
+    batch_item_complete (retry->item, response, error);
+    g_slice_free (BatchRetry, retry);
+
+    if (--ctx->n_pending > 0)
+        return;
+
+    /* If every command worked on its own, the modem is the one not handling
+     * the compound command line properly */
+    if (ctx->n_succeeded == g_list_length (ctx->items)) {
+        mm_obj_dbg (ctx->self, "batched queries not supported, disabling batching");
+        ctx->self->priv->batch_disabled = TRUE;
+    }
+    batch_context_free (ctx);
+}
+
+static void
+batch_command_ready (MMPortSerial *port,
+                     GAsyncResult *res,
+                     BatchContext *ctx)
+{
+    g_autoptr(GPtrArray)  commands = NULL;
+    g_auto(GStrv)         responses = NULL;
+    g_autoptr(GString)    response = NULL;
+    GError               *error = NULL;
+    GList                *l;
+    guint                 i;
+
+    commands = g_ptr_array_new ();
+    for (l = ctx->items; l; l = g_list_next (l))
+        g_ptr_array_add (commands, ((BatchItem *)l->data)->command);
+    g_ptr_array_add (commands, NULL);
+
+    response = take_response (port, res, &error);
+    if (!response && !batch_error_is_reply (error)) {
+        /* Every command gets the same error, as if each had been sent alone */
+        for (l = ctx->items; l; l = g_list_next (l))
+            batch_item_complete ((BatchItem *)l->data, NULL, g_error_copy (error));
+        g_error_free (error);
+        batch_context_free (ctx);
+        return;
+    }
+
+    if (response)
+        responses = mm_split_compound_at_response (response->str, (const gchar **)commands->pdata, &error);
+
+    if (!responses) {
+        /* The whole command line fails as soon as one of the commands fails,
+         * so run them one by one to get each its own response */
+        mm_obj_dbg (ctx->self, "couldn't run batched queries: %s; running them one by one", error->message);
+        g_error_free (error);
+        ctx->n_pending = g_list_length (ctx->items);
+        for (l = ctx->items; l; l = g_list_next (l)) {
+            BatchRetry *retry;
+
+            retry = g_slice_new (BatchRetry);
+            retry->ctx = ctx;
+            retry->item = l->data;
+            batch_item_send (ctx->self, retry->item, (GAsyncReadyCallback)batch_retry_ready, retry);
+        }
+        return;
+    }
+
+    for (l = ctx->items, i = 0; l; l = g_list_next (l), i++)
+        batch_item_complete ((BatchItem *)l->data, g_string_new (responses[i]), NULL);
+    batch_context_free (ctx);
+}
+
+static void
+batch_flush (MMPortSerialAt *self)
+{
+    g_autoptr(GPtrArray)  commands = NULL;
+    g_autofree gchar     *compound = NULL;
+    BatchContext         *ctx;
+    BatchItem            *item;
+    GList                *l;
+    guint32               timeout_seconds = 0;
+
+    if (g_queue_is_empty (self->priv->batch_pending))
+        return;
+
+    /* Nothing to merge with */
+    if (g_queue_get_length (self->priv->batch_pending) == 1) {
+        item = g_queue_pop_head (self->priv->batch_pending);
+        batch_item_send (self, item, (GAsyncReadyCallback)serial_command_ready, item->simple);
+        item->simple = NULL;
+        batch_item_free (item);
+        return;
+    }
+
+    ctx = g_slice_new0 (BatchContext);
+    ctx->self = g_object_ref (self);
+    ctx->items = self->priv->batch_pending->head;
+    g_queue_init (self->priv->batch_pending);
+
+    /* The command line takes as long as all commands together, and runs in
+     * the most urgent class of all of them */
+    item = g_slice_new0 (BatchItem);
+    item->priority = MM_PORT_SERIAL_PRIORITY_LAST;
+    commands = g_ptr_array_new ();
+    for (l = ctx->items; l; l = g_list_next (l)) {
+        BatchItem *batched = l->data;
+
+        g_ptr_array_add (commands, batched->command);
+        timeout_seconds += batched->timeout_seconds;
+        item->priority = MIN (item->priority, batched->priority);
+    }
+    g_ptr_array_add (commands, NULL);
+
+    compound = mm_build_compound_at_command ((const gchar **)commands->pdata);
+    mm_obj_dbg (self, "running %u queries in a single command line", commands->len - 1);
+
+    item->command = g_strdup_printf ("AT%s", compound);
+    item->timeout_seconds = timeout_seconds;
+    batch_item_send (self, item, (GAsyncReadyCallback)batch_command_ready, ctx);
+    batch_item_free (item);
+}
+
+gboolean
+mm_port_serial_at_can_batch (MMPortSerialAt *self,
+                             const gchar *command)
+{
+    g_return_val_if_fail (MM_IS_PORT_SERIAL_AT (self), FALSE);
+
+    if (self->priv->batch_disabled)
+        return FALSE;
+
+    /* Only queries and actions without arguments, so that running them again
+     * one by one if the command line fails has no side effects */
+    if (!mm_at_command_is_batchable (command) || strchr (command, '='))
+        return FALSE;
+
+    return !g_hash_table_contains (self->priv->batch_failing, command);
+}
+
+static gboolean
+batch_command_allowed (MMPortSerialAt *self,
+                       const gchar *command,
+                       gboolean is_raw,
+                       gboolean allow_cached)
+{
+    if (!self->priv->batch_depth || is_raw || allow_cached)
+        return FALSE;
+
+    return mm_port_serial_at_can_batch (self, command);
+}
+
 void
-mm_port_serial_at_command (MMPortSerialAt *self,
-                           const char *command,
-                           guint32 timeout_seconds,
-                           gboolean is_raw,
-                           gboolean allow_cached,
-                           GCancellable *cancellable,
-                           GAsyncReadyCallback callback,
-                           gpointer user_data)
+mm_port_serial_at_batch_begin (MMPortSerialAt *self)
+{
+    g_return_if_fail (MM_IS_PORT_SERIAL_AT (self));
+
+    self->priv->batch_depth++;
+}
+
+void
+mm_port_serial_at_batch_end (MMPortSerialAt *self)
+{
+    g_return_if_fail (MM_IS_PORT_SERIAL_AT (self));
+    g_return_if_fail (self->priv->batch_depth > 0);
+
+    if (--self->priv->batch_depth == 0)
+        batch_flush (self);
+}
+
+/*****************************************************************************/
+
+void
+mm_port_serial_at_command_full (MMPortSerialAt *self,
+                                const char *command,
+                                guint32 timeout_seconds,
+                                gboolean is_raw,
+                                gboolean allow_cached,
+                                MMPortSerialPriority priority,
+                                GCancellable *cancellable,
+                                GAsyncReadyCallback callback,
+                                gpointer user_data)
 {
     GSimpleAsyncResult *simple;
     GByteArray *buf;
@@ -411,61 +1158,62 @@ mm_port_serial_at_command (MMPortSerialAt *self,
     g_return_if_fail (MM_IS_PORT_SERIAL_AT (self));
     g_return_if_fail (command != NULL);
 
+    simple = g_simple_async_result_new (G_OBJECT (self),
+                                        callback,
+                                        user_data,
+                                        mm_port_serial_at_command);
+
+    /* Hold it until the batch window is over */
+    if (batch_command_allowed (self, command, is_raw, allow_cached)) {
+        BatchItem *item;
+
+        item = g_slice_new0 (BatchItem);
+        item->simple = simple;
+        item->command = g_strdup (command);
+        item->timeout_seconds = timeout_seconds;
+        item->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+        item->priority = priority;
+        g_queue_push_tail (self->priv->batch_pending, item);
+        return;
+    }
+
     buf = at_command_to_byte_array (command,
                                     is_raw,
                                     (mm_port_get_subsys (MM_PORT (self)) == MM_PORT_SUBSYS_TTY ?
                                      self->priv->send_lf :
                                      TRUE));
-    g_return_if_fail (buf != NULL);
-
-    simple = g_simple_async_result_new (G_OBJECT (self),
-                                        callback,
-                                        user_data,
-                                        mm_port_serial_at_command);
 
     mm_port_serial_command (MM_PORT_SERIAL (self),
                             buf,
                             timeout_seconds,
                             allow_cached,
                             is_raw, /* raw commands always run next, never queued last */
+                            priority,
                             cancellable,
                             (GAsyncReadyCallback)serial_command_ready,
                             simple);
     g_byte_array_unref (buf);
 }
 
-static void
-debug_log (MMPortSerial *self,
-           const gchar  *prefix,
-           const gchar  *buf,
-           gsize         len)
-{
-    static GString *debug = NULL;
-    const  char    *s;
-
-    if (!debug)
-        debug = g_string_sized_new (256);
-
-    g_string_append (debug, prefix);
-    g_string_append (debug, " '");
-
-    s = buf;
-    while (len--) {
-        if (g_ascii_isprint (*s))
-            g_string_append_c (debug, *s);
-        else if (*s == '\r')
-            g_string_append (debug, "<CR>");
-        else if (*s == '\n')
-            g_string_append (debug, "<LF>");
-        else
-            g_string_append_printf (debug, "\\%u", (guint8) (*s & 0xFF));
-
-        s++;
-    }
-
-    g_string_append_c (debug, '\'');
-    mm_obj_dbg (self, "%s", debug->str);
-    g_string_truncate (debug, 0);
+void
+mm_port_serial_at_command (MMPortSerialAt *self,
+                           const char *command,
+                           guint32 timeout_seconds,
+                           gboolean is_raw,
+                           gboolean allow_cached,
+                           GCancellable *cancellable,
+                           GAsyncReadyCallback callback,
+                           gpointer user_data)
+{
+    mm_port_serial_at_command_full (self,
+                                    command,
+                                    timeout_seconds,
+                                    is_raw,
+                                    allow_cached,
+                                    MM_PORT_SERIAL_PRIORITY_NORMAL,
+                                    cancellable,
+                                    callback,
+                                    user_data);
 }
 
 void
@@ -553,6 +1301,9 @@ mm_port_serial_at_init (MMPortSerialAt *self)
 
     /* By default, don't send line feed */
     self->priv->send_lf = FALSE;
+
+    self->priv->batch_pending = g_queue_new ();
+    self->priv->batch_failing = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 }
 
 static void
@@ -622,16 +1373,24 @@ finalize (GObject *object)
             handler->notify (handler->user_data);
 
         g_regex_unref (handler->regex);
+        g_free (handler->prefix);
         g_slice_free (MMAtUnsolicitedMsgHandler, handler);
         self->priv->unsolicited_msg_handlers = g_slist_delete_link (self->priv->unsolicited_msg_handlers,
                                                                     self->priv->unsolicited_msg_handlers);
     }
 
+    if (self->priv->unsolicited_msg_index)
+        g_hash_table_destroy (self->priv->unsolicited_msg_index);
+
     if (self->priv->response_parser_notify)
         self->priv->response_parser_notify (self->priv->response_parser_user_data);
 
     g_strfreev (self->priv->init_sequence);
 
+    g_assert (g_queue_is_empty (self->priv->batch_pending));
+    g_queue_free (self->priv->batch_pending);
+    g_hash_table_unref (self->priv->batch_failing);
+
     G_OBJECT_CLASS (mm_port_serial_at_parent_class)->finalize (object);
 }
 
@@ -650,7 +1409,9 @@ mm_port_serial_at_class_init (MMPortSerialAtClass *klass)
 
     serial_class->parse_unsolicited = parse_unsolicited;
     serial_class->parse_response = parse_response;
-    serial_class->debug_log = debug_log;
+    serial_class->check_echo = check_echo;
+    serial_class->debug_format = mm_port_serial_debug_format_text;
+    serial_class->trace_command = trace_command;
     serial_class->config = config;
 
     g_object_class_install_property
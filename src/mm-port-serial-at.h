@@ -58,6 +58,14 @@ typedef gboolean (*MMPortSerialAtResponseParserFn) (gpointer   user_data,
                                                     gpointer   log_object,
                                                     GError   **error);
 
+/* Called with every line received, without the line end, and with the
+ * incomplete last line each time it grows. Should return TRUE if the line may
+ * let the response parser find a complete response. */
+typedef gboolean (*MMPortSerialAtResponseLineFn) (gpointer     user_data,
+                                                  const gchar *line,
+                                                  gsize        line_len,
+                                                  gboolean     complete);
+
 typedef void (*MMPortSerialAtUnsolicitedMsgFn) (MMPortSerialAt *port,
                                                 GMatchInfo *match_info,
                                                 gpointer user_data);
@@ -96,6 +104,14 @@ void     mm_port_serial_at_set_response_parser (MMPortSerialAt *self,
                                                 gpointer user_data,
                                                 GDestroyNotify notify);
 
+/* Same as mm_port_serial_at_set_response_parser(), but only giving the
+ * response to the parser once @line_fn tells that it may be complete */
+void     mm_port_serial_at_set_response_parser_full (MMPortSerialAt *self,
+                                                     MMPortSerialAtResponseParserFn fn,
+                                                     MMPortSerialAtResponseLineFn line_fn,
+                                                     gpointer user_data,
+                                                     GDestroyNotify notify);
+
 void         mm_port_serial_at_command        (MMPortSerialAt *self,
                                                const char *command,
                                                guint32 timeout_seconds,
@@ -104,10 +120,35 @@ void         mm_port_serial_at_command        (MMPortSerialAt *self,
                                                GCancellable *cancellable,
                                                GAsyncReadyCallback callback,
                                                gpointer user_data);
+/* Like mm_port_serial_at_command(), which schedules the command in the
+ * normal priority class, but with an explicit priority class */
+void         mm_port_serial_at_command_full   (MMPortSerialAt *self,
+                                               const char *command,
+                                               guint32 timeout_seconds,
+                                               gboolean is_raw,
+                                               gboolean allow_cached,
+                                               MMPortSerialPriority priority,
+                                               GCancellable *cancellable,
+                                               GAsyncReadyCallback callback,
+                                               gpointer user_data);
 const gchar *mm_port_serial_at_command_finish (MMPortSerialAt *self,
                                                GAsyncResult *res,
                                                GError **error);
 
+/* Between these calls, queries issued with mm_port_serial_at_command() are
+ * held, and when the outermost window is over they are all sent in a single
+ * compound command line. If the modem replies with an error, or the reply
+ * can't be split per query, each query is retried on its own; queries
+ * failing alone are not batched again, and batching is disabled in the port
+ * if all of them succeed alone. Timeouts and cancellations are reported to
+ * every query as they are. Raw and cached commands, and commands with
+ * arguments, are never held. */
+void         mm_port_serial_at_batch_begin    (MMPortSerialAt *self);
+void         mm_port_serial_at_batch_end      (MMPortSerialAt *self);
+/* Whether the command would be held in a batch window */
+gboolean     mm_port_serial_at_can_batch      (MMPortSerialAt *self,
+                                               const gchar *command);
+
 /*
  * Convert a string into a quoted and escaped string. Returns a new
  * allocated string. Follows ITU V.250 5.4.2.2 "String constants".
@@ -115,7 +156,7 @@ const gchar *mm_port_serial_at_command_finish (MMPortSerialAt *self,
 gchar   *mm_port_serial_at_quote_string (const char *string);
 
 /* Just for unit tests */
-void     mm_port_serial_at_remove_echo (GByteArray *response);
+void     mm_port_serial_at_remove_echo (MMSerialBuffer *response);
 
 void     mm_port_serial_at_set_flags (MMPortSerialAt *self,
                                       MMPortSerialAtFlag flags);
@@ -53,119 +53,75 @@ mm_port_serial_gps_add_trace_handler (MMPortSerialGps *self,
 
 /*****************************************************************************/
 
-static gboolean
-remove_eval_cb (const GMatchInfo *match_info,
-                GString *result,
-                gpointer user_data)
-{
-    int *result_len = (int *) user_data;
-    int start;
-    int end;
-
-    if (g_match_info_fetch_pos  (match_info, 0, &start, &end))
-        *result_len -= (end - start);
-
-    return FALSE;
-}
-
 static MMPortSerialResponseType
 parse_response (MMPortSerial *port,
-                GByteArray *response,
+                MMSerialBuffer *response,
                 GByteArray **parsed_response,
                 GError **error)
 {
     MMPortSerialGps *self = MM_PORT_SERIAL_GPS (port);
     gboolean matches;
     GMatchInfo *match_info;
-    gchar *str;
-    gint result_len;
+    const gchar *data;
+    gsize len;
+    gint previous_end = 0;
     guint i;
 
-    for (i = 0; i < response->len; i++) {
+    data = (const gchar *) mm_serial_buffer_peek (response, &len);
+    for (i = 0; i < len; i++) {
         /* If there is any content before the first $,
          * assume it's garbage, and skip it */
-        if (response->data[i] == '$') {
-            if (i > 0)
-                g_byte_array_remove_range (response, 0, i);
+        if (data[i] == '$') {
+            if (i > 0) {
+                mm_serial_buffer_consume (response, i);
+                data = (const gchar *) mm_serial_buffer_peek (response, &len);
+            }
             /* else, good, we're already started with $ */
             break;
         }
     }
 
     matches = g_regex_match_full (self->priv->known_traces_regex,
-                                  (const gchar *) response->data,
-                                  response->len,
+                                  data, len,
                                   0, 0, &match_info, NULL);
+    if (!matches) {
+        g_match_info_free (match_info);
+        return MM_PORT_SERIAL_RESPONSE_NONE;
+    }
+
+    /* The parsed response is built with whatever is found between the
+     * matched traces */
+    *parsed_response = g_byte_array_sized_new (len);
 
-    if (self->priv->callback) {
-        while (g_match_info_matches (match_info)) {
-            gchar *trace;
+    while (g_match_info_matches (match_info)) {
+        gint start;
+        gint end;
 
-            trace = g_match_info_fetch (match_info, 0);
-            if (trace) {
+        if (g_match_info_fetch_pos (match_info, 0, &start, &end)) {
+            if (self->priv->callback) {
+                gchar *trace;
+
+                trace = g_strndup (&data[start], end - start);
                 self->priv->callback (self, trace, self->priv->user_data);
                 g_free (trace);
             }
-            g_match_info_next (match_info, NULL);
+
+            if (start > previous_end)
+                g_byte_array_append (*parsed_response, (const guint8 *) &data[previous_end], start - previous_end);
+            previous_end = end;
         }
+        g_match_info_next (match_info, NULL);
     }
 
     g_match_info_free (match_info);
 
-    if (!matches)
-        return MM_PORT_SERIAL_RESPONSE_NONE;
-
-    /* Remove matches */
-    result_len = response->len;
-    str = g_regex_replace_eval (self->priv->known_traces_regex,
-                                (const char *) response->data,
-                                response->len,
-                                0, 0,
-                                remove_eval_cb, &result_len, NULL);
+    if ((gsize) previous_end < len)
+        g_byte_array_append (*parsed_response, (const guint8 *) &data[previous_end], len - previous_end);
 
     /* Cleanup response buffer */
-    g_byte_array_remove_range (response, 0, response->len);
-
-    /* Build parsed response */
-    *parsed_response = g_byte_array_new_take ((guint8 *)str, result_len);
-
-    return TRUE;
-}
-
-/*****************************************************************************/
-
-static void
-debug_log (MMPortSerial *self,
-           const gchar  *prefix,
-           const gchar  *buf,
-           gsize         len)
-{
-    static GString *debug = NULL;
-    const gchar    *s;
-
-    if (!debug)
-        debug = g_string_sized_new (256);
-
-    g_string_append (debug, prefix);
-    g_string_append (debug, " '");
-
-    s = buf;
-    while (len--) {
-        if (g_ascii_isprint (*s))
-            g_string_append_c (debug, *s);
-        else if (*s == '\r')
-            g_string_append (debug, "<CR>");
-        else if (*s == '\n')
-            g_string_append (debug, "<LF>");
-        else
-            g_string_append_printf (debug, "\\%u", (guint8) (*s & 0xFF));
-
-        s++;
-    }
+    mm_serial_buffer_clear (response);
 
-    g_string_append_c (debug, '\'');
-    mm_obj_dbg (self, "%s", debug->str);
-    g_string_truncate (debug, 0);
+    return MM_PORT_SERIAL_RESPONSE_BUFFER;
 }
 
 /*****************************************************************************/
@@ -220,5 +176,5 @@ mm_port_serial_gps_class_init (MMPortSerialGpsClass *klass)
     object_class->finalize = finalize;
 
     serial_class->parse_response = parse_response;
-    serial_class->debug_log = debug_log;
+    serial_class->debug_format = mm_port_serial_debug_format_text;
 }
@@ -38,7 +38,7 @@ struct _MMPortSerialQcdmPrivate {
 /*****************************************************************************/
 
 static gboolean
-find_qcdm_start (GByteArray *response, gsize *start)
+find_qcdm_start (const guint8 *data, gsize len, gsize *start)
 {
     guint i;
     gint  last = -1;
@@ -49,9 +49,9 @@ find_qcdm_start (GByteArray *response, gsize *start)
      * with 0x7E and ending with 0x7E, and (3) a non-QCDM frame that still
      * uses HDLC framing (like Sierra CnS) that starts and ends with 0x7E.
      */
-    for (i = 0; i < response->len; i++) {
+    for (i = 0; i < len; i++) {
         /* Marker found */
-        if (response->data[i] == 0x7E) {
+        if (data[i] == 0x7E) {
             /* If we didn't get an initial marker, count at least 3 bytes since
              * origin; if we did get an initial marker, count at least 3 bytes
              * since the marker.
@@ -71,11 +71,13 @@ find_qcdm_start (GByteArray *response, gsize *start)
 }
 
 static MMPortSerialResponseType
-parse_qcdm (GByteArray *response,
+parse_qcdm (MMSerialBuffer *response,
             gboolean want_log,
             GByteArray **parsed_response,
             GError **error)
 {
+    const guint8 *data;
+    gsize len;
     gsize start = 0;
     gsize used = 0;
     gsize unescaped_len = 0;
@@ -83,7 +85,8 @@ parse_qcdm (GByteArray *response,
     qcdmbool more = FALSE;
 
     /* Get the offset into the buffer of where the QCDM frame starts */
-    if (!find_qcdm_start (response, &start)) {
+    data = mm_serial_buffer_peek (response, &len);
+    if (!find_qcdm_start (data, len, &start)) {
         /* Discard the unparsable data right away, we do need a QCDM
          * start, and anything that comes before it is unknown data
          * that we'll never use. */
@@ -91,14 +94,15 @@ parse_qcdm (GByteArray *response,
     }
 
     /* If there is anything before the start marker, remove it */
-    g_byte_array_remove_range (response, 0, start);
-    if (response->len == 0)
+    mm_serial_buffer_consume (response, start);
+    data = mm_serial_buffer_peek (response, &len);
+    if (len == 0)
         return MM_PORT_SERIAL_RESPONSE_NONE;
 
     /* Try to decapsulate the response into a buffer */
     unescaped_buffer = g_malloc (1024);
-    if (!dm_decapsulate_buffer ((const char *)(response->data),
-                                response->len,
+    if (!dm_decapsulate_buffer ((const char *)data,
+                                len,
                                 (char *)unescaped_buffer,
                                 1024,
                                 &unescaped_len,
@@ -139,13 +143,13 @@ parse_qcdm (GByteArray *response,
     /* Remove the data we used from the input buffer, leaving out any
      * additional data that may already been received (e.g. from the following
      * message). */
-    g_byte_array_remove_range (response, 0, used);
+    mm_serial_buffer_consume (response, used);
     return MM_PORT_SERIAL_RESPONSE_BUFFER;
 }
 
 static MMPortSerialResponseType
 parse_response (MMPortSerial *port,
-                GByteArray *response,
+                MMSerialBuffer *response,
                 GByteArray **parsed_response,
                 GError **error)
 {
@@ -200,32 +204,12 @@ mm_port_serial_qcdm_command (MMPortSerialQcdm *self,
                             timeout_seconds,
                             FALSE, /* never cached */
                             FALSE, /* always queued last */
+                            MM_PORT_SERIAL_PRIORITY_NORMAL,
                             cancellable,
                             (GAsyncReadyCallback)serial_command_ready,
                             task);
 }
 
-static void
-debug_log (MMPortSerial *self,
-           const gchar  *prefix,
-           const gchar  *buf,
-           gsize         len)
-{
-    static GString *debug = NULL;
-    const gchar    *s = buf;
-
-    if (!debug)
-        debug = g_string_sized_new (512);
-
-    g_string_append (debug, prefix);
-
-    while (len--)
-        g_string_append_printf (debug, " %02x", (guint8) (*s++ & 0xFF));
-
-    mm_obj_dbg (self, "%s", debug->str);
-    g_string_truncate (debug, 0);
-}
-
 /*****************************************************************************/
 
 typedef struct {
@@ -297,7 +281,7 @@ mm_port_serial_qcdm_enable_unsolicited_msg_handler (MMPortSerialQcdm *self,
 }
 
 static void
-parse_unsolicited (MMPortSerial *port, GByteArray *response)
+parse_unsolicited (MMPortSerial *port, MMSerialBuffer *response)
 {
     MMPortSerialQcdm *self = MM_PORT_SERIAL_QCDM (port);
     GByteArray *log_buffer = NULL;
@@ -416,5 +400,5 @@ mm_port_serial_qcdm_class_init (MMPortSerialQcdmClass *klass)
     port_class->parse_unsolicited = parse_unsolicited;
     port_class->parse_response = parse_response;
     port_class->config_fd = config_fd;
-    port_class->debug_log = debug_log;
+    port_class->debug_format = mm_port_serial_debug_format_hex;
 }
@@ -56,6 +56,7 @@ enum {
     PROP_STOPBITS,
     PROP_FLOW_CONTROL,
     PROP_SEND_DELAY,
+    PROP_SEND_DELAY_ADAPTIVE,
     PROP_FD,
     PROP_SPEW_CONTROL,
     PROP_FLASH_OK,
@@ -75,13 +76,52 @@ static guint signals[LAST_SIGNAL] = { 0 };
 
 #define SERIAL_BUF_SIZE 2048
 
+/* When adaptive send pacing is enabled in a TTY with a send delay (plugins
+ * opt in), commands are written in a single burst until the device shows it
+ * can't cope with that, i.e. until the echo of a command comes back
+ * corrupted, and only then the per-byte send delay is applied. */
+typedef enum {
+    SEND_PACING_UNKNOWN,
+    SEND_PACING_BURST,
+    SEND_PACING_PACED,
+} SendPacing;
+
+static const gchar *send_pacing_str[] = { "unknown", "burst", "paced" };
+
+/* Pacing results found, shared by all ports with the same vid:pid:iface */
+static GHashTable *send_pacing_cache;
+
+/* Commands are sent in priority class order, unless a command of a lower class
+ * has been waiting for longer than the class offset: each command gets a
+ * virtual deadline (time queued + offset of its class), and the pending
+ * command with the earliest deadline is sent first. */
+static const gint64 priority_offset_us[MM_PORT_SERIAL_PRIORITY_LAST] = {
+    [MM_PORT_SERIAL_PRIORITY_INTERACTIVE] = 0,
+    [MM_PORT_SERIAL_PRIORITY_NORMAL]      = 2 * G_USEC_PER_SEC,
+    [MM_PORT_SERIAL_PRIORITY_BACKGROUND]  = 10 * G_USEC_PER_SEC,
+};
+
+static const gchar *priority_str[MM_PORT_SERIAL_PRIORITY_LAST] = { "interactive", "normal", "background" };
+
+typedef struct {
+    /* Commands pending to be sent */
+    GQueue *pending;
+    /* Metrics */
+    guint   max_depth;
+    guint64 n_sent;
+    gint64  total_wait_us;
+    gint64  max_wait_us;
+} PriorityLane;
+
 struct _MMPortSerialPrivate {
     guint32 open_count;
     gboolean forced_close;
     int fd;
     GHashTable *reply_cache;
-    GQueue *queue;
-    GByteArray *response;
+    PriorityLane lanes[MM_PORT_SERIAL_PRIORITY_LAST];
+    /* Command being sent or waiting for its response */
+    struct _CommandContext *current;
+    MMSerialBuffer *response;
 
     /* For real ports, iochannel, and we implement the eagain limit */
     GIOChannel *iochannel;
@@ -98,6 +138,9 @@ struct _MMPortSerialPrivate {
     guint stopbits;
     MMFlowControl flow_control;
     guint64 send_delay;
+    gboolean send_delay_adaptive;
+    SendPacing send_pacing;
+    gchar *send_pacing_key;
     gboolean spew_control;
     gboolean flash_ok;
 
@@ -109,6 +152,9 @@ struct _MMPortSerialPrivate {
 
     guint n_consecutive_timeouts;
 
+    /* NUL bytes received and escaped in the response buffer */
+    guint64 n_escaped_nul;
+
     guint connected_id;
 
     GTask *flash_task;
@@ -118,7 +164,7 @@ struct _MMPortSerialPrivate {
 /*****************************************************************************/
 /* Command */
 
-typedef struct {
+typedef struct _CommandContext {
     MMPortSerial *self;
     GSimpleAsyncResult *result;
     GCancellable *cancellable;
@@ -127,14 +173,28 @@ typedef struct {
     gboolean allow_cached;
     guint32 eagain_count;
 
+    /* Scheduling */
+    MMPortSerialPriority priority;
+    MMPortSerialPriority requested_priority;
+    gint64 queued_time;
+    gint64 deadline;
+
     guint32 idx;
     gboolean started;
     gboolean done;
+    MMTraceSpan trace_span;
+
+    /* Adaptive send pacing */
+    gboolean burst;
+    gboolean echo_checked;
+    gboolean echo_corrupted;
+    gboolean paced_retry;
 } CommandContext;
 
 static void
 command_context_complete_and_free (CommandContext *ctx, gboolean idle)
 {
+    mm_trace_end (ctx->trace_span);
     if (idle)
         g_simple_async_result_complete_in_idle (ctx->result);
     else
@@ -147,6 +207,77 @@ command_context_complete_and_free (CommandContext *ctx, gboolean idle)
     g_slice_free (CommandContext, ctx);
 }
 
+static void
+port_serial_queue_command (MMPortSerial   *self,
+                           CommandContext *ctx,
+                           gboolean        run_next)
+{
+    PriorityLane *lane;
+
+    /* Commands requested to run next (e.g. raw data after a prompt) really are
+     * the next ones sent, regardless of their class */
+    if (run_next) {
+        ctx->priority = MM_PORT_SERIAL_PRIORITY_INTERACTIVE;
+        ctx->deadline = 0;
+    } else {
+        ctx->priority = ctx->requested_priority;
+        ctx->deadline = ctx->queued_time + priority_offset_us[ctx->priority];
+    }
+
+    lane = &self->priv->lanes[ctx->priority];
+    if (run_next)
+        g_queue_push_head (lane->pending, ctx);
+    else
+        g_queue_push_tail (lane->pending, ctx);
+
+    lane->max_depth = MAX (lane->max_depth, g_queue_get_length (lane->pending));
+}
+
+/* Pops the pending command that should be sent next */
+static CommandContext *
+port_serial_dequeue_command (MMPortSerial *self)
+{
+    CommandContext *next = NULL;
+    PriorityLane   *lane;
+    gint64          wait_us;
+    guint           i;
+
+    /* Commands are queued in deadline order within each lane, so just compare
+     * the heads; on ties, the higher class wins */
+    for (i = 0; i < MM_PORT_SERIAL_PRIORITY_LAST; i++) {
+        CommandContext *head;
+
+        head = g_queue_peek_head (self->priv->lanes[i].pending);
+        if (head && (!next || head->deadline < next->deadline))
+            next = head;
+    }
+
+    if (!next)
+        return NULL;
+
+    lane = &self->priv->lanes[next->priority];
+    g_queue_pop_head (lane->pending);
+
+    wait_us = g_get_monotonic_time () - next->queued_time;
+    lane->n_sent++;
+    lane->total_wait_us += wait_us;
+    lane->max_wait_us = MAX (lane->max_wait_us, wait_us);
+
+    return next;
+}
+
+static gboolean
+port_serial_has_pending_commands (MMPortSerial *self)
+{
+    guint i;
+
+    for (i = 0; i < MM_PORT_SERIAL_PRIORITY_LAST; i++) {
+        if (!g_queue_is_empty (self->priv->lanes[i].pending))
+            return TRUE;
+    }
+    return FALSE;
+}
+
 GByteArray *
 mm_port_serial_command_finish (MMPortSerial *self,
                                GAsyncResult *res,
@@ -164,6 +295,7 @@ mm_port_serial_command (MMPortSerial *self,
                         guint32 timeout_seconds,
                         gboolean allow_cached,
                         gboolean run_next,
+                        MMPortSerialPriority priority,
                         GCancellable *cancellable,
                         GAsyncReadyCallback callback,
                         gpointer user_data)
@@ -172,6 +304,7 @@ mm_port_serial_command (MMPortSerial *self,
 
     g_return_if_fail (MM_IS_PORT_SERIAL (self));
     g_return_if_fail (command != NULL);
+    g_return_if_fail (priority < MM_PORT_SERIAL_PRIORITY_LAST);
 
     /* Setup command context */
     ctx = g_slice_new0 (CommandContext);
@@ -184,6 +317,8 @@ mm_port_serial_command (MMPortSerial *self,
     ctx->allow_cached = allow_cached;
     ctx->timeout = timeout_seconds;
     ctx->cancellable = (cancellable ? g_object_ref (cancellable) : NULL);
+    ctx->queued_time = g_get_monotonic_time ();
+    ctx->requested_priority = priority;
 
     /* Only accept about 3 seconds of EAGAIN for this command */
     if (self->priv->send_delay && mm_port_get_subsys (MM_PORT (self)) == MM_PORT_SUBSYS_TTY)
@@ -204,17 +339,22 @@ mm_port_serial_command (MMPortSerial *self,
     if (!allow_cached)
         port_serial_set_cached_reply (self, ctx->command, NULL);
 
-    /* If requested to run next, push to the head of the queue so that it really is
-     * the next one sent */
-    if (run_next)
-        g_queue_push_head (self->priv->queue, ctx);
-    else
-        g_queue_push_tail (self->priv->queue, ctx);
+    port_serial_queue_command (self, ctx, run_next);
 
-    if (g_queue_get_length (self->priv->queue) == 1)
+    if (!self->priv->current)
         port_serial_schedule_queue_process (self, 0);
 }
 
+guint
+mm_port_serial_get_queue_depth (MMPortSerial         *self,
+                                MMPortSerialPriority  priority)
+{
+    g_return_val_if_fail (MM_IS_PORT_SERIAL (self), 0);
+    g_return_val_if_fail (priority < MM_PORT_SERIAL_PRIORITY_LAST, 0);
+
+    return g_queue_get_length (self->priv->lanes[priority].pending);
+}
+
 /*****************************************************************************/
 
 static gboolean
@@ -524,18 +664,280 @@ real_config_fd (MMPortSerial *self, int fd, GError **error)
     return internal_tcsetattr (self, fd, &stbuf, error);
 }
 
+typedef struct {
+    guint8 len;
+    gchar  str[5];
+} DebugEscape;
+
+static DebugEscape debug_escape_table[256];
+
+static void
+debug_escape_table_init (void)
+{
+    static volatile gsize initialized = 0;
+    guint i;
+
+    if (!g_once_init_enter (&initialized))
+        return;
+
+    for (i = 0; i < G_N_ELEMENTS (debug_escape_table); i++) {
+        DebugEscape *escape = &debug_escape_table[i];
+
+        if (g_ascii_isprint (i)) {
+            escape->str[0] = (gchar) i;
+            escape->len = 1;
+        } else if (i == '\r')
+            escape->len = g_strlcpy (escape->str, "<CR>", sizeof (escape->str));
+        else if (i == '\n')
+            escape->len = g_strlcpy (escape->str, "<LF>", sizeof (escape->str));
+        else
+            escape->len = g_snprintf (escape->str, sizeof (escape->str), "\\%u", i);
+    }
+
+    g_once_init_leave (&initialized, 1);
+}
+
+void
+mm_port_serial_debug_escape (GString     *str,
+                             const gchar *buf,
+                             gsize        len)
+{
+    gsize pos;
+    gsize i;
+
+    debug_escape_table_init ();
+
+    /* Make room for the worst case, and then just copy from the table */
+    pos = str->len;
+    g_string_set_size (str, pos + (len * 4));
+    for (i = 0; i < len; i++) {
+        const DebugEscape *escape = &debug_escape_table[(guint8) buf[i]];
+
+        memcpy (&str->str[pos], escape->str, escape->len);
+        pos += escape->len;
+    }
+    g_string_truncate (str, pos);
+}
+
+void
+mm_port_serial_debug_format_text (GString     *str,
+                                  const gchar *prefix,
+                                  const gchar *buf,
+                                  gsize        len)
+{
+    g_string_append (str, prefix);
+    g_string_append (str, " '");
+    mm_port_serial_debug_escape (str, buf, len);
+    g_string_append_c (str, '\'');
+}
+
+void
+mm_port_serial_debug_format_hex (GString     *str,
+                                 const gchar *prefix,
+                                 const gchar *buf,
+                                 gsize        len)
+{
+    static const gchar hex[] = "0123456789abcdef";
+    gsize              pos;
+    gsize              i;
+
+    g_string_append (str, prefix);
+
+    /* Each byte as " xx" */
+    pos = str->len;
+    g_string_set_size (str, pos + (len * 3));
+    for (i = 0; i < len; i++) {
+        str->str[pos++] = ' ';
+        str->str[pos++] = hex[(guint8) buf[i] >> 4];
+        str->str[pos++] = hex[(guint8) buf[i] & 0x0f];
+    }
+}
+
 static void
 serial_debug (MMPortSerial *self,
               const gchar  *prefix,
               const gchar  *buf,
               gsize         len)
 {
+    static GString        *debug = NULL;
+    MMLogRecorderFormatFn  format;
+
     g_return_if_fail (len > 0);
 
-    if (MM_PORT_SERIAL_GET_CLASS (self)->debug_log)
-        MM_PORT_SERIAL_GET_CLASS (self)->debug_log (self, prefix, buf, len);
+    format = MM_PORT_SERIAL_GET_CLASS (self)->debug_format;
+    if (!format)
+        return;
+
+    /* Traces are only ever logged in DEBUG level, so don't even format them
+     * otherwise; the log recorder keeps the raw data and only formats it if
+     * it's ever dumped */
+    if (!mm_log_check_level_enabled (MM_LOG_LEVEL_DEBUG)) {
+        mm_log_recorder_add_data (self, prefix, buf, len, format);
+        return;
+    }
+
+    if (!debug)
+        debug = g_string_sized_new (256);
+
+    format (debug, prefix, buf, len);
+    mm_obj_dbg (self, "%s", debug->str);
+    g_string_truncate (debug, 0);
 }
 
+/*****************************************************************************/
+/* Adaptive send pacing */
+
+static gboolean
+port_serial_send_burst (MMPortSerial *self)
+{
+    return (self->priv->send_delay_adaptive &&
+            self->priv->send_delay > 0 &&
+            mm_port_get_subsys (MM_PORT (self)) == MM_PORT_SUBSYS_TTY &&
+            self->priv->send_pacing != SEND_PACING_PACED);
+}
+
+static void
+port_serial_set_send_pacing (MMPortSerial *self,
+                             SendPacing    pacing)
+{
+    if (self->priv->send_pacing == pacing)
+        return;
+
+    mm_obj_dbg (self, "send pacing updated: %s -> %s",
+                send_pacing_str[self->priv->send_pacing],
+                send_pacing_str[pacing]);
+    self->priv->send_pacing = pacing;
+
+    if (self->priv->send_pacing_key)
+        g_hash_table_insert (send_pacing_cache,
+                             g_strdup (self->priv->send_pacing_key),
+                             GUINT_TO_POINTER (pacing));
+}
+
+static void
+port_serial_load_send_pacing (MMPortSerial *self)
+{
+    MMKernelDevice *kernel_device;
+    guint16         vid;
+    guint16         pid;
+
+    if (self->priv->send_pacing_key || !port_serial_send_burst (self))
+        return;
+
+    kernel_device = mm_port_peek_kernel_device (MM_PORT (self));
+    if (!kernel_device)
+        return;
+
+    vid = mm_kernel_device_get_physdev_vid (kernel_device);
+    pid = mm_kernel_device_get_physdev_pid (kernel_device);
+    if (!vid || !pid)
+        return;
+
+    self->priv->send_pacing_key = g_strdup_printf ("%04x:%04x:%02x", vid, pid,
+                                                   mm_kernel_device_get_property_as_int_hex (kernel_device, "ID_USB_INTERFACE_NUM"));
+
+    if (G_UNLIKELY (!send_pacing_cache))
+        send_pacing_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    else {
+        gpointer cached;
+
+        if (g_hash_table_lookup_extended (send_pacing_cache, self->priv->send_pacing_key, NULL, &cached)) {
+            self->priv->send_pacing = (SendPacing) GPOINTER_TO_UINT (cached);
+            mm_obj_dbg (self, "send pacing already known for %s: %s",
+                        self->priv->send_pacing_key,
+                        send_pacing_str[self->priv->send_pacing]);
+        }
+    }
+}
+
+/* Validate the echo of a command written in a single burst, as soon as
+ * enough data is received for it */
+static void
+port_serial_check_echo (MMPortSerial *self)
+{
+    CommandContext *ctx;
+    const guint8   *data;
+    gsize           len;
+
+    ctx = self->priv->current;
+    if (!ctx || !ctx->burst || !ctx->done || ctx->echo_checked)
+        return;
+
+    if (!MM_PORT_SERIAL_GET_CLASS (self)->check_echo) {
+        ctx->echo_checked = TRUE;
+        return;
+    }
+
+    data = mm_serial_buffer_peek (self->priv->response, &len);
+    switch (MM_PORT_SERIAL_GET_CLASS (self)->check_echo (self, ctx->command, data, len)) {
+    case MM_PORT_SERIAL_ECHO_UNKNOWN:
+        return;
+    case MM_PORT_SERIAL_ECHO_CORRUPTED:
+        mm_obj_dbg (self, "corrupted echo received for command written in a single burst");
+        ctx->echo_corrupted = TRUE;
+        /* Fall through */
+    case MM_PORT_SERIAL_ECHO_VALID:
+        ctx->echo_checked = TRUE;
+        return;
+    default:
+        g_assert_not_reached ();
+    }
+}
+
+/* Update the send pacing with the result of the command, and return TRUE if
+ * the command needs to be sent again applying the send delay */
+static gboolean
+port_serial_update_send_pacing (MMPortSerial   *self,
+                                CommandContext *ctx,
+                                const GError   *error)
+{
+    /* Command written with the send delay after a failed burst; the burst
+     * corrupted the echo, so keep pacing whatever the result of the retry */
+    if (ctx->paced_retry) {
+        port_serial_set_send_pacing (self, SEND_PACING_PACED);
+        return FALSE;
+    }
+
+    if (!ctx->burst || !ctx->done)
+        return FALSE;
+
+    if (!error) {
+        /* The command was understood even if the echo was corrupted, so don't
+         * send it again, just pace the next ones */
+        port_serial_set_send_pacing (self, ctx->echo_corrupted ? SEND_PACING_PACED : SEND_PACING_BURST);
+        return FALSE;
+    }
+
+    if (g_error_matches (error, MM_SERIAL_ERROR, MM_SERIAL_ERROR_RESPONSE_TIMEOUT)) {
+        /* Not safe to retry, the command may have been run. A timeout alone
+         * says nothing about bursts (e.g. the modem may just be busy), so
+         * only the echo decides whether to pace the next ones. */
+        if (ctx->echo_corrupted)
+            port_serial_set_send_pacing (self, SEND_PACING_PACED);
+        return FALSE;
+    }
+
+    /* A command with bytes lost in the write is usually rejected with a
+     * generic error; retry only if the echo shows that is what happened, as
+     * otherwise the command may just be unsupported, or may have failed after
+     * being run. */
+    if (ctx->echo_corrupted) {
+        if (g_error_matches (error, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_UNKNOWN)) {
+            mm_obj_dbg (self, "command written in a single burst failed: retrying with send delay");
+            return TRUE;
+        }
+        port_serial_set_send_pacing (self, SEND_PACING_PACED);
+        return FALSE;
+    }
+
+    /* A valid echo means the whole command got through */
+    if (ctx->echo_checked)
+        port_serial_set_send_pacing (self, SEND_PACING_BURST);
+    return FALSE;
+}
+
+/*****************************************************************************/
+
 static gboolean
 port_serial_process_command (MMPortSerial *self,
                              CommandContext *ctx,
@@ -560,13 +962,17 @@ port_serial_process_command (MMPortSerial *self,
     /* Only print command the first time */
     if (ctx->started == FALSE) {
         ctx->started = TRUE;
+        ctx->burst = port_serial_send_burst (self) && !ctx->paced_retry;
         serial_debug (self, "-->", (const gchar *) ctx->command->data, ctx->command->len);
+        /* A paced retry keeps the span of the first attempt */
+        if (!ctx->trace_span && mm_trace_enabled () && MM_PORT_SERIAL_GET_CLASS (self)->trace_command)
+            ctx->trace_span = MM_PORT_SERIAL_GET_CLASS (self)->trace_command (self, ctx->command);
     }
 
-    if (self->priv->send_delay == 0 || mm_port_get_subsys (MM_PORT (self)) != MM_PORT_SUBSYS_TTY) {
-        /* Send the whole command in one write */
-        send_len = (gssize)ctx->command->len;
-        p = (gchar *)ctx->command->data;
+    if (self->priv->send_delay == 0 || mm_port_get_subsys (MM_PORT (self)) != MM_PORT_SUBSYS_TTY || ctx->burst) {
+        /* Send the whole (pending) command in one write */
+        send_len = (gssize)(ctx->command->len - ctx->idx);
+        p = (gchar *)&ctx->command->data[ctx->idx];
     } else {
         /* Send just one byte of the command */
         send_len = 1;
@@ -737,7 +1143,24 @@ port_serial_got_response (MMPortSerial *self,
     {
         CommandContext *ctx;
 
-        ctx = (CommandContext *) g_queue_pop_head (self->priv->queue);
+        ctx = self->priv->current;
+        if (ctx && port_serial_update_send_pacing (self, ctx, error)) {
+            /* Write the command again from the start, keeping it as the
+             * current one */
+            ctx->paced_retry = TRUE;
+            ctx->burst = FALSE;
+            ctx->started = FALSE;
+            ctx->done = FALSE;
+            ctx->echo_checked = FALSE;
+            ctx->echo_corrupted = FALSE;
+            ctx->idx = 0;
+            port_serial_schedule_queue_process (self, 0);
+            g_object_unref (self);
+            return;
+        }
+
+        ctx = self->priv->current;
+        self->priv->current = NULL;
         if (ctx) {
             /* Complete the command context with the appropriate result */
             if (error)
@@ -755,7 +1178,7 @@ port_serial_got_response (MMPortSerial *self,
             command_context_complete_and_free (ctx, FALSE);
         }
 
-        if (!g_queue_is_empty (self->priv->queue))
+        if (port_serial_has_pending_commands (self))
             port_serial_schedule_queue_process (self, 0);
     }
     g_object_unref (self);
@@ -823,7 +1246,11 @@ port_serial_queue_process (gpointer data)
 
     self->priv->queue_id = 0;
 
-    ctx = (CommandContext *) g_queue_peek_head (self->priv->queue);
+    /* Pick the next command to send, unless the current one is still being
+     * written */
+    if (!self->priv->current)
+        self->priv->current = port_serial_dequeue_command (self);
+    ctx = self->priv->current;
     if (!ctx)
         return G_SOURCE_REMOVE;
 
@@ -856,7 +1283,7 @@ port_serial_queue_process (gpointer data)
     /* Schedule the next byte of the command to be sent */
     if (!ctx->done) {
         port_serial_schedule_queue_process (self,
-                                            (mm_port_get_subsys (MM_PORT (self)) == MM_PORT_SUBSYS_TTY ?
+                                            ((mm_port_get_subsys (MM_PORT (self)) == MM_PORT_SUBSYS_TTY && !ctx->burst) ?
                                              self->priv->send_delay / 1000 :
                                              0));
         return G_SOURCE_REMOVE;
@@ -898,6 +1325,10 @@ parse_response_buffer (MMPortSerial *self)
     GError *error = NULL;
     GByteArray *parsed_response = NULL;
 
+    /* Validate the echo of the command in progress, if needed, before any
+     * parsing modifies the response buffer */
+    port_serial_check_echo (self);
+
     /* Parse unsolicited messages in the subclass.
      *
      * If any message found, it's processed immediately and the message is
@@ -947,7 +1378,8 @@ common_input_available (MMPortSerial *self,
                         GIOCondition condition)
 {
     char buf[SERIAL_BUF_SIZE + 1];
-    gsize bytes_read = 0, data_len = 0, i = 0, j = 0;
+    gsize bytes_read = 0;
+    gboolean escape_nul = FALSE;
     GIOStatus status = G_IO_STATUS_NORMAL;
     CommandContext *ctx;
     GError *error = NULL;
@@ -956,20 +1388,18 @@ common_input_available (MMPortSerial *self,
 
     if (condition & G_IO_HUP) {
         mm_obj_dbg (self, "unexpected port hangup!");
-        if (self->priv->response->len)
-            g_byte_array_remove_range (self->priv->response, 0, self->priv->response->len);
+        mm_serial_buffer_clear (self->priv->response);
         port_serial_close_force (self);
         return G_SOURCE_REMOVE;
     }
 
     if (condition & G_IO_ERR) {
-        if (self->priv->response->len)
-            g_byte_array_remove_range (self->priv->response, 0, self->priv->response->len);
+        mm_serial_buffer_clear (self->priv->response);
         return G_SOURCE_CONTINUE;
     }
 
     /* Don't read any input if the current command isn't done being sent yet */
-    ctx = g_queue_peek_nth (self->priv->queue, 0);
+    ctx = self->priv->current;
     if (ctx && (ctx->started == TRUE) && (ctx->done == FALSE))
         return G_SOURCE_CONTINUE;
 
@@ -987,27 +1417,8 @@ common_input_available (MMPortSerial *self,
                     mm_obj_warn (self, "read error: %s", error->message);
                 g_clear_error (&error);
             } else {
-                /* convert NULs to "\\0" */
-                if (bytes_read > 0) {
-                    data_len = bytes_read;
-                    for (i = bytes_read - 1; i > 0; --i) {
-                        if (buf[i] == '\0') {
-                            /* Shuffle over by one to sub 2 char "\0" for '\0' */
-                            if (data_len + 1 < SERIAL_BUF_SIZE) {
-                                buf[data_len + 1] = '\0';
-                            }
-                            for (j = data_len; j >= i; --j) {
-                                if (j + 1 < SERIAL_BUF_SIZE) {
-                                    buf[j + 1] = buf[j];
-                                }
-                            }
-                            buf[i] = '\\';
-                            buf[i + 1] = '0';
-                            data_len++;
-                        }
-                    }
-                    bytes_read = data_len;
-                }
+                /* NULs are converted to "\\0" when stored in the response buffer */
+                escape_nul = TRUE;
             }
         } else if (self->priv->socket) {
             gssize sbytes_read;
@@ -1037,13 +1448,16 @@ common_input_available (MMPortSerial *self,
 
         g_assert (bytes_read > 0);
         serial_debug (self, "<--", buf, bytes_read);
-        g_byte_array_append (self->priv->response, (const guint8 *) buf, bytes_read);
+        if (escape_nul)
+            self->priv->n_escaped_nul += mm_serial_buffer_append_escape_nul (self->priv->response, (const guint8 *) buf, bytes_read);
+        else
+            mm_serial_buffer_append (self->priv->response, (const guint8 *) buf, bytes_read);
 
         /* Make sure the response doesn't grow too long */
-        if ((self->priv->response->len > SERIAL_BUF_SIZE) && self->priv->spew_control) {
+        if ((mm_serial_buffer_get_len (self->priv->response) > SERIAL_BUF_SIZE) && self->priv->spew_control) {
             /* Notify listeners and then trim the buffer */
             g_signal_emit (self, signals[BUFFER_FULL], 0, self->priv->response);
-            g_byte_array_remove_range (self->priv->response, 0, (SERIAL_BUF_SIZE / 2));
+            mm_serial_buffer_consume (self->priv->response, (SERIAL_BUF_SIZE / 2));
         }
 
         /* See if we can parse anything. The response parsing may actually
@@ -1202,6 +1616,8 @@ mm_port_serial_open (MMPortSerial *self, GError **error)
 
     mm_obj_dbg (self, "opening serial port...");
 
+    port_serial_load_send_pacing (self);
+
     g_get_current_time (&tv_start);
 
     /* Non-socket setup needs the fd open */
@@ -1449,6 +1865,18 @@ _close_internal (MMPortSerial *self, gboolean force)
         g_get_current_time (&tv_end);
 
         mm_obj_dbg (self, "serial port closed");
+        if (self->priv->n_escaped_nul)
+            mm_obj_dbg (self, "NUL bytes escaped in received data: %" G_GUINT64_FORMAT, self->priv->n_escaped_nul);
+        for (i = 0; i < MM_PORT_SERIAL_PRIORITY_LAST; i++) {
+            PriorityLane *lane = &self->priv->lanes[i];
+
+            if (!lane->n_sent)
+                continue;
+            mm_obj_dbg (self, "%s commands: %" G_GUINT64_FORMAT " sent, max queue depth %u, "
+                        "wait time %" G_GINT64_FORMAT "ms average, %" G_GINT64_FORMAT "ms max",
+                        priority_str[i], lane->n_sent, lane->max_depth,
+                        (lane->total_wait_us / (gint64) lane->n_sent) / 1000, lane->max_wait_us / 1000);
+        }
 
         /* Some ports don't respond to data and when close is called
          * the serial layer waits up to 30 second (closing_wait) for
@@ -1460,17 +1888,25 @@ _close_internal (MMPortSerial *self, gboolean force)
     }
 
     /* Clear the command queue */
-    for (i = 0; i < g_queue_get_length (self->priv->queue); i++) {
-        CommandContext *ctx;
-
-        ctx = g_queue_peek_nth (self->priv->queue, i);
-        g_simple_async_result_set_error (ctx->result,
+    if (self->priv->current) {
+        g_simple_async_result_set_error (self->priv->current->result,
                                          MM_SERIAL_ERROR,
                                          MM_SERIAL_ERROR_SEND_FAILED,
                                          "Serial port is now closed");
-        command_context_complete_and_free (ctx, TRUE);
+        command_context_complete_and_free (self->priv->current, TRUE);
+        self->priv->current = NULL;
+    }
+    for (i = 0; i < MM_PORT_SERIAL_PRIORITY_LAST; i++) {
+        CommandContext *ctx;
+
+        while ((ctx = g_queue_pop_head (self->priv->lanes[i].pending)) != NULL) {
+            g_simple_async_result_set_error (ctx->result,
+                                             MM_SERIAL_ERROR,
+                                             MM_SERIAL_ERROR_SEND_FAILED,
+                                             "Serial port is now closed");
+            command_context_complete_and_free (ctx, TRUE);
+        }
     }
-    g_queue_clear (self->priv->queue);
 
     if (self->priv->timeout_id) {
         g_source_remove (self->priv->timeout_id);
@@ -1917,6 +2353,16 @@ mm_port_serial_get_flow_control (MMPortSerial *self)
 
 /*****************************************************************************/
 
+guint64
+mm_port_serial_get_n_escaped_nul (MMPortSerial *self)
+{
+    g_return_val_if_fail (MM_IS_PORT_SERIAL (self), 0);
+
+    return self->priv->n_escaped_nul;
+}
+
+/*****************************************************************************/
+
 MMPortSerial *
 mm_port_serial_new (const char *name, MMPortType ptype)
 {
@@ -1972,6 +2418,8 @@ ba_free (gpointer v)
 static void
 mm_port_serial_init (MMPortSerial *self)
 {
+    guint i;
+
     self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, MM_TYPE_PORT_SERIAL, MMPortSerialPrivate);
 
     self->priv->reply_cache = g_hash_table_new_full (ba_hash, ba_equal, ba_free, ba_free);
@@ -1984,8 +2432,9 @@ mm_port_serial_init (MMPortSerial *self)
     self->priv->flow_control = MM_FLOW_CONTROL_UNKNOWN;
     self->priv->send_delay = 1000;
 
-    self->priv->queue = g_queue_new ();
-    self->priv->response = g_byte_array_sized_new (500);
+    for (i = 0; i < MM_PORT_SERIAL_PRIORITY_LAST; i++)
+        self->priv->lanes[i].pending = g_queue_new ();
+    self->priv->response = mm_serial_buffer_new (2 * SERIAL_BUF_SIZE);
 }
 
 static void
@@ -2018,6 +2467,9 @@ set_property (GObject *object,
     case PROP_SEND_DELAY:
         self->priv->send_delay = g_value_get_uint64 (value);
         break;
+    case PROP_SEND_DELAY_ADAPTIVE:
+        self->priv->send_delay_adaptive = g_value_get_boolean (value);
+        break;
     case PROP_SPEW_CONTROL:
         self->priv->spew_control = g_value_get_boolean (value);
         break;
@@ -2060,6 +2512,9 @@ get_property (GObject *object,
     case PROP_SEND_DELAY:
         g_value_set_uint64 (value, self->priv->send_delay);
         break;
+    case PROP_SEND_DELAY_ADAPTIVE:
+        g_value_set_boolean (value, self->priv->send_delay_adaptive);
+        break;
     case PROP_SPEW_CONTROL:
         g_value_set_boolean (value, self->priv->spew_control);
         break;
@@ -2076,6 +2531,7 @@ static void
 finalize (GObject *object)
 {
     MMPortSerial *self = MM_PORT_SERIAL (object);
+    guint i;
 
     port_serial_close_force     (MM_PORT_SERIAL (object));
     mm_port_serial_flash_cancel (MM_PORT_SERIAL (object));
@@ -2093,8 +2549,10 @@ finalize (GObject *object)
         g_source_remove (self->priv->queue_id);
 
     g_hash_table_destroy (self->priv->reply_cache);
-    g_byte_array_unref (self->priv->response);
-    g_queue_free (self->priv->queue);
+    g_free (self->priv->send_pacing_key);
+    mm_serial_buffer_free (self->priv->response);
+    for (i = 0; i < MM_PORT_SERIAL_PRIORITY_LAST; i++)
+        g_queue_free (self->priv->lanes[i].pending);
 
     G_OBJECT_CLASS (mm_port_serial_parent_class)->finalize (object);
 }
@@ -2171,6 +2629,15 @@ mm_port_serial_class_init (MMPortSerialClass *klass)
                               0, G_MAXUINT64, 0,
                               G_PARAM_READWRITE));
 
+    g_object_class_install_property
+        (object_class, PROP_SEND_DELAY_ADAPTIVE,
+         g_param_spec_boolean (MM_PORT_SERIAL_SEND_DELAY_ADAPTIVE,
+                               "SendDelayAdaptive",
+                               "Write commands in a single burst and only apply "
+                               "the send delay if the device requires it",
+                               FALSE,
+                               G_PARAM_READWRITE));
+
     g_object_class_install_property
         (object_class, PROP_SPEW_CONTROL,
          g_param_spec_boolean (MM_PORT_SERIAL_SPEW_CONTROL,
@@ -22,7 +22,10 @@
 #include <gio/gio.h>
 
 #include "mm-modem-helpers.h"
+#include "mm-log.h"
 #include "mm-port.h"
+#include "mm-serial-buffer.h"
+#include "mm-trace.h"
 
 #define MM_TYPE_PORT_SERIAL            (mm_port_serial_get_type ())
 #define MM_PORT_SERIAL(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), MM_TYPE_PORT_SERIAL, MMPortSerial))
@@ -37,6 +40,7 @@
 #define MM_PORT_SERIAL_STOPBITS     "stopbits"
 #define MM_PORT_SERIAL_FLOW_CONTROL "flowcontrol"
 #define MM_PORT_SERIAL_SEND_DELAY   "send-delay"
+#define MM_PORT_SERIAL_SEND_DELAY_ADAPTIVE "send-delay-adaptive"
 #define MM_PORT_SERIAL_FD           "fd" /* Construct-only */
 #define MM_PORT_SERIAL_SPEW_CONTROL "spew-control" /* Construct-only */
 #define MM_PORT_SERIAL_FLASH_OK     "flash-ok" /* Construct-only */
@@ -47,6 +51,22 @@ typedef enum {
     MM_PORT_SERIAL_RESPONSE_ERROR,
 } MMPortSerialResponseType;
 
+typedef enum {
+    MM_PORT_SERIAL_ECHO_UNKNOWN,
+    MM_PORT_SERIAL_ECHO_VALID,
+    MM_PORT_SERIAL_ECHO_CORRUPTED,
+} MMPortSerialEchoResult;
+
+/* Command priority classes. Pending commands are sent in class order, but a
+ * command that has been waiting long enough goes before newer commands of a
+ * higher class, so that no class is starved. */
+typedef enum {
+    MM_PORT_SERIAL_PRIORITY_INTERACTIVE,
+    MM_PORT_SERIAL_PRIORITY_NORMAL,
+    MM_PORT_SERIAL_PRIORITY_BACKGROUND,
+    MM_PORT_SERIAL_PRIORITY_LAST
+} MMPortSerialPriority;
+
 typedef struct _MMPortSerial MMPortSerial;
 typedef struct _MMPortSerialClass MMPortSerialClass;
 typedef struct _MMPortSerialPrivate MMPortSerialPrivate;
@@ -60,10 +80,10 @@ struct _MMPortSerialClass {
     MMPortClass parent;
 
     /* Called for subclasses to parse unsolicited responses.  If any recognized
-     * unsolicited response is found, it should be removed from the 'response'
-     * byte array before returning.
+     * unsolicited response is found, it should be consumed or cut from the
+     * 'response' buffer before returning.
      */
-    void     (*parse_unsolicited) (MMPortSerial *self, GByteArray *response);
+    void     (*parse_unsolicited) (MMPortSerial *self, MMSerialBuffer *response);
 
     /*
      * Called to parse the device's response to a command or determine if the
@@ -78,14 +98,27 @@ struct _MMPortSerialClass {
      * If there is no response, @MM_PORT_SERIAL_RESPONSE_NONE will be returned,
      * and neither @error nor @parsed_response will be set.
      *
-     * The implementation is allowed to cleanup the @response byte array, e.g. to
-     * just remove 1 single response if more than one found.
+     * The implementation is allowed to consume data from the @response buffer,
+     * e.g. to just remove 1 single response if more than one found.
      */
     MMPortSerialResponseType (*parse_response) (MMPortSerial *self,
-                                                GByteArray *response,
+                                                MMSerialBuffer *response,
                                                 GByteArray **parsed_response,
                                                 GError **error);
 
+    /*
+     * Called to validate the echo of a @command written in a single burst
+     * with the data received so far, when adaptive send pacing is in use.
+     *
+     * Should return @MM_PORT_SERIAL_ECHO_CORRUPTED if the data shows that the
+     * device didn't get the full command, or @MM_PORT_SERIAL_ECHO_UNKNOWN if
+     * more data is needed to decide.
+     */
+    MMPortSerialEchoResult (*check_echo) (MMPortSerial     *self,
+                                          const GByteArray *command,
+                                          const guint8     *data,
+                                          gsize             len);
+
     /* Called to configure the serial port fd after it's opened.  On error, should
      * return FALSE and set 'error' as appropriate.
      */
@@ -95,13 +128,18 @@ struct _MMPortSerialClass {
      * should get ignored. */
     void (*config)                (MMPortSerial *self);
 
-    void (*debug_log)             (MMPortSerial *self,
-                                   const gchar  *prefix,
-                                   const gchar  *buf,
-                                   gsize         len);
+    /* Formats traffic traces, either to be logged right away or when the
+     * log recorder is dumped */
+    MMLogRecorderFormatFn debug_format;
+
+    /* Called when tracing is enabled and a @command is first written, to
+     * begin the trace span that lasts until the command completes. May
+     * return 0 if the command isn't traced. */
+    MMTraceSpan (*trace_command) (MMPortSerial     *self,
+                                  const GByteArray *command);
 
     /* Signals */
-    void (*buffer_full)           (MMPortSerial *port, const GByteArray *buffer);
+    void (*buffer_full)           (MMPortSerial *port, MMSerialBuffer *buffer);
     void (*timed_out)             (MMPortSerial *port, guint n_consecutive_replies);
     void (*forced_close)          (MMPortSerial *port);
 };
@@ -140,11 +178,14 @@ gboolean mm_port_serial_flash_finish      (MMPortSerial *self,
                                            GError **error);
 void     mm_port_serial_flash_cancel      (MMPortSerial *self);
 
+/* Commands are scheduled in the given @priority class. Commands requested to
+ * @run_next are always sent first, regardless of the class. */
 void        mm_port_serial_command        (MMPortSerial *self,
                                            GByteArray *command,
                                            guint32 timeout_seconds,
                                            gboolean allow_cached,
                                            gboolean run_next,
+                                           MMPortSerialPriority priority,
                                            GCancellable *cancellable,
                                            GAsyncReadyCallback callback,
                                            gpointer user_data);
@@ -152,9 +193,33 @@ GByteArray *mm_port_serial_command_finish (MMPortSerial *self,
                                            GAsyncResult *res,
                                            GError **error);
 
+/* Number of commands of the given class waiting to be sent */
+guint mm_port_serial_get_queue_depth (MMPortSerial         *self,
+                                      MMPortSerialPriority  priority);
+
 gboolean mm_port_serial_set_flow_control (MMPortSerial   *self,
                                           MMFlowControl   flow_control,
                                           GError        **error);
 
 MMFlowControl mm_port_serial_get_flow_control (MMPortSerial *self);
+
+/* Number of NUL bytes received and escaped as "\\0" since the port was created */
+guint64 mm_port_serial_get_n_escaped_nul (MMPortSerial *self);
+
+/* Appends @buf to @str with <CR> and <LF> shown as such and any other
+ * non-printable byte as its decimal value */
+void mm_port_serial_debug_escape (GString     *str,
+                                  const gchar *buf,
+                                  gsize        len);
+
+/* debug_format() implementations: "<prefix> '<escaped text>'" and
+ * "<prefix> xx xx ..." respectively */
+void mm_port_serial_debug_format_text (GString     *str,
+                                       const gchar *prefix,
+                                       const gchar *buf,
+                                       gsize        len);
+void mm_port_serial_debug_format_hex  (GString     *str,
+                                       const gchar *prefix,
+                                       const gchar *buf,
+                                       gsize        len);
 #endif /* MM_PORT_SERIAL_H */
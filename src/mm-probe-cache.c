@@ -0,0 +1,280 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "mm-probe-cache.h"
+#include "mm-versioned-key-file.h"
+#include "mm-log.h"
+
+/*
+ * The cache is stored as a key file:
+ *
+ *   [probe-cache]
+ *   version=<daemon version>
+ *
+ *   [device <device key>]
+ *   plugin=<plugin name>
+ *   ports=<port key>;<port key>;...
+ *
+ *   [port <device key> <port key>]
+ *   probed=<MMPortProbeFlag mask>
+ *   at=true|false
+ *   ...
+ */
+
+#define CACHE_GROUP        "probe-cache"
+#define DEVICE_KEY_PLUGIN  "plugin"
+#define DEVICE_KEY_PORTS   "ports"
+#define PORT_KEY_PROBED    "probed"
+#define PORT_KEY_AT        "at"
+#define PORT_KEY_QCDM      "qcdm"
+#define PORT_KEY_QMI       "qmi"
+#define PORT_KEY_MBIM      "mbim"
+#define PORT_KEY_ICERA     "icera"
+#define PORT_KEY_XMM       "xmm"
+#define PORT_KEY_VENDOR    "vendor"
+#define PORT_KEY_PRODUCT   "product"
+
+struct _MMProbeCache {
+    gpointer  log_object;
+    gchar    *path;
+    GKeyFile *key_file;
+};
+
+/*****************************************************************************/
+
+void
+mm_probe_cache_port_clear (MMProbeCachePort *port)
+{
+    g_clear_pointer (&port->vendor, g_free);
+    g_clear_pointer (&port->product, g_free);
+}
+
+/*****************************************************************************/
+
+gchar *
+mm_probe_cache_build_device_key (guint16 vid,
+                                 guint16 pid,
+                                 guint16 revision)
+{
+    if (!vid && !pid)
+        return NULL;
+    return g_strdup_printf ("%04x:%04x:%04x", vid, pid, revision);
+}
+
+gchar *
+mm_probe_cache_build_port_key (const gchar *subsystem,
+                               const gchar *interface_number,
+                               const gchar *driver)
+{
+    if (!subsystem || !interface_number)
+        return NULL;
+    return g_strdup_printf ("%s/%s/%s", subsystem, interface_number, driver ? driver : "none");
+}
+
+static gchar *
+build_device_group (const gchar *device_key)
+{
+    return g_strdup_printf ("device %s", device_key);
+}
+
+static gchar *
+build_port_group (const gchar *device_key,
+                  const gchar *port_key)
+{
+    return g_strdup_printf ("port %s %s", device_key, port_key);
+}
+
+/*****************************************************************************/
+
+gchar *
+mm_probe_cache_get_plugin (MMProbeCache *self,
+                           const gchar  *device_key)
+{
+    g_autofree gchar *group = NULL;
+
+    group = build_device_group (device_key);
+    return g_key_file_get_string (self->key_file, group, DEVICE_KEY_PLUGIN, NULL);
+}
+
+gchar **
+mm_probe_cache_get_ports (MMProbeCache *self,
+                          const gchar  *device_key)
+{
+    g_autofree gchar *group = NULL;
+
+    group = build_device_group (device_key);
+    return g_key_file_get_string_list (self->key_file, group, DEVICE_KEY_PORTS, NULL, NULL);
+}
+
+gboolean
+mm_probe_cache_get_port (MMProbeCache     *self,
+                         const gchar      *device_key,
+                         const gchar      *port_key,
+                         MMProbeCachePort *port)
+{
+    g_autofree gchar *group = NULL;
+    GError           *error = NULL;
+
+    group = build_port_group (device_key, port_key);
+    if (!g_key_file_has_group (self->key_file, group))
+        return FALSE;
+
+    memset (port, 0, sizeof (MMProbeCachePort));
+    port->probed   = (guint) g_key_file_get_integer (self->key_file, group, PORT_KEY_PROBED, &error);
+    port->is_at    = g_key_file_get_boolean (self->key_file, group, PORT_KEY_AT, error ? NULL : &error);
+    port->is_qcdm  = g_key_file_get_boolean (self->key_file, group, PORT_KEY_QCDM, error ? NULL : &error);
+    port->is_qmi   = g_key_file_get_boolean (self->key_file, group, PORT_KEY_QMI, error ? NULL : &error);
+    port->is_mbim  = g_key_file_get_boolean (self->key_file, group, PORT_KEY_MBIM, error ? NULL : &error);
+    port->is_icera = g_key_file_get_boolean (self->key_file, group, PORT_KEY_ICERA, error ? NULL : &error);
+    port->is_xmm   = g_key_file_get_boolean (self->key_file, group, PORT_KEY_XMM, error ? NULL : &error);
+    /* Vendor and product are optional */
+    port->vendor   = g_key_file_get_string (self->key_file, group, PORT_KEY_VENDOR, NULL);
+    port->product  = g_key_file_get_string (self->key_file, group, PORT_KEY_PRODUCT, NULL);
+
+    if (error) {
+        mm_obj_warn (self->log_object, "invalid probe cache entry '%s': %s", group, error->message);
+        g_error_free (error);
+        mm_probe_cache_port_clear (port);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*****************************************************************************/
+
+static gboolean
+remove_port_groups (MMProbeCache *self,
+                    const gchar  *device_key)
+{
+    g_autofree gchar  *prefix = NULL;
+    gchar            **groups;
+    guint              i;
+    gboolean           found = FALSE;
+
+    prefix = g_strdup_printf ("port %s ", device_key);
+    groups = g_key_file_get_groups (self->key_file, NULL);
+    for (i = 0; groups[i]; i++) {
+        if (g_str_has_prefix (groups[i], prefix)) {
+            g_key_file_remove_group (self->key_file, groups[i], NULL);
+            found = TRUE;
+        }
+    }
+    g_strfreev (groups);
+    return found;
+}
+
+gboolean
+mm_probe_cache_remove_device (MMProbeCache *self,
+                              const gchar  *device_key)
+{
+    g_autofree gchar *group = NULL;
+    gboolean          found;
+
+    group = build_device_group (device_key);
+    found = g_key_file_remove_group (self->key_file, group, NULL);
+    if (remove_port_groups (self, device_key))
+        found = TRUE;
+    return found;
+}
+
+void
+mm_probe_cache_set_device (MMProbeCache *self,
+                           const gchar  *device_key,
+                           const gchar  *plugin)
+{
+    g_autofree gchar *group = NULL;
+
+    mm_probe_cache_remove_device (self, device_key);
+
+    group = build_device_group (device_key);
+    g_key_file_set_string (self->key_file, group, DEVICE_KEY_PLUGIN, plugin);
+    g_key_file_set_string_list (self->key_file, group, DEVICE_KEY_PORTS, NULL, 0);
+}
+
+void
+mm_probe_cache_set_port (MMProbeCache           *self,
+                         const gchar            *device_key,
+                         const gchar            *port_key,
+                         const MMProbeCachePort *port)
+{
+    g_autofree gchar *device_group = NULL;
+    g_autofree gchar *group = NULL;
+    gchar           **ports;
+    gsize             n_ports = 0;
+
+    device_group = build_device_group (device_key);
+    g_return_if_fail (g_key_file_has_group (self->key_file, device_group));
+
+    /* Add to the list of ports of the device, if not there already */
+    ports = g_key_file_get_string_list (self->key_file, device_group, DEVICE_KEY_PORTS, &n_ports, NULL);
+    if (!ports || !g_strv_contains ((const gchar * const *) ports, port_key)) {
+        ports = g_renew (gchar *, ports, n_ports + 2);
+        ports[n_ports++] = g_strdup (port_key);
+        ports[n_ports] = NULL;
+        g_key_file_set_string_list (self->key_file, device_group, DEVICE_KEY_PORTS,
+                                    (const gchar * const *) ports, n_ports);
+    }
+    g_strfreev (ports);
+
+    group = build_port_group (device_key, port_key);
+    g_key_file_remove_group (self->key_file, group, NULL);
+    g_key_file_set_integer (self->key_file, group, PORT_KEY_PROBED, (gint) port->probed);
+    g_key_file_set_boolean (self->key_file, group, PORT_KEY_AT,    port->is_at);
+    g_key_file_set_boolean (self->key_file, group, PORT_KEY_QCDM,  port->is_qcdm);
+    g_key_file_set_boolean (self->key_file, group, PORT_KEY_QMI,   port->is_qmi);
+    g_key_file_set_boolean (self->key_file, group, PORT_KEY_MBIM,  port->is_mbim);
+    g_key_file_set_boolean (self->key_file, group, PORT_KEY_ICERA, port->is_icera);
+    g_key_file_set_boolean (self->key_file, group, PORT_KEY_XMM,   port->is_xmm);
+    if (port->vendor)
+        g_key_file_set_string (self->key_file, group, PORT_KEY_VENDOR, port->vendor);
+    if (port->product)
+        g_key_file_set_string (self->key_file, group, PORT_KEY_PRODUCT, port->product);
+}
+
+/*****************************************************************************/
+
+gboolean
+mm_probe_cache_save (MMProbeCache  *self,
+                     GError       **error)
+{
+    return mm_versioned_key_file_save (self->key_file, self->path, error);
+}
+
+MMProbeCache *
+mm_probe_cache_new (const gchar *path,
+                    gpointer     log_object)
+{
+    MMProbeCache *self;
+
+    self = g_slice_new0 (MMProbeCache);
+    self->log_object = log_object;
+    self->path = g_strdup (path);
+
+    /* Plugins and probing logic may change between releases, so results
+     * stored by other versions aren't trusted */
+    self->key_file = mm_versioned_key_file_load (path, CACHE_GROUP, "probe cache", log_object);
+    if (!self->key_file)
+        self->key_file = mm_versioned_key_file_new (CACHE_GROUP);
+    return self;
+}
+
+void
+mm_probe_cache_free (MMProbeCache *self)
+{
+    g_key_file_free (self->key_file);
+    g_free (self->path);
+    g_slice_free (MMProbeCache, self);
+}
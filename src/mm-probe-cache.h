@@ -0,0 +1,87 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_PROBE_CACHE_H
+#define MM_PROBE_CACHE_H
+
+#include <glib.h>
+
+/*
+ * Persistent cache of port probing results.
+ *
+ * Devices are identified by the VID, PID and revision of their physical
+ * device, and each of their ports by subsystem, USB interface number and
+ * driver, so that entries stay valid across reboots and re-enumerations
+ * even if port names change. For every device the cache keeps the plugin
+ * that ended up handling it and the full list of ports it exposed; for
+ * every port, the results of the probings that were run on it.
+ *
+ * Entries are written by a daemon of the same version only; a cache file
+ * written by a different version is discarded when loaded.
+ */
+
+typedef struct _MMProbeCache MMProbeCache;
+
+typedef struct {
+    /* Mask of MMPortProbeFlag values for which results are available */
+    guint     probed;
+    gboolean  is_at;
+    gboolean  is_qcdm;
+    gboolean  is_qmi;
+    gboolean  is_mbim;
+    gboolean  is_icera;
+    gboolean  is_xmm;
+    gchar    *vendor;
+    gchar    *product;
+} MMProbeCachePort;
+
+void          mm_probe_cache_port_clear (MMProbeCachePort *port);
+
+/* Loads the cache contents from @path, if it exists. */
+MMProbeCache *mm_probe_cache_new        (const gchar      *path,
+                                         gpointer          log_object);
+void          mm_probe_cache_free       (MMProbeCache     *self);
+gboolean      mm_probe_cache_save       (MMProbeCache     *self,
+                                         GError          **error);
+
+/* Returns NULL if the device or port can't be identified reliably */
+gchar        *mm_probe_cache_build_device_key (guint16      vid,
+                                               guint16      pid,
+                                               guint16      revision);
+gchar        *mm_probe_cache_build_port_key   (const gchar *subsystem,
+                                               const gchar *interface_number,
+                                               const gchar *driver);
+
+/* Lookups */
+gchar        *mm_probe_cache_get_plugin (MMProbeCache     *self,
+                                         const gchar      *device_key);
+gchar       **mm_probe_cache_get_ports  (MMProbeCache     *self,
+                                         const gchar      *device_key);
+gboolean      mm_probe_cache_get_port   (MMProbeCache     *self,
+                                         const gchar      *device_key,
+                                         const gchar      *port_key,
+                                         MMProbeCachePort *port);
+
+/* Updates. A device entry is replaced as a whole: set_device() drops all
+ * the ports previously stored for the device. */
+void          mm_probe_cache_set_device    (MMProbeCache           *self,
+                                            const gchar            *device_key,
+                                            const gchar            *plugin);
+void          mm_probe_cache_set_port      (MMProbeCache           *self,
+                                            const gchar            *device_key,
+                                            const gchar            *port_key,
+                                            const MMProbeCachePort *port);
+gboolean      mm_probe_cache_remove_device (MMProbeCache           *self,
+                                            const gchar            *device_key);
+
+#endif /* MM_PROBE_CACHE_H */
@@ -0,0 +1,236 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "mm-property-cache.h"
+#include "mm-versioned-key-file.h"
+#include "mm-log.h"
+
+/*
+ * The cache is stored as a key file:
+ *
+ *   [property-cache]
+ *   version=<daemon version>
+ *
+ *   [unit <unit key>]
+ *   equipment-id=<equipment id>
+ *   <property>=<GVariant text format>
+ *   ...
+ *
+ * The unit key is built from the URI-escaped equipment id and revision,
+ * separated by '/'.
+ */
+
+#define CACHE_GROUP            "property-cache"
+#define UNIT_KEY_EQUIPMENT_ID  "equipment-id"
+
+struct _MMPropertyCache {
+    gpointer  log_object;
+    gchar    *path;
+    GKeyFile *key_file;
+};
+
+/*****************************************************************************/
+
+gchar *
+mm_property_cache_build_unit_key (const gchar *equipment_id,
+                                  const gchar *revision)
+{
+    g_autofree gchar *escaped_equipment_id = NULL;
+    g_autofree gchar *escaped_revision = NULL;
+
+    if (!equipment_id || !equipment_id[0] || !revision || !revision[0])
+        return NULL;
+
+    escaped_equipment_id = g_uri_escape_string (equipment_id, NULL, FALSE);
+    escaped_revision = g_uri_escape_string (revision, NULL, FALSE);
+    return g_strdup_printf ("%s/%s", escaped_equipment_id, escaped_revision);
+}
+
+static gchar *
+build_unit_group (const gchar *unit_key)
+{
+    return g_strdup_printf ("unit %s", unit_key);
+}
+
+static gchar *
+build_equipment_id (const gchar *unit_key)
+{
+    const gchar *separator;
+
+    separator = strchr (unit_key, '/');
+    g_assert (separator);
+    return g_strndup (unit_key, separator - unit_key);
+}
+
+/*****************************************************************************/
+
+gboolean
+mm_property_cache_has_unit (MMPropertyCache *self,
+                            const gchar     *unit_key)
+{
+    g_autofree gchar *group = NULL;
+
+    group = build_unit_group (unit_key);
+    return g_key_file_has_group (self->key_file, group);
+}
+
+gboolean
+mm_property_cache_remove_unit (MMPropertyCache *self,
+                               const gchar     *unit_key)
+{
+    g_autofree gchar *group = NULL;
+
+    group = build_unit_group (unit_key);
+    return g_key_file_remove_group (self->key_file, group, NULL);
+}
+
+void
+mm_property_cache_set_unit (MMPropertyCache *self,
+                            const gchar     *unit_key)
+{
+    g_autofree gchar  *group = NULL;
+    g_autofree gchar  *equipment_id = NULL;
+    gchar            **groups;
+    guint              i;
+
+    /* Drop all entries of the same unit, including those of other firmware
+     * revisions */
+    equipment_id = build_equipment_id (unit_key);
+    groups = g_key_file_get_groups (self->key_file, NULL);
+    for (i = 0; groups[i]; i++) {
+        g_autofree gchar *value = NULL;
+
+        if (!g_str_has_prefix (groups[i], "unit "))
+            continue;
+        value = g_key_file_get_string (self->key_file, groups[i], UNIT_KEY_EQUIPMENT_ID, NULL);
+        if (g_strcmp0 (value, equipment_id) == 0) {
+            mm_obj_dbg (self->log_object, "dropping property cache entry '%s'", groups[i] + strlen ("unit "));
+            g_key_file_remove_group (self->key_file, groups[i], NULL);
+        }
+    }
+    g_strfreev (groups);
+
+    group = build_unit_group (unit_key);
+    g_key_file_set_string (self->key_file, group, UNIT_KEY_EQUIPMENT_ID, equipment_id);
+}
+
+/*****************************************************************************/
+
+GVariant *
+mm_property_cache_get (MMPropertyCache    *self,
+                       const gchar        *unit_key,
+                       const gchar        *key,
+                       const GVariantType *type)
+{
+    g_autofree gchar *group = NULL;
+    g_autofree gchar *text = NULL;
+    GVariant         *value;
+    GError           *error = NULL;
+
+    group = build_unit_group (unit_key);
+    text = g_key_file_get_string (self->key_file, group, key, NULL);
+    if (!text)
+        return NULL;
+
+    value = g_variant_parse (type, text, NULL, NULL, &error);
+    if (!value) {
+        mm_obj_warn (self->log_object, "invalid property cache value '%s' in entry '%s': %s",
+                     key, unit_key, error->message);
+        g_error_free (error);
+        return NULL;
+    }
+    return g_variant_ref_sink (value);
+}
+
+void
+mm_property_cache_set (MMPropertyCache *self,
+                       const gchar     *unit_key,
+                       const gchar     *key,
+                       GVariant        *value)
+{
+    g_autofree gchar *group = NULL;
+    g_autofree gchar *text = NULL;
+
+    g_assert (!g_str_equal (key, UNIT_KEY_EQUIPMENT_ID));
+
+    group = build_unit_group (unit_key);
+    g_variant_ref_sink (value);
+    if (g_key_file_has_group (self->key_file, group)) {
+        text = g_variant_print (value, TRUE);
+        g_key_file_set_string (self->key_file, group, key, text);
+    } else
+        g_warn_if_reached ();
+    g_variant_unref (value);
+}
+
+/*****************************************************************************/
+
+gboolean
+mm_property_cache_save (MMPropertyCache  *self,
+                        GError          **error)
+{
+    return mm_versioned_key_file_save (self->key_file, self->path, error);
+}
+
+MMPropertyCache *
+mm_property_cache_new (const gchar *path,
+                       gpointer     log_object)
+{
+    MMPropertyCache *self;
+
+    self = g_slice_new0 (MMPropertyCache);
+    self->log_object = log_object;
+    self->path = g_strdup (path);
+
+    /* How properties are loaded may change between releases, so values
+     * stored by other versions aren't trusted */
+    self->key_file = mm_versioned_key_file_load (path, CACHE_GROUP, "property cache", log_object);
+    if (!self->key_file)
+        self->key_file = mm_versioned_key_file_new (CACHE_GROUP);
+    return self;
+}
+
+void
+mm_property_cache_free (MMPropertyCache *self)
+{
+    g_key_file_free (self->key_file);
+    g_free (self->path);
+    g_slice_free (MMPropertyCache, self);
+}
+
+/*****************************************************************************/
+
+gboolean
+mm_property_cache_loaders_inherited (gpointer     instance,
+                                     GType        base_type,
+                                     GType        iface_type,
+                                     const gsize *offsets,
+                                     guint        n_offsets)
+{
+    gpointer iface;
+    gpointer base_iface;
+    guint    i;
+
+    iface = g_type_interface_peek (G_TYPE_INSTANCE_GET_CLASS (instance, base_type, GTypeClass), iface_type);
+    base_iface = g_type_interface_peek (g_type_class_peek (base_type), iface_type);
+    g_assert (iface && base_iface);
+
+    for (i = 0; i < n_offsets; i++) {
+        if (G_STRUCT_MEMBER (gpointer, iface, offsets[i]) != G_STRUCT_MEMBER (gpointer, base_iface, offsets[i]))
+            return FALSE;
+    }
+    return TRUE;
+}
@@ -0,0 +1,76 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_PROPERTY_CACHE_H
+#define MM_PROPERTY_CACHE_H
+
+#include <glib.h>
+#include <glib-object.h>
+
+/*
+ * Persistent cache of static modem properties.
+ *
+ * Units are identified by their equipment identifier (e.g. the IMEI) and
+ * their firmware revision, and for each unit the cache keeps the values of
+ * the properties that never change for a given unit and firmware, as
+ * GVariants. Storing a unit drops every other entry of the same equipment
+ * identifier, so entries of an older firmware don't outlive an upgrade.
+ *
+ * Entries are written by a daemon of the same version only; a cache file
+ * written by a different version is discarded when loaded.
+ */
+
+typedef struct _MMPropertyCache MMPropertyCache;
+
+/* Loads the cache contents from @path, if it exists. */
+MMPropertyCache *mm_property_cache_new  (const gchar      *path,
+                                         gpointer          log_object);
+void             mm_property_cache_free (MMPropertyCache  *self);
+gboolean         mm_property_cache_save (MMPropertyCache  *self,
+                                         GError          **error);
+
+/* Returns NULL if the unit can't be identified reliably */
+gchar           *mm_property_cache_build_unit_key (const gchar *equipment_id,
+                                                   const gchar *revision);
+
+gboolean         mm_property_cache_has_unit    (MMPropertyCache *self,
+                                                const gchar     *unit_key);
+/* Creates an empty entry for the unit, replacing any previous one */
+void             mm_property_cache_set_unit    (MMPropertyCache *self,
+                                                const gchar     *unit_key);
+gboolean         mm_property_cache_remove_unit (MMPropertyCache *self,
+                                                const gchar     *unit_key);
+
+/* Returns a new reference to the value, or NULL if missing or not of the
+ * given type */
+GVariant        *mm_property_cache_get (MMPropertyCache    *self,
+                                        const gchar        *unit_key,
+                                        const gchar        *key,
+                                        const GVariantType *type);
+/* The unit must exist. Floating references are consumed. */
+void             mm_property_cache_set (MMPropertyCache    *self,
+                                        const gchar        *unit_key,
+                                        const gchar        *key,
+                                        GVariant           *value);
+
+/* Whether the methods at the given offsets of the @iface_type vtable are the
+ * ones @base_type implements, i.e. not overridden by the type of @instance.
+ * Must be called on a fully constructed instance, as during instance
+ * initialization the vtable is the one of the type being initialized. */
+gboolean         mm_property_cache_loaders_inherited (gpointer     instance,
+                                                      GType        base_type,
+                                                      GType        iface_type,
+                                                      const gsize *offsets,
+                                                      guint        n_offsets);
+
+#endif /* MM_PROPERTY_CACHE_H */
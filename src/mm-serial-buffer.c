@@ -0,0 +1,246 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <string.h>
+
+#include "mm-serial-buffer.h"
+
+struct _MMSerialBuffer {
+    guint8 *data;
+    gsize   size;
+    /* Read cursor, first unparsed byte */
+    gsize   head;
+    /* Write cursor, first free byte */
+    gsize   tail;
+    /* Changes whenever data is removed */
+    guint   generation;
+};
+
+static guint generation_counter;
+
+static void
+generation_bump (MMSerialBuffer *self)
+{
+    /* Taken from a counter shared by all buffers, so that a value stored for
+     * one buffer never matches another one */
+    self->generation = ++generation_counter;
+    if (G_UNLIKELY (!self->generation))
+        self->generation = ++generation_counter;
+}
+
+MMSerialBuffer *
+mm_serial_buffer_new (gsize reserved_size)
+{
+    MMSerialBuffer *self;
+
+    self = g_slice_new0 (MMSerialBuffer);
+    self->size = MAX (reserved_size, 16);
+    self->data = g_malloc (self->size);
+    generation_bump (self);
+    return self;
+}
+
+void
+mm_serial_buffer_free (MMSerialBuffer *self)
+{
+    if (!self)
+        return;
+    g_free (self->data);
+    g_slice_free (MMSerialBuffer, self);
+}
+
+gsize
+mm_serial_buffer_get_len (MMSerialBuffer *self)
+{
+    return self->tail - self->head;
+}
+
+guint
+mm_serial_buffer_get_generation (MMSerialBuffer *self)
+{
+    return self->generation;
+}
+
+const guint8 *
+mm_serial_buffer_peek (MMSerialBuffer *self,
+                       gsize          *len)
+{
+    if (len)
+        *len = self->tail - self->head;
+    return &self->data[self->head];
+}
+
+/* Make sure there are at least @len free bytes after the write cursor */
+static void
+ensure_room (MMSerialBuffer *self,
+             gsize           len)
+{
+    gsize unparsed;
+
+    if (self->tail + len <= self->size)
+        return;
+
+    unparsed = self->tail - self->head;
+
+    /* Not enough room after the write cursor; if the unparsed data plus
+     * the new one fits in the storage, rewind the window to the start,
+     * otherwise grow. */
+    if (unparsed + len > self->size) {
+        gsize new_size;
+
+        new_size = self->size;
+        while (unparsed + len > new_size)
+            new_size *= 2;
+        self->data = g_realloc (self->data, new_size);
+        self->size = new_size;
+    }
+
+    if (self->tail + len > self->size) {
+        if (unparsed)
+            memmove (self->data, &self->data[self->head], unparsed);
+        self->head = 0;
+        self->tail = unparsed;
+    }
+}
+
+void
+mm_serial_buffer_append (MMSerialBuffer *self,
+                         const guint8   *data,
+                         gsize           len)
+{
+    if (!len)
+        return;
+
+    ensure_room (self, len);
+    memcpy (&self->data[self->tail], data, len);
+    self->tail += len;
+}
+
+gsize
+mm_serial_buffer_append_escape_nul (MMSerialBuffer *self,
+                                    const guint8   *data,
+                                    gsize           len)
+{
+    const guint8 *p;
+    const guint8 *end;
+    const guint8 *nul;
+    gsize         n_nul = 0;
+
+    if (!len)
+        return 0;
+
+    /* The first byte is never escaped, leading NULs are skipped by the
+     * AT response parser instead */
+    end = data + len;
+    for (p = data + 1; p < end && (nul = memchr (p, '\0', end - p)) != NULL; p = nul + 1)
+        n_nul++;
+
+    if (!n_nul) {
+        mm_serial_buffer_append (self, data, len);
+        return 0;
+    }
+
+    ensure_room (self, len + n_nul);
+
+    /* Copy the chunks in between NULs, writing the 2-char escape sequence
+     * in place of each NUL */
+    self->data[self->tail++] = data[0];
+    for (p = data + 1; p < end; p = nul + 1) {
+        nul = memchr (p, '\0', end - p);
+        if (!nul) {
+            memcpy (&self->data[self->tail], p, end - p);
+            self->tail += end - p;
+            break;
+        }
+        memcpy (&self->data[self->tail], p, nul - p);
+        self->tail += nul - p;
+        self->data[self->tail++] = '\\';
+        self->data[self->tail++] = '0';
+    }
+
+    return n_nul;
+}
+
+void
+mm_serial_buffer_consume (MMSerialBuffer *self,
+                          gsize           len)
+{
+    g_return_if_fail (len <= self->tail - self->head);
+
+    if (!len)
+        return;
+
+    self->head += len;
+    generation_bump (self);
+
+    /* Rewind for free as soon as there's nothing left to parse */
+    if (self->head == self->tail)
+        self->head = self->tail = 0;
+}
+
+void
+mm_serial_buffer_cut (MMSerialBuffer *self,
+                      gsize           offset,
+                      gsize           len)
+{
+    g_return_if_fail (offset + len <= self->tail - self->head);
+
+    if (!len)
+        return;
+
+    /* Shift the bytes in front of the cut forward and move the read cursor */
+    if (offset)
+        memmove (&self->data[self->head + len], &self->data[self->head], offset);
+    mm_serial_buffer_consume (self, len);
+}
+
+void
+mm_serial_buffer_cut_spans (MMSerialBuffer           *self,
+                            const MMSerialBufferSpan *spans,
+                            guint                     n_spans)
+{
+    gsize shift = 0;
+    guint i;
+
+    if (!n_spans)
+        return;
+
+    for (i = 1; i < n_spans; i++)
+        g_return_if_fail (spans[i - 1].offset + spans[i - 1].len <= spans[i].offset);
+    g_return_if_fail (spans[n_spans - 1].offset + spans[n_spans - 1].len <= self->tail - self->head);
+
+    /* Walk the spans backwards, shifting forward each chunk of kept data in
+     * between spans by the amount of data removed after it; data after the
+     * last span stays in place */
+    for (i = n_spans; i > 0; i--) {
+        gsize chunk_start;
+        gsize chunk_len;
+
+        shift += spans[i - 1].len;
+        chunk_start = (i > 1) ? spans[i - 2].offset + spans[i - 2].len : 0;
+        chunk_len = spans[i - 1].offset - chunk_start;
+        if (chunk_len && shift)
+            memmove (&self->data[self->head + chunk_start + shift],
+                     &self->data[self->head + chunk_start],
+                     chunk_len);
+    }
+
+    mm_serial_buffer_consume (self, shift);
+}
+
+void
+mm_serial_buffer_clear (MMSerialBuffer *self)
+{
+    self->head = self->tail = 0;
+    generation_bump (self);
+}
@@ -0,0 +1,82 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_SERIAL_BUFFER_H
+#define MM_SERIAL_BUFFER_H
+
+#include <glib.h>
+
+/*
+ * Input buffer for serial ports.
+ *
+ * Unparsed data is kept in a single contiguous window delimited by a read
+ * cursor and a write cursor. Parsers look at the window in place with
+ * mm_serial_buffer_peek() and drop whatever they processed with
+ * mm_serial_buffer_consume(), which just moves the read cursor forward.
+ * Data is only ever moved within the storage when new input is appended
+ * and there is no room left after the write cursor.
+ */
+typedef struct _MMSerialBuffer MMSerialBuffer;
+
+MMSerialBuffer *mm_serial_buffer_new     (gsize           reserved_size);
+void            mm_serial_buffer_free    (MMSerialBuffer *self);
+
+gsize           mm_serial_buffer_get_len (MMSerialBuffer *self);
+
+/* Returns a value that changes every time data is removed from the buffer,
+ * and which is never shared with other buffers. Incremental parsers use it
+ * to know whether the offsets they keep are still valid. */
+guint           mm_serial_buffer_get_generation (MMSerialBuffer *self);
+
+/* Returns the unparsed data in the buffer, which is valid until the next
+ * append(). */
+const guint8   *mm_serial_buffer_peek    (MMSerialBuffer *self,
+                                          gsize          *len);
+
+void            mm_serial_buffer_append  (MMSerialBuffer *self,
+                                          const guint8   *data,
+                                          gsize           len);
+
+/* Same as append(), but replacing every NUL byte after the first one with
+ * the two characters '\\' and '0', in a single pass. Returns the number of
+ * NUL bytes escaped. */
+gsize           mm_serial_buffer_append_escape_nul (MMSerialBuffer *self,
+                                                    const guint8   *data,
+                                                    gsize           len);
+
+/* Drop the first @len bytes of unparsed data */
+void            mm_serial_buffer_consume (MMSerialBuffer *self,
+                                          gsize           len);
+
+/* Drop @len bytes starting at @offset from the read cursor. Only the bytes
+ * before @offset are moved, so cutting a message found close to the start
+ * of the buffer is cheap regardless of how much data follows it. */
+void            mm_serial_buffer_cut     (MMSerialBuffer *self,
+                                          gsize           offset,
+                                          gsize           len);
+
+/* Drop several chunks of unparsed data in a single compaction. Spans are
+ * given as offsets from the read cursor, sorted and not overlapping. Every
+ * byte kept is moved at most once. */
+typedef struct {
+    gsize offset;
+    gsize len;
+} MMSerialBufferSpan;
+
+void            mm_serial_buffer_cut_spans (MMSerialBuffer           *self,
+                                            const MMSerialBufferSpan *spans,
+                                            guint                     n_spans);
+
+void            mm_serial_buffer_clear   (MMSerialBuffer *self);
+
+#endif /* MM_SERIAL_BUFFER_H */
@@ -14,6 +14,7 @@
  * Copyright (C) 2009 Red Hat, Inc.
  */
 
+#include <config.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -25,75 +26,271 @@
 static void
 response_clean (GString *response)
 {
-    char *s;
+    const gchar *s = response->str;
+    gsize        start = 0;
+    gsize        end = response->len;
 
     /* Ends with one or more '<CR><LF>' */
-    s = response->str + response->len - 1;
-    while ((s > response->str) && (*s == '\n') && (*(s - 1) == '\r')) {
-        g_string_truncate (response, response->len - 2);
-        s -= 2;
-    }
+    while ((end >= 2) && (s[end - 2] == '\r') && (s[end - 1] == '\n'))
+        end -= 2;
 
     /* Contains duplicate '<CR><CR>' */
-    s = response->str;
-    while ((response->len >= 2) && (*s == '\r') && (*(s + 1) == '\r')) {
-        g_string_erase (response, 0, 1);
-        s = response->str;
-    }
+    while ((end - start >= 2) && (s[start] == '\r') && (s[start + 1] == '\r'))
+        start++;
 
     /* Starts with one or more '<CR><LF>' */
-    s = response->str;
-    while ((response->len >= 2) && (*s == '\r') && (*(s + 1) == '\n')) {
-        g_string_erase (response, 0, 2);
-        s = response->str;
-    }
+    while ((end - start >= 2) && (s[start] == '\r') && (s[start + 1] == '\n'))
+        start += 2;
+
+    g_string_truncate (response, end);
+    if (start)
+        g_string_erase (response, 0, start);
 }
 
+/*****************************************************************************/
+/* Final result code scanner */
+
+typedef enum {
+    FINAL_RESULT_NONE,
+    FINAL_RESULT_OK,
+    FINAL_RESULT_CONNECT,
+    FINAL_RESULT_SMS_PROMPT,
+    /* Errors */
+    FINAL_RESULT_CME_ERROR,
+    FINAL_RESULT_CMS_ERROR,
+    FINAL_RESULT_CME_ERROR_STR,
+    FINAL_RESULT_CMS_ERROR_STR,
+    FINAL_RESULT_EZX_ERROR,
+    FINAL_RESULT_ERROR,
+    FINAL_RESULT_NO_CARRIER,
+    FINAL_RESULT_BUSY,
+    FINAL_RESULT_NO_ANSWER,
+    FINAL_RESULT_NO_DIALTONE,
+    FINAL_RESULT_NA,
+} FinalResult;
+
+#define FINAL_RESULT_IS_ERROR(result) ((result) >= FINAL_RESULT_CME_ERROR)
 
 static gboolean
-remove_eval_cb (const GMatchInfo *match_info,
-                GString *result,
-                gpointer user_data)
+line_has_prefix (const gchar  *line,
+                 gsize         line_len,
+                 const gchar  *prefix,
+                 const gchar **rest,
+                 gsize        *rest_len)
 {
-    int *result_len = (int *) user_data;
-    int start;
-    int end;
+    gsize prefix_len;
 
-    if (g_match_info_fetch_pos  (match_info, 0, &start, &end))
-        *result_len -= (end - start);
+    prefix_len = strlen (prefix);
+    if (line_len < prefix_len || memcmp (line, prefix, prefix_len) != 0)
+        return FALSE;
 
+    if (rest) {
+        *rest = line + prefix_len;
+        *rest_len = line_len - prefix_len;
+    }
     return TRUE;
 }
 
-static void
-remove_matches (GRegex *r, GString *string)
+static gboolean
+line_has_suffix (const gchar *line,
+                 gsize        line_len,
+                 const gchar *suffix)
+{
+    gsize suffix_len;
+
+    suffix_len = strlen (suffix);
+    return (line_len >= suffix_len && memcmp (line + line_len - suffix_len, suffix, suffix_len) == 0);
+}
+
+/* Parses the "\s*<value>" argument of an error result code, returning TRUE if
+ * it is a non-empty number */
+static gboolean
+error_argument_parse (const gchar  *rest,
+                      gsize         rest_len,
+                      const gchar **arg,
+                      gsize        *arg_len)
+{
+    gsize i;
+
+    while (rest_len && g_ascii_isspace (*rest)) {
+        rest++;
+        rest_len--;
+    }
+    *arg = rest;
+    *arg_len = rest_len;
+
+    for (i = 0; i < rest_len; i++) {
+        if (!g_ascii_isdigit (rest[i]))
+            return FALSE;
+    }
+    return (rest_len > 0);
+}
+
+/* Tells whether a single line, without <CR><LF>, is a final result code */
+static FinalResult
+final_result_line_classify (const gchar  *line,
+                            gsize         line_len,
+                            const gchar **arg,
+                            gsize        *arg_len)
+{
+    const gchar *rest;
+    gsize        rest_len;
+
+    *arg = NULL;
+    *arg_len = 0;
+
+    if (!line_len)
+        return FINAL_RESULT_NONE;
+
+    switch (line[0]) {
+    case 'O':
+        if (line_len == 2 && line[1] == 'K')
+            return FINAL_RESULT_OK;
+        break;
+    case 'C':
+        if (line_has_prefix (line, line_len, "CONNECT", NULL, NULL))
+            return FINAL_RESULT_CONNECT;
+        break;
+    case '+':
+        if (line_has_prefix (line, line_len, "+CME ERROR:", &rest, &rest_len)) {
+            if (error_argument_parse (rest, rest_len, arg, arg_len))
+                return FINAL_RESULT_CME_ERROR;
+            return (*arg_len ? FINAL_RESULT_CME_ERROR_STR : FINAL_RESULT_NONE);
+        }
+        if (line_has_prefix (line, line_len, "+CMS ERROR:", &rest, &rest_len)) {
+            if (error_argument_parse (rest, rest_len, arg, arg_len))
+                return FINAL_RESULT_CMS_ERROR;
+            return (*arg_len ? FINAL_RESULT_CMS_ERROR_STR : FINAL_RESULT_NONE);
+        }
+        break;
+    case 'M':
+        /* Motorola EZX errors */
+        if (line_has_prefix (line, line_len, "MODEM ERROR:", &rest, &rest_len) &&
+            error_argument_parse (rest, rest_len, arg, arg_len))
+            return FINAL_RESULT_EZX_ERROR;
+        break;
+    case 'E':
+        if (line_has_prefix (line, line_len, "ERROR", NULL, NULL))
+            return FINAL_RESULT_ERROR;
+        break;
+    case 'B':
+        if (line_has_prefix (line, line_len, "BUSY", NULL, NULL))
+            return FINAL_RESULT_BUSY;
+        break;
+    case 'N':
+        if (line_has_prefix (line, line_len, "NO CARRIER", NULL, NULL))
+            return FINAL_RESULT_NO_CARRIER;
+        if (line_has_prefix (line, line_len, "NO ANSWER", NULL, NULL))
+            return FINAL_RESULT_NO_ANSWER;
+        if (line_has_prefix (line, line_len, "NO DIALTONE", NULL, NULL))
+            return FINAL_RESULT_NO_DIALTONE;
+        /* Samsung Z810 may reply "NA" to report a not-available error */
+        if (line_len == 2 && line[1] == 'A')
+            return FINAL_RESULT_NA;
+        break;
+    default:
+        break;
+    }
+
+    if (line_has_suffix (line, line_len, "COMMAND NOT SUPPORT"))
+        return FINAL_RESULT_ERROR;
+
+    return FINAL_RESULT_NONE;
+}
+
+/*
+ * Looks for a final result code in the last line of the response, scanning it
+ * backwards once. Returns FINAL_RESULT_NONE if the response doesn't end with
+ * a complete final result code line.
+ *
+ * @result_start is set to the offset of the <CR><LF> preceding the final
+ * result code line, and @arg/@arg_len to the error code or string given in the
+ * error result codes that have one.
+ */
+static FinalResult
+final_result_scan (const gchar  *str,
+                   gsize         len,
+                   gsize        *result_start,
+                   const gchar **arg,
+                   gsize        *arg_len)
+{
+    const gchar *line;
+    gsize        line_len;
+    gsize        end;
+    gsize        i;
+
+    *arg = NULL;
+    *arg_len = 0;
+
+    /* SMS prompt: "<CR><LF>>" followed by optional whitespace */
+    end = len;
+    while (end > 0 && g_ascii_isspace (str[end - 1]))
+        end--;
+    if (end >= 3 && str[end - 1] == '>' && str[end - 2] == '\n' && str[end - 3] == '\r') {
+        *result_start = end - 3;
+        return FINAL_RESULT_SMS_PROMPT;
+    }
+
+    /* Any other final result code must end with at least one <CR><LF> */
+    end = len;
+    while (end >= 2 && str[end - 2] == '\r' && str[end - 1] == '\n')
+        end -= 2;
+    if (end == len)
+        return FINAL_RESULT_NONE;
+
+    /* Look for the <CR><LF> starting the last line; the line itself must not
+     * have any other <CR> or <LF> */
+    for (i = end; i > 0; i--) {
+        if (str[i - 1] == '\r' || str[i - 1] == '\n')
+            break;
+    }
+    if (i < 2 || str[i - 1] != '\n' || str[i - 2] != '\r')
+        return FINAL_RESULT_NONE;
+
+    *result_start = i - 2;
+    line = &str[i];
+    line_len = end - i;
+    return final_result_line_classify (line, line_len, arg, arg_len);
+}
+
+/* Looks for a result code line anywhere in the response, i.e. not necessarily
+ * the last one, as with CONNECT followed by data */
+static gboolean
+result_line_find (const gchar *str,
+                  gsize        len,
+                  const gchar *prefix,
+                  gboolean     complete)
 {
-    char *str;
-    int result_len = string->len;
+    g_autofree gchar *needle = NULL;
+    const gchar      *p;
+    const gchar      *end;
+    gsize             needle_len;
+
+    needle = g_strdup_printf ("\r\n%s", prefix);
+    needle_len = strlen (needle);
+    end = str + len;
 
-    str = g_regex_replace_eval (r, string->str, string->len, 0, 0,
-                                remove_eval_cb, &result_len, NULL);
+    for (p = str; (p = memmem (p, end - p, needle, needle_len)) != NULL; p += needle_len) {
+        const gchar *eol;
 
-    g_string_truncate (string, 0);
-    g_string_append_len (string, str, result_len);
-    g_free (str);
+        if (!complete)
+            return TRUE;
+
+        /* The rest of the line must be followed by <CR><LF> */
+        eol = memchr (p + needle_len, '\n', end - (p + needle_len));
+        if (eol && eol[-1] == '\r')
+            return TRUE;
+    }
+    return FALSE;
 }
 
+/*****************************************************************************/
+
 typedef struct {
-    /* Regular expressions for successful replies */
-    GRegex *regex_ok;
-    GRegex *regex_connect;
-    GRegex *regex_sms;
+    /* Regular expressions for custom replies; a custom successful reply is
+     * looked for before anything else, and a custom error reply before any
+     * standard error result code */
     GRegex *regex_custom_successful;
-    /* Regular expressions for error replies */
-    GRegex *regex_cme_error;
-    GRegex *regex_cms_error;
-    GRegex *regex_cme_error_str;
-    GRegex *regex_cms_error_str;
-    GRegex *regex_ezx_error;
-    GRegex *regex_unknown_error;
-    GRegex *regex_connect_failed;
-    GRegex *regex_na;
     GRegex *regex_custom_error;
     /* User-provided parser filter */
     mm_serial_parser_v1_filter_fn filter_callback;
@@ -103,30 +300,7 @@ typedef struct {
 gpointer
 mm_serial_parser_v1_new (void)
 {
-    MMSerialParserV1 *parser;
-    GRegexCompileFlags flags = G_REGEX_DOLLAR_ENDONLY | G_REGEX_RAW | G_REGEX_OPTIMIZE;
-
-    parser = g_slice_new (MMSerialParserV1);
-
-    parser->regex_ok = g_regex_new ("\\r\\nOK(\\r\\n)+$", flags, 0, NULL);
-    parser->regex_connect = g_regex_new ("\\r\\nCONNECT.*\\r\\n", flags, 0, NULL);
-    parser->regex_sms = g_regex_new ("\\r\\n>\\s*$", flags, 0, NULL);
-    parser->regex_cme_error = g_regex_new ("\\r\\n\\+CME ERROR:\\s*(\\d+)\\r\\n$", flags, 0, NULL);
-    parser->regex_cms_error = g_regex_new ("\\r\\n\\+CMS ERROR:\\s*(\\d+)\\r\\n$", flags, 0, NULL);
-    parser->regex_cme_error_str = g_regex_new ("\\r\\n\\+CME ERROR:\\s*([^\\n\\r]+)\\r\\n$", flags, 0, NULL);
-    parser->regex_cms_error_str = g_regex_new ("\\r\\n\\+CMS ERROR:\\s*([^\\n\\r]+)\\r\\n$", flags, 0, NULL);
-    parser->regex_ezx_error = g_regex_new ("\\r\\n\\MODEM ERROR:\\s*(\\d+)\\r\\n$", flags, 0, NULL);
-    parser->regex_unknown_error = g_regex_new ("\\r\\n(ERROR)|(COMMAND NOT SUPPORT)\\r\\n$", flags, 0, NULL);
-    parser->regex_connect_failed = g_regex_new ("\\r\\n(NO CARRIER)|(BUSY)|(NO ANSWER)|(NO DIALTONE)\\r\\n$", flags, 0, NULL);
-    /* Samsung Z810 may reply "NA" to report a not-available error */
-    parser->regex_na = g_regex_new ("\\r\\nNA\\r\\n", flags, 0, NULL);
-
-    parser->regex_custom_successful = NULL;
-    parser->regex_custom_error = NULL;
-    parser->filter_callback = NULL;
-    parser->filter_user_data = NULL;
-
-    return parser;
+    return g_slice_new0 (MMSerialParserV1);
 }
 
 void
@@ -160,6 +334,110 @@ mm_serial_parser_v1_add_filter (gpointer data,
     parser->filter_user_data = user_data;
 }
 
+gboolean
+mm_serial_parser_v1_check_line (gpointer     data,
+                                const gchar *line,
+                                gsize        line_len,
+                                gboolean     complete)
+{
+    MMSerialParserV1 *parser = (MMSerialParserV1 *) data;
+    const gchar      *arg;
+    gsize             arg_len;
+    gsize             i;
+
+    g_return_val_if_fail (parser != NULL, TRUE);
+
+    /* Custom regexes and filters may match any text */
+    if (parser->regex_custom_successful || parser->regex_custom_error || parser->filter_callback)
+        return TRUE;
+
+    /* SMS prompt, possibly followed by whitespace */
+    if (line_len > 0 && line[0] == '>') {
+        i = 1;
+        while (i < line_len && g_ascii_isspace (line[i]))
+            i++;
+        if (i == line_len)
+            return TRUE;
+    }
+
+    /* Error result codes are also reported before the line is complete */
+    if (line_has_prefix (line, line_len, "ERROR", NULL, NULL) ||
+        line_has_prefix (line, line_len, "NO CARRIER", NULL, NULL))
+        return TRUE;
+
+    if (!complete)
+        return FALSE;
+
+    return (final_result_line_classify (line, line_len, &arg, &arg_len) != FINAL_RESULT_NONE);
+}
+
+static gboolean
+custom_successful_match (MMSerialParserV1 *parser,
+                         GString          *response)
+{
+    return (parser->regex_custom_successful &&
+            g_regex_match_full (parser->regex_custom_successful,
+                                response->str, response->len,
+                                0, 0, NULL, NULL));
+}
+
+static gboolean
+custom_error_match (MMSerialParserV1  *parser,
+                    GString           *response,
+                    gpointer           log_object,
+                    GError           **error)
+{
+    GMatchInfo       *match_info = NULL;
+    g_autofree gchar *str = NULL;
+
+    if (!parser->regex_custom_error ||
+        !g_regex_match_full (parser->regex_custom_error,
+                             response->str, response->len,
+                             0, 0, &match_info, NULL)) {
+        g_clear_pointer (&match_info, g_match_info_free);
+        return FALSE;
+    }
+
+    str = g_match_info_fetch (match_info, 1);
+    g_assert (str);
+    g_match_info_free (match_info);
+    g_propagate_error (error, mm_mobile_equipment_error_for_code (atoi (str), log_object));
+    return TRUE;
+}
+
+/* Custom error replies and result codes not given in the last line */
+static FinalResult
+parse_slow_path (MMSerialParserV1  *parser,
+                 GString           *response,
+                 gpointer           log_object,
+                 GError           **error)
+{
+    /* CONNECT may be followed right away by data */
+    if (result_line_find (response->str, response->len, "CONNECT", TRUE))
+        return FINAL_RESULT_CONNECT;
+
+    if (custom_error_match (parser, response, log_object, error))
+        return FINAL_RESULT_ERROR;
+
+    /* Error result codes followed by some other data */
+    if (result_line_find (response->str, response->len, "ERROR", FALSE)) {
+        g_propagate_error (error, mm_mobile_equipment_error_for_code (MM_MOBILE_EQUIPMENT_ERROR_UNKNOWN, log_object));
+        return FINAL_RESULT_ERROR;
+    }
+    if (result_line_find (response->str, response->len, "NO CARRIER", FALSE)) {
+        g_propagate_error (error, mm_connection_error_for_code (MM_CONNECTION_ERROR_NO_CARRIER, log_object));
+        return FINAL_RESULT_NO_CARRIER;
+    }
+    if (result_line_find (response->str, response->len, "NA\r\n", FALSE)) {
+        g_propagate_error (error, g_error_new (MM_MOBILE_EQUIPMENT_ERROR,
+                                               MM_MOBILE_EQUIPMENT_ERROR_NOT_ALLOWED,
+                                               "Not Allowed"));
+        return FINAL_RESULT_NA;
+    }
+
+    return FINAL_RESULT_NONE;
+}
+
 gboolean
 mm_serial_parser_v1_parse (gpointer   data,
                            GString   *response,
@@ -167,17 +445,23 @@ mm_serial_parser_v1_parse (gpointer   data,
                            GError   **error)
 {
     MMSerialParserV1 *parser = (MMSerialParserV1 *) data;
-    GMatchInfo *match_info;
     GError *local_error = NULL;
-    gboolean found = FALSE;
-    char *str = NULL;
+    FinalResult result;
+    gsize result_start = 0;
+    const gchar *arg;
+    gsize arg_len;
 
     g_return_val_if_fail (parser != NULL, FALSE);
     g_return_val_if_fail (response != NULL, FALSE);
 
     /* Skip NUL bytes if they are found leading the response */
-    while (response->len > 0 && response->str[0] == '\0')
-        g_string_erase (response, 0, 1);
+    if (response->len > 0 && response->str[0] == '\0') {
+        gsize n_nul = 1;
+
+        while (n_nul < response->len && response->str[n_nul] == '\0')
+            n_nul++;
+        g_string_erase (response, 0, n_nul);
+    }
 
     if (G_UNLIKELY (!response->len))
         return FALSE;
@@ -195,178 +479,90 @@ mm_serial_parser_v1_parse (gpointer   data,
         return TRUE;
     }
 
-    /* Then, check for successful responses */
-
-    /* Custom successful replies first, if any */
-    if (parser->regex_custom_successful) {
-        found = g_regex_match_full (parser->regex_custom_successful,
-                                    response->str, response->len,
-                                    0, 0, NULL, NULL);
-    }
-
-    if (!found) {
-        found = g_regex_match_full (parser->regex_ok,
-                                    response->str, response->len,
-                                    0, 0, NULL, NULL);
-        if (found)
-            remove_matches (parser->regex_ok, response);
-    }
-
-    if (!found) {
-        found = g_regex_match_full (parser->regex_connect,
-                                    response->str, response->len,
-                                    0, 0, NULL, NULL);
-    }
-
-    if (!found) {
-        found = g_regex_match_full (parser->regex_sms,
-                                    response->str, response->len,
-                                    0, 0, NULL, NULL);
-    }
-
-    if (found) {
+    /* Custom successful replies go before anything else, as they may include
+     * a standard final result code, even an error one */
+    if (custom_successful_match (parser, response)) {
         response_clean (response);
         return TRUE;
     }
 
-    /* Now failures */
-
-    /* Custom error matches first, if any */
-    if (parser->regex_custom_error) {
-        found = g_regex_match_full (parser->regex_custom_error,
-                                    response->str, response->len,
-                                    0, 0, &match_info, NULL);
-        if (found) {
-            str = g_match_info_fetch (match_info, 1);
-            g_assert (str);
-            local_error = mm_mobile_equipment_error_for_code (atoi (str), log_object);
-            goto done;
-        }
-        g_match_info_free (match_info);
-    }
-
-    /* Numeric CME errors */
-    found = g_regex_match_full (parser->regex_cme_error,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        str = g_match_info_fetch (match_info, 1);
-        g_assert (str);
-        local_error = mm_mobile_equipment_error_for_code (atoi (str), log_object);
-        goto done;
-    }
-    g_match_info_free (match_info);
-
-    /* Numeric CMS errors */
-    found = g_regex_match_full (parser->regex_cms_error,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        str = g_match_info_fetch (match_info, 1);
-        g_assert (str);
-        local_error = mm_message_error_for_code (atoi (str), log_object);
-        goto done;
-    }
-    g_match_info_free (match_info);
+    /* Fast path: standard final result code in the last line */
+    result = final_result_scan (response->str, response->len, &result_start, &arg, &arg_len);
+
+    /* Custom error replies go before the standard error result codes */
+    if (FINAL_RESULT_IS_ERROR (result) &&
+        custom_error_match (parser, response, log_object, &local_error))
+        result = FINAL_RESULT_ERROR;
+
+    switch (result) {
+    case FINAL_RESULT_NONE:
+        /* Inconclusive, go on with the custom and less common replies */
+        result = parse_slow_path (parser, response, log_object, &local_error);
+        break;
+    case FINAL_RESULT_OK:
+        /* The OK itself is not part of the response */
+        g_string_truncate (response, result_start);
+        break;
+    case FINAL_RESULT_CONNECT:
+    case FINAL_RESULT_SMS_PROMPT:
+        break;
+    case FINAL_RESULT_CME_ERROR:
+        local_error = mm_mobile_equipment_error_for_code (atoi (arg), log_object);
+        break;
+    case FINAL_RESULT_CMS_ERROR:
+        local_error = mm_message_error_for_code (atoi (arg), log_object);
+        break;
+    case FINAL_RESULT_CME_ERROR_STR: {
+        g_autofree gchar *str = g_strndup (arg, arg_len);
 
-    /* String CME errors */
-    found = g_regex_match_full (parser->regex_cme_error_str,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        str = g_match_info_fetch (match_info, 1);
-        g_assert (str);
         local_error = mm_mobile_equipment_error_for_string (str, log_object);
-        goto done;
+        break;
     }
-    g_match_info_free (match_info);
+    case FINAL_RESULT_CMS_ERROR_STR: {
+        g_autofree gchar *str = g_strndup (arg, arg_len);
 
-    /* String CMS errors */
-    found = g_regex_match_full (parser->regex_cms_error_str,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        str = g_match_info_fetch (match_info, 1);
-        g_assert (str);
         local_error = mm_message_error_for_string (str, log_object);
-        goto done;
-    }
-    g_match_info_free (match_info);
-
-    /* Motorola EZX errors */
-    found = g_regex_match_full (parser->regex_ezx_error,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        str = g_match_info_fetch (match_info, 1);
-        g_assert (str);
-        local_error = mm_mobile_equipment_error_for_code (MM_MOBILE_EQUIPMENT_ERROR_UNKNOWN, log_object);
-        goto done;
-    }
-    g_match_info_free (match_info);
-
-    /* Last resort; unknown error */
-    found = g_regex_match_full (parser->regex_unknown_error,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        local_error = mm_mobile_equipment_error_for_code (MM_MOBILE_EQUIPMENT_ERROR_UNKNOWN, log_object);
-        goto done;
-    }
-    g_match_info_free (match_info);
-
-    /* Connection failures */
-    found = g_regex_match_full (parser->regex_connect_failed,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        MMConnectionError code;
-
-        str = g_match_info_fetch (match_info, 1);
-        g_assert (str);
-
-        if (!strcmp (str, "NO CARRIER"))
-            code = MM_CONNECTION_ERROR_NO_CARRIER;
-        else if (!strcmp (str, "BUSY"))
-            code = MM_CONNECTION_ERROR_BUSY;
-        else if (!strcmp (str, "NO ANSWER"))
-            code = MM_CONNECTION_ERROR_NO_ANSWER;
-        else if (!strcmp (str, "NO DIALTONE"))
-            code = MM_CONNECTION_ERROR_NO_DIALTONE;
-        else {
-            /* uhm... make something up (yes, ok, lie!). */
-            code = MM_CONNECTION_ERROR_NO_CARRIER;
-        }
-
-        local_error = mm_connection_error_for_code (code, log_object);
-        goto done;
+        break;
     }
-    g_match_info_free (match_info);
-
-    /* NA error */
-    found = g_regex_match_full (parser->regex_na,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
+    case FINAL_RESULT_EZX_ERROR:
+    case FINAL_RESULT_ERROR:
+        /* Unless already given by a custom error reply */
+        if (!local_error)
+            local_error = mm_mobile_equipment_error_for_code (MM_MOBILE_EQUIPMENT_ERROR_UNKNOWN, log_object);
+        break;
+    case FINAL_RESULT_NO_CARRIER:
+        local_error = mm_connection_error_for_code (MM_CONNECTION_ERROR_NO_CARRIER, log_object);
+        break;
+    case FINAL_RESULT_BUSY:
+        local_error = mm_connection_error_for_code (MM_CONNECTION_ERROR_BUSY, log_object);
+        break;
+    case FINAL_RESULT_NO_ANSWER:
+        local_error = mm_connection_error_for_code (MM_CONNECTION_ERROR_NO_ANSWER, log_object);
+        break;
+    case FINAL_RESULT_NO_DIALTONE:
+        local_error = mm_connection_error_for_code (MM_CONNECTION_ERROR_NO_DIALTONE, log_object);
+        break;
+    case FINAL_RESULT_NA:
         /* Assume NA means 'Not Allowed' :) */
         local_error = g_error_new (MM_MOBILE_EQUIPMENT_ERROR,
                                    MM_MOBILE_EQUIPMENT_ERROR_NOT_ALLOWED,
                                    "Not Allowed");
-        goto done;
+        break;
+    default:
+        g_assert_not_reached ();
     }
 
-done:
-    g_free (str);
-    g_match_info_free (match_info);
-    if (found)
-        response_clean (response);
+    if (result == FINAL_RESULT_NONE)
+        return FALSE;
+
+    response_clean (response);
 
     if (local_error) {
         mm_obj_dbg (log_object, "operation failure: %d (%s)", local_error->code, local_error->message);
         g_propagate_error (error, local_error);
     }
 
-    return found;
+    return TRUE;
 }
 
 gboolean
@@ -386,18 +582,6 @@ mm_serial_parser_v1_destroy (gpointer data)
 
     g_return_if_fail (parser != NULL);
 
-    g_regex_unref (parser->regex_ok);
-    g_regex_unref (parser->regex_connect);
-    g_regex_unref (parser->regex_sms);
-    g_regex_unref (parser->regex_cme_error);
-    g_regex_unref (parser->regex_cms_error);
-    g_regex_unref (parser->regex_cme_error_str);
-    g_regex_unref (parser->regex_cms_error_str);
-    g_regex_unref (parser->regex_ezx_error);
-    g_regex_unref (parser->regex_unknown_error);
-    g_regex_unref (parser->regex_connect_failed);
-    g_regex_unref (parser->regex_na);
-
     if (parser->regex_custom_successful)
         g_regex_unref (parser->regex_custom_successful);
     if (parser->regex_custom_error)
@@ -26,6 +26,13 @@ gboolean mm_serial_parser_v1_parse                (gpointer parser,
                                                    GString *response,
                                                    gpointer log_object,
                                                    GError **error);
+/* Tells whether the given line, without the trailing <CR><LF>, may let
+ * mm_serial_parser_v1_parse() find a complete response. When @complete is
+ * FALSE the line end hasn't been received yet. */
+gboolean mm_serial_parser_v1_check_line           (gpointer     parser,
+                                                   const gchar *line,
+                                                   gsize        line_len,
+                                                   gboolean     complete);
 void     mm_serial_parser_v1_destroy              (gpointer parser);
 gboolean mm_serial_parser_v1_is_known_error       (const GError *error);
 
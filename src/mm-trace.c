@@ -0,0 +1,303 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "mm-trace.h"
+#include "mm-log-object.h"
+
+typedef struct {
+    MMTraceSpan  id;
+    gchar       *object;
+    gchar       *category;
+    gchar       *name;
+    gchar       *port;
+    gchar       *command;
+    gint64       begin;
+    gint64       end;
+} Span;
+
+typedef struct {
+    Span        *spans;
+    guint        size;
+    MMTraceSpan  next_id;
+} Trace;
+
+static Trace *trace;
+
+/*****************************************************************************/
+
+static void
+span_clear (Span *span)
+{
+    g_free (span->object);
+    g_free (span->category);
+    g_free (span->name);
+    g_free (span->port);
+    g_free (span->command);
+    memset (span, 0, sizeof (Span));
+}
+
+static Span *
+trace_lookup (MMTraceSpan id)
+{
+    Span *span;
+
+    if (!trace || !id)
+        return NULL;
+
+    span = &trace->spans[(id - 1) % trace->size];
+    return (span->id == id) ? span : NULL;
+}
+
+/*****************************************************************************/
+
+gboolean
+mm_trace_enabled (void)
+{
+    return !!trace;
+}
+
+void
+mm_trace_setup (guint max_spans)
+{
+    if (trace) {
+        guint i;
+
+        for (i = 0; i < trace->size; i++)
+            span_clear (&trace->spans[i]);
+        g_free (trace->spans);
+        g_slice_free (Trace, trace);
+        trace = NULL;
+    }
+
+    if (max_spans) {
+        trace = g_slice_new0 (Trace);
+        trace->size = max_spans;
+        trace->spans = g_new0 (Span, max_spans);
+        trace->next_id = 1;
+    }
+}
+
+MMTraceSpan
+mm_trace_begin (gpointer     obj,
+                const gchar *category,
+                const gchar *name)
+{
+    Span *span;
+
+    if (!trace)
+        return 0;
+
+    span = &trace->spans[(trace->next_id - 1) % trace->size];
+    span_clear (span);
+    span->id = trace->next_id++;
+    if (obj && MM_IS_LOG_OBJECT (obj))
+        span->object = g_strdup (mm_log_object_get_id (MM_LOG_OBJECT (obj)));
+    span->category = g_strdup (category);
+    span->name = g_strdup (name ? name : category);
+    span->begin = g_get_monotonic_time ();
+    return span->id;
+}
+
+void
+mm_trace_end (MMTraceSpan id)
+{
+    Span *span;
+
+    span = trace_lookup (id);
+    if (span && !span->end)
+        span->end = g_get_monotonic_time ();
+}
+
+void
+mm_trace_set_port (MMTraceSpan  id,
+                   const gchar *port)
+{
+    Span *span;
+
+    span = trace_lookup (id);
+    if (span) {
+        g_free (span->port);
+        span->port = g_strdup (port);
+    }
+}
+
+void
+mm_trace_set_command (MMTraceSpan  id,
+                      const gchar *command)
+{
+    Span *span;
+
+    span = trace_lookup (id);
+    if (span) {
+        g_free (span->command);
+        span->command = g_strdup (command);
+    }
+}
+
+void
+mm_trace_step (MMTraceSpan *id,
+               gpointer     obj,
+               const gchar *category,
+               guint        step)
+{
+    Span             *span;
+    g_autofree gchar *name = NULL;
+
+    if (!trace)
+        return;
+
+    name = g_strdup_printf ("%s step %u", category, step);
+    span = trace_lookup (*id);
+    if (span && !span->end && !g_strcmp0 (span->name, name))
+        return;
+
+    mm_trace_end (*id);
+    *id = mm_trace_begin (obj, category, name);
+}
+
+void
+mm_trace_clear (MMTraceSpan *id)
+{
+    mm_trace_end (*id);
+    *id = 0;
+}
+
+/*****************************************************************************/
+/* Chrome trace event format */
+
+static void
+append_json_string (GString     *str,
+                    const gchar *value)
+{
+    const gchar *p;
+
+    g_string_append_c (str, '"');
+    for (p = value; *p; p++) {
+        switch (*p) {
+        case '"':
+            g_string_append (str, "\\\"");
+            break;
+        case '\\':
+            g_string_append (str, "\\\\");
+            break;
+        case '\n':
+            g_string_append (str, "\\n");
+            break;
+        case '\r':
+            g_string_append (str, "\\r");
+            break;
+        case '\t':
+            g_string_append (str, "\\t");
+            break;
+        default:
+            if ((guchar) *p < 0x20)
+                g_string_append_printf (str, "\\u%04x", (guchar) *p);
+            else
+                g_string_append_c (str, *p);
+            break;
+        }
+    }
+    g_string_append_c (str, '"');
+}
+
+static void
+append_thread_name (GString     *str,
+                    glong        pid,
+                    guint        tid,
+                    const gchar *name)
+{
+    g_string_append_printf (str,
+                            "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%u,\"args\":{\"name\":",
+                            str->str[str->len - 1] == '[' ? "" : ",", pid, tid);
+    append_json_string (str, name);
+    g_string_append (str, "}}");
+}
+
+static void
+append_span (GString    *str,
+             glong       pid,
+             guint       tid,
+             const Span *span)
+{
+    g_string_append (str, ",{\"name\":");
+    append_json_string (str, span->name);
+    g_string_append (str, ",\"cat\":");
+    append_json_string (str, span->category);
+    if (span->end)
+        g_string_append_printf (str, ",\"ph\":\"X\",\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT,
+                                span->begin, span->end - span->begin);
+    else
+        g_string_append_printf (str, ",\"ph\":\"B\",\"ts\":%" G_GINT64_FORMAT, span->begin);
+    g_string_append_printf (str, ",\"pid\":%ld,\"tid\":%u,\"args\":{", pid, tid);
+    if (span->object) {
+        g_string_append (str, "\"object\":");
+        append_json_string (str, span->object);
+    }
+    if (span->port) {
+        g_string_append_printf (str, "%s\"port\":", span->object ? "," : "");
+        append_json_string (str, span->port);
+    }
+    if (span->command) {
+        g_string_append_printf (str, "%s\"command\":", (span->object || span->port) ? "," : "");
+        append_json_string (str, span->command);
+    }
+    g_string_append (str, "}}");
+}
+
+gchar *
+mm_trace_build_chrome_json (void)
+{
+    GString    *str;
+    GHashTable *tids;
+    glong       pid;
+
+    str = g_string_new ("{\"traceEvents\":[");
+    pid = (glong) getpid ();
+
+    /* tid 0 groups the spans not bound to any object, each object gets its
+     * own track afterwards */
+    append_thread_name (str, pid, 0, "ModemManager");
+
+    if (trace) {
+        MMTraceSpan first_id;
+        MMTraceSpan i;
+
+        tids = g_hash_table_new (g_str_hash, g_str_equal);
+        first_id = (trace->next_id > trace->size) ? (trace->next_id - trace->size) : 1;
+        for (i = first_id; i < trace->next_id; i++) {
+            const Span *span;
+            guint       tid = 0;
+
+            span = trace_lookup (i);
+            if (!span)
+                continue;
+
+            if (span->object) {
+                tid = GPOINTER_TO_UINT (g_hash_table_lookup (tids, span->object));
+                if (!tid) {
+                    tid = g_hash_table_size (tids) + 1;
+                    g_hash_table_insert (tids, span->object, GUINT_TO_POINTER (tid));
+                    append_thread_name (str, pid, tid, span->object);
+                }
+            }
+            append_span (str, pid, tid, span);
+        }
+        g_hash_table_unref (tids);
+    }
+
+    g_string_append (str, "],\"displayTimeUnit\":\"ms\"}");
+    return g_string_free (str, FALSE);
+}
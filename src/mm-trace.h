@@ -0,0 +1,65 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_TRACE_H
+#define MM_TRACE_H
+
+#include <glib.h>
+
+/*
+ * Lightweight span tracing.
+ *
+ * A span records the begin and end time of an operation (e.g. a step of a
+ * state machine or an AT command), the object running it and optionally the
+ * port and command used. The most recent spans are kept in a fixed-size
+ * ring, and can be exported in the Chrome trace event JSON format, which
+ * chrome://tracing and Perfetto load directly.
+ *
+ * Spans are only recorded from the main thread. When tracing is disabled,
+ * mm_trace_begin() returns 0 and all other operations on it are no-ops.
+ */
+
+typedef guint MMTraceSpan;
+
+/* Keeps up to @max_spans spans; 0 disables tracing and drops all spans */
+void         mm_trace_setup   (guint        max_spans);
+gboolean     mm_trace_enabled (void);
+
+MMTraceSpan  mm_trace_begin       (gpointer     obj,
+                                   const gchar *category,
+                                   const gchar *name);
+void         mm_trace_end         (MMTraceSpan  span);
+void         mm_trace_set_port    (MMTraceSpan  span,
+                                   const gchar *port);
+void         mm_trace_set_command (MMTraceSpan  span,
+                                   const gchar *command);
+
+/* Helper for state machines: ends the span in @span, if any, and begins a
+ * new one named after the given step. A no-op if @span is already tracing
+ * that same step.
+ *
+ * Meant to be called right after the step function returns, so that steps
+ * skipped by falling through the switch don't get a span, and the one being
+ * waited for gets it instead. */
+void         mm_trace_step        (MMTraceSpan *span,
+                                   gpointer     obj,
+                                   const gchar *category,
+                                   guint        step);
+
+/* Ends the span in @span, if any, and resets it */
+void         mm_trace_clear       (MMTraceSpan *span);
+
+/* Spans not ended yet are exported as begin events only */
+gchar       *mm_trace_build_chrome_json (void);
+
+#endif /* MM_TRACE_H */
@@ -0,0 +1,70 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+
+#include "mm-versioned-key-file.h"
+#include "mm-log.h"
+
+#define KEY_VERSION "version"
+
+GKeyFile *
+mm_versioned_key_file_new (const gchar *group)
+{
+    GKeyFile *key_file;
+
+    key_file = g_key_file_new ();
+    g_key_file_set_string (key_file, group, KEY_VERSION, PACKAGE_VERSION);
+    return key_file;
+}
+
+GKeyFile *
+mm_versioned_key_file_load (const gchar *path,
+                            const gchar *group,
+                            const gchar *description,
+                            gpointer     log_object)
+{
+    GKeyFile         *key_file;
+    GError           *error = NULL;
+    g_autofree gchar *version = NULL;
+
+    key_file = g_key_file_new ();
+    if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, &error)) {
+        if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+            mm_obj_warn (log_object, "couldn't load %s from '%s': %s", description, path, error->message);
+        g_error_free (error);
+        g_key_file_free (key_file);
+        return NULL;
+    }
+
+    version = g_key_file_get_string (key_file, group, KEY_VERSION, NULL);
+    if (g_strcmp0 (version, PACKAGE_VERSION) != 0) {
+        mm_obj_dbg (log_object, "discarding %s written by version '%s'", description, version ? version : "unknown");
+        g_key_file_free (key_file);
+        return NULL;
+    }
+
+    return key_file;
+}
+
+gboolean
+mm_versioned_key_file_save (GKeyFile     *key_file,
+                            const gchar  *path,
+                            GError      **error)
+{
+    g_autofree gchar *data = NULL;
+    gsize             len = 0;
+
+    data = g_key_file_to_data (key_file, &len, NULL);
+    return g_file_set_contents (path, data, (gssize) len, error);
+}
@@ -0,0 +1,43 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_VERSIONED_KEY_FILE_H
+#define MM_VERSIONED_KEY_FILE_H
+
+#include <glib.h>
+
+/*
+ * Key files with state persisted by the daemon across restarts.
+ *
+ * The version of the daemon that wrote the file is stored in the 'version'
+ * key of a main group given by the user of the file, and files written by a
+ * different version are discarded when loaded, as the logic that built the
+ * stored state may have changed.
+ */
+
+/* Creates a new key file with just the version of the running daemon. */
+GKeyFile *mm_versioned_key_file_new  (const gchar  *group);
+
+/* Loads the key file from @path, or returns NULL if it doesn't exist, can't
+ * be loaded, or was written by a different version. @description names the
+ * contents of the file in the log messages. */
+GKeyFile *mm_versioned_key_file_load (const gchar  *path,
+                                      const gchar  *group,
+                                      const gchar  *description,
+                                      gpointer      log_object);
+
+gboolean  mm_versioned_key_file_save (GKeyFile     *key_file,
+                                      const gchar  *path,
+                                      GError      **error);
+
+#endif /* MM_VERSIONED_KEY_FILE_H */
@@ -17,7 +17,11 @@
 #include <string.h>
 #include <glib.h>
 
+#include <ModemManager.h>
+#include <libmm-glib.h>
+
 #include "mm-port-serial-at.h"
+#include "mm-serial-parsers.h"
 #include "mm-log-test.h"
 
 typedef struct {
@@ -47,21 +51,405 @@ at_serial_echo_removal (void)
     guint i;
 
     for (i = 0; i < G_N_ELEMENTS (echo_removal_tests); i++) {
-        GByteArray *ba;
+        MMSerialBuffer *buffer;
 
-        /* Note that we add last NUL also to the byte array, so that we can compare
+        /* Note that we add last NUL also to the buffer, so that we can compare
          * C strings later on */
-        ba = g_byte_array_sized_new (strlen (echo_removal_tests[i].original) + 1);
-        g_byte_array_prepend (ba,
-                              (guint8 *)echo_removal_tests[i].original,
-                              strlen (echo_removal_tests[i].original) + 1);
+        buffer = mm_serial_buffer_new (strlen (echo_removal_tests[i].original) + 1);
+        mm_serial_buffer_append (buffer,
+                                 (guint8 *)echo_removal_tests[i].original,
+                                 strlen (echo_removal_tests[i].original) + 1);
+
+        mm_port_serial_at_remove_echo (buffer);
+
+        g_assert_cmpstr ((gchar *)mm_serial_buffer_peek (buffer, NULL), ==, echo_removal_tests[i].without_echo);
+
+        mm_serial_buffer_free (buffer);
+    }
+}
+
+static void
+at_serial_buffer_consume_and_cut (void)
+{
+    MMSerialBuffer *buffer;
+    GString        *expected;
+    const guint8   *data;
+    gsize           len;
+    guint           i;
+
+    buffer = mm_serial_buffer_new (16);
+
+    /* Consuming just moves the read cursor */
+    mm_serial_buffer_append (buffer, (const guint8 *) "\r\n+CREG: 1\r\n\r\nOK\r\n", 18);
+    mm_serial_buffer_consume (buffer, 12);
+    data = mm_serial_buffer_peek (buffer, &len);
+    g_assert_cmpuint (len, ==, 6);
+    g_assert (memcmp (data, "\r\nOK\r\n", len) == 0);
+
+    /* Cutting a chunk in the middle keeps the data around it in order */
+    mm_serial_buffer_append (buffer, (const guint8 *) "\r\n+CSQ: 20,99\r\n", 15);
+    mm_serial_buffer_cut (buffer, 2, 4);
+    data = mm_serial_buffer_peek (buffer, &len);
+    g_assert_cmpuint (len, ==, 17);
+    g_assert (memcmp (data, "\r\n\r\n+CSQ: 20,99\r\n", len) == 0);
+
+    /* Buffer is rewound once fully consumed */
+    mm_serial_buffer_consume (buffer, len);
+    g_assert_cmpuint (mm_serial_buffer_get_len (buffer), ==, 0);
+
+    /* Many small appends and consumes keep the contents right across rewinds
+     * and reallocations */
+    expected = g_string_new (NULL);
+    for (i = 0; i < 100; i++) {
+        mm_serial_buffer_append (buffer, (const guint8 *) "abcdefg", 7);
+        g_string_append (expected, "abcdefg");
+        mm_serial_buffer_consume (buffer, 5);
+        g_string_erase (expected, 0, 5);
+    }
+    data = mm_serial_buffer_peek (buffer, &len);
+    g_assert_cmpuint (len, ==, expected->len);
+    g_assert (memcmp (data, expected->str, len) == 0);
+    g_string_free (expected, TRUE);
+
+    mm_serial_buffer_clear (buffer);
+    g_assert_cmpuint (mm_serial_buffer_get_len (buffer), ==, 0);
+
+    mm_serial_buffer_free (buffer);
+}
+
+typedef struct {
+    const gchar *original;
+    gsize        original_len;
+    const gchar *escaped;
+    gsize        n_escaped;
+} NulEscapeTest;
+
+static const NulEscapeTest nul_escape_tests[] = {
+    { "\r\nOK\r\n", 6, "\r\nOK\r\n", 0 },
+    { "\0\r\nOK\r\n", 7, "\0\r\nOK\r\n", 0 },
+    { "\r\n\0OK\r\n", 7, "\r\n\\0OK\r\n", 1 },
+    { "\0\0\0", 3, "\0\\0\\0", 2 },
+    { "ab\0", 3, "ab\\0", 1 },
+};
+
+static void
+at_serial_nul_escape (void)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (nul_escape_tests); i++) {
+        MMSerialBuffer *buffer;
+        const guint8   *data;
+        gsize           len;
+        gsize           n_escaped;
+
+        buffer = mm_serial_buffer_new (4);
+        n_escaped = mm_serial_buffer_append_escape_nul (buffer,
+                                                        (const guint8 *) nul_escape_tests[i].original,
+                                                        nul_escape_tests[i].original_len);
+        g_assert_cmpuint (n_escaped, ==, nul_escape_tests[i].n_escaped);
+
+        data = mm_serial_buffer_peek (buffer, &len);
+        g_assert_cmpuint (len, ==, nul_escape_tests[i].original_len + n_escaped);
+        g_assert (memcmp (data, nul_escape_tests[i].escaped, len) == 0);
+
+        mm_serial_buffer_free (buffer);
+    }
+}
+
+typedef struct {
+    const gchar *original;
+    gboolean     found;
+    const gchar *parsed;
+    GQuark       error_domain;
+    gint         error_code;
+} ParserTest;
+
+static void
+run_parser_tests (gpointer          parser,
+                  const ParserTest *parser_tests,
+                  guint             n_parser_tests)
+{
+    guint i;
+
+    for (i = 0; i < n_parser_tests; i++) {
+        GString  *response;
+        GError   *error = NULL;
+        gboolean  found;
+
+        response = g_string_new (parser_tests[i].original);
+        found = mm_serial_parser_v1_parse (parser, response, NULL, &error);
+        g_assert_cmpint (found, ==, parser_tests[i].found);
+        if (parser_tests[i].error_domain)
+            g_assert_error (error, parser_tests[i].error_domain, parser_tests[i].error_code);
+        else
+            g_assert_no_error (error);
+        if (parser_tests[i].parsed)
+            g_assert_cmpstr (response->str, ==, parser_tests[i].parsed);
+        g_clear_error (&error);
+        g_string_free (response, TRUE);
+    }
+}
+
+static void
+at_serial_parser (void)
+{
+    const ParserTest parser_tests[] = {
+        { "\r\n+CSQ: 20,99\r\n\r\nOK\r\n", TRUE, "+CSQ: 20,99", 0, 0 },
+        { "\r\nOK\r\n\r\n", TRUE, "", 0, 0 },
+        { "\r\n+CSQ: 20,99\r\n", FALSE, NULL, 0, 0 },
+        { "\r\n+CSQ: 20,99\r\n\r\nOK", FALSE, NULL, 0, 0 },
+        { "\r\nCONNECT 115200\r\n", TRUE, "CONNECT 115200", 0, 0 },
+        { "\r\nCONNECT\r\n~~~", TRUE, "CONNECT\r\n~~~", 0, 0 },
+        { "\r\n> ", TRUE, "> ", 0, 0 },
+        { "\r\n+CME ERROR: 10\r\n", TRUE, NULL, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_SIM_NOT_INSERTED },
+        { "\r\n+CME ERROR: SIM not inserted\r\n", TRUE, NULL, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_SIM_NOT_INSERTED },
+        { "\r\n+CMS ERROR: 310\r\n", TRUE, NULL, MM_MESSAGE_ERROR, MM_MESSAGE_ERROR_SIM_NOT_INSERTED },
+        { "\r\nERROR\r\n", TRUE, NULL, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_UNKNOWN },
+        { "\r\nERROR\r\n+CRE", TRUE, NULL, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_UNKNOWN },
+        { "\r\nNO CARRIER\r\n", TRUE, NULL, MM_CONNECTION_ERROR, MM_CONNECTION_ERROR_NO_CARRIER },
+        { "\r\nBUSY\r\n", TRUE, NULL, MM_CONNECTION_ERROR, MM_CONNECTION_ERROR_BUSY },
+        { "\r\nNO DIALTONE\r\n", TRUE, NULL, MM_CONNECTION_ERROR, MM_CONNECTION_ERROR_NO_DIALTONE },
+        { "\r\nNA\r\n", TRUE, NULL, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_NOT_ALLOWED },
+    };
+    gpointer parser;
+
+    parser = mm_serial_parser_v1_new ();
+    run_parser_tests (parser, parser_tests, G_N_ELEMENTS (parser_tests));
+
+    mm_serial_parser_v1_destroy (parser);
+}
 
-        mm_port_serial_at_remove_echo (ba);
+static void
+at_serial_parser_custom (void)
+{
+    const ParserTest parser_tests[] = {
+        /* Custom successful replies, even if followed by a standard final result code */
+        { "\r\n+CPIN: READY\r\n", TRUE, "+CPIN: READY", 0, 0 },
+        { "\r\n+CPIN: READY\r\n\r\nOK\r\n", TRUE, "+CPIN: READY\r\n\r\nOK", 0, 0 },
+        { "\r\n+CPIN: SIM PIN\r\n\r\nERROR\r\n", TRUE, NULL, 0, 0 },
+        /* Custom error replies go before standard error result codes only */
+        { "\r\n+XERR: 10\r\n", TRUE, NULL, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_SIM_NOT_INSERTED },
+        { "\r\n+XERR: 10\r\n\r\nERROR\r\n", TRUE, NULL, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_SIM_NOT_INSERTED },
+        { "\r\n+XERR: 10\r\n\r\n+CME ERROR: 3\r\n", TRUE, NULL, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_SIM_NOT_INSERTED },
+        { "\r\n+XERR: 10\r\n\r\nOK\r\n", TRUE, "+XERR: 10", 0, 0 },
+        /* Standard replies still work */
+        { "\r\n+CSQ: 20,99\r\n\r\nOK\r\n", TRUE, "+CSQ: 20,99", 0, 0 },
+        { "\r\nERROR\r\n", TRUE, NULL, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_UNKNOWN },
+    };
+    gpointer  parser;
+    GRegex   *successful;
+    GRegex   *error_regex;
+
+    parser = mm_serial_parser_v1_new ();
+    successful = g_regex_new ("\\r\\n\\+CPIN: .*\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+    error_regex = g_regex_new ("\\r\\n\\+XERR: (\\d+)\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+    mm_serial_parser_v1_set_custom_regex (parser, successful, error_regex);
+    g_regex_unref (successful);
+    g_regex_unref (error_regex);
+    run_parser_tests (parser, parser_tests, G_N_ELEMENTS (parser_tests));
+
+    mm_serial_parser_v1_destroy (parser);
+}
+
+static void
+unsolicited_msg_count (MMPortSerialAt *port,
+                       GMatchInfo     *match_info,
+                       guint          *count)
+{
+    (*count)++;
+}
+
+static void
+at_serial_unsolicited_dispatch (void)
+{
+    MMPortSerialAt *port;
+    MMSerialBuffer *buffer;
+    GRegex         *creg_regex;
+    GRegex         *creg_generic_regex;
+    GRegex         *qss_regex;
+    GRegex         *rssi_regex;
+    guint           n_creg = 0;
+    guint           n_creg_generic = 0;
+    guint           n_qss = 0;
+    guint           n_rssi = 0;
+    const gchar    *data = "\r\n+CREG: 1\r\n\r\n#QSS: 1\r\n\r\n+CSQ: 20,99\r\n\r\n+CREG: 5\r\n";
+    const guint8   *remaining;
+    gsize           len;
+
+    port = mm_port_serial_at_new ("ttyTEST", MM_PORT_SUBSYS_TTY);
+
+    /* Handlers added last run first, and text they match is not given to the
+     * ones added before */
+    creg_generic_regex = g_regex_new ("\\r\\n\\+CREG:(.*)\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+    creg_regex = g_regex_new ("\\r\\n\\+CREG: 1\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+    /* No literal prefix after <CR><LF>, always run */
+    qss_regex = g_regex_new ("#QSS:\\s*([0-3])\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+    /* Prefix not found, never run */
+    rssi_regex = g_regex_new ("\\r\\n\\^RSSI:\\s*(\\d+)\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+
+    mm_port_serial_at_add_unsolicited_msg_handler (port, creg_generic_regex, (MMPortSerialAtUnsolicitedMsgFn) unsolicited_msg_count, &n_creg_generic, NULL);
+    mm_port_serial_at_add_unsolicited_msg_handler (port, creg_regex, (MMPortSerialAtUnsolicitedMsgFn) unsolicited_msg_count, &n_creg, NULL);
+    mm_port_serial_at_add_unsolicited_msg_handler (port, qss_regex, (MMPortSerialAtUnsolicitedMsgFn) unsolicited_msg_count, &n_qss, NULL);
+    mm_port_serial_at_add_unsolicited_msg_handler (port, rssi_regex, (MMPortSerialAtUnsolicitedMsgFn) unsolicited_msg_count, &n_rssi, NULL);
+
+    buffer = mm_serial_buffer_new (strlen (data));
+    mm_serial_buffer_append (buffer, (const guint8 *) data, strlen (data));
+    MM_PORT_SERIAL_GET_CLASS (port)->parse_unsolicited (MM_PORT_SERIAL (port), buffer);
+
+    g_assert_cmpuint (n_creg, ==, 1);
+    g_assert_cmpuint (n_creg_generic, ==, 1);
+    g_assert_cmpuint (n_qss, ==, 1);
+    g_assert_cmpuint (n_rssi, ==, 0);
+
+    remaining = mm_serial_buffer_peek (buffer, &len);
+    g_assert_cmpuint (len, ==, strlen ("\r\n\r\n+CSQ: 20,99\r\n"));
+    g_assert (memcmp (remaining, "\r\n\r\n+CSQ: 20,99\r\n", len) == 0);
+
+    mm_serial_buffer_free (buffer);
+    g_regex_unref (creg_generic_regex);
+    g_regex_unref (creg_regex);
+    g_regex_unref (qss_regex);
+    g_regex_unref (rssi_regex);
+    g_object_unref (port);
+}
+
+static void
+at_serial_unsolicited_overlap (void)
+{
+    MMPortSerialAt *port;
+    MMSerialBuffer *buffer;
+    GRegex         *ciev_regex;
+    GRegex         *creg_regex;
+    guint           n_ciev = 0;
+    guint           n_creg = 0;
+    const gchar    *data = "\r\n+CIEV: 1\r\n+CREG: 1\r\n\r\nOK";
+    const guint8   *remaining;
+    gsize           len;
+
+    port = mm_port_serial_at_new ("ttyTEST", MM_PORT_SUBSYS_TTY);
+
+    /* The +CIEV match takes the <CR><LF> before +CREG; the +CREG handler
+     * still matches once the +CIEV text is removed */
+    creg_regex = g_regex_new ("\\r\\n\\+CREG: (\\d)\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+    ciev_regex = g_regex_new ("\\+CIEV: (\\d)\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
 
-        g_assert_cmpstr ((gchar *)ba->data, ==, echo_removal_tests[i].without_echo);
+    mm_port_serial_at_add_unsolicited_msg_handler (port, creg_regex, (MMPortSerialAtUnsolicitedMsgFn) unsolicited_msg_count, &n_creg, NULL);
+    mm_port_serial_at_add_unsolicited_msg_handler (port, ciev_regex, (MMPortSerialAtUnsolicitedMsgFn) unsolicited_msg_count, &n_ciev, NULL);
 
-        g_byte_array_unref (ba);
+    buffer = mm_serial_buffer_new (strlen (data));
+    mm_serial_buffer_append (buffer, (const guint8 *) data, strlen (data));
+    MM_PORT_SERIAL_GET_CLASS (port)->parse_unsolicited (MM_PORT_SERIAL (port), buffer);
+
+    g_assert_cmpuint (n_ciev, ==, 1);
+    g_assert_cmpuint (n_creg, ==, 1);
+
+    remaining = mm_serial_buffer_peek (buffer, &len);
+    g_assert_cmpuint (len, ==, strlen ("\r\nOK"));
+    g_assert (memcmp (remaining, "\r\nOK", len) == 0);
+
+    mm_serial_buffer_free (buffer);
+    g_regex_unref (ciev_regex);
+    g_regex_unref (creg_regex);
+    g_object_unref (port);
+}
+
+typedef struct {
+    gpointer parser;
+    guint    n_calls;
+} CountingParser;
+
+static gboolean
+counting_parser_parse (CountingParser *counting,
+                       GString        *response,
+                       gpointer        log_object,
+                       GError        **error)
+{
+    counting->n_calls++;
+    return mm_serial_parser_v1_parse (counting->parser, response, log_object, error);
+}
+
+static gboolean
+counting_parser_check_line (CountingParser *counting,
+                            const gchar    *line,
+                            gsize           line_len,
+                            gboolean        complete)
+{
+    return mm_serial_parser_v1_check_line (counting->parser, line, line_len, complete);
+}
+
+static void
+at_serial_incremental_parse (void)
+{
+    MMPortSerialAt           *port;
+    MMSerialBuffer           *buffer;
+    GRegex                   *cmt_regex;
+    CountingParser            counting = { NULL, 0 };
+    guint                     n_cmt = 0;
+    GByteArray               *parsed = NULL;
+    GError                   *error = NULL;
+    MMPortSerialResponseType  type = MM_PORT_SERIAL_RESPONSE_NONE;
+    guint                     i;
+    const gchar              *expected = "+CMGL: 1,1,,23\r\n07911326040000F0040B911346610089F60000\r\n"
+                                          "+CMGL: 2,1,,23\r\n07911326040000F0040B911346610089F60000";
+    const gchar              *chunks[] = {
+        "AT+CMGL=4\r\r\n+CMGL: 1,1,,2",
+        "3\r\n07911326040000F0",
+        "040B911346610089F60000\r\n+CMGL: 2,1,,23\r\n0791",
+        /* Message split in two reads, the header line already complete */
+        "1326040000F0040B911346610089F60000\r\n\r\n+CMT: ,23\r\n",
+        "07911326040000F0\r\n",
+        "\r\nO",
+        "K\r",
+        "\n",
+    };
+
+    port = mm_port_serial_at_new ("ttyTEST", MM_PORT_SUBSYS_TTY);
+    counting.parser = mm_serial_parser_v1_new ();
+    mm_port_serial_at_set_response_parser_full (port,
+                                                (MMPortSerialAtResponseParserFn) counting_parser_parse,
+                                                (MMPortSerialAtResponseLineFn) counting_parser_check_line,
+                                                &counting,
+                                                NULL);
+
+    cmt_regex = g_regex_new ("\\r\\n\\+CMT: ,(\\d+)\\r\\n(\\w+)\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+    mm_port_serial_at_add_unsolicited_msg_handler (port, cmt_regex, (MMPortSerialAtUnsolicitedMsgFn) unsolicited_msg_count, &n_cmt, NULL);
+
+    buffer = mm_serial_buffer_new (16);
+    for (i = 0; i < G_N_ELEMENTS (chunks); i++) {
+        g_assert_cmpint (type, ==, MM_PORT_SERIAL_RESPONSE_NONE);
+        mm_serial_buffer_append (buffer, (const guint8 *) chunks[i], strlen (chunks[i]));
+        MM_PORT_SERIAL_GET_CLASS (port)->parse_unsolicited (MM_PORT_SERIAL (port), buffer);
+        type = MM_PORT_SERIAL_GET_CLASS (port)->parse_response (MM_PORT_SERIAL (port), buffer, &parsed, &error);
     }
+
+    /* The parser only got the response once the final result code was complete */
+    g_assert_cmpint (type, ==, MM_PORT_SERIAL_RESPONSE_BUFFER);
+    g_assert_no_error (error);
+    g_assert_cmpuint (counting.n_calls, ==, 1);
+    g_assert_cmpuint (n_cmt, ==, 1);
+    g_assert (parsed);
+    g_assert_cmpuint (parsed->len, ==, strlen (expected));
+    g_assert (memcmp (parsed->data, expected, parsed->len) == 0);
+    g_assert_cmpuint (mm_serial_buffer_get_len (buffer), ==, 0);
+
+    g_byte_array_unref (parsed);
+    mm_serial_buffer_free (buffer);
+    g_regex_unref (cmt_regex);
+    g_object_unref (port);
+    mm_serial_parser_v1_destroy (counting.parser);
+}
+
+static void
+at_serial_debug_escape (void)
+{
+    GString *str;
+
+    str = g_string_new ("<-- '");
+    mm_port_serial_debug_escape (str, "\r\nOK\r\n\x01\xff", 8);
+    g_string_append_c (str, '\'');
+    g_assert_cmpstr (str->str, ==, "<-- '<CR><LF>OK<CR><LF>\\1\\255'");
+    g_string_free (str, TRUE);
 }
 
 int main (int argc, char **argv)
@@ -69,6 +457,14 @@ int main (int argc, char **argv)
     g_test_init (&argc, &argv, NULL);
 
     g_test_add_func ("/ModemManager/AT-serial/echo-removal", at_serial_echo_removal);
+    g_test_add_func ("/ModemManager/AT-serial/buffer-consume-and-cut", at_serial_buffer_consume_and_cut);
+    g_test_add_func ("/ModemManager/AT-serial/nul-escape", at_serial_nul_escape);
+    g_test_add_func ("/ModemManager/AT-serial/parser", at_serial_parser);
+    g_test_add_func ("/ModemManager/AT-serial/parser-custom", at_serial_parser_custom);
+    g_test_add_func ("/ModemManager/AT-serial/unsolicited-dispatch", at_serial_unsolicited_dispatch);
+    g_test_add_func ("/ModemManager/AT-serial/unsolicited-overlap", at_serial_unsolicited_overlap);
+    g_test_add_func ("/ModemManager/AT-serial/incremental-parse", at_serial_incremental_parse);
+    g_test_add_func ("/ModemManager/AT-serial/debug-escape", at_serial_debug_escape);
 
     return g_test_run ();
 }
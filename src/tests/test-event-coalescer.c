@@ -0,0 +1,196 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <locale.h>
+
+#include "mm-event-coalescer.h"
+#include "mm-log-test.h"
+
+/*****************************************************************************/
+
+/* Items are the port names; reported events are recorded as
+ * "<group> <+|-><port>" */
+
+static void
+record_cb (const gchar            *group,
+           MMEventCoalescerAction  action,
+           gpointer                item,
+           GPtrArray              *reported)
+{
+    g_ptr_array_add (reported,
+                     g_strdup_printf ("%s %c%s",
+                                      group,
+                                      action == MM_EVENT_COALESCER_ACTION_ADD ? '+' : '-',
+                                      (const gchar *) item));
+}
+
+static void
+push (MMEventCoalescer       *coalescer,
+      const gchar            *group,
+      const gchar            *port,
+      MMEventCoalescerAction  action)
+{
+    mm_event_coalescer_push (coalescer, group, port, action, g_strdup (port));
+}
+
+static void
+assert_reported (GPtrArray   *reported,
+                 const gchar *expected)
+{
+    g_autofree gchar *str = NULL;
+
+    g_ptr_array_add (reported, NULL);
+    str = g_strjoinv (",", (gchar **) reported->pdata);
+    g_assert_cmpstr (str, ==, expected);
+    g_ptr_array_set_size (reported, 0);
+}
+
+#define ADD    MM_EVENT_COALESCER_ACTION_ADD
+#define REMOVE MM_EVENT_COALESCER_ACTION_REMOVE
+
+static void
+test_immediate (void)
+{
+    MMEventCoalescer *coalescer;
+    GPtrArray        *reported;
+
+    reported = g_ptr_array_new_with_free_func (g_free);
+    coalescer = mm_event_coalescer_new (0, 0, g_free, (MMEventCoalescerFunc) record_cb, reported, NULL);
+
+    push (coalescer, "dev1", "ttyUSB0", ADD);
+    push (coalescer, "dev1", "ttyUSB0", REMOVE);
+    assert_reported (reported, "dev1 +ttyUSB0,dev1 -ttyUSB0");
+    g_assert_cmpuint (mm_event_coalescer_get_n_events (coalescer), ==, 2);
+    g_assert_cmpuint (mm_event_coalescer_get_n_suppressed (coalescer), ==, 0);
+
+    mm_event_coalescer_free (coalescer);
+    g_ptr_array_unref (reported);
+}
+
+static void
+test_coalesce (void)
+{
+    MMEventCoalescer *coalescer;
+    GPtrArray        *reported;
+
+    reported = g_ptr_array_new_with_free_func (g_free);
+    coalescer = mm_event_coalescer_new (100, 1000, g_free, (MMEventCoalescerFunc) record_cb, reported, NULL);
+
+    /* add + remove: a single remove, in case the port was known before */
+    push (coalescer, "dev1", "ttyUSB0", ADD);
+    push (coalescer, "dev1", "ttyUSB0", REMOVE);
+    mm_event_coalescer_flush (coalescer);
+    assert_reported (reported, "dev1 -ttyUSB0");
+    g_assert_cmpuint (mm_event_coalescer_get_n_suppressed (coalescer), ==, 1);
+
+    /* Repeated adds: a single add */
+    push (coalescer, "dev1", "ttyUSB0", ADD);
+    push (coalescer, "dev1", "ttyUSB0", ADD);
+    push (coalescer, "dev1", "ttyUSB0", ADD);
+    mm_event_coalescer_flush (coalescer);
+    assert_reported (reported, "dev1 +ttyUSB0");
+    g_assert_cmpuint (mm_event_coalescer_get_n_suppressed (coalescer), ==, 3);
+
+    /* Device reset with a new composition: removes first, then the adds of
+     * every device together */
+    push (coalescer, "dev1", "ttyUSB0", ADD);
+    push (coalescer, "dev2", "wwan0", ADD);
+    push (coalescer, "dev1", "ttyUSB1", ADD);
+    push (coalescer, "dev1", "ttyUSB0", REMOVE);
+    push (coalescer, "dev1", "ttyUSB1", REMOVE);
+    push (coalescer, "dev1", "ttyUSB0", ADD);
+    push (coalescer, "dev1", "ttyUSB1", ADD);
+    push (coalescer, "dev1", "cdc-wdm0", ADD);
+    mm_event_coalescer_flush (coalescer);
+    assert_reported (reported,
+                     "dev1 -ttyUSB0,dev1 -ttyUSB1,"
+                     "dev1 +ttyUSB0,dev1 +ttyUSB1,dev1 +cdc-wdm0,"
+                     "dev2 +wwan0");
+    g_assert_cmpuint (mm_event_coalescer_get_n_events (coalescer), ==, 13);
+    g_assert_cmpuint (mm_event_coalescer_get_n_suppressed (coalescer), ==, 5);
+
+    /* Events of a queued port stay in its group */
+    push (coalescer, "dev1", "ttyUSB0", ADD);
+    push (coalescer, "/sys/devices/ttyUSB0", "ttyUSB0", REMOVE);
+    mm_event_coalescer_flush (coalescer);
+    assert_reported (reported, "dev1 -ttyUSB0");
+
+    /* Nothing queued */
+    mm_event_coalescer_flush (coalescer);
+    g_assert_cmpuint (reported->len, ==, 0);
+
+    /* Queued events are discarded */
+    push (coalescer, "dev1", "ttyUSB0", ADD);
+    mm_event_coalescer_free (coalescer);
+    g_assert_cmpuint (reported->len, ==, 0);
+    g_ptr_array_unref (reported);
+}
+
+static gboolean
+quit_cb (GMainLoop *loop)
+{
+    g_main_loop_quit (loop);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean
+push_cb (MMEventCoalescer *coalescer)
+{
+    push (coalescer, "dev1", "ttyUSB0", ADD);
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+test_max_delay (void)
+{
+    MMEventCoalescer *coalescer;
+    GPtrArray        *reported;
+    GMainLoop        *loop;
+    guint             push_id;
+
+    reported = g_ptr_array_new_with_free_func (g_free);
+    coalescer = mm_event_coalescer_new (50, 200, g_free, (MMEventCoalescerFunc) record_cb, reported, NULL);
+    loop = g_main_loop_new (NULL, FALSE);
+
+    /* Events keep arriving within the window, but are still reported once
+     * the maximum delay is reached */
+    push_id = g_timeout_add (10, (GSourceFunc) push_cb, coalescer);
+    g_timeout_add (500, (GSourceFunc) quit_cb, loop);
+    g_main_loop_run (loop);
+    g_source_remove (push_id);
+
+    g_assert_cmpuint (reported->len, >=, 1);
+    g_assert_cmpstr (g_ptr_array_index (reported, 0), ==, "dev1 +ttyUSB0");
+    g_assert_cmpuint (mm_event_coalescer_get_n_suppressed (coalescer), >, 0);
+
+    mm_event_coalescer_free (coalescer);
+    g_main_loop_unref (loop);
+    g_ptr_array_unref (reported);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    setlocale (LC_ALL, "");
+
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/event-coalescer/immediate", test_immediate);
+    g_test_add_func ("/MM/event-coalescer/coalesce",  test_coalesce);
+    g_test_add_func ("/MM/event-coalescer/max-delay", test_max_delay);
+
+    return g_test_run ();
+}
@@ -0,0 +1,38 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
+
+/* Common helpers to be used by test applications */
+
+/* Builds the path of a file that doesn't exist yet in the temporary
+ * directory, with a name built from the given template */
+static inline gchar *
+test_build_tmp_path (const gchar *tmpl)
+{
+    gchar *path;
+    gint   fd;
+
+    fd = g_file_open_tmp (tmpl, &path, NULL);
+    g_assert_cmpint (fd, >=, 0);
+    close (fd);
+    g_unlink (path);
+    return path;
+}
+
+#endif /* TEST_HELPERS_H */
@@ -0,0 +1,163 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <glib.h>
+#include <string.h>
+#include <locale.h>
+
+#include "mm-log-binary.h"
+
+/*****************************************************************************/
+
+/* Encodes a message record and checks that decoding it gives @expected, or
+ * that it can't be encoded if @expected is NULL */
+static void
+common_test_roundtrip (const gchar *expected,
+                       const gchar *fmt,
+                       ...)
+{
+    GString            *out;
+    GString            *decoded;
+    MMLogBinaryRecord   record;
+    MMLogBinaryMessage  message;
+    va_list             args;
+    gboolean            encoded;
+
+    out = g_string_new (NULL);
+    va_start (args, fmt);
+    encoded = mm_log_binary_append_message (out, MM_LOG_LEVEL_DEBUG, 3, 2, 1, fmt, args);
+    va_end (args);
+
+    if (!expected) {
+        g_assert (!encoded);
+        g_assert_cmpuint (out->len, ==, 0);
+        g_string_free (out, TRUE);
+        return;
+    }
+
+    g_assert (encoded);
+    g_assert_cmpuint (out->len, >=, sizeof (record) + sizeof (message));
+    memcpy (&record, out->str, sizeof (record));
+    g_assert_cmpuint (record.type, ==, MM_LOG_BINARY_RECORD_MESSAGE);
+    g_assert_cmpuint (record.level, ==, MM_LOG_LEVEL_DEBUG);
+    g_assert_cmpuint (record.len, ==, out->len - sizeof (record));
+    memcpy (&message, &out->str[sizeof (record)], sizeof (message));
+    g_assert_cmpuint (message.format_id, ==, 3);
+    g_assert_cmpuint (message.object_id, ==, 2);
+    g_assert_cmpuint (message.module_id, ==, 1);
+
+    decoded = g_string_new (NULL);
+    g_assert (mm_log_binary_format_args (decoded,
+                                         fmt,
+                                         (const guint8 *) &out->str[sizeof (record) + sizeof (message)],
+                                         record.len - sizeof (message)));
+    g_assert_cmpstr (decoded->str, ==, expected);
+
+    g_string_free (decoded, TRUE);
+    g_string_free (out, TRUE);
+}
+
+static void
+test_roundtrip_integers (void)
+{
+    common_test_roundtrip ("no conversions", "no conversions");
+    common_test_roundtrip ("a 5 b -3 c 100%", "a %d b %i c %u%%", 5, -3, 100);
+    common_test_roundtrip ("x ff y 7fffffffffffffff", "x %x y %" G_GINT64_MODIFIER "x", 255, G_GINT64_CONSTANT (0x7fffffffffffffff));
+    common_test_roundtrip ("h -1 hh 255", "h %hd hh %hhu", 0xffff, 0x1ff);
+    common_test_roundtrip ("z 12345 l -2", "z %" G_GSIZE_FORMAT " l %ld", (gsize) 12345, -2L);
+    common_test_roundtrip ("w [   42] [-7  ]", "w [%*d] [%-4lld]", 5, 42, -7LL);
+}
+
+static void
+test_roundtrip_others (void)
+{
+    common_test_roundtrip ("s 'hello' 'he' [  ab]", "s '%s' '%.*s' [%4s]", "hello", 2, "hello", "ab");
+    common_test_roundtrip ("f 3.14 e 1.000000e+00 c Z", "f %.2f e %e c %c", 3.14159, 1.0, 'Z');
+}
+
+static void
+test_unsupported (void)
+{
+    gint n;
+
+    common_test_roundtrip (NULL, "written %n", &n);
+    common_test_roundtrip (NULL, "positional %1$d", 1);
+}
+
+static gboolean
+append_args (GString     *out,
+             const gchar *fmt,
+             ...)
+{
+    va_list  args;
+    gboolean encoded;
+
+    va_start (args, fmt);
+    encoded = mm_log_binary_append_args (out, fmt, args);
+    va_end (args);
+    return encoded;
+}
+
+static void
+test_args (void)
+{
+    GString *out;
+    GString *decoded;
+    gint     n;
+
+    /* Appended as they are, after whatever is already there */
+    out = g_string_new ("id");
+    g_assert (append_args (out, "%s: %u", "port", 7));
+    decoded = g_string_new (NULL);
+    g_assert (mm_log_binary_format_args (decoded, "%s: %u", (const guint8 *) &out->str[2], out->len - 2));
+    g_assert_cmpstr (decoded->str, ==, "port: 7");
+
+    /* Nothing appended if they can't be encoded */
+    g_string_assign (out, "id");
+    g_assert (!append_args (out, "%d %n", 1, &n));
+    g_assert_cmpstr (out->str, ==, "id");
+
+    g_string_free (decoded, TRUE);
+    g_string_free (out, TRUE);
+}
+
+static void
+test_malformed_args (void)
+{
+    GString *decoded;
+    gint64   value = 5;
+
+    decoded = g_string_new (NULL);
+    /* Too short */
+    g_assert (!mm_log_binary_format_args (decoded, "%d", (const guint8 *) &value, 4));
+    /* Too long */
+    g_assert (!mm_log_binary_format_args (decoded, "none", (const guint8 *) &value, sizeof (value)));
+    g_string_free (decoded, TRUE);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    setlocale (LC_ALL, "");
+
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/log-binary/roundtrip/integers", test_roundtrip_integers);
+    g_test_add_func ("/MM/log-binary/roundtrip/others",   test_roundtrip_others);
+    g_test_add_func ("/MM/log-binary/unsupported",        test_unsupported);
+    g_test_add_func ("/MM/log-binary/args",               test_args);
+    g_test_add_func ("/MM/log-binary/malformed-args",     test_malformed_args);
+
+    return g_test_run ();
+}
@@ -4462,6 +4462,151 @@ test_bcd_to_string (void *f, gpointer d)
 
 /*****************************************************************************/
 
+static void
+test_compound_at_command (void *f, gpointer d)
+{
+    const gchar *commands[] = { "+CGMI", "AT+CGMM", "+CGMR", NULL };
+    gchar       *compound;
+
+    g_assert (mm_at_command_is_batchable ("+CSQ"));
+    g_assert (mm_at_command_is_batchable ("AT+COPS?"));
+    g_assert (mm_at_command_is_batchable ("^SYSINFO"));
+    g_assert (!mm_at_command_is_batchable ("I"));
+    g_assert (!mm_at_command_is_batchable ("D*99#"));
+    g_assert (!mm_at_command_is_batchable ("+COPS=3,2;+COPS?"));
+    g_assert (!mm_at_command_is_batchable ("+CPBR=1,\"a;b\""));
+
+    compound = mm_build_compound_at_command (commands);
+    g_assert_cmpstr (compound, ==, "+CGMI;+CGMM;+CGMR");
+    g_free (compound);
+}
+
+static const struct {
+    const gchar *command;
+    const gchar *prefix;
+} at_command_prefix_tests[] = {
+    { "AT+CPIN=\"1234\"",                "AT+CPIN=" },
+    { "AT+CPIN?",                        "AT+CPIN?" },
+    { "AT+CPIN=?",                       "AT+CPIN=?" },
+    { "AT$QCPDPP=1,1,\"pass\",\"user\"", "AT$QCPDPP=" },
+    { "ATD*99#",                         "ATD" },
+    { "AT&F E0",                         "AT&F" },
+    { "ATZ\r",                           "ATZ" },
+    { "AT",                              "AT" },
+    { "+CGMI;+CGMM;+CGSN",               "+CGMI;+CGMM;+CGSN" },
+    { "AT+CREG?;+CGREG?\r",              "AT+CREG?;+CGREG?" },
+    { "AT+COPS=3,2;+COPS?",              "AT+COPS=" },
+    { "AT+CGMI;D*99#",                   "AT+CGMI" },
+};
+
+static void
+test_at_command_prefix (void *f, gpointer d)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (at_command_prefix_tests); i++) {
+        gchar *prefix;
+
+        prefix = mm_at_command_get_prefix (at_command_prefix_tests[i].command);
+        g_assert_cmpstr (prefix, ==, at_command_prefix_tests[i].prefix);
+        g_free (prefix);
+    }
+}
+
+typedef struct {
+    const gchar *response;
+    const gchar *commands[4];
+    /* NULL first item if the response cannot be split */
+    const gchar *expected[4];
+} CompoundResponseTest;
+
+static const CompoundResponseTest compound_response_tests[] = {
+    /* One untagged line per command */
+    { "QUALCOMM INCORPORATED\r\n\r\nEC25\r\n\r\n359072060000000",
+      { "+CGMI", "+CGMM", "+CGSN" },
+      { "QUALCOMM INCORPORATED", "EC25", "359072060000000" } },
+    /* Tagged lines */
+    { "+CSQ: 20,99\r\n\r\n+COPS: 0,0,\"Vodafone\",7",
+      { "+CSQ", "+COPS?" },
+      { "+CSQ: 20,99", "+COPS: 0,0,\"Vodafone\",7" } },
+    /* Multiple tagged lines for the same command */
+    { "+CSQ: 20,99\r\n+CGDCONT: 1,\"IP\",\"a\"\r\n+CGDCONT: 2,\"IP\",\"b\"",
+      { "+CSQ", "+CGDCONT?" },
+      { "+CSQ: 20,99", "+CGDCONT: 1,\"IP\",\"a\"\r\n+CGDCONT: 2,\"IP\",\"b\"" } },
+    /* A command with an empty response */
+    { "+COPS: 0",
+      { "+CSQ", "+COPS?" },
+      { "", "+COPS: 0" } },
+    /* Out of order */
+    { "+COPS: 0\r\n+CSQ: 20,99",
+      { "+CSQ", "+COPS?" },
+      { NULL } },
+    /* Untagged lines that cannot be assigned */
+    { "+CSQ: 20,99\r\nfoo\r\nbar",
+      { "+CSQ", "+COPS?" },
+      { NULL } },
+    /* Untagged lines before the tagged lines of a previous command */
+    { "Quectel\r\n+CSQ: 20,99",
+      { "+CSQ", "+CGMI" },
+      { NULL } },
+    /* Tagged reply of a command usually replying without tag */
+    { "+CGSN: 359072060000000\r\nQuectel",
+      { "+CGSN", "+CGMI" },
+      { "+CGSN: 359072060000000", "Quectel" } },
+    /* Empty response of a command known to reply with a single line */
+    { "EC25",
+      { "+CGMI", "+CGMM" },
+      { NULL } },
+    { "+CSQ: 20,99",
+      { "+CGMI", "+CSQ" },
+      { NULL } },
+    /* Multi-line response, the only untagged one */
+    { "+CSQ: 20,99\r\nEC25EFAR06A06M4G\r\nbuild 1234",
+      { "+CSQ", "+CGMR" },
+      { "+CSQ: 20,99", "EC25EFAR06A06M4G\r\nbuild 1234" } },
+    { "+CSQ: 20,99",
+      { "+CGMR", "+CSQ" },
+      { "", "+CSQ: 20,99" } },
+    /* Multi-line response along with other untagged ones: the first line
+     * could be either the reply of +CGMI or part of the one of +CGMR */
+    { "EC25EFAR06A06M4G\r\nbuild 1234",
+      { "+CGMI", "+CGMR" },
+      { NULL } },
+    { "Quectel\r\nEC25EFAR06A06M4G\r\nbuild 1234",
+      { "+CGMI", "+CGMR" },
+      { NULL } },
+};
+
+static void
+test_compound_at_response (void *f, gpointer d)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (compound_response_tests); i++) {
+        const CompoundResponseTest *test = &compound_response_tests[i];
+        GError *error = NULL;
+        gchar **responses;
+        guint   j;
+
+        responses = mm_split_compound_at_response (test->response, (const gchar **) test->commands, &error);
+        if (!test->expected[0]) {
+            g_assert (error);
+            g_assert (!responses);
+            g_error_free (error);
+            continue;
+        }
+
+        g_assert_no_error (error);
+        g_assert (responses);
+        for (j = 0; test->commands[j]; j++)
+            g_assert_cmpstr (responses[j], ==, test->expected[j]);
+        g_assert (!responses[j]);
+        g_strfreev (responses);
+    }
+}
+
+/*****************************************************************************/
+
 #define TESTCASE(t, d) g_test_create_case (#t, 0, d, NULL, (GTestFixtureFunc) t, NULL)
 
 int main (int argc, char **argv)
@@ -4693,6 +4838,10 @@ int main (int argc, char **argv)
 
     g_test_suite_add (suite, TESTCASE (test_bcd_to_string, NULL));
 
+    g_test_suite_add (suite, TESTCASE (test_compound_at_command, NULL));
+    g_test_suite_add (suite, TESTCASE (test_at_command_prefix, NULL));
+    g_test_suite_add (suite, TESTCASE (test_compound_at_response, NULL));
+
     result = g_test_run ();
 
     reg_test_data_free (reg_data);
@@ -0,0 +1,254 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <locale.h>
+
+#include "mm-plugin-manifest.h"
+#include "mm-log-test.h"
+#include "test-helpers.h"
+
+/*****************************************************************************/
+
+static GArray *
+build_vendor_ids (guint   first,
+                  ...)
+{
+    GArray  *array;
+    va_list  args;
+    guint    vid;
+
+    array = g_array_new (FALSE, FALSE, sizeof (guint16));
+    va_start (args, first);
+    for (vid = first; vid; vid = va_arg (args, guint)) {
+        guint16 value = (guint16) vid;
+
+        g_array_append_val (array, value);
+    }
+    va_end (args);
+    return array;
+}
+
+static void
+test_roundtrip (void)
+{
+    GPtrArray                 *entries;
+    MMPluginManifestEntry     *entry;
+    MMPluginManifestProductId  id;
+    gchar                     *path;
+
+    path = test_build_tmp_path ("test-plugin-manifest-XXXXXX");
+
+    entries = g_ptr_array_new_with_free_func ((GDestroyNotify) mm_plugin_manifest_entry_free);
+
+    entry = mm_plugin_manifest_entry_new ("libmm-plugin-sierra.so");
+    entry->mtime = 1600000000;
+    entry->size = 123456;
+    entry->name = g_strdup ("sierra");
+    entry->subsystems = g_strsplit ("tty,net,usbmisc", ",", -1);
+    entry->mandatory_vendor_ids = build_vendor_ids (0x1199, 0x0f3d, 0);
+    entry->vendor_ids = build_vendor_ids (0x1199, 0x0f3d, 0);
+    g_ptr_array_add (entries, entry);
+
+    entry = mm_plugin_manifest_entry_new ("libmm-plugin-generic.so");
+    entry->name = g_strdup ("generic");
+    entry->generic = TRUE;
+    g_ptr_array_add (entries, entry);
+
+    entry = mm_plugin_manifest_entry_new ("libmm-plugin-x22x.so");
+    entry->name = g_strdup ("x22x");
+    entry->udev_tags = g_strsplit ("ID_MM_X22X_TAGGED", ",", -1);
+    entry->drivers = g_new0 (gchar *, 1);
+    entry->vendor_ids = build_vendor_ids (0x1bbb, 0x0b3c, 0);
+    entry->product_ids = g_array_new (FALSE, FALSE, sizeof (MMPluginManifestProductId));
+    id.vid = 0x0000;
+    id.pid = 0xffff;
+    g_array_append_val (entry->product_ids, id);
+    g_ptr_array_add (entries, entry);
+
+    g_assert (mm_plugin_manifest_save (path, entries, NULL));
+    g_ptr_array_unref (entries);
+
+    /* Reload from disk, same order */
+    entries = mm_plugin_manifest_load (path, NULL);
+    g_assert (entries);
+    g_assert_cmpuint (entries->len, ==, 3);
+
+    entry = g_ptr_array_index (entries, 0);
+    g_assert_cmpstr (entry->filename, ==, "libmm-plugin-sierra.so");
+    g_assert_cmpuint (entry->mtime, ==, 1600000000);
+    g_assert_cmpuint (entry->size, ==, 123456);
+    g_assert_cmpstr (entry->name, ==, "sierra");
+    g_assert (!entry->generic);
+    g_assert_cmpuint (g_strv_length (entry->subsystems), ==, 3);
+    g_assert_cmpstr (entry->subsystems[2], ==, "usbmisc");
+    g_assert (entry->mandatory_vendor_ids);
+    g_assert_cmpuint (entry->mandatory_vendor_ids->len, ==, 2);
+    g_assert_cmpuint (g_array_index (entry->mandatory_vendor_ids, guint16, 1), ==, 0x0f3d);
+    g_assert_cmpuint (entry->vendor_ids->len, ==, 2);
+    g_assert (!entry->udev_tags);
+    g_assert (!entry->drivers);
+    g_assert (!entry->product_ids);
+
+    entry = g_ptr_array_index (entries, 1);
+    g_assert_cmpstr (entry->filename, ==, "libmm-plugin-generic.so");
+    g_assert (entry->generic);
+    g_assert (!entry->subsystems);
+    g_assert (!entry->mandatory_vendor_ids);
+    g_assert (!entry->vendor_ids);
+
+    entry = g_ptr_array_index (entries, 2);
+    g_assert_cmpstr (entry->name, ==, "x22x");
+    g_assert (!entry->mandatory_vendor_ids);
+    g_assert_cmpuint (g_strv_length (entry->udev_tags), ==, 1);
+    g_assert_cmpstr (entry->udev_tags[0], ==, "ID_MM_X22X_TAGGED");
+    /* Empty, but set */
+    g_assert (entry->drivers);
+    g_assert_cmpuint (g_strv_length (entry->drivers), ==, 0);
+    g_assert_cmpuint (entry->product_ids->len, ==, 1);
+    g_assert_cmpuint (g_array_index (entry->product_ids, MMPluginManifestProductId, 0).vid, ==, 0x0000);
+    g_assert_cmpuint (g_array_index (entry->product_ids, MMPluginManifestProductId, 0).pid, ==, 0xffff);
+
+    g_ptr_array_unref (entries);
+    g_unlink (path);
+    g_free (path);
+}
+
+static void
+common_test_discarded (const gchar *contents)
+{
+    gchar *path;
+
+    path = test_build_tmp_path ("test-plugin-manifest-XXXXXX");
+    g_assert (g_file_set_contents (path, contents, -1, NULL));
+    g_assert (!mm_plugin_manifest_load (path, NULL));
+    g_unlink (path);
+    g_free (path);
+}
+
+static void
+test_discarded (void)
+{
+    gchar *path;
+
+    /* Missing file */
+    path = test_build_tmp_path ("test-plugin-manifest-XXXXXX");
+    g_assert (!mm_plugin_manifest_load (path, NULL));
+    g_free (path);
+
+    /* Other version */
+    common_test_discarded ("[plugin-manifest]\n"
+                           "version=0.0.1\n"
+                           "\n"
+                           "[plugin libmm-plugin-sierra.so]\n"
+                           "mtime=1\n"
+                           "size=2\n"
+                           "name=sierra\n"
+                           "generic=false\n");
+
+    /* Missing mandatory key */
+    common_test_discarded ("[plugin-manifest]\n"
+                           "version=" PACKAGE_VERSION "\n"
+                           "\n"
+                           "[plugin libmm-plugin-sierra.so]\n"
+                           "mtime=1\n"
+                           "name=sierra\n"
+                           "generic=false\n");
+
+    /* Invalid vendor and product ids */
+    common_test_discarded ("[plugin-manifest]\n"
+                           "version=" PACKAGE_VERSION "\n"
+                           "\n"
+                           "[plugin libmm-plugin-sierra.so]\n"
+                           "mtime=1\n"
+                           "size=2\n"
+                           "name=sierra\n"
+                           "generic=false\n"
+                           "vendor-ids=11990;\n");
+    common_test_discarded ("[plugin-manifest]\n"
+                           "version=" PACKAGE_VERSION "\n"
+                           "\n"
+                           "[plugin libmm-plugin-sierra.so]\n"
+                           "mtime=1\n"
+                           "size=2\n"
+                           "name=sierra\n"
+                           "generic=false\n"
+                           "product-ids=1199;\n");
+}
+
+static void
+test_matches (void)
+{
+    GPtrArray             *entries;
+    MMPluginManifestEntry *entry;
+    g_autofree gchar      *dir = NULL;
+    g_autofree gchar      *path_a = NULL;
+    g_autofree gchar      *path_b = NULL;
+    const gchar           *both[] = { "libmm-plugin-b.so", "libmm-plugin-a.so", NULL };
+    const gchar           *one[] = { "libmm-plugin-a.so", NULL };
+    const gchar           *other[] = { "libmm-plugin-a.so", "libmm-plugin-c.so", NULL };
+
+    dir = g_dir_make_tmp ("test-plugin-manifest-XXXXXX", NULL);
+    g_assert (dir);
+    path_a = g_build_filename (dir, "libmm-plugin-a.so", NULL);
+    path_b = g_build_filename (dir, "libmm-plugin-b.so", NULL);
+    g_assert (g_file_set_contents (path_a, "a", -1, NULL));
+    g_assert (g_file_set_contents (path_b, "bb", -1, NULL));
+
+    entries = g_ptr_array_new_with_free_func ((GDestroyNotify) mm_plugin_manifest_entry_free);
+    entry = mm_plugin_manifest_entry_new ("libmm-plugin-a.so");
+    g_assert (mm_plugin_manifest_entry_stat (entry, dir, NULL));
+    g_assert_cmpuint (entry->size, ==, 1);
+    g_ptr_array_add (entries, entry);
+    entry = mm_plugin_manifest_entry_new ("libmm-plugin-b.so");
+    g_assert (mm_plugin_manifest_entry_stat (entry, dir, NULL));
+    g_assert_cmpuint (entry->size, ==, 2);
+    g_ptr_array_add (entries, entry);
+
+    /* Order doesn't matter, the set of files does */
+    g_assert (mm_plugin_manifest_matches (entries, dir, both, NULL));
+    g_assert (!mm_plugin_manifest_matches (entries, dir, one, NULL));
+    g_assert (!mm_plugin_manifest_matches (entries, dir, other, NULL));
+
+    /* Updated plugin */
+    g_assert (g_file_set_contents (path_b, "bbb", -1, NULL));
+    g_assert (!mm_plugin_manifest_matches (entries, dir, both, NULL));
+
+    /* Removed plugin */
+    g_unlink (path_b);
+    g_assert (!mm_plugin_manifest_matches (entries, dir, both, NULL));
+    entry = mm_plugin_manifest_entry_new ("libmm-plugin-b.so");
+    g_assert (!mm_plugin_manifest_entry_stat (entry, dir, NULL));
+    mm_plugin_manifest_entry_free (entry);
+
+    g_ptr_array_unref (entries);
+    g_unlink (path_a);
+    g_rmdir (dir);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    setlocale (LC_ALL, "");
+
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/plugin-manifest/roundtrip", test_roundtrip);
+    g_test_add_func ("/MM/plugin-manifest/discarded", test_discarded);
+    g_test_add_func ("/MM/plugin-manifest/matches",   test_matches);
+
+    return g_test_run ();
+}
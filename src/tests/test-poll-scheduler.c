@@ -0,0 +1,282 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <locale.h>
+#include <string.h>
+
+#include "mm-poll-scheduler.h"
+#include "mm-log-test.h"
+
+/*****************************************************************************/
+
+typedef struct {
+    MMPollScheduler *scheduler;
+    gint64           now;
+    GString         *runs;
+    guint            n_batch_begin;
+    guint            n_batch_end;
+    gboolean         in_batch;
+    guint            remove_id;
+    gint64           refresh_until;
+} Fixture;
+
+typedef struct {
+    Fixture     *fixture;
+    const gchar *tag;
+    guint        n_left;
+} Poll;
+
+static gint64
+clock_cb (Fixture *fixture)
+{
+    return fixture->now;
+}
+
+static void
+fixture_init (Fixture *fixture)
+{
+    memset (fixture, 0, sizeof (Fixture));
+    /* Never at 0, which means 'never' for the scheduler */
+    fixture->now = G_USEC_PER_SEC;
+    fixture->scheduler = mm_poll_scheduler_new (1000, NULL);
+    mm_poll_scheduler_set_clock (fixture->scheduler, (MMPollSchedulerClockFunc) clock_cb, fixture);
+    fixture->runs = g_string_new (NULL);
+}
+
+static void
+fixture_clear (Fixture *fixture)
+{
+    mm_poll_scheduler_free (fixture->scheduler);
+    g_string_free (fixture->runs, TRUE);
+}
+
+/* Moves the clock forward in 1ms steps, running the polls due at each one;
+ * while refreshes are requested, "a" is refreshed every 5ms */
+static void
+advance (Fixture *fixture,
+         guint    ms)
+{
+    guint i;
+
+    for (i = 0; i < ms; i++) {
+        fixture->now += 1000;
+        if (fixture->now <= fixture->refresh_until && (fixture->now / 1000) % 5 == 0)
+            mm_poll_scheduler_refreshed (fixture->scheduler, "a");
+        mm_poll_scheduler_run_due (fixture->scheduler);
+    }
+}
+
+static gboolean
+poll_cb (Poll *poll)
+{
+    Fixture *fixture = poll->fixture;
+
+    g_string_append (fixture->runs, poll->tag);
+    if (fixture->in_batch)
+        g_string_append_c (fixture->runs, '*');
+
+    if (fixture->remove_id) {
+        mm_poll_scheduler_remove (fixture->scheduler, fixture->remove_id);
+        fixture->remove_id = 0;
+    }
+
+    if (--poll->n_left > 0)
+        return G_SOURCE_CONTINUE;
+    return G_SOURCE_REMOVE;
+}
+
+static void
+batch_cb (gboolean  begin,
+          Fixture  *fixture)
+{
+    g_assert (fixture->in_batch != begin);
+    fixture->in_batch = begin;
+    if (begin)
+        fixture->n_batch_begin++;
+    else
+        fixture->n_batch_end++;
+}
+
+/*****************************************************************************/
+
+static void
+test_repeat (void)
+{
+    Fixture fixture;
+    Poll    a;
+
+    fixture_init (&fixture);
+
+    a.fixture = &fixture;
+    a.tag = "a";
+    a.n_left = 3;
+    mm_poll_scheduler_add (fixture.scheduler, "a", 20, (MMPollSchedulerFunc) poll_cb, &a);
+
+    advance (&fixture, 19);
+    g_assert_cmpstr (fixture.runs->str, ==, "");
+    advance (&fixture, 1);
+    g_assert_cmpstr (fixture.runs->str, ==, "a");
+    advance (&fixture, 280);
+    g_assert_cmpstr (fixture.runs->str, ==, "aaa");
+    g_assert_cmpuint (mm_poll_scheduler_get_n_runs (fixture.scheduler, "a"), ==, 3);
+    g_assert_cmpuint (mm_poll_scheduler_get_n_batched (fixture.scheduler, "a"), ==, 0);
+    g_assert_cmpuint (mm_poll_scheduler_get_n_wakeups (fixture.scheduler), ==, 3);
+
+    fixture_clear (&fixture);
+}
+
+static void
+test_align (void)
+{
+    Fixture fixture;
+    Poll    a;
+    Poll    b;
+    Poll    c;
+
+    fixture_init (&fixture);
+    mm_poll_scheduler_set_batch_func (fixture.scheduler, (MMPollSchedulerBatchFunc) batch_cb, &fixture);
+
+    a.fixture = b.fixture = c.fixture = &fixture;
+    a.tag = "a";
+    b.tag = "b";
+    c.tag = "c";
+    a.n_left = b.n_left = c.n_left = 1;
+
+    /* b is close enough to a to run along with it, c is not */
+    mm_poll_scheduler_add (fixture.scheduler, "a", 100, (MMPollSchedulerFunc) poll_cb, &a);
+    mm_poll_scheduler_add (fixture.scheduler, "b", 110, (MMPollSchedulerFunc) poll_cb, &b);
+    mm_poll_scheduler_add (fixture.scheduler, "c", 200, (MMPollSchedulerFunc) poll_cb, &c);
+
+    advance (&fixture, 100);
+    g_assert (g_str_equal (fixture.runs->str, "a*b*") || g_str_equal (fixture.runs->str, "b*a*"));
+    advance (&fixture, 100);
+    g_assert (g_str_has_suffix (fixture.runs->str, "*c"));
+    g_assert_cmpuint (fixture.n_batch_begin, ==, 1);
+    g_assert_cmpuint (fixture.n_batch_end, ==, 1);
+    g_assert_cmpuint (mm_poll_scheduler_get_n_wakeups (fixture.scheduler), ==, 2);
+    g_assert_cmpuint (mm_poll_scheduler_get_n_batched (fixture.scheduler, "a"), ==, 1);
+    g_assert_cmpuint (mm_poll_scheduler_get_n_batched (fixture.scheduler, "c"), ==, 0);
+
+    fixture_clear (&fixture);
+}
+
+static void
+test_remove (void)
+{
+    Fixture fixture;
+    Poll    a;
+    Poll    b;
+    guint   id_a;
+    guint   id_b;
+
+    fixture_init (&fixture);
+
+    a.fixture = b.fixture = &fixture;
+    a.tag = "a";
+    b.tag = "b";
+    a.n_left = b.n_left = 1;
+
+    /* Both due together, whichever runs first removes the other one */
+    id_a = mm_poll_scheduler_add (fixture.scheduler, "a", 50, (MMPollSchedulerFunc) poll_cb, &a);
+    id_b = mm_poll_scheduler_add (fixture.scheduler, "b", 50, (MMPollSchedulerFunc) poll_cb, &b);
+    g_assert_cmpuint (id_a, !=, id_b);
+    fixture.remove_id = id_b;
+
+    advance (&fixture, 200);
+    g_assert (g_str_equal (fixture.runs->str, "a") || g_str_equal (fixture.runs->str, "b"));
+
+    /* Removing unknown polls, or from a scheduler already gone, is fine */
+    mm_poll_scheduler_remove (fixture.scheduler, id_a);
+    mm_poll_scheduler_remove (NULL, id_a);
+
+    fixture_clear (&fixture);
+}
+
+static void
+test_stats (void)
+{
+    Fixture           fixture;
+    Poll              a;
+    g_autofree gchar *stats = NULL;
+
+    fixture_init (&fixture);
+
+    a.fixture = &fixture;
+    a.tag = "a";
+    a.n_left = 1;
+    mm_poll_scheduler_add (fixture.scheduler, "signal", 10, (MMPollSchedulerFunc) poll_cb, &a);
+    advance (&fixture, 100);
+
+    mm_poll_scheduler_complete (fixture.scheduler, "signal");
+    /* Only once per run */
+    mm_poll_scheduler_complete (fixture.scheduler, "signal");
+    mm_poll_scheduler_complete (fixture.scheduler, "unknown");
+
+    stats = mm_poll_scheduler_build_stats (fixture.scheduler);
+    g_assert_cmpstr (stats, ==, "1 wakeups, 1 polls run, 0 skipped; signal: 1 runs, 0 skipped, 0 batched, avg 0.090s, max 0.090s");
+
+    fixture_clear (&fixture);
+}
+
+static void
+test_backoff (void)
+{
+    Fixture fixture;
+    Poll    a;
+
+    fixture_init (&fixture);
+
+    a.fixture = &fixture;
+    a.tag = "a";
+    a.n_left = 100;
+    mm_poll_scheduler_add (fixture.scheduler, "a", 20, (MMPollSchedulerFunc) poll_cb, &a);
+
+    /* Unknown polls, or a scheduler already gone, are ignored */
+    mm_poll_scheduler_refreshed (fixture.scheduler, "unknown");
+    mm_poll_scheduler_refreshed (NULL, "a");
+
+    /* Refreshed for the first 100ms, so skipped at 20ms, 60ms and 140ms, with
+     * the interval doubled each time, up to 8 times the base one */
+    fixture.refresh_until = fixture.now + 100 * 1000;
+    advance (&fixture, 299);
+    g_assert_cmpuint (mm_poll_scheduler_get_n_skipped (fixture.scheduler, "a"), ==, 3);
+    g_assert_cmpuint (mm_poll_scheduler_get_n_runs (fixture.scheduler, "a"), ==, 0);
+
+    /* Not refreshed since 100ms, so run at 300ms and then back to the base
+     * rate: 320ms, 340ms... 480ms */
+    advance (&fixture, 181);
+    g_assert_cmpuint (mm_poll_scheduler_get_n_skipped (fixture.scheduler, "a"), ==, 3);
+    g_assert_cmpuint (mm_poll_scheduler_get_n_runs (fixture.scheduler, "a"), ==, 10);
+    g_assert_cmpuint (mm_poll_scheduler_get_n_runs (fixture.scheduler, "a"), ==, strlen (fixture.runs->str));
+
+    fixture_clear (&fixture);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    setlocale (LC_ALL, "");
+
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/poll-scheduler/repeat", test_repeat);
+    g_test_add_func ("/MM/poll-scheduler/align",  test_align);
+    g_test_add_func ("/MM/poll-scheduler/remove", test_remove);
+    g_test_add_func ("/MM/poll-scheduler/stats",  test_stats);
+    g_test_add_func ("/MM/poll-scheduler/backoff", test_backoff);
+
+    return g_test_run ();
+}
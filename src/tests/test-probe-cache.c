@@ -0,0 +1,156 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <locale.h>
+
+#include "mm-probe-cache.h"
+#include "mm-log-test.h"
+#include "test-helpers.h"
+
+/*****************************************************************************/
+
+static void
+test_keys (void)
+{
+    gchar *key;
+
+    key = mm_probe_cache_build_device_key (0x1199, 0x9071, 0x0006);
+    g_assert_cmpstr (key, ==, "1199:9071:0006");
+    g_free (key);
+    g_assert (!mm_probe_cache_build_device_key (0, 0, 0x0100));
+
+    key = mm_probe_cache_build_port_key ("tty", "03", "qcserial");
+    g_assert_cmpstr (key, ==, "tty/03/qcserial");
+    g_free (key);
+    key = mm_probe_cache_build_port_key ("tty", "00", NULL);
+    g_assert_cmpstr (key, ==, "tty/00/none");
+    g_free (key);
+    g_assert (!mm_probe_cache_build_port_key ("tty", NULL, "option"));
+}
+
+static void
+test_roundtrip (void)
+{
+    MMProbeCache      *cache;
+    MMProbeCachePort   port = { 0 };
+    gchar             *path;
+    gchar             *plugin;
+    gchar            **ports;
+
+    path = test_build_tmp_path ("test-probe-cache-XXXXXX");
+
+    cache = mm_probe_cache_new (path, NULL);
+    g_assert (!mm_probe_cache_get_plugin (cache, "1199:9071:0006"));
+
+    mm_probe_cache_set_device (cache, "1199:9071:0006", "sierra");
+    port.probed = 0x7;
+    port.is_at = TRUE;
+    port.vendor = (gchar *) "sierra wireless";
+    mm_probe_cache_set_port (cache, "1199:9071:0006", "tty/03/qcserial", &port);
+    port.probed = 0x40;
+    port.is_at = FALSE;
+    port.is_qmi = TRUE;
+    port.vendor = NULL;
+    mm_probe_cache_set_port (cache, "1199:9071:0006", "usbmisc/08/qmi_wwan", &port);
+    mm_probe_cache_set_port (cache, "1199:9071:0006", "net/08/qmi_wwan", &(MMProbeCachePort) { 0 });
+    g_assert (mm_probe_cache_save (cache, NULL));
+    mm_probe_cache_free (cache);
+
+    /* Reload from disk */
+    cache = mm_probe_cache_new (path, NULL);
+    plugin = mm_probe_cache_get_plugin (cache, "1199:9071:0006");
+    g_assert_cmpstr (plugin, ==, "sierra");
+    g_free (plugin);
+
+    ports = mm_probe_cache_get_ports (cache, "1199:9071:0006");
+    g_assert_cmpuint (g_strv_length (ports), ==, 3);
+    g_assert_cmpstr (ports[0], ==, "tty/03/qcserial");
+    g_assert_cmpstr (ports[1], ==, "usbmisc/08/qmi_wwan");
+    g_assert_cmpstr (ports[2], ==, "net/08/qmi_wwan");
+    g_strfreev (ports);
+
+    g_assert (mm_probe_cache_get_port (cache, "1199:9071:0006", "tty/03/qcserial", &port));
+    g_assert_cmpuint (port.probed, ==, 0x7);
+    g_assert (port.is_at);
+    g_assert (!port.is_qmi);
+    g_assert_cmpstr (port.vendor, ==, "sierra wireless");
+    g_assert (!port.product);
+    mm_probe_cache_port_clear (&port);
+
+    g_assert (mm_probe_cache_get_port (cache, "1199:9071:0006", "usbmisc/08/qmi_wwan", &port));
+    g_assert_cmpuint (port.probed, ==, 0x40);
+    g_assert (!port.is_at);
+    g_assert (port.is_qmi);
+    g_assert (!port.vendor);
+    mm_probe_cache_port_clear (&port);
+
+    g_assert (!mm_probe_cache_get_port (cache, "1199:9071:0006", "tty/02/qcserial", &port));
+    g_assert (!mm_probe_cache_get_port (cache, "1199:9071:0007", "tty/03/qcserial", &port));
+
+    /* Setting the device again drops its previous ports */
+    mm_probe_cache_set_device (cache, "1199:9071:0006", "generic");
+    ports = mm_probe_cache_get_ports (cache, "1199:9071:0006");
+    g_assert_cmpuint (g_strv_length (ports), ==, 0);
+    g_strfreev (ports);
+    g_assert (!mm_probe_cache_get_port (cache, "1199:9071:0006", "tty/03/qcserial", &port));
+
+    g_assert (mm_probe_cache_remove_device (cache, "1199:9071:0006"));
+    g_assert (!mm_probe_cache_remove_device (cache, "1199:9071:0006"));
+    g_assert (!mm_probe_cache_get_plugin (cache, "1199:9071:0006"));
+
+    mm_probe_cache_free (cache);
+    g_unlink (path);
+    g_free (path);
+}
+
+static void
+test_other_version (void)
+{
+    MMProbeCache *cache;
+    gchar        *path;
+
+    path = test_build_tmp_path ("test-probe-cache-XXXXXX");
+    g_assert (g_file_set_contents (path,
+                                   "[probe-cache]\n"
+                                   "version=0.0.1\n"
+                                   "\n"
+                                   "[device 1199:9071:0006]\n"
+                                   "plugin=sierra\n"
+                                   "ports=tty/03/qcserial;\n",
+                                   -1, NULL));
+
+    cache = mm_probe_cache_new (path, NULL);
+    g_assert (!mm_probe_cache_get_plugin (cache, "1199:9071:0006"));
+    mm_probe_cache_free (cache);
+
+    g_unlink (path);
+    g_free (path);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    setlocale (LC_ALL, "");
+
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/probe-cache/keys",          test_keys);
+    g_test_add_func ("/MM/probe-cache/roundtrip",     test_roundtrip);
+    g_test_add_func ("/MM/probe-cache/other-version", test_other_version);
+
+    return g_test_run ();
+}
@@ -0,0 +1,255 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <locale.h>
+
+#include "mm-property-cache.h"
+#include "mm-log-test.h"
+#include "test-helpers.h"
+
+/*****************************************************************************/
+
+static void
+test_keys (void)
+{
+    gchar *key;
+
+    key = mm_property_cache_build_unit_key ("359072060000000", "SWI9X15C_05.05.58.00 r27038 carmd-fwbuild1 2015/03/04 21:30:23");
+    g_assert_cmpstr (key, ==, "359072060000000/SWI9X15C_05.05.58.00%20r27038%20carmd-fwbuild1%202015%2F03%2F04%2021%3A30%3A23");
+    g_free (key);
+    key = mm_property_cache_build_unit_key ("[abc]", "1");
+    g_assert_cmpstr (key, ==, "%5Babc%5D/1");
+    g_free (key);
+
+    g_assert (!mm_property_cache_build_unit_key (NULL, "1.0"));
+    g_assert (!mm_property_cache_build_unit_key ("359072060000000", ""));
+}
+
+static void
+test_roundtrip (void)
+{
+    MMPropertyCache  *cache;
+    GVariant         *value;
+    gchar            *path;
+    g_autofree gchar *unit = NULL;
+
+    path = test_build_tmp_path ("test-property-cache-XXXXXX");
+    unit = mm_property_cache_build_unit_key ("359072060000000", "1.0 beta");
+
+    cache = mm_property_cache_new (path, NULL);
+    g_assert (!mm_property_cache_has_unit (cache, unit));
+    g_assert (!mm_property_cache_get (cache, unit, "Model", G_VARIANT_TYPE_STRING));
+
+    mm_property_cache_set_unit (cache, unit);
+    mm_property_cache_set (cache, unit, "Model", g_variant_new_string ("MC7710 \"quoted\""));
+    mm_property_cache_set (cache, unit, "SupportedIpFamilies", g_variant_new_uint32 (7));
+    mm_property_cache_set (cache, unit, "SupportedModes",
+                           g_variant_new_parsed ("[(@u 14, @u 8), (@u 14, @u 0)]"));
+    g_assert (mm_property_cache_save (cache, NULL));
+    mm_property_cache_free (cache);
+
+    /* Reload from disk */
+    cache = mm_property_cache_new (path, NULL);
+    g_assert (mm_property_cache_has_unit (cache, unit));
+
+    value = mm_property_cache_get (cache, unit, "Model", G_VARIANT_TYPE_STRING);
+    g_assert (value);
+    g_assert_cmpstr (g_variant_get_string (value, NULL), ==, "MC7710 \"quoted\"");
+    g_variant_unref (value);
+
+    value = mm_property_cache_get (cache, unit, "SupportedIpFamilies", G_VARIANT_TYPE_UINT32);
+    g_assert (value);
+    g_assert_cmpuint (g_variant_get_uint32 (value), ==, 7);
+    g_variant_unref (value);
+
+    value = mm_property_cache_get (cache, unit, "SupportedModes", G_VARIANT_TYPE ("a(uu)"));
+    g_assert (value);
+    g_assert_cmpuint (g_variant_n_children (value), ==, 2);
+    g_variant_unref (value);
+
+    /* Type mismatch */
+    g_assert (!mm_property_cache_get (cache, unit, "SupportedIpFamilies", G_VARIANT_TYPE_STRING));
+    /* Missing */
+    g_assert (!mm_property_cache_get (cache, unit, "Manufacturer", G_VARIANT_TYPE_STRING));
+
+    g_assert (mm_property_cache_remove_unit (cache, unit));
+    g_assert (!mm_property_cache_remove_unit (cache, unit));
+    g_assert (!mm_property_cache_has_unit (cache, unit));
+
+    mm_property_cache_free (cache);
+    g_unlink (path);
+    g_free (path);
+}
+
+static void
+test_firmware_change (void)
+{
+    MMPropertyCache  *cache;
+    gchar            *path;
+    g_autofree gchar *old_unit = NULL;
+    g_autofree gchar *new_unit = NULL;
+    g_autofree gchar *other_unit = NULL;
+
+    path = test_build_tmp_path ("test-property-cache-XXXXXX");
+    old_unit = mm_property_cache_build_unit_key ("359072060000000", "1.0");
+    new_unit = mm_property_cache_build_unit_key ("359072060000000", "2.0");
+    other_unit = mm_property_cache_build_unit_key ("359072060000001", "1.0");
+
+    cache = mm_property_cache_new (path, NULL);
+    mm_property_cache_set_unit (cache, old_unit);
+    mm_property_cache_set (cache, old_unit, "Model", g_variant_new_string ("old"));
+    mm_property_cache_set_unit (cache, other_unit);
+
+    /* Setting the entry for the new firmware drops the old one */
+    mm_property_cache_set_unit (cache, new_unit);
+    g_assert (!mm_property_cache_has_unit (cache, old_unit));
+    g_assert (mm_property_cache_has_unit (cache, new_unit));
+    g_assert (mm_property_cache_has_unit (cache, other_unit));
+    g_assert (!mm_property_cache_get (cache, new_unit, "Model", G_VARIANT_TYPE_STRING));
+
+    mm_property_cache_free (cache);
+    g_free (path);
+}
+
+static void
+test_other_version (void)
+{
+    MMPropertyCache *cache;
+    gchar           *path;
+
+    path = test_build_tmp_path ("test-property-cache-XXXXXX");
+    g_assert (g_file_set_contents (path,
+                                   "[property-cache]\n"
+                                   "version=0.0.1\n"
+                                   "\n"
+                                   "[unit 359072060000000/1.0]\n"
+                                   "equipment-id=359072060000000\n"
+                                   "Model='MC7710'\n",
+                                   -1, NULL));
+
+    cache = mm_property_cache_new (path, NULL);
+    g_assert (!mm_property_cache_has_unit (cache, "359072060000000/1.0"));
+    mm_property_cache_free (cache);
+
+    g_unlink (path);
+    g_free (path);
+}
+
+/*****************************************************************************/
+/* Overridden loaders */
+
+typedef struct {
+    GTypeInterface g_iface;
+    void (* load_a) (void);
+    void (* load_b) (void);
+} TestIfaceInterface;
+
+static GType test_iface_get_type (void);
+G_DEFINE_INTERFACE (TestIface, test_iface, G_TYPE_OBJECT)
+
+static void
+test_iface_default_init (TestIfaceInterface *iface)
+{
+}
+
+static void base_load_a  (void) {}
+static void base_load_b  (void) {}
+static void child_load_b (void) {}
+
+typedef GObject      TestBase;
+typedef GObjectClass TestBaseClass;
+typedef GObject      TestChild;
+typedef GObjectClass TestChildClass;
+typedef GObject      TestGrandchild;
+typedef GObjectClass TestGrandchildClass;
+
+static void
+test_base_iface_init (TestIfaceInterface *iface)
+{
+    iface->load_a = base_load_a;
+    iface->load_b = base_load_b;
+}
+
+static void
+test_child_iface_init (TestIfaceInterface *iface)
+{
+    iface->load_b = child_load_b;
+}
+
+static GType test_base_get_type (void);
+G_DEFINE_TYPE_WITH_CODE (TestBase, test_base, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (test_iface_get_type (), test_base_iface_init))
+static void test_base_init       (TestBase       *self)  {}
+static void test_base_class_init (TestBaseClass  *klass) {}
+
+static GType test_child_get_type (void);
+G_DEFINE_TYPE_WITH_CODE (TestChild, test_child, test_base_get_type (),
+                         G_IMPLEMENT_INTERFACE (test_iface_get_type (), test_child_iface_init))
+static void test_child_init       (TestChild      *self)  {}
+static void test_child_class_init (TestChildClass *klass) {}
+
+static GType test_grandchild_get_type (void);
+G_DEFINE_TYPE (TestGrandchild, test_grandchild, test_child_get_type ())
+static void test_grandchild_init       (TestGrandchild      *self)  {}
+static void test_grandchild_class_init (TestGrandchildClass *klass) {}
+
+static void
+test_loaders (void)
+{
+    static const gsize offset_a[] = { G_STRUCT_OFFSET (TestIfaceInterface, load_a) };
+    static const gsize offset_b[] = { G_STRUCT_OFFSET (TestIfaceInterface, load_b) };
+    static const gsize offsets[]  = { G_STRUCT_OFFSET (TestIfaceInterface, load_a), G_STRUCT_OFFSET (TestIfaceInterface, load_b) };
+    GObject *base;
+    GObject *child;
+    GObject *grandchild;
+
+    base = g_object_new (test_base_get_type (), NULL);
+    child = g_object_new (test_child_get_type (), NULL);
+    grandchild = g_object_new (test_grandchild_get_type (), NULL);
+
+    g_assert (mm_property_cache_loaders_inherited (base, test_base_get_type (), test_iface_get_type (), offsets, G_N_ELEMENTS (offsets)));
+
+    /* Overriding a loader in a subclass, or in any of its parents */
+    g_assert (mm_property_cache_loaders_inherited (child, test_base_get_type (), test_iface_get_type (), offset_a, G_N_ELEMENTS (offset_a)));
+    g_assert (!mm_property_cache_loaders_inherited (child, test_base_get_type (), test_iface_get_type (), offset_b, G_N_ELEMENTS (offset_b)));
+    g_assert (!mm_property_cache_loaders_inherited (child, test_base_get_type (), test_iface_get_type (), offsets, G_N_ELEMENTS (offsets)));
+    g_assert (mm_property_cache_loaders_inherited (grandchild, test_base_get_type (), test_iface_get_type (), offset_a, G_N_ELEMENTS (offset_a)));
+    g_assert (!mm_property_cache_loaders_inherited (grandchild, test_base_get_type (), test_iface_get_type (), offsets, G_N_ELEMENTS (offsets)));
+
+    /* Nothing overridden with respect to its own parent */
+    g_assert (mm_property_cache_loaders_inherited (grandchild, test_child_get_type (), test_iface_get_type (), offsets, G_N_ELEMENTS (offsets)));
+
+    g_object_unref (base);
+    g_object_unref (child);
+    g_object_unref (grandchild);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    setlocale (LC_ALL, "");
+
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/property-cache/keys",            test_keys);
+    g_test_add_func ("/MM/property-cache/roundtrip",       test_roundtrip);
+    g_test_add_func ("/MM/property-cache/firmware-change", test_firmware_change);
+    g_test_add_func ("/MM/property-cache/other-version",   test_other_version);
+    g_test_add_func ("/MM/property-cache/loaders",         test_loaders);
+
+    return g_test_run ();
+}
@@ -0,0 +1,159 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <locale.h>
+#include <string.h>
+
+#include "mm-trace.h"
+#include "mm-log-test.h"
+
+/*****************************************************************************/
+
+static guint
+count_occurrences (const gchar *str,
+                   const gchar *needle)
+{
+    const gchar *p;
+    guint        n = 0;
+
+    for (p = strstr (str, needle); p; p = strstr (p + 1, needle))
+        n++;
+    return n;
+}
+
+static void
+test_disabled (void)
+{
+    MMTraceSpan       span;
+    g_autofree gchar *json = NULL;
+
+    mm_trace_setup (0);
+    g_assert (!mm_trace_enabled ());
+
+    span = mm_trace_begin (NULL, "at", "AT+CGMI");
+    g_assert_cmpuint (span, ==, 0);
+    mm_trace_set_port (span, "ttyUSB2");
+    mm_trace_end (span);
+
+    span = 0;
+    mm_trace_step (&span, NULL, "init", 1);
+    g_assert_cmpuint (span, ==, 0);
+
+    json = mm_trace_build_chrome_json ();
+    g_assert (g_str_has_prefix (json, "{\"traceEvents\":[{\"name\":\"thread_name\""));
+    g_assert_cmpuint (count_occurrences (json, "\"ph\":\"X\""), ==, 0);
+}
+
+static void
+test_span (void)
+{
+    MMTraceSpan       span;
+    g_autofree gchar *json = NULL;
+
+    mm_trace_setup (8);
+    g_assert (mm_trace_enabled ());
+
+    span = mm_trace_begin (NULL, "at", "AT+CGMI");
+    g_assert_cmpuint (span, !=, 0);
+    mm_trace_set_port (span, "ttyUSB2");
+    mm_trace_set_command (span, "AT+CGMI\r\"quoted\"");
+    mm_trace_end (span);
+
+    /* Left open */
+    mm_trace_begin (NULL, "at", "AT+CGMM");
+
+    json = mm_trace_build_chrome_json ();
+    g_assert (strstr (json, "{\"name\":\"AT+CGMI\",\"cat\":\"at\",\"ph\":\"X\",\"ts\":"));
+    g_assert (strstr (json, "\"args\":{\"port\":\"ttyUSB2\",\"command\":\"AT+CGMI\\r\\\"quoted\\\"\"}}"));
+    g_assert (strstr (json, "{\"name\":\"AT+CGMM\",\"cat\":\"at\",\"ph\":\"B\",\"ts\":"));
+    g_assert (g_str_has_suffix (json, "],\"displayTimeUnit\":\"ms\"}"));
+
+    mm_trace_setup (0);
+}
+
+static void
+test_ring (void)
+{
+    MMTraceSpan       first;
+    MMTraceSpan       span;
+    g_autofree gchar *json = NULL;
+
+    mm_trace_setup (2);
+
+    first = mm_trace_begin (NULL, "at", "first");
+    span = mm_trace_begin (NULL, "at", "second");
+    mm_trace_end (span);
+    span = mm_trace_begin (NULL, "at", "third");
+    mm_trace_end (span);
+
+    /* Already overwritten, must be ignored */
+    mm_trace_set_port (first, "ttyUSB0");
+    mm_trace_end (first);
+
+    json = mm_trace_build_chrome_json ();
+    g_assert (!strstr (json, "\"first\""));
+    g_assert (!strstr (json, "ttyUSB0"));
+    g_assert (strstr (json, "\"second\""));
+    g_assert (strstr (json, "\"third\""));
+    g_assert_cmpuint (count_occurrences (json, "\"ph\":\"X\""), ==, 2);
+
+    mm_trace_setup (0);
+}
+
+static void
+test_step (void)
+{
+    MMTraceSpan       span = 0;
+    MMTraceSpan       previous;
+    g_autofree gchar *json = NULL;
+
+    mm_trace_setup (8);
+
+    mm_trace_step (&span, NULL, "enable", 1);
+    previous = span;
+    g_assert_cmpuint (span, !=, 0);
+
+    /* Same step again, e.g. when retried */
+    mm_trace_step (&span, NULL, "enable", 1);
+    g_assert_cmpuint (span, ==, previous);
+
+    mm_trace_step (&span, NULL, "enable", 2);
+    g_assert_cmpuint (span, !=, previous);
+    mm_trace_clear (&span);
+    g_assert_cmpuint (span, ==, 0);
+
+    json = mm_trace_build_chrome_json ();
+    g_assert_cmpuint (count_occurrences (json, "\"name\":\"enable step 1\",\"cat\":\"enable\",\"ph\":\"X\""), ==, 1);
+    g_assert_cmpuint (count_occurrences (json, "\"name\":\"enable step 2\",\"cat\":\"enable\",\"ph\":\"X\""), ==, 1);
+    g_assert_cmpuint (count_occurrences (json, "\"ph\":\"B\""), ==, 0);
+
+    mm_trace_setup (0);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    setlocale (LC_ALL, "");
+
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/trace/disabled", test_disabled);
+    g_test_add_func ("/MM/trace/span",     test_span);
+    g_test_add_func ("/MM/trace/ring",     test_ring);
+    g_test_add_func ("/MM/trace/step",     test_step);
+
+    return g_test_run ();
+}
@@ -15,9 +15,11 @@
 
 #include <glib.h>
 #include <glib-object.h>
+#include <glib/gstdio.h>
 #include <string.h>
 #include <stdio.h>
 #include <locale.h>
+#include <unistd.h>
 
 #define _LIBMM_INSIDE_MM
 #include <libmm-glib.h>
@@ -30,15 +32,297 @@
 static void
 test_load_cleanup_core (void)
 {
-    GArray *rules;
-    GError *error = NULL;
+    MMUdevRules *rules;
+    GError      *error = NULL;
 
     rules = mm_kernel_device_generic_rules_load (TESTUDEVRULESDIR, &error);
     g_assert_no_error (error);
     g_assert (rules);
-    g_assert (rules->len > 0);
+    g_assert (mm_udev_rules_get_n_rules (rules) > 0);
 
-    g_array_unref (rules);
+    mm_udev_rules_unref (rules);
+}
+
+/************************************************************/
+/* Full set of rules, as installed: core ones and the ones from all plugins */
+
+static void
+link_rule_files (const gchar *dir,
+                 const gchar *target_dir)
+{
+    GDir        *gdir;
+    const gchar *name;
+
+    gdir = g_dir_open (dir, 0, NULL);
+    g_assert (gdir);
+    while ((name = g_dir_read_name (gdir)) != NULL) {
+        g_autofree gchar *source = NULL;
+        g_autofree gchar *target = NULL;
+
+        if (!g_str_has_suffix (name, ".rules"))
+            continue;
+        source = g_build_filename (dir, name, NULL);
+        target = g_build_filename (target_dir, name, NULL);
+        g_assert_cmpint (symlink (source, target), ==, 0);
+    }
+    g_dir_close (gdir);
+}
+
+static void
+remove_dir (const gchar *path)
+{
+    GDir        *gdir;
+    const gchar *name;
+
+    gdir = g_dir_open (path, 0, NULL);
+    g_assert (gdir);
+    while ((name = g_dir_read_name (gdir)) != NULL) {
+        g_autofree gchar *file = NULL;
+
+        file = g_build_filename (path, name, NULL);
+        g_unlink (file);
+    }
+    g_dir_close (gdir);
+    g_rmdir (path);
+}
+
+static MMUdevRules *
+load_all_rules (void)
+{
+    MMUdevRules      *rules;
+    GError           *error = NULL;
+    GDir             *gdir;
+    const gchar      *name;
+    g_autofree gchar *tmpdir = NULL;
+
+    tmpdir = g_dir_make_tmp ("test-udev-rules-XXXXXX", &error);
+    g_assert_no_error (error);
+
+    link_rule_files (TESTUDEVRULESDIR, tmpdir);
+    gdir = g_dir_open (TESTPLUGINUDEVRULESDIR, 0, NULL);
+    g_assert (gdir);
+    while ((name = g_dir_read_name (gdir)) != NULL) {
+        g_autofree gchar *plugindir = NULL;
+
+        plugindir = g_build_filename (TESTPLUGINUDEVRULESDIR, name, NULL);
+        if (g_file_test (plugindir, G_FILE_TEST_IS_DIR))
+            link_rule_files (plugindir, tmpdir);
+    }
+    g_dir_close (gdir);
+
+    rules = mm_kernel_device_generic_rules_load (tmpdir, &error);
+    g_assert_no_error (error);
+    g_assert (rules);
+
+    remove_dir (tmpdir);
+    return rules;
+}
+
+/************************************************************/
+/* Indexed vs unindexed evaluation */
+
+typedef struct {
+    MMUdevRulesDevice  device;
+    gchar             *sysfs_path;
+} TestDevice;
+
+static void
+test_device_free (TestDevice *test_device)
+{
+    g_free (test_device->sysfs_path);
+    g_slice_free (TestDevice, test_device);
+}
+
+/* Builds a device matching the vendor-specific conditions of the given rule,
+ * so that every vendor index gets exercised */
+static TestDevice *
+test_device_new_for_rule (const MMUdevRule *rule)
+{
+    TestDevice *test_device;
+    guint       i;
+
+    test_device = g_slice_new0 (TestDevice);
+    test_device->device.name = "ttyUSB0";
+    test_device->device.driver = "option";
+
+    for (i = 0; rule->conditions && i < rule->conditions->len; i++) {
+        const MMUdevRuleMatch *match;
+
+        match = &g_array_index (rule->conditions, MMUdevRuleMatch, i);
+        if (match->type != MM_UDEV_RULE_MATCH_TYPE_EQUAL)
+            continue;
+        switch (match->parameter_id) {
+        case MM_UDEV_RULE_PARAMETER_DRIVER:
+            test_device->device.driver = match->value;
+            break;
+        case MM_UDEV_RULE_PARAMETER_ATTR_ID_VENDOR:
+            test_device->device.physdev_vid = match->value_uint;
+            break;
+        case MM_UDEV_RULE_PARAMETER_ATTR_ID_PRODUCT:
+            test_device->device.physdev_pid = match->value_uint;
+            break;
+        case MM_UDEV_RULE_PARAMETER_ATTR_MANUFACTURER:
+            test_device->device.physdev_manufacturer = match->value;
+            break;
+        case MM_UDEV_RULE_PARAMETER_ATTR_PRODUCT:
+            test_device->device.physdev_product = match->value;
+            break;
+        case MM_UDEV_RULE_PARAMETER_ATTR_INTERFACE_NUMBER:
+            test_device->device.interface_number = match->value_uint;
+            break;
+        default:
+            break;
+        }
+    }
+
+    test_device->sysfs_path = g_strdup_printf ("/sys/devices/pci0000:00/0000:00:14.0/usb1/1-1/1-1:1.%u/%s/tty/%s",
+                                               test_device->device.interface_number,
+                                               test_device->device.name,
+                                               test_device->device.name);
+    test_device->device.sysfs_path = test_device->sysfs_path;
+    return test_device;
+}
+
+static GPtrArray *
+build_test_devices (MMUdevRules *rules)
+{
+    GPtrArray  *test_devices;
+    guint       i;
+
+    test_devices = g_ptr_array_new_with_free_func ((GDestroyNotify) test_device_free);
+    for (i = 0; i < mm_udev_rules_get_n_rules (rules); i++) {
+        const MMUdevRule *rule;
+
+        rule = mm_udev_rules_get_rule (rules, i);
+        if (rule->result.type == MM_UDEV_RULE_RESULT_TYPE_PROPERTY)
+            g_ptr_array_add (test_devices, test_device_new_for_rule (rule));
+    }
+    /* And one without any vendor-specific rule */
+    g_ptr_array_add (test_devices, test_device_new_for_rule (&(MMUdevRule) { 0 }));
+    return test_devices;
+}
+
+static GPtrArray *
+build_property_names (MMUdevRules *rules)
+{
+    GPtrArray  *names;
+    GHashTable *seen;
+    guint       i;
+
+    names = g_ptr_array_new ();
+    seen = g_hash_table_new (g_str_hash, g_str_equal);
+    for (i = 0; i < mm_udev_rules_get_n_rules (rules); i++) {
+        const MMUdevRule *rule;
+
+        rule = mm_udev_rules_get_rule (rules, i);
+        if (rule->result.type == MM_UDEV_RULE_RESULT_TYPE_PROPERTY &&
+            g_hash_table_add (seen, rule->result.content.property.name))
+            g_ptr_array_add (names, rule->result.content.property.name);
+    }
+    g_hash_table_unref (seen);
+    return names;
+}
+
+static void
+test_index (void)
+{
+    MMUdevRules *rules;
+    GPtrArray   *test_devices;
+    GPtrArray   *names;
+    guint        n_indexed = 0;
+    guint        n_unindexed = 0;
+    guint        i;
+
+    rules = load_all_rules ();
+    test_devices = build_test_devices (rules);
+    names = build_property_names (rules);
+
+    for (i = 0; i < test_devices->len; i++) {
+        TestDevice *test_device;
+        GObject    *indexed;
+        GObject    *unindexed;
+        guint       j;
+
+        test_device = g_ptr_array_index (test_devices, i);
+
+        indexed = g_object_new (G_TYPE_OBJECT, NULL);
+        test_device->device.object = indexed;
+        n_indexed += mm_udev_rules_apply (rules, &test_device->device);
+
+        unindexed = g_object_new (G_TYPE_OBJECT, NULL);
+        test_device->device.object = unindexed;
+        n_unindexed += mm_udev_rules_apply_unindexed (rules, &test_device->device);
+
+        for (j = 0; j < names->len; j++) {
+            const gchar *name;
+
+            name = g_ptr_array_index (names, j);
+            g_assert_cmpstr (g_object_get_data (indexed, name), ==, g_object_get_data (unindexed, name));
+        }
+
+        g_object_unref (indexed);
+        g_object_unref (unindexed);
+    }
+
+    g_test_message ("%u rules, %u devices: %u rules evaluated with index, %u without",
+                    mm_udev_rules_get_n_rules (rules), test_devices->len, n_indexed, n_unindexed);
+    g_assert_cmpuint (n_indexed, <, n_unindexed);
+
+    g_ptr_array_unref (names);
+    g_ptr_array_unref (test_devices);
+    mm_udev_rules_unref (rules);
+}
+
+#define BENCHMARK_ROUNDS 20
+
+static void
+test_benchmark (void)
+{
+    MMUdevRules *rules;
+    GPtrArray   *test_devices;
+    GObject     *object;
+    guint        round;
+    guint        i;
+    gdouble      elapsed_indexed;
+    gdouble      elapsed_unindexed;
+
+    rules = load_all_rules ();
+    test_devices = build_test_devices (rules);
+    object = g_object_new (G_TYPE_OBJECT, NULL);
+
+    g_test_timer_start ();
+    for (round = 0; round < BENCHMARK_ROUNDS; round++) {
+        for (i = 0; i < test_devices->len; i++) {
+            TestDevice *test_device;
+
+            test_device = g_ptr_array_index (test_devices, i);
+            test_device->device.object = object;
+            mm_udev_rules_apply (rules, &test_device->device);
+        }
+    }
+    elapsed_indexed = g_test_timer_elapsed ();
+
+    g_test_timer_start ();
+    for (round = 0; round < BENCHMARK_ROUNDS; round++) {
+        for (i = 0; i < test_devices->len; i++) {
+            TestDevice *test_device;
+
+            test_device = g_ptr_array_index (test_devices, i);
+            test_device->device.object = object;
+            mm_udev_rules_apply_unindexed (rules, &test_device->device);
+        }
+    }
+    elapsed_unindexed = g_test_timer_elapsed ();
+
+    g_test_minimized_result (elapsed_indexed * G_USEC_PER_SEC / (BENCHMARK_ROUNDS * test_devices->len),
+                             "indexed: %.2f us per port",
+                             elapsed_indexed * G_USEC_PER_SEC / (BENCHMARK_ROUNDS * test_devices->len));
+    g_test_message ("unindexed: %.2f us per port",
+                    elapsed_unindexed * G_USEC_PER_SEC / (BENCHMARK_ROUNDS * test_devices->len));
+
+    g_object_unref (object);
+    g_ptr_array_unref (test_devices);
+    mm_udev_rules_unref (rules);
 }
 
 /************************************************************/
@@ -50,6 +334,9 @@ int main (int argc, char **argv)
     g_test_init (&argc, &argv, NULL);
 
     g_test_add_func ("/MM/test-udev-rules/load-cleanup-core", test_load_cleanup_core);
+    g_test_add_func ("/MM/test-udev-rules/index",             test_index);
+    if (g_test_perf ())
+        g_test_add_func ("/MM/test-udev-rules/benchmark",     test_benchmark);
 
     return g_test_run ();
 }
@@ -0,0 +1,250 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <locale.h>
+#include <string.h>
+#include <errno.h>
+
+#include <glib.h>
+
+#include "mm-log-binary.h"
+
+#define PROGRAM_NAME    "mmlogdecode"
+#define PROGRAM_VERSION PACKAGE_VERSION
+
+/* Context */
+static gboolean  relative_flag;
+static gboolean  version_flag;
+
+static GOptionEntry main_entries[] = {
+    { "relative-timestamps", 'r', 0, G_OPTION_ARG_NONE, &relative_flag,
+      "Show timestamps relative to the start of each log session",
+      NULL
+    },
+    { "version", 'V', 0, G_OPTION_ARG_NONE, &version_flag,
+      "Print version",
+      NULL
+    },
+    { NULL }
+};
+
+typedef struct {
+    gboolean    started;
+    GHashTable *strings;
+    gint64      wall_time;
+    gint64      monotonic_time;
+} DecodeContext;
+
+static const gchar *
+level_description (guint level)
+{
+    switch (level) {
+    case MM_LOG_LEVEL_DEBUG:
+        return "<debug>";
+    case MM_LOG_LEVEL_WARN:
+        return "<warn> ";
+    case MM_LOG_LEVEL_INFO:
+        return "<info> ";
+    case MM_LOG_LEVEL_ERR:
+        return "<error>";
+    default:
+        return "<?>    ";
+    }
+}
+
+static gboolean
+decode_header (DecodeContext *ctx,
+               const guint8  *payload,
+               gsize          len)
+{
+    MMLogBinaryHeader header;
+
+    if (len < sizeof (header))
+        return FALSE;
+    memcpy (&header, payload, sizeof (header));
+    if (memcmp (header.magic, MM_LOG_BINARY_MAGIC, sizeof (header.magic)) != 0)
+        return FALSE;
+    if (header.byte_order != MM_LOG_BINARY_BYTE_ORDER) {
+        g_printerr ("error: log written by a host with a different byte order\n");
+        exit (EXIT_FAILURE);
+    }
+
+    /* New session, string ids start over */
+    g_hash_table_remove_all (ctx->strings);
+    ctx->wall_time = header.wall_time;
+    ctx->monotonic_time = header.monotonic_time;
+    ctx->started = TRUE;
+    return TRUE;
+}
+
+static gboolean
+decode_string (DecodeContext *ctx,
+               const guint8  *payload,
+               gsize          len)
+{
+    guint32 id;
+
+    if (len < sizeof (id))
+        return FALSE;
+    memcpy (&id, payload, sizeof (id));
+    g_hash_table_insert (ctx->strings,
+                         GUINT_TO_POINTER (id),
+                         g_strndup ((const gchar *) &payload[sizeof (id)], len - sizeof (id)));
+    return TRUE;
+}
+
+static gboolean
+decode_message (DecodeContext *ctx,
+                guint          level,
+                const guint8  *payload,
+                gsize          len,
+                GString       *line)
+{
+    MMLogBinaryMessage  message;
+    const gchar        *str;
+    gint64              time;
+
+    if (len < sizeof (message))
+        return FALSE;
+    memcpy (&message, payload, sizeof (message));
+    payload += sizeof (message);
+    len -= sizeof (message);
+
+    time = message.time - ctx->monotonic_time;
+    if (!relative_flag)
+        time += ctx->wall_time;
+    g_string_append_printf (line, "%s [%09" G_GINT64_FORMAT ".%06" G_GINT64_FORMAT "] ",
+                            level_description (level),
+                            time / G_USEC_PER_SEC,
+                            ABS (time % G_USEC_PER_SEC));
+
+    if (message.object_id && (str = g_hash_table_lookup (ctx->strings, GUINT_TO_POINTER (message.object_id))))
+        g_string_append_printf (line, "[%s] ", str);
+    if (message.module_id && (str = g_hash_table_lookup (ctx->strings, GUINT_TO_POINTER (message.module_id))))
+        g_string_append_printf (line, "(%s) ", str);
+
+    if (!message.format_id) {
+        g_string_append_len (line, (const gchar *) payload, len);
+        return TRUE;
+    }
+
+    str = g_hash_table_lookup (ctx->strings, GUINT_TO_POINTER (message.format_id));
+    if (!str || !mm_log_binary_format_args (line, str, payload, len))
+        g_string_append_printf (line, "<undecodable message with format id %u>", message.format_id);
+    return TRUE;
+}
+
+static void
+print_version_and_exit (void)
+{
+    g_print ("\n"
+             PROGRAM_NAME " " PROGRAM_VERSION "\n"
+             "License GPLv2+: GNU GPL version 2 or later <http://gnu.org/licenses/gpl-2.0.html>\n"
+             "This is free software: you are free to change and redistribute it.\n"
+             "There is NO WARRANTY, to the extent permitted by law.\n"
+             "\n");
+    exit (EXIT_SUCCESS);
+}
+
+int main (int argc, char **argv)
+{
+    GOptionContext *context;
+    DecodeContext   ctx = { 0 };
+    FILE           *file;
+    GString        *line;
+    guint8         *payload = NULL;
+    gsize           payload_size = 0;
+    gint            status = EXIT_SUCCESS;
+
+    setlocale (LC_ALL, "");
+
+    /* Setup option context, process it and destroy it */
+    context = g_option_context_new ("[FILE] - ModemManager binary log decoder");
+    g_option_context_add_main_entries (context, main_entries, NULL);
+    g_option_context_parse (context, &argc, &argv, NULL);
+    g_option_context_free (context);
+
+    if (version_flag)
+        print_version_and_exit ();
+
+    if (argc > 2) {
+        g_printerr ("error: too many arguments\n");
+        exit (EXIT_FAILURE);
+    }
+
+    if (argc < 2 || g_str_equal (argv[1], "-"))
+        file = stdin;
+    else if (!(file = fopen (argv[1], "rb"))) {
+        g_printerr ("error: couldn't open '%s': %s\n", argv[1], g_strerror (errno));
+        exit (EXIT_FAILURE);
+    }
+
+    ctx.strings = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+    line = g_string_sized_new (512);
+
+    while (TRUE) {
+        MMLogBinaryRecord record;
+        gsize             n;
+        gboolean          valid = TRUE;
+
+        n = fread (&record, 1, sizeof (record), file);
+        if (n == 0)
+            break;
+        if (n < sizeof (record)) {
+            g_printerr ("warning: truncated record at the end of the log\n");
+            break;
+        }
+
+        if (record.len > payload_size) {
+            payload_size = record.len;
+            payload = g_realloc (payload, payload_size);
+        }
+        if (fread (payload, 1, record.len, file) < record.len) {
+            g_printerr ("warning: truncated record at the end of the log\n");
+            break;
+        }
+
+        if (record.type == MM_LOG_BINARY_RECORD_HEADER)
+            valid = decode_header (&ctx, payload, record.len);
+        else if (!ctx.started) {
+            g_printerr ("error: not a binary ModemManager log\n");
+            status = EXIT_FAILURE;
+            break;
+        } else if (record.type == MM_LOG_BINARY_RECORD_STRING)
+            valid = decode_string (&ctx, payload, record.len);
+        else if (record.type == MM_LOG_BINARY_RECORD_MESSAGE) {
+            g_string_truncate (line, 0);
+            valid = decode_message (&ctx, record.level, payload, record.len, line);
+            if (valid)
+                g_print ("%s\n", line->str);
+        }
+        /* Unknown record types are skipped */
+
+        if (!valid) {
+            g_printerr ("error: malformed record of type %u\n", record.type);
+            status = EXIT_FAILURE;
+            break;
+        }
+    }
+
+    g_string_free (line, TRUE);
+    g_hash_table_unref (ctx.strings);
+    g_free (payload);
+    if (file != stdin)
+        fclose (file);
+    return status;
+}